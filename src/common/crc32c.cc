@@ -0,0 +1,226 @@
+#include "common/crc32c.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace pain::common {
+
+namespace {
+// reflected Castagnoli polynomial
+constexpr uint32_t kPoly = 0x82f63b78;
+
+constexpr std::array<std::array<uint32_t, 256>, 8> make_tables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ kPoly : crc >> 1;
+        }
+        tables[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        for (size_t k = 1; k < 8; k++) {
+            tables[k][n] = (tables[k - 1][n] >> 8) ^ tables[0][tables[k - 1][n] & 0xff];
+        }
+    }
+    return tables;
+}
+
+constexpr auto kTables = make_tables();
+
+// crc is the raw register, i.e. without inversion
+uint32_t crc32c_sw(uint32_t crc, const uint8_t* p, size_t size) {
+    while (size > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        crc = (crc >> 8) ^ kTables[0][(crc ^ *p++) & 0xff];
+        size--;
+    }
+    while (size >= 8) {
+        uint64_t word = 0;
+        memcpy(&word, p, sizeof(word));
+        word ^= crc;
+        crc = kTables[7][word & 0xff] ^ kTables[6][(word >> 8) & 0xff] ^ kTables[5][(word >> 16) & 0xff] ^
+              kTables[4][(word >> 24) & 0xff] ^ kTables[3][(word >> 32) & 0xff] ^ kTables[2][(word >> 40) & 0xff] ^
+              kTables[1][(word >> 48) & 0xff] ^ kTables[0][word >> 56];
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = (crc >> 8) ^ kTables[0][(crc ^ *p++) & 0xff];
+        size--;
+    }
+    return crc;
+}
+
+// a * b mod P, polynomials are bit reflected, x^0 is the highest bit
+uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1U << 31;
+    uint32_t p = 0;
+    while (m != 0) {
+        if ((a & m) != 0) {
+            p ^= b;
+        }
+        m >>= 1;
+        b = (b & 1) != 0 ? (b >> 1) ^ kPoly : b >> 1;
+    }
+    return p;
+}
+
+// x^n mod P
+uint32_t xpow(uint64_t n) {
+    uint32_t result = 1U << 31;
+    uint32_t base = 1U << 30;
+    while (n != 0) {
+        if ((n & 1) != 0) {
+            result = multmodp(result, base);
+        }
+        base = multmodp(base, base);
+        n >>= 1;
+    }
+    return result;
+}
+
+#if defined(__x86_64__)
+// the three streams are long enough to hide the latency of crc32, and the merge is cheap
+constexpr size_t kLongStride = 8192;
+constexpr size_t kShortStride = 256;
+
+// clmul(crc, x^(8n - 33)) folded by crc32 equals crc * x^(8n) mod P, which shifts the
+// register over n zero bytes
+const uint64_t kLongShift = xpow(8 * kLongStride - 33);
+const uint64_t kShortShift = xpow(8 * kShortStride - 33);
+
+__attribute__((target("sse4.2,pclmul"))) uint32_t shift(uint32_t crc, uint64_t k) {
+    auto product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                                        _mm_cvtsi64_si128(static_cast<int64_t>(k)),
+                                        0);
+    return static_cast<uint32_t>(_mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(product))));
+}
+
+template <size_t kStride>
+__attribute__((target("sse4.2,pclmul"))) uint32_t
+crc32c_interleaved(uint32_t crc, const uint8_t*& p, size_t& size, uint64_t k) {
+    while (size >= 3 * kStride) {
+        uint64_t crc0 = crc;
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        for (size_t i = 0; i < kStride; i += 8) {
+            uint64_t w0 = 0;
+            uint64_t w1 = 0;
+            uint64_t w2 = 0;
+            memcpy(&w0, p + i, 8);
+            memcpy(&w1, p + kStride + i, 8);
+            memcpy(&w2, p + 2 * kStride + i, 8);
+            crc0 = _mm_crc32_u64(crc0, w0);
+            crc1 = _mm_crc32_u64(crc1, w1);
+            crc2 = _mm_crc32_u64(crc2, w2);
+        }
+        crc = shift(static_cast<uint32_t>(crc0), k) ^ static_cast<uint32_t>(crc1);
+        crc = shift(crc, k) ^ static_cast<uint32_t>(crc2);
+        p += 3 * kStride;
+        size -= 3 * kStride;
+    }
+    return crc;
+}
+
+__attribute__((target("sse4.2,pclmul"))) uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t size) {
+    while (size > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+        size--;
+    }
+    crc = crc32c_interleaved<kLongStride>(crc, p, size, kLongShift);
+    crc = crc32c_interleaved<kShortStride>(crc, p, size, kShortShift);
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word = 0;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while (size > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+        size--;
+    }
+    return crc;
+}
+
+const bool kHasHardware = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul");
+}();
+#endif
+
+uint32_t crc32c_raw(uint32_t crc, const uint8_t* p, size_t size) {
+#if defined(__x86_64__)
+    if (kHasHardware) {
+        return crc32c_hw(crc, p, size);
+    }
+#endif
+    return crc32c_sw(crc, p, size);
+}
+} // namespace
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+    return ~crc32c_raw(~crc, static_cast<const uint8_t*>(data), size);
+}
+
+uint32_t crc32c(uint32_t crc, const IOBuf& buf, size_t offset, size_t size) {
+    uint32_t raw = ~crc;
+    for (size_t i = 0; i < buf.backing_block_num() && size > 0; i++) {
+        auto block = buf.backing_block(i);
+        if (offset >= block.size()) {
+            offset -= block.size();
+            continue;
+        }
+        auto n = std::min<size_t>(block.size() - offset, size);
+        raw = crc32c_raw(raw, reinterpret_cast<const uint8_t*>(block.data()) + offset, n);
+        offset = 0;
+        size -= n;
+    }
+    return ~raw;
+}
+
+std::vector<uint32_t> crc32c_blocks(const IOBuf& buf, size_t first, size_t block_size) {
+    std::vector<uint32_t> crcs;
+    uint32_t raw = ~0U;
+    // bytes still missing from the current piece, and whether it has any yet
+    size_t left = first == 0 ? block_size : first;
+    bool partial = false;
+    for (size_t i = 0; i < buf.backing_block_num(); i++) {
+        auto block = buf.backing_block(i);
+        auto p = reinterpret_cast<const uint8_t*>(block.data());
+        auto size = block.size();
+        while (size > 0) {
+            auto n = std::min(size, left);
+            raw = crc32c_raw(raw, p, n);
+            p += n;
+            size -= n;
+            left -= n;
+            partial = true;
+            if (left == 0) {
+                crcs.push_back(~raw);
+                raw = ~0U;
+                left = block_size;
+                partial = false;
+            }
+        }
+    }
+    if (partial) {
+        crcs.push_back(~raw);
+    }
+    return crcs;
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2) {
+    if (len2 == 0) {
+        return crc1;
+    }
+    return multmodp(xpow(8 * static_cast<uint64_t>(len2)), crc1) ^ crc2;
+}
+
+} // namespace pain::common
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <pain/base/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pain::common {
+
+// CRC-32C (Castagnoli) with the usual pre and post inversion, crc is the checksum of the
+// preceding data so a buffer can be checksummed piece by piece.
+// Uses SSE4.2 crc32 on three interleaved streams merged with PCLMUL when the cpu supports
+// them, otherwise a slicing-by-8 table.
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+
+// checksum of buf[offset, offset + size)
+uint32_t crc32c(uint32_t crc, const IOBuf& buf, size_t offset, size_t size);
+
+// checksums of consecutive pieces of buf, the first piece has first bytes and the following
+// ones block_size bytes, the last piece may be shorter. The blocks of buf are walked once
+std::vector<uint32_t> crc32c_blocks(const IOBuf& buf, size_t first, size_t block_size);
+
+inline uint32_t crc32c(const IOBuf& buf) {
+    return crc32c(0, buf, 0, buf.size());
+}
+
+// checksum of A + B from the checksums of A and B and the length of B
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+} // namespace pain::common
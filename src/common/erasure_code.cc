@@ -0,0 +1,165 @@
+#include "common/erasure_code.h"
+#include <isa-l/erasure_code.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+
+namespace pain::common {
+
+namespace {
+// ec_init_tables expands each coefficient to 32 bytes of lookup tables
+constexpr size_t kTableSize = 32;
+} // namespace
+
+ErasureCode::ErasureCode(uint32_t data_count, uint32_t parity_count) :
+    _data_count(data_count),
+    _parity_count(parity_count),
+    _encode_matrix(size_t(data_count + parity_count) * data_count),
+    _encode_tables(kTableSize * data_count * parity_count) {
+    // cauchy matrices are invertible for any choice of rows, unlike vandermonde ones
+    gf_gen_cauchy1_matrix(_encode_matrix.data(), fragment_count(), _data_count);
+    ec_init_tables(_data_count,
+                   _parity_count,
+                   &_encode_matrix[size_t(_data_count) * _data_count],
+                   _encode_tables.data());
+}
+
+Status ErasureCode::create(uint32_t data_count, uint32_t parity_count, std::shared_ptr<const ErasureCode>* code) {
+    if (data_count == 0 || parity_count == 0 || data_count + parity_count > kMaxFragmentCount) {
+        return Status(EINVAL, "invalid erasure code parameters");
+    }
+    code->reset(new ErasureCode(data_count, parity_count));
+    return Status::OK();
+}
+
+Status ErasureCode::encode(const IOBuf& data, std::vector<IOBuf>* fragments) const {
+    auto len = fragment_size(data.size());
+    if (len == 0) {
+        return Status(EINVAL, "no data to encode");
+    }
+    if (len > INT32_MAX) {
+        return Status(EINVAL, "data is too large to encode");
+    }
+    // isa-l takes contiguous buffers, the data is copied once into them and padded with zeros
+    std::string buf(len * fragment_count(), '\0');
+    data.copy_to(buf.data(), data.size());
+    std::vector<uint8_t*> ptrs(fragment_count());
+    for (uint32_t i = 0; i < fragment_count(); i++) {
+        ptrs[i] = reinterpret_cast<uint8_t*>(buf.data()) + i * len;
+    }
+    ec_encode_data(static_cast<int>(len),
+                   static_cast<int>(_data_count),
+                   static_cast<int>(_parity_count),
+                   const_cast<uint8_t*>(_encode_tables.data()),
+                   ptrs.data(),
+                   &ptrs[_data_count]);
+
+    fragments->clear();
+    fragments->resize(fragment_count());
+    for (uint32_t i = 0; i < fragment_count(); i++) {
+        (*fragments)[i].append(ptrs[i], len);
+    }
+    return Status::OK();
+}
+
+Status ErasureCode::decode(std::vector<IOBuf>* fragments, const std::vector<bool>& present) const {
+    if (present.size() != fragment_count()) {
+        return Status(EINVAL, "fragment count mismatch");
+    }
+    std::vector<uint32_t> missing;
+    for (uint32_t i = 0; i < fragment_count(); i++) {
+        if (!present[i]) {
+            missing.push_back(i);
+        }
+    }
+    return decode(fragments, present, missing);
+}
+
+Status ErasureCode::decode(std::vector<IOBuf>* fragments,
+                           const std::vector<bool>& present,
+                           const std::vector<uint32_t>& wanted) const {
+    if (fragments->size() != fragment_count() || present.size() != fragment_count()) {
+        return Status(EINVAL, "fragment count mismatch");
+    }
+    for (auto i : wanted) {
+        if (i >= fragment_count() || present[i]) {
+            return Status(EINVAL, "wanted fragment is out of range or present");
+        }
+    }
+    std::vector<uint32_t> sources;
+    size_t len = 0;
+    for (uint32_t i = 0; i < fragment_count(); i++) {
+        if (!present[i]) {
+            continue;
+        }
+        if (sources.size() < _data_count) {
+            if (!sources.empty() && (*fragments)[i].size() != len) {
+                return Status(EINVAL, "fragments differ in size");
+            }
+            len = (*fragments)[i].size();
+            sources.push_back(i);
+        }
+    }
+    if (sources.size() < _data_count) {
+        return Status(ENODATA, "not enough fragments to decode");
+    }
+    if (wanted.empty()) {
+        return Status::OK();
+    }
+    if (len == 0 || len > INT32_MAX) {
+        return Status(EINVAL, "invalid fragment size");
+    }
+
+    // rows of the sources form an invertible matrix mapping data fragments to sources, its
+    // inverse gives the data fragments from the sources, and parity rows times it the parity
+    size_t k = _data_count;
+    std::vector<uint8_t> matrix(k * k);
+    for (size_t i = 0; i < k; i++) {
+        std::copy_n(&_encode_matrix[sources[i] * k], k, &matrix[i * k]);
+    }
+    std::vector<uint8_t> inverse(k * k);
+    if (gf_invert_matrix(matrix.data(), inverse.data(), static_cast<int>(k)) < 0) {
+        return Status(EINVAL, "singular decode matrix");
+    }
+    std::vector<uint8_t> decode_matrix(wanted.size() * k);
+    for (size_t r = 0; r < wanted.size(); r++) {
+        auto* row = &decode_matrix[r * k];
+        if (wanted[r] < k) {
+            std::copy_n(&inverse[wanted[r] * k], k, row);
+            continue;
+        }
+        for (size_t i = 0; i < k; i++) {
+            uint8_t s = 0;
+            for (size_t j = 0; j < k; j++) {
+                s ^= gf_mul(inverse[j * k + i], _encode_matrix[wanted[r] * k + j]);
+            }
+            row[i] = s;
+        }
+    }
+    std::vector<uint8_t> tables(kTableSize * k * wanted.size());
+    ec_init_tables(static_cast<int>(k), static_cast<int>(wanted.size()), decode_matrix.data(), tables.data());
+
+    std::string buf(len * (k + wanted.size()), '\0');
+    std::vector<uint8_t*> ptrs(k + wanted.size());
+    for (size_t i = 0; i < ptrs.size(); i++) {
+        ptrs[i] = reinterpret_cast<uint8_t*>(buf.data()) + i * len;
+    }
+    for (size_t i = 0; i < k; i++) {
+        (*fragments)[sources[i]].copy_to(ptrs[i], len);
+    }
+    ec_encode_data(static_cast<int>(len),
+                   static_cast<int>(k),
+                   static_cast<int>(wanted.size()),
+                   tables.data(),
+                   ptrs.data(),
+                   &ptrs[k]);
+    for (size_t r = 0; r < wanted.size(); r++) {
+        auto& fragment = (*fragments)[wanted[r]];
+        fragment.clear();
+        fragment.append(ptrs[k + r], len);
+    }
+    return Status::OK();
+}
+
+} // namespace pain::common
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <pain/base/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace pain::common {
+
+// ErasureCode splits data into k data fragments and computes m parity fragments with ISA-L,
+// any k of the k + m fragments are enough to rebuild the others. The code is systematic, the
+// data fragments are the data cut in k pieces of fragment_size bytes, the last one padded with
+// zeros, so a range of the data is read from the data fragments as long as they are present.
+//
+// An ErasureCode holds only the coding tables and is shared by concurrent encoders.
+class ErasureCode {
+public:
+    static constexpr uint32_t kMaxFragmentCount = 255;
+
+    static Status create(uint32_t data_count, uint32_t parity_count, std::shared_ptr<const ErasureCode>* code);
+
+    uint32_t data_count() const {
+        return _data_count;
+    }
+
+    uint32_t parity_count() const {
+        return _parity_count;
+    }
+
+    uint32_t fragment_count() const {
+        return _data_count + _parity_count;
+    }
+
+    // bytes of each fragment of size bytes data
+    uint64_t fragment_size(uint64_t size) const {
+        return (size + _data_count - 1) / _data_count;
+    }
+
+    // cut data in data_count fragments followed by parity_count parity fragments
+    Status encode(const IOBuf& data, std::vector<IOBuf>* fragments) const;
+
+    // rebuild fragments which are not present from data_count present ones of the same size,
+    // fragments has fragment_count entries and the rebuilt ones are stored in place
+    Status decode(std::vector<IOBuf>* fragments, const std::vector<bool>& present) const;
+    // rebuild only the fragments in wanted, the other ones not present are left as they are.
+    // Bytes at the same position of the fragments form a code word, so equal ranges of the
+    // fragments decode the same range of the wanted ones.
+    Status decode(std::vector<IOBuf>* fragments,
+                  const std::vector<bool>& present,
+                  const std::vector<uint32_t>& wanted) const;
+
+private:
+    ErasureCode(uint32_t data_count, uint32_t parity_count);
+
+    uint32_t _data_count;
+    uint32_t _parity_count;
+    // fragment_count x data_count, the identity on top of the cauchy parity rows
+    std::vector<uint8_t> _encode_matrix;
+    // tables of the parity rows expanded by ec_init_tables
+    std::vector<uint8_t> _encode_tables;
+};
+
+using ErasureCodePtr = std::shared_ptr<const ErasureCode>;
+
+} // namespace pain::common
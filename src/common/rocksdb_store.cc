@@ -29,7 +29,7 @@ RocksdbStore::~RocksdbStore() {
     }
 }
 
-Status RocksdbStore::open(const char* data_path, RocksdbStorePtr* store) {
+Status RocksdbStore::open(const char* data_path, RocksdbStorePtr* store, bool wal, bool sync) {
     BOOST_ASSERT(data_path != nullptr);
     BOOST_ASSERT(store != nullptr);
     auto fs = braft::default_file_system();
@@ -63,6 +63,8 @@ Status RocksdbStore::open(const char* data_path, RocksdbStorePtr* store) {
     rocksdb_store->_data_path = data_path;
     rocksdb_store->_db = txn_db->GetBaseDB();
     rocksdb_store->_txn_db = txn_db;
+    rocksdb_store->_write_options.disableWAL = !wal && !sync;
+    rocksdb_store->_write_options.sync = sync;
     *store = rocksdb_store;
     return Status::OK();
 }
@@ -15,7 +15,9 @@ public:
     RocksdbStore();
     ~RocksdbStore() override;
 
-    static Status open(const char* data_path, RocksdbStorePtr* store);
+    // writes skip the WAL by default since the store is recovered from the raft log, users
+    // without a log of their own enable it with wal, sync also syncs it on every write
+    static Status open(const char* data_path, RocksdbStorePtr* store, bool wal = false, bool sync = false);
     Status close() override;
     Status recover(const char* from) override;
     Status check_point(const char* to, std::vector<std::string>* files) override;
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "common/crc32c.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+
+namespace {
+using namespace pain;
+using namespace pain::common;
+
+// 逐位计算的参考实现
+uint32_t crc32c_bitwise(const std::string& data) {
+    uint32_t crc = ~0U;
+    for (auto c : data) {
+        crc ^= static_cast<uint8_t>(c);
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+std::string random_string(size_t size, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::string data(size, '\0');
+    for (auto& c : data) {
+        c = static_cast<char>(gen());
+    }
+    return data;
+}
+
+TEST(Crc32c, KnownValues) {
+    EXPECT_EQ(crc32c(0, "", 0), 0U);
+    EXPECT_EQ(crc32c(0, "123456789", 9), 0xe3069283U);
+    std::string zeros(32, '\0');
+    EXPECT_EQ(crc32c(0, zeros.data(), zeros.size()), 0x8a9136aaU);
+}
+
+TEST(Crc32c, MatchesReference) {
+    // 覆盖交织路径、短路径和非对齐的起始地址
+    for (size_t size : {1UL, 7UL, 8UL, 100UL, 767UL, 768UL, 5000UL, 24576UL, 24577UL, 100000UL}) {
+        auto data = random_string(size + 3, static_cast<uint32_t>(size));
+        for (size_t shift = 0; shift < 3; shift++) {
+            auto piece = data.substr(shift, size);
+            EXPECT_EQ(crc32c(0, data.data() + shift, size), crc32c_bitwise(piece)) << size << " " << shift;
+        }
+    }
+}
+
+TEST(Crc32c, Incremental) {
+    auto data = random_string(50000, 1);
+    uint32_t crc = 0;
+    for (size_t pos = 0; pos < data.size(); pos += 777) {
+        crc = crc32c(crc, data.data() + pos, std::min<size_t>(777, data.size() - pos));
+    }
+    EXPECT_EQ(crc, crc32c(0, data.data(), data.size()));
+}
+
+TEST(Crc32c, Combine) {
+    auto data = random_string(30000, 2);
+    for (size_t split : {0UL, 1UL, 4096UL, 12345UL, 30000UL}) {
+        auto crc1 = crc32c(0, data.data(), split);
+        auto crc2 = crc32c(0, data.data() + split, data.size() - split);
+        EXPECT_EQ(crc32c_combine(crc1, crc2, data.size() - split), crc32c(0, data.data(), data.size())) << split;
+    }
+}
+
+TEST(Crc32c, IOBufRange) {
+    IOBuf buf;
+    std::string data;
+    for (int i = 0; i < 10; i++) {
+        auto piece = random_string(3000 + i, i);
+        buf.append(piece);
+        data += piece;
+    }
+    EXPECT_EQ(crc32c(buf), crc32c(0, data.data(), data.size()));
+    EXPECT_EQ(crc32c(0, buf, 2999, 10000), crc32c(0, data.data() + 2999, 10000));
+    EXPECT_EQ(crc32c(0, buf, 100, 0), 0U);
+}
+
+TEST(Crc32c, IOBufBlocks) {
+    IOBuf buf;
+    std::string data;
+    for (int i = 0; i < 10; i++) {
+        auto piece = random_string(3000 + i, i);
+        buf.append(piece);
+        data += piece;
+    }
+    // 第一段不完整，之后每段 4096 字节，最后一段剩余的部分
+    for (size_t first : {1UL, 100UL, 4096UL}) {
+        auto crcs = crc32c_blocks(buf, first, 4096);
+        std::vector<uint32_t> expected;
+        for (size_t pos = 0; pos < data.size();) {
+            auto len = std::min(data.size() - pos, pos == 0 ? first : 4096);
+            expected.push_back(crc32c(0, data.data() + pos, len));
+            pos += len;
+        }
+        EXPECT_EQ(crcs, expected) << first;
+    }
+    EXPECT_TRUE(crc32c_blocks(IOBuf(), 100, 4096).empty());
+}
+
+} // namespace
+
+// NOLINTEND(readability-magic-numbers)
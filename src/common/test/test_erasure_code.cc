@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "common/erasure_code.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+
+namespace {
+using namespace pain;
+using namespace pain::common;
+
+std::string random_data(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::string data(size, '\0');
+    for (auto& c : data) {
+        c = static_cast<char>(rng());
+    }
+    return data;
+}
+
+TEST(TestErasureCode, Create) {
+    ErasureCodePtr code;
+    ASSERT_EQ(ErasureCode::create(0, 4, &code).error_code(), EINVAL);
+    ASSERT_EQ(ErasureCode::create(10, 0, &code).error_code(), EINVAL);
+    ASSERT_EQ(ErasureCode::create(200, 56, &code).error_code(), EINVAL);
+    ASSERT_TRUE(ErasureCode::create(10, 4, &code).ok());
+    ASSERT_EQ(code->data_count(), 10);
+    ASSERT_EQ(code->parity_count(), 4);
+    ASSERT_EQ(code->fragment_count(), 14);
+    ASSERT_EQ(code->fragment_size(100), 10);
+    ASSERT_EQ(code->fragment_size(101), 11);
+}
+
+TEST(TestErasureCode, DataFragmentsAreSystematic) {
+    ErasureCodePtr code;
+    ASSERT_TRUE(ErasureCode::create(4, 2, &code).ok());
+    auto data = random_data(1001, 1);
+    IOBuf buf;
+    buf.append(data);
+    std::vector<IOBuf> fragments;
+    ASSERT_TRUE(code->encode(buf, &fragments).ok());
+    ASSERT_EQ(fragments.size(), 6);
+
+    // 数据分片依次拼接即为原数据，末尾补零
+    std::string joined;
+    for (uint32_t i = 0; i < 4; i++) {
+        ASSERT_EQ(fragments[i].size(), 251);
+        joined += fragments[i].to_string();
+    }
+    ASSERT_EQ(joined.substr(0, data.size()), data);
+    ASSERT_EQ(joined.substr(data.size()), std::string(3, '\0'));
+
+    ASSERT_EQ(code->encode(IOBuf(), &fragments).error_code(), EINVAL);
+}
+
+TEST(TestErasureCode, DecodeAnyLostFragments) {
+    ErasureCodePtr code;
+    ASSERT_TRUE(ErasureCode::create(6, 3, &code).ok());
+    IOBuf buf;
+    buf.append(random_data(64 * 1024 + 7, 2));
+    std::vector<IOBuf> expected;
+    ASSERT_TRUE(code->encode(buf, &expected).ok());
+
+    // 丢失任意不超过 3 个分片（数据或校验）都可以恢复
+    std::vector<std::vector<uint32_t>> cases = {{0}, {8}, {0, 5}, {2, 7}, {6, 7, 8}, {0, 1, 2}, {1, 4, 8}};
+    for (const auto& lost : cases) {
+        auto fragments = expected;
+        std::vector<bool> present(9, true);
+        for (auto i : lost) {
+            fragments[i].clear();
+            present[i] = false;
+        }
+        ASSERT_TRUE(code->decode(&fragments, present).ok());
+        for (uint32_t i = 0; i < 9; i++) {
+            ASSERT_EQ(fragments[i], expected[i]) << "fragment " << i;
+        }
+    }
+}
+
+TEST(TestErasureCode, DecodeRangeOfWantedFragments) {
+    ErasureCodePtr code;
+    ASSERT_TRUE(ErasureCode::create(4, 2, &code).ok());
+    IOBuf buf;
+    buf.append(random_data(4000, 4));
+    std::vector<IOBuf> expected;
+    ASSERT_TRUE(code->encode(buf, &expected).ok());
+
+    // 只取各分片的同一段，只恢复需要的分片，其他缺失的分片保持不变
+    std::vector<IOBuf> fragments(6);
+    std::vector<bool> present = {false, true, false, true, true, true};
+    for (uint32_t i = 0; i < 6; i++) {
+        if (present[i]) {
+            expected[i].append_to(&fragments[i], 300, 100);
+        }
+    }
+    ASSERT_TRUE(code->decode(&fragments, present, {0}).ok());
+    IOBuf range;
+    expected[0].append_to(&range, 300, 100);
+    ASSERT_EQ(fragments[0], range);
+    ASSERT_TRUE(fragments[2].empty());
+
+    ASSERT_EQ(code->decode(&fragments, present, {1}).error_code(), EINVAL);
+    ASSERT_EQ(code->decode(&fragments, present, {6}).error_code(), EINVAL);
+}
+
+TEST(TestErasureCode, DecodeErrors) {
+    ErasureCodePtr code;
+    ASSERT_TRUE(ErasureCode::create(3, 2, &code).ok());
+    IOBuf buf;
+    buf.append(random_data(300, 3));
+    std::vector<IOBuf> fragments;
+    ASSERT_TRUE(code->encode(buf, &fragments).ok());
+
+    // 可用分片不足
+    std::vector<bool> present = {false, true, false, true, false};
+    ASSERT_EQ(code->decode(&fragments, present).error_code(), ENODATA);
+
+    // 分片数量不匹配
+    std::vector<IOBuf> short_fragments(4);
+    ASSERT_EQ(code->decode(&short_fragments, std::vector<bool>(4, true)).error_code(), EINVAL);
+
+    // 分片大小不一致
+    present = {true, true, true, false, false};
+    fragments[1].pop_back(1);
+    ASSERT_EQ(code->decode(&fragments, present).error_code(), EINVAL);
+}
+
+} // namespace
+
+// NOLINTEND(readability-magic-numbers)
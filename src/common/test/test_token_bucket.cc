@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "common/token_bucket.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+
+namespace {
+using namespace pain::common;
+
+TEST(TestTokenBucket, TakeWithinBurst) {
+    TokenBucket bucket(1000, 100);
+    // 初始时桶是满的
+    ASSERT_TRUE(bucket.try_take(60, 0));
+    ASSERT_TRUE(bucket.try_take(40, 0));
+    ASSERT_FALSE(bucket.try_take(1, 0));
+
+    // 每毫秒补充一个令牌，不超过 burst
+    ASSERT_TRUE(bucket.try_take(10, 10 * 1000));
+    ASSERT_FALSE(bucket.try_take(1, 10 * 1000));
+    ASSERT_FALSE(bucket.try_take(101, 10 * 1000 * 1000));
+    ASSERT_TRUE(bucket.try_take(100, 10 * 1000 * 1000));
+}
+
+TEST(TestTokenBucket, TakeIntoDebt) {
+    TokenBucket bucket(1000, 100);
+    ASSERT_EQ(bucket.take(100, 0), 0);
+    // 超出的部分按速率等待
+    ASSERT_EQ(bucket.take(500, 0), 500 * 1000);
+    ASSERT_FALSE(bucket.try_take(1, 400 * 1000));
+    ASSERT_EQ(bucket.take(10, 500 * 1000), 10 * 1000);
+    ASSERT_EQ(bucket.take(0, 510 * 1000), 0);
+}
+
+TEST(TestTokenBucket, Reset) {
+    TokenBucket bucket(0, 0);
+    // 速率为 0 时不限速
+    ASSERT_TRUE(bucket.try_take(1 << 30, 0));
+    ASSERT_EQ(bucket.take(1 << 30, 0), 0);
+
+    bucket.reset(100, 10);
+    ASSERT_EQ(bucket.rate(), 100);
+    ASSERT_FALSE(bucket.try_take(1, 0));
+    ASSERT_TRUE(bucket.try_take(10, 100 * 1000));
+
+    // 降低 burst 时剩余的令牌也随之减少
+    bucket.reset(100, 50);
+    ASSERT_TRUE(bucket.try_take(1, 1000 * 1000));
+    ASSERT_FALSE(bucket.try_take(50, 1000 * 1000));
+}
+
+} // namespace
+
+// NOLINTEND(readability-magic-numbers)
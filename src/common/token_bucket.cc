@@ -0,0 +1,62 @@
+#include "common/token_bucket.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace pain::common {
+
+namespace {
+constexpr double kMicrosecondsPerSecond = 1000.0 * 1000.0;
+} // namespace
+
+TokenBucket::TokenBucket(uint64_t rate, uint64_t burst) :
+    _rate(rate), _burst(burst), _tokens(static_cast<double>(burst)) {}
+
+void TokenBucket::reset(uint64_t rate, uint64_t burst) {
+    std::lock_guard lock(_mutex);
+    _rate = rate;
+    _burst = burst;
+    _tokens = std::min(_tokens, static_cast<double>(burst));
+}
+
+uint64_t TokenBucket::rate() const {
+    std::lock_guard lock(_mutex);
+    return _rate;
+}
+
+void TokenBucket::refill(int64_t now_us) {
+    if (_last_us >= 0 && now_us > _last_us) {
+        auto elapsed = static_cast<double>(now_us - _last_us);
+        _tokens = std::min(_tokens + elapsed * static_cast<double>(_rate) / kMicrosecondsPerSecond,
+                           static_cast<double>(_burst));
+    }
+    _last_us = std::max(_last_us, now_us);
+}
+
+bool TokenBucket::try_take(uint64_t n, int64_t now_us) {
+    std::lock_guard lock(_mutex);
+    if (_rate == 0) {
+        return true;
+    }
+    refill(now_us);
+    if (_tokens < static_cast<double>(n)) {
+        return false;
+    }
+    _tokens -= static_cast<double>(n);
+    return true;
+}
+
+int64_t TokenBucket::take(uint64_t n, int64_t now_us) {
+    std::lock_guard lock(_mutex);
+    if (_rate == 0) {
+        return 0;
+    }
+    refill(now_us);
+    _tokens -= static_cast<double>(n);
+    if (_tokens >= 0) {
+        return 0;
+    }
+    return static_cast<int64_t>(std::ceil(-_tokens * kMicrosecondsPerSecond / static_cast<double>(_rate)));
+}
+
+} // namespace pain::common
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <cstdint>
+
+namespace pain::common {
+
+// TokenBucket admits rate tokens per second with bursts of up to burst tokens. take() may
+// put the bucket in debt, a request larger than the tokens left is granted along with the
+// time to wait until the debt is paid back, so large requests are neither starved nor split.
+//
+// Time is passed in by the callers, which keeps the bucket usable from tests and lets a
+// caller reuse the clock it read for other purposes.
+class TokenBucket {
+public:
+    // a rate of 0 is unlimited
+    TokenBucket(uint64_t rate, uint64_t burst);
+
+    // change the rate, the tokens left are kept up to the new burst
+    void reset(uint64_t rate, uint64_t burst);
+
+    uint64_t rate() const;
+
+    // take n tokens if they are there, a request larger than burst never fits
+    bool try_take(uint64_t n, int64_t now_us);
+
+    // take n tokens, returns the microseconds to wait before using them
+    int64_t take(uint64_t n, int64_t now_us);
+
+private:
+    void refill(int64_t now_us);
+
+    mutable bthread::Mutex _mutex;
+    uint64_t _rate;
+    uint64_t _burst;
+    // negative when in debt
+    double _tokens;
+    int64_t _last_us = -1;
+};
+
+} // namespace pain::common
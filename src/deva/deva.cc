@@ -1,6 +1,7 @@
 #include "deva/deva.h"
 #include <pain/base/plog.h>
 #include <pain/base/uuid.h>
+#include <algorithm>
 #include "common/object_id_util.h"
 #include "common/txn_manager.h"
 #include "deva/macro.h"
@@ -137,8 +138,24 @@ DEVA_METHOD(CreateChunk) {
 
 DEVA_METHOD(CheckInChunk) {
     SPAN(span);
-    PLOG_INFO(("desc", "seal")("version", version)("index", index));
-    return Status::OK();
+    PLOG_DEBUG(("desc", "check_in_chunk")("version", version)("index", index)("request", request->DebugString()));
+    auto file_id = common::from_proto(request->file_id());
+    proto::FileInfo file_info;
+    auto status = get_file_info(file_id, &file_info);
+    if (!status.ok()) {
+        return status;
+    }
+    const auto& chunk_info = request->chunk_info();
+    auto count = static_cast<uint64_t>(file_info.chunk_infos_size());
+    if (chunk_info.index() + 1 == count) {
+        file_info.mutable_chunk_infos(static_cast<int>(count - 1))->CopyFrom(chunk_info);
+    } else if (chunk_info.index() == count) {
+        file_info.add_chunk_infos()->CopyFrom(chunk_info);
+    } else {
+        return Status(EINVAL, fmt::format("chunk {} checked in after {} chunks", chunk_info.index(), count));
+    }
+    file_info.set_size(std::max(file_info.size(), chunk_info.offset() + chunk_info.length()));
+    return update_file_info(file_id, file_info);
 }
 
 DEVA_METHOD(SealChunk) {
@@ -175,6 +192,97 @@ DEVA_METHOD(GetFileInfo) {
     return Status::OK();
 }
 
+DEVA_METHOD(ConvertChunk) {
+    SPAN(span);
+    PLOG_INFO(("desc", "convert_chunk")("version", version)("index", index));
+    auto& chunk_info = request->chunk_info();
+    if (chunk_info.type() != pain::proto::ChunkType::CHUNK_TYPE_EC ||
+        static_cast<uint64_t>(chunk_info.replicas_size()) !=
+            uint64_t(chunk_info.config().replica_count()) + chunk_info.config().parity_count()) {
+        return Status(EINVAL, "invalid erasure coded layout");
+    }
+    auto chunk_id = common::from_proto(chunk_info.chunk_id());
+    // every replica holder may try to convert the chunk, the first layout wins
+    if (_store->hexists(_chunk_info_key, chunk_id.str())) {
+        auto status = get_chunk_info(chunk_id, response->mutable_chunk_info());
+        if (!status.ok()) {
+            return status;
+        }
+        return Status(EEXIST, fmt::format("chunk {} is converted already", chunk_id.str()));
+    }
+
+    auto txn = common::TxnManager::instance().get_txn_store();
+    if (txn == nullptr) {
+        return Status(EIO, "Failed to begin transaction");
+    }
+    auto status = txn->hset(_chunk_info_key, chunk_id.str(), chunk_info.SerializeAsString());
+    if (!status.ok()) {
+        return status;
+    }
+    for (auto& fragment : chunk_info.replicas()) {
+        ObjectId fragment_id(chunk_id.partition_id(), common::from_proto(fragment.chunk_id()));
+        status = txn->hset(_chunk_fragment_key, fragment_id.str(), chunk_id.str());
+        if (!status.ok()) {
+            return status;
+        }
+    }
+    response->mutable_chunk_info()->CopyFrom(chunk_info);
+    return Status::OK();
+}
+
+DEVA_METHOD(GetChunkInfo) {
+    SPAN(span);
+    PLOG_DEBUG(("desc", "get_chunk_info")("version", version)("index", index));
+    auto chunk_id = common::from_proto(request->chunk_id());
+    if (_store->hexists(_chunk_fragment_key, chunk_id.str())) {
+        std::string chunk_id_str;
+        auto status = _store->hget(_chunk_fragment_key, chunk_id.str(), &chunk_id_str);
+        if (!status.ok()) {
+            return status;
+        }
+        auto id = ObjectId::from_str(chunk_id_str);
+        if (!id.has_value()) {
+            return Status(EIO, fmt::format("invalid chunk of fragment {}", chunk_id.str()));
+        }
+        chunk_id = *id;
+    }
+    if (!_store->hexists(_chunk_info_key, chunk_id.str())) {
+        return Status(ENOENT, fmt::format("no layout of chunk {}", chunk_id.str()));
+    }
+    return get_chunk_info(chunk_id, response->mutable_chunk_info());
+}
+
+DEVA_METHOD(ReportBadChunk) {
+    SPAN(span);
+    PLOG_INFO(("desc", "report_bad_chunk")("version", version)("index", index));
+    auto& bad_chunk = request->bad_chunk();
+    if (bad_chunk.manusya().empty()) {
+        return Status(EINVAL, "manusya of bad chunk is empty");
+    }
+    auto chunk_id = common::from_proto(bad_chunk.chunk_id());
+    auto txn = common::TxnManager::instance().get_txn_store();
+    if (txn == nullptr) {
+        return Status(EIO, "Failed to begin transaction");
+    }
+    auto field = fmt::format("{}@{}", chunk_id.str(), bad_chunk.manusya());
+    return txn->hset(_bad_chunk_key, field, bad_chunk.SerializeAsString());
+}
+
+DEVA_METHOD(ListBadChunk) {
+    SPAN(span);
+    PLOG_DEBUG(("desc", "list_bad_chunk")("version", version)("index", index));
+    auto it = _store->hgetall(_bad_chunk_key);
+    if (it == nullptr) {
+        return Status(EIO, "Failed to list bad chunks");
+    }
+    for (; it->valid(); it->next()) {
+        if (!response->add_bad_chunks()->ParseFromArray(it->value().data(), static_cast<int>(it->value().size()))) {
+            return Status(EIO, "Failed to parse bad chunk");
+        }
+    }
+    return Status::OK();
+}
+
 DEVA_METHOD(ManusyaHeartbeat) {
     SPAN(span);
     PLOG_INFO(("desc", "manusya_heartbeat")("version", version)("index", index));
@@ -286,6 +394,18 @@ Status Deva::remove_file_info(const ObjectId& id) {
     return Status::OK();
 }
 
+Status Deva::get_chunk_info(const ObjectId& id, proto::ChunkInfo* chunk_info) {
+    std::string chunk_info_str;
+    auto status = _store->hget(_chunk_info_key, id.str(), &chunk_info_str);
+    if (!status.ok()) {
+        return status;
+    }
+    if (!chunk_info->ParseFromString(chunk_info_str)) {
+        return Status(EIO, "Failed to parse chunk info");
+    }
+    return Status::OK();
+}
+
 Status Deva::save_snapshot(std::string_view path, std::vector<std::string>* files) {
     return _store->check_point(path.data(), files);
 }
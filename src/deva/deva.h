@@ -60,6 +60,10 @@ public:
     DEVA_ENTRY(SealChunk);
     DEVA_ENTRY(SealAndNewChunk);
     DEVA_ENTRY(GetFileInfo);
+    DEVA_ENTRY(ConvertChunk);
+    DEVA_ENTRY(GetChunkInfo);
+    DEVA_ENTRY(ReportBadChunk);
+    DEVA_ENTRY(ListBadChunk);
     DEVA_ENTRY(ManusyaHeartbeat);
     DEVA_ENTRY(ListManusya);
 
@@ -80,12 +84,18 @@ private:
     Status update_file_info(const ObjectId& id, const proto::FileInfo& file_info);
     Status get_file_info(const ObjectId& id, proto::FileInfo* file_info);
     Status remove_file_info(const ObjectId& id);
+    Status get_chunk_info(const ObjectId& id, proto::ChunkInfo* chunk_info);
 
 private:
     std::atomic<int> _use_count;
     common::StorePtr _store;
     Namespace _namespace;
     const char* _file_info_key = "file_info";
+    // layouts of erasure coded chunks, and the chunk of each fragment
+    const char* _chunk_info_key = "chunk_info";
+    const char* _chunk_fragment_key = "chunk_fragment";
+    // corrupted replicas to repair, by chunk and manusya
+    const char* _bad_chunk_key = "bad_chunk";
     const char* _meta_key = "meta";
     const char* _applied_index_key = "applied_index";
     int64_t _applied_index = 0;
@@ -32,6 +32,10 @@ enum class OpType : uint32_t {
     DEFINE_RSM_OP(8, SealAndNewChunk, true),
     DEFINE_RSM_OP(9, ReadDir, false),
     DEFINE_RSM_OP(10, GetFileInfo, false),
+    DEFINE_RSM_OP(11, ConvertChunk, true),
+    DEFINE_RSM_OP(12, GetChunkInfo, false),
+    DEFINE_RSM_OP(13, ReportBadChunk, true),
+    DEFINE_RSM_OP(14, ListBadChunk, false),
     DEFINE_RSM_OP(20, ManusyaHeartbeat, false),
     DEFINE_RSM_OP(21, ListManusya, false),
     DEFINE_RSM_OP(100, MaxDevaOp, true),
@@ -61,6 +65,8 @@ public:
             BRANCH(CheckInChunk)
             BRANCH(SealChunk)
             BRANCH(SealAndNewChunk)
+            BRANCH(ConvertChunk)
+            BRANCH(ReportBadChunk)
         default:
             BOOST_ASSERT_MSG(false, fmt::format("unknown op type: {}", op_type).c_str());
         }
@@ -138,6 +138,20 @@ DEVA_SERVICE_METHOD(NewChunk) {
 DEVA_SERVICE_METHOD(CheckInChunk) {
     brpc::ClosureGuard done_guard(done);
     DEFINE_SPAN(span, controller);
+    pain::proto::deva::store::CheckInChunkRequest check_in_chunk_request;
+    pain::proto::deva::store::CheckInChunkResponse check_in_chunk_response;
+    check_in_chunk_request.mutable_file_id()->CopyFrom(request->file_id());
+    check_in_chunk_request.mutable_chunk_info()->CopyFrom(request->chunk_info());
+    auto status =
+        bridge<Deva, OpType::kCheckInChunk>(1, _rsm, check_in_chunk_request, &check_in_chunk_response).get();
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to check in chunk")("error", status.error_str()));
+        response->mutable_header()->set_status(status.error_code());
+        response->mutable_header()->set_message(status.error_str());
+        return;
+    }
+    response->mutable_header()->set_status(0);
+    response->mutable_header()->set_message("ok");
 }
 
 DEVA_SERVICE_METHOD(SealChunk) {
@@ -150,6 +164,76 @@ DEVA_SERVICE_METHOD(SealAndNewChunk) {
     DEFINE_SPAN(span, controller);
 }
 
+DEVA_SERVICE_METHOD(ConvertChunk) {
+    brpc::ClosureGuard done_guard(done);
+    DEFINE_SPAN(span, controller);
+    pain::proto::deva::store::ConvertChunkRequest convert_chunk_request;
+    pain::proto::deva::store::ConvertChunkResponse convert_chunk_response;
+    convert_chunk_request.mutable_chunk_info()->CopyFrom(request->chunk_info());
+    auto status = bridge<Deva, OpType::kConvertChunk>(1, _rsm, convert_chunk_request, &convert_chunk_response).get();
+    // the existing layout is returned along with EEXIST
+    response->mutable_chunk_info()->Swap(convert_chunk_response.mutable_chunk_info());
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to convert chunk")("error", status.error_str()));
+        response->mutable_header()->set_status(status.error_code());
+        response->mutable_header()->set_message(status.error_str());
+        return;
+    }
+    response->mutable_header()->set_status(0);
+    response->mutable_header()->set_message("ok");
+}
+
+DEVA_SERVICE_METHOD(GetChunkInfo) {
+    brpc::ClosureGuard done_guard(done);
+    DEFINE_SPAN(span, controller);
+    pain::proto::deva::store::GetChunkInfoRequest get_chunk_info_request;
+    pain::proto::deva::store::GetChunkInfoResponse get_chunk_info_response;
+    get_chunk_info_request.mutable_chunk_id()->CopyFrom(request->chunk_id());
+    auto status = bridge<Deva, OpType::kGetChunkInfo>(1, _rsm, get_chunk_info_request, &get_chunk_info_response).get();
+    if (!status.ok()) {
+        response->mutable_header()->set_status(status.error_code());
+        response->mutable_header()->set_message(status.error_str());
+        return;
+    }
+    response->mutable_chunk_info()->Swap(get_chunk_info_response.mutable_chunk_info());
+    response->mutable_header()->set_status(0);
+    response->mutable_header()->set_message("ok");
+}
+
+DEVA_SERVICE_METHOD(ReportBadChunk) {
+    brpc::ClosureGuard done_guard(done);
+    DEFINE_SPAN(span, controller);
+    pain::proto::deva::store::ReportBadChunkRequest report_bad_chunk_request;
+    pain::proto::deva::store::ReportBadChunkResponse report_bad_chunk_response;
+    report_bad_chunk_request.mutable_bad_chunk()->CopyFrom(request->bad_chunk());
+    auto status =
+        bridge<Deva, OpType::kReportBadChunk>(1, _rsm, report_bad_chunk_request, &report_bad_chunk_response).get();
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to report bad chunk")("error", status.error_str()));
+        response->mutable_header()->set_status(status.error_code());
+        response->mutable_header()->set_message(status.error_str());
+        return;
+    }
+    response->mutable_header()->set_status(0);
+    response->mutable_header()->set_message("ok");
+}
+
+DEVA_SERVICE_METHOD(ListBadChunk) {
+    brpc::ClosureGuard done_guard(done);
+    DEFINE_SPAN(span, controller);
+    pain::proto::deva::store::ListBadChunkRequest list_bad_chunk_request;
+    pain::proto::deva::store::ListBadChunkResponse list_bad_chunk_response;
+    auto status = bridge<Deva, OpType::kListBadChunk>(1, _rsm, list_bad_chunk_request, &list_bad_chunk_response).get();
+    if (!status.ok()) {
+        response->mutable_header()->set_status(status.error_code());
+        response->mutable_header()->set_message(status.error_str());
+        return;
+    }
+    response->mutable_bad_chunks()->Swap(list_bad_chunk_response.mutable_bad_chunks());
+    response->mutable_header()->set_status(0);
+    response->mutable_header()->set_message("ok");
+}
+
 DEVA_SERVICE_METHOD(ManusyaHeartbeat) {
     brpc::ClosureGuard done_guard(done);
     DEFINE_SPAN(span, controller);
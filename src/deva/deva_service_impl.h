@@ -27,6 +27,10 @@ public:
     DEVA_SERVICE_METHOD(CheckInChunk);
     DEVA_SERVICE_METHOD(SealChunk);
     DEVA_SERVICE_METHOD(SealAndNewChunk);
+    DEVA_SERVICE_METHOD(ConvertChunk);
+    DEVA_SERVICE_METHOD(GetChunkInfo);
+    DEVA_SERVICE_METHOD(ReportBadChunk);
+    DEVA_SERVICE_METHOD(ListBadChunk);
     DEVA_SERVICE_METHOD(ManusyaHeartbeat);
     DEVA_SERVICE_METHOD(ListManusya);
 
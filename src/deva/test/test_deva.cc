@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <set>
+#include <string>
 #include "pain/base/scope_exit.h"
 #include "pain/proto/deva.pb.h"
 #include "common/object_id_util.h"
@@ -52,6 +54,45 @@ public:
             _mock_deva.group().c_str(), &pain::proto::deva::DevaService::ListManusya, &request, response);
     }
 
+    pain::Status convert_chunk(const pain::proto::ChunkInfo& chunk_info,
+                               pain::proto::deva::ConvertChunkResponse* response) {
+        pain::proto::deva::ConvertChunkRequest request;
+        request.mutable_chunk_info()->CopyFrom(chunk_info);
+        return pain::deva::call_rpc(
+            _mock_deva.group().c_str(), &pain::proto::deva::DevaService::ConvertChunk, &request, response);
+    }
+
+    pain::Status check_in_chunk(const pain::proto::ObjectId& file_id,
+                                const pain::proto::ChunkInfo& chunk_info,
+                                pain::proto::deva::CheckInChunkResponse* response) {
+        pain::proto::deva::CheckInChunkRequest request;
+        request.mutable_file_id()->CopyFrom(file_id);
+        request.mutable_chunk_info()->CopyFrom(chunk_info);
+        return pain::deva::call_rpc(
+            _mock_deva.group().c_str(), &pain::proto::deva::DevaService::CheckInChunk, &request, response);
+    }
+
+    pain::Status get_chunk_info(const pain::ObjectId& chunk_id, pain::proto::deva::GetChunkInfoResponse* response) {
+        pain::proto::deva::GetChunkInfoRequest request;
+        pain::common::to_proto(chunk_id, request.mutable_chunk_id());
+        return pain::deva::call_rpc(
+            _mock_deva.group().c_str(), &pain::proto::deva::DevaService::GetChunkInfo, &request, response);
+    }
+
+    pain::Status report_bad_chunk(const pain::proto::BadChunk& bad_chunk,
+                                  pain::proto::deva::ReportBadChunkResponse* response) {
+        pain::proto::deva::ReportBadChunkRequest request;
+        request.mutable_bad_chunk()->CopyFrom(bad_chunk);
+        return pain::deva::call_rpc(
+            _mock_deva.group().c_str(), &pain::proto::deva::DevaService::ReportBadChunk, &request, response);
+    }
+
+    pain::Status list_bad_chunk(pain::proto::deva::ListBadChunkResponse* response) {
+        pain::proto::deva::ListBadChunkRequest request;
+        return pain::deva::call_rpc(
+            _mock_deva.group().c_str(), &pain::proto::deva::DevaService::ListBadChunk, &request, response);
+    }
+
     void TearDown() override {
         if (::testing::Test::HasFailure()) {
             _mock_deva.do_not_remove_data_path();
@@ -277,4 +318,189 @@ TEST_F(TestDeva, ListManusya) {
     }
 }
 
+TEST_F(TestDeva, ConvertChunk) {
+    _mock_deva.start();
+    SCOPE_EXIT {
+        _mock_deva.stop();
+    };
+    std::string leader;
+    auto status = _mock_deva.wait_for_leader(&leader);
+    ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+
+    auto chunk_id = pain::ObjectId::generate(1);
+    pain::proto::ChunkInfo chunk_info;
+    pain::common::to_proto(chunk_id, chunk_info.mutable_chunk_id());
+    chunk_info.set_length(1000); // NOLINT(readability-magic-numbers)
+    chunk_info.set_state(pain::proto::ChunkState::CHUNK_STATE_SEALED);
+    chunk_info.set_type(pain::proto::ChunkType::CHUNK_TYPE_EC);
+    chunk_info.mutable_config()->set_replica_count(2);
+    chunk_info.mutable_config()->set_parity_count(1);
+    std::vector<pain::ObjectId> fragment_ids;
+    const int base_port = 8101; // NOLINT(readability-magic-numbers)
+    for (int i = 0; i < 3; i++) {
+        fragment_ids.push_back(pain::ObjectId::generate(1));
+        auto replica = chunk_info.add_replicas();
+        pain::common::to_proto(fragment_ids.back().uuid(), replica->mutable_chunk_id());
+        replica->set_length(500); // NOLINT(readability-magic-numbers)
+        replica->mutable_location()->set_uri(fmt::format("127.0.0.1:{}", base_port + i));
+    }
+
+    {
+        pain::proto::deva::GetChunkInfoResponse response;
+        status = get_chunk_info(chunk_id, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        EXPECT_EQ(response.header().status(), ENOENT);
+    }
+
+    {
+        pain::proto::deva::ConvertChunkResponse response;
+        status = convert_chunk(chunk_info, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        ASSERT_EQ(response.header().status(), 0) << response.header().message();
+    }
+
+    // the layout is found by the chunk and by each fragment
+    fragment_ids.push_back(chunk_id);
+    for (auto& id : fragment_ids) {
+        pain::proto::deva::GetChunkInfoResponse response;
+        status = get_chunk_info(id, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        ASSERT_EQ(response.header().status(), 0) << response.header().message();
+        EXPECT_EQ(response.chunk_info().SerializeAsString(), chunk_info.SerializeAsString());
+    }
+
+    // a second layout is refused and the first one returned
+    {
+        auto other = chunk_info;
+        other.mutable_replicas(0)->set_length(0);
+        pain::proto::deva::ConvertChunkResponse response;
+        status = convert_chunk(other, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        EXPECT_EQ(response.header().status(), EEXIST);
+        EXPECT_EQ(response.chunk_info().SerializeAsString(), chunk_info.SerializeAsString());
+    }
+
+    // the fragments must match the config
+    {
+        auto invalid = chunk_info;
+        pain::common::to_proto(pain::ObjectId::generate(1), invalid.mutable_chunk_id());
+        invalid.mutable_replicas()->RemoveLast();
+        pain::proto::deva::ConvertChunkResponse response;
+        status = convert_chunk(invalid, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        EXPECT_EQ(response.header().status(), EINVAL);
+    }
+}
+
+TEST_F(TestDeva, CheckInChunk) {
+    _mock_deva.start();
+    SCOPE_EXIT {
+        _mock_deva.stop();
+    };
+    std::string leader;
+    auto status = _mock_deva.wait_for_leader(&leader);
+    ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+
+    pain::proto::deva::OpenFileResponse open_response;
+    status = open("/ec.txt", pain::proto::deva::OpenFlag::OPEN_CREATE, &open_response);
+    ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+    auto file_id = open_response.file_info().file_id();
+
+    pain::proto::ChunkInfo chunk_info;
+    pain::common::to_proto(pain::ObjectId::generate(1), chunk_info.mutable_chunk_id());
+    chunk_info.set_index(0);
+    chunk_info.set_state(pain::proto::ChunkState::CHUNK_STATE_CHECKIN);
+    chunk_info.set_type(pain::proto::ChunkType::CHUNK_TYPE_EC);
+    chunk_info.mutable_config()->set_replica_count(2);
+    chunk_info.mutable_config()->set_parity_count(1);
+    const int base_port = 8101; // NOLINT(readability-magic-numbers)
+    for (int i = 0; i < 3; i++) {
+        auto replica = chunk_info.add_replicas();
+        pain::common::to_proto(pain::ObjectId::generate(1).uuid(), replica->mutable_chunk_id());
+        replica->mutable_location()->set_uri(fmt::format("127.0.0.1:{}", base_port + i));
+    }
+
+    {
+        pain::proto::deva::CheckInChunkResponse response;
+        status = check_in_chunk(file_id, chunk_info, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        ASSERT_EQ(response.header().status(), 0) << response.header().message();
+    }
+
+    // the last chunk is replaced once sealed
+    chunk_info.set_state(pain::proto::ChunkState::CHUNK_STATE_SEALED);
+    chunk_info.set_length(4096); // NOLINT(readability-magic-numbers)
+    {
+        pain::proto::deva::CheckInChunkResponse response;
+        status = check_in_chunk(file_id, chunk_info, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        ASSERT_EQ(response.header().status(), 0) << response.header().message();
+    }
+
+    // chunks are checked in in order
+    {
+        auto skipped = chunk_info;
+        skipped.set_index(2);
+        pain::proto::deva::CheckInChunkResponse response;
+        status = check_in_chunk(file_id, skipped, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        EXPECT_EQ(response.header().status(), EINVAL);
+    }
+
+    // the chunks are found from the file
+    status = open("/ec.txt", pain::proto::deva::OpenFlag::OPEN_READ, &open_response);
+    ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+    ASSERT_EQ(open_response.file_info().chunk_infos_size(), 1);
+    EXPECT_EQ(open_response.file_info().chunk_infos(0).SerializeAsString(), chunk_info.SerializeAsString());
+    EXPECT_EQ(open_response.file_info().size(), 4096); // NOLINT(readability-magic-numbers)
+}
+
+TEST_F(TestDeva, ReportBadChunk) {
+    _mock_deva.start();
+    SCOPE_EXIT {
+        _mock_deva.stop();
+    };
+    std::string leader;
+    auto status = _mock_deva.wait_for_leader(&leader);
+    ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+
+    auto chunk_id = pain::ObjectId::generate(1);
+    pain::proto::BadChunk bad_chunk;
+    pain::common::to_proto(chunk_id, bad_chunk.mutable_chunk_id());
+    bad_chunk.set_manusya("127.0.0.1:8101");
+    bad_chunk.set_reason("checksum mismatch");
+
+    // reports of the same replica replace each other, other replicas are kept apart
+    for (const auto* manusya : {"127.0.0.1:8101", "127.0.0.1:8101", "127.0.0.1:8102"}) {
+        bad_chunk.set_manusya(manusya);
+        pain::proto::deva::ReportBadChunkResponse response;
+        status = report_bad_chunk(bad_chunk, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        ASSERT_EQ(response.header().status(), 0) << response.header().message();
+    }
+
+    {
+        pain::proto::deva::ListBadChunkResponse response;
+        status = list_bad_chunk(&response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        ASSERT_EQ(response.header().status(), 0) << response.header().message();
+        ASSERT_EQ(response.bad_chunks_size(), 2);
+        std::set<std::string> manusya;
+        for (auto& chunk : response.bad_chunks()) {
+            EXPECT_EQ(pain::common::from_proto(chunk.chunk_id()), chunk_id);
+            EXPECT_EQ(chunk.reason(), "checksum mismatch");
+            manusya.insert(chunk.manusya());
+        }
+        EXPECT_EQ(manusya, std::set<std::string>({"127.0.0.1:8101", "127.0.0.1:8102"}));
+    }
+
+    {
+        bad_chunk.clear_manusya();
+        pain::proto::deva::ReportBadChunkResponse response;
+        status = report_bad_chunk(bad_chunk, &response);
+        ASSERT_TRUE(status.ok()) << status.error_str() << "(" << status.error_code() << ")";
+        EXPECT_EQ(response.header().status(), EINVAL);
+    }
+}
+
 } // namespace
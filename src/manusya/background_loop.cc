@@ -0,0 +1,70 @@
+#include "manusya/background_loop.h"
+#include <butil/time.h>
+#include <cerrno>
+#include <format>
+#include <mutex>
+
+namespace pain::manusya {
+
+BackgroundLoop::BackgroundLoop(std::string name,
+                               std::function<void()> pass,
+                               std::function<uint64_t()> interval_us) :
+    _name(std::move(name)), _pass(std::move(pass)), _interval_us(std::move(interval_us)) {}
+
+BackgroundLoop::~BackgroundLoop() {
+    stop();
+}
+
+Status BackgroundLoop::start() {
+    std::lock_guard lock(_mutex);
+    if (_tid != 0) {
+        return Status(EEXIST, std::format("{} is started already", _name));
+    }
+    _stopped = false;
+    if (bthread_start_background(&_tid, nullptr, run, this) != 0) {
+        _tid = 0;
+        return Status(EAGAIN, std::format("failed to start {}", _name));
+    }
+    return Status::OK();
+}
+
+void BackgroundLoop::stop() {
+    bthread_t tid = 0;
+    {
+        std::lock_guard lock(_mutex);
+        _stopped = true;
+        _cond.notify_all();
+        std::swap(tid, _tid);
+    }
+    if (tid != 0) {
+        bthread_join(tid, nullptr);
+    }
+}
+
+bool BackgroundLoop::stopped() const {
+    std::lock_guard lock(_mutex);
+    return _stopped;
+}
+
+bool BackgroundLoop::wait_for(uint64_t us) {
+    auto now = static_cast<uint64_t>(butil::gettimeofday_us());
+    auto deadline = now + us;
+    std::unique_lock lock(_mutex);
+    while (!_stopped && now < deadline) {
+        _cond.wait_for(lock, static_cast<long>(deadline - now));
+        now = butil::gettimeofday_us();
+    }
+    return !_stopped;
+}
+
+void* BackgroundLoop::run(void* arg) {
+    auto* loop = static_cast<BackgroundLoop*>(arg);
+    while (true) {
+        loop->_pass();
+        if (!loop->wait_for(loop->_interval_us())) {
+            return nullptr;
+        }
+    }
+}
+
+} // namespace pain::manusya
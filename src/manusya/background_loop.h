@@ -0,0 +1,45 @@
+#pragma once
+
+#include <bthread/bthread.h>
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace pain::manusya {
+
+// BackgroundLoop runs a pass on a background bthread, then again after every interval until
+// it is stopped. A pass checks stopped() between its steps and sleeps through wait_for(), so
+// stop() cuts both the interval and the waits of a running pass short.
+class BackgroundLoop {
+public:
+    // name is used in errors, the interval is read after every pass so flag changes apply
+    // to the next wait
+    BackgroundLoop(std::string name, std::function<void()> pass, std::function<uint64_t()> interval_us);
+    ~BackgroundLoop();
+    BackgroundLoop(const BackgroundLoop&) = delete;
+    BackgroundLoop& operator=(const BackgroundLoop&) = delete;
+
+    Status start();
+    void stop();
+
+    bool stopped() const;
+
+    // sleep for us microseconds, false if stopped before or meanwhile
+    bool wait_for(uint64_t us);
+
+private:
+    static void* run(void* arg);
+
+    std::string _name;
+    std::function<void()> _pass;
+    std::function<uint64_t()> _interval_us;
+    bthread_t _tid = 0;
+    bool _stopped = false;
+    mutable bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+};
+
+} // namespace pain::manusya
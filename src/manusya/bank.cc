@@ -1,78 +1,156 @@
 #include "manusya/bank.h"
+#include <gflags/gflags.h>
 #include <pain/base/plog.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "manusya/block_cache.h"
 
 DEFINE_string(manusya_store, "memory://", "The path to store the data of manusya");
+DEFINE_uint32(manusya_load_threads, 8, "Threads to register chunks when manusya starts");
 
 namespace pain::manusya {
 
+namespace {
+// names each loading thread handles at least
+constexpr size_t kMinLoadBatch = 4096;
+constexpr uint32_t kWalkPageSize = 1024;
+} // namespace
+
 Bank& Bank::instance() {
     static Bank s_bank(Store::create(FLAGS_manusya_store.c_str()));
     return s_bank;
 }
 
 Status Bank::load() {
-    std::unique_lock lock(_mutex);
-    _store->for_each([this](const char* path) mutable {
-        PLOG_TRACE(("desc", "load chunk")("path", path));
-        auto id = ObjectId::from_str_or_die(path);
-        ChunkPtr chunk;
-        auto status = Chunk::create({}, _store, id, &chunk);
-        if (!status.ok()) {
-            PLOG_ERROR(("desc", "failed to create chunk")("error", status.error_str()));
-            return;
-        }
-        uint64_t size = 0;
-        // chunk should be sealed when loaded
-        chunk->query_and_seal(&size);
-        _chunks[id] = chunk;
+    // only names are collected here, chunks are registered as sealed without opening their
+    // files, size and checksums are read by the first get_chunk of each chunk
+    std::vector<std::string> names;
+    _store->for_each([&names](const char* path) {
+        names.emplace_back(path);
     });
+
+    auto thread_count = std::clamp<size_t>(FLAGS_manusya_load_threads, 1, names.size() / kMinLoadBatch + 1);
+    std::atomic<uint64_t> count = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([this, &names, &count, t, thread_count]() {
+            for (size_t i = t; i < names.size(); i += thread_count) {
+                // skip checksum sidecars
+                if (!ObjectId::valid(names[i])) {
+                    continue;
+                }
+                auto id = ObjectId::from_str_or_die(names[i]);
+                insert(Chunk::recover({}, _store, id));
+                count.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    PLOG_INFO(("desc", "bank loaded")("chunks", count.load())("threads", thread_count));
     return Status::OK();
 }
 
+void Bank::insert(ChunkPtr chunk) {
+    auto& s = shard(chunk->chunk_id());
+    std::unique_lock lock(s.mutex);
+    s.ids.insert(chunk->chunk_id());
+    s.chunks[chunk->chunk_id()] = std::move(chunk);
+}
+
 Status Bank::create_chunk(ChunkOptions options, uint32_t partition_id, ChunkPtr* chunk) {
     if (chunk == nullptr) {
         return Status(EINVAL, "chunk is nullptr");
     }
-    std::unique_lock lock(_mutex);
+    // the id is unique, so the chunk is created without holding any shard lock
     auto status = Chunk::create(options, _store, ObjectId::generate(partition_id), chunk);
     if (!status.ok()) {
         return status;
     }
-    _chunks[(*chunk)->chunk_id()] = *chunk;
+    insert(*chunk);
     return Status::OK();
 }
 
 Status Bank::get_chunk(ObjectId chunk_id, ChunkPtr* chunk) {
-    std::unique_lock lock(_mutex);
-    auto it = _chunks.find(chunk_id);
-    if (it == _chunks.end()) {
+    auto& s = shard(chunk_id);
+    std::unique_lock lock(s.mutex);
+    auto it = s.chunks.find(chunk_id);
+    if (it == s.chunks.end()) {
         return Status(ENOENT, "Chunk not found");
     }
     *chunk = it->second;
-    return Status::OK();
+    lock.unlock();
+    // chunks recovered by load are opened on first access
+    return (*chunk)->open();
 }
 
 Status Bank::remove_chunk(ObjectId chunk_id) {
-    std::unique_lock lock(_mutex);
-    auto it = _chunks.find(chunk_id);
-    if (it == _chunks.end()) {
+    auto& s = shard(chunk_id);
+    std::unique_lock lock(s.mutex);
+    auto it = s.chunks.find(chunk_id);
+    if (it == s.chunks.end()) {
         return Status(ENOENT, "Chunk not found");
     }
-    _chunks.erase(it);
+    auto size = it->second->size();
+    s.chunks.erase(it);
+    s.ids.erase(chunk_id);
+    lock.unlock();
+
+    BlockCache::instance().erase(chunk_id, size);
+
     _store->remove(chunk_id.str().c_str()).get();
+    _store->remove(Store::checksum_path(chunk_id.str().c_str()).c_str()).get();
     return Status::OK();
 }
 
 void Bank::list_chunk(ObjectId start, uint32_t limit, std::function<void(ObjectId chunk_id)> cb) {
-    std::unique_lock lock(_mutex);
-    auto it = _chunks.lower_bound(start);
-    for (uint32_t i = 0; i < limit && it != _chunks.end(); i++, it++) {
+    // take the first limit ids of every shard, the smallest limit of them form the page
+    std::vector<ObjectId> ids;
+    for (auto& s : _shards) {
+        std::unique_lock lock(s.mutex);
+        auto it = s.ids.lower_bound(start);
+        for (uint32_t i = 0; i < limit && it != s.ids.end(); i++, it++) {
+            ids.push_back(*it);
+        }
+    }
+    auto count = std::min<size_t>(limit, ids.size());
+    std::partial_sort(ids.begin(), ids.begin() + static_cast<ptrdiff_t>(count), ids.end());
+    for (size_t i = 0; i < count; i++) {
         try {
-            cb(it->second->chunk_id());
+            cb(ids[i]);
         } catch (const std::exception& e) {
             PLOG_ERROR(("desc", "failed to list chunk")("error", e.what()));
         }
     }
 }
 
+void Bank::for_each_chunk(const std::function<bool(const ObjectId& chunk_id)>& cb) {
+    ObjectId start;
+    bool first_page = true;
+    while (true) {
+        std::vector<ObjectId> ids;
+        list_chunk(start, kWalkPageSize, [&ids](ObjectId chunk_id) {
+            ids.push_back(chunk_id);
+        });
+        for (const auto& chunk_id : ids) {
+            // pages start with the last chunk of the previous one
+            if (!first_page && chunk_id == start) {
+                continue;
+            }
+            if (!cb(chunk_id)) {
+                return;
+            }
+        }
+        if (ids.size() < kWalkPageSize) {
+            return;
+        }
+        start = ids.back();
+        first_page = false;
+    }
+}
+
 }; // namespace pain::manusya
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <pain/base/object_id.h>
+#include <array>
+#include <set>
+#include <unordered_map>
 #include "manusya/chunk.h"
 #include "manusya/store.h"
 
@@ -21,12 +24,32 @@ public:
 
     Status remove_chunk(ObjectId chunk_id);
 
+    // chunks are listed in ObjectId order starting from start
     void list_chunk(ObjectId start, uint32_t limit, std::function<void(ObjectId chunk_id)> cb);
 
+    // visit every chunk in ObjectId order, a page of list_chunk at a time so that no shard is
+    // locked while cb runs, the walk stops once cb returns false
+    void for_each_chunk(const std::function<bool(const ObjectId& chunk_id)>& cb);
+
 private:
+    // chunks are spread over shards by the hash of ObjectId, so lookups of different chunks
+    // rarely contend, each shard also keeps its ids ordered to serve list_chunk
+    static constexpr size_t kShardCount = 64;
+
+    struct Shard {
+        std::unordered_map<ObjectId, ChunkPtr> chunks;
+        std::set<ObjectId> ids;
+        mutable bthread::Mutex mutex;
+    };
+
+    Shard& shard(const ObjectId& chunk_id) {
+        return _shards[std::hash<ObjectId>()(chunk_id) % kShardCount];
+    }
+
+    void insert(ChunkPtr chunk);
+
     StorePtr _store;
-    std::map<ObjectId, ChunkPtr> _chunks;
-    mutable bthread::Mutex _mutex;
+    std::array<Shard, kShardCount> _shards;
 };
 
 }; // namespace pain::manusya
@@ -0,0 +1,181 @@
+#include "manusya/block_cache.h"
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <mutex>
+
+DEFINE_uint64(manusya_block_cache_size,
+              256 * 1024 * 1024,
+              "Bytes of memory to cache blocks of sealed chunks, 0 disables the cache");
+
+namespace pain::manusya {
+
+namespace {
+bvar::Adder<uint64_t> g_block_cache_hit_count("manusya_block_cache_hit_count");
+bvar::Adder<uint64_t> g_block_cache_miss_count("manusya_block_cache_miss_count");
+bvar::Adder<uint64_t> g_block_cache_evict_count("manusya_block_cache_evict_count");
+bvar::Adder<int64_t> g_block_cache_bytes("manusya_block_cache_bytes");
+} // namespace
+
+BlockCache::BlockCache(uint64_t capacity, size_t shard_count) :
+    _capacity(capacity), _shards(std::max<size_t>(shard_count, 1)) {
+    for (auto& s : _shards) {
+        s.capacity = _capacity / _shards.size();
+        // start with a small cold share like CLOCK-Pro, misses of evicted blocks grow it
+        s.cold_target = std::max<uint64_t>(s.capacity / 10, std::min(kBlockSize, s.capacity));
+    }
+}
+
+BlockCache& BlockCache::instance() {
+    static BlockCache s_block_cache(FLAGS_manusya_block_cache_size);
+    return s_block_cache;
+}
+
+bool BlockCache::lookup(const ObjectId& chunk_id, uint64_t index, IOBuf* data, uint32_t* crc) {
+    Key key{chunk_id, index};
+    auto& s = shard(key);
+    std::lock_guard lock(s.mutex);
+    auto it = s.entries.find(key);
+    if (it == s.entries.end()) {
+        g_block_cache_miss_count << 1;
+        return false;
+    }
+    g_block_cache_hit_count << 1;
+    it->second->referenced = true;
+    *data = it->second->data;
+    *crc = it->second->crc;
+    return true;
+}
+
+void BlockCache::insert(const ObjectId& chunk_id, uint64_t index, const IOBuf& data, uint32_t crc) {
+    if (_capacity == 0) {
+        return;
+    }
+    Key key{chunk_id, index};
+    auto& s = shard(key);
+    std::lock_guard lock(s.mutex);
+    auto it = s.entries.find(key);
+    if (it != s.entries.end()) {
+        if (it->second->data.size() == data.size()) {
+            return;
+        }
+        // a stale partial block, replaced by the block of the sealed size
+        remove(&s, it->second.get());
+    }
+    auto entry = std::make_unique<Entry>();
+    entry->key = key;
+    entry->data = data;
+    entry->crc = crc;
+    // missed again in its test period, the block is hot and cold blocks deserve more room
+    auto ghost = s.ghost_index.find(key);
+    if (ghost != s.ghost_index.end()) {
+        s.ghosts.erase(ghost->second);
+        s.ghost_index.erase(ghost);
+        s.cold_target = std::min(s.cold_target + data.size(), s.capacity);
+        entry->hot = true;
+        s.hot.push_back(*entry);
+        s.hot_bytes += data.size();
+    } else {
+        s.cold.push_back(*entry);
+        s.cold_bytes += data.size();
+    }
+    g_block_cache_bytes << static_cast<int64_t>(data.size());
+    s.entries.emplace(key, std::move(entry));
+    evict(&s);
+}
+
+void BlockCache::erase(const ObjectId& chunk_id, uint64_t size) {
+    for (uint64_t index = 0; index * kBlockSize < size; index++) {
+        Key key{chunk_id, index};
+        auto& s = shard(key);
+        std::lock_guard lock(s.mutex);
+        auto it = s.entries.find(key);
+        if (it != s.entries.end()) {
+            remove(&s, it->second.get());
+        }
+        auto ghost = s.ghost_index.find(key);
+        if (ghost != s.ghost_index.end()) {
+            s.ghosts.erase(ghost->second);
+            s.ghost_index.erase(ghost);
+        }
+    }
+}
+
+uint64_t BlockCache::size() const {
+    uint64_t size = 0;
+    for (const auto& s : _shards) {
+        std::lock_guard lock(s.mutex);
+        size += s.hot_bytes + s.cold_bytes;
+    }
+    return size;
+}
+
+void BlockCache::evict(Shard* shard) {
+    // every pass of a hand clears a referenced bit or moves an entry towards eviction, and no
+    // bit is set while the mutex is held, so the loop ends
+    while (shard->hot_bytes + shard->cold_bytes > shard->capacity) {
+        auto hot_target = shard->capacity - std::min(shard->cold_target, shard->capacity);
+        if (!shard->cold.empty() && (shard->hot_bytes <= hot_target || shard->hot.empty())) {
+            run_cold_hand(shard);
+        } else {
+            run_hot_hand(shard);
+        }
+    }
+}
+
+void BlockCache::run_hot_hand(Shard* shard) {
+    auto& entry = shard->hot.front();
+    shard->hot.pop_front();
+    if (entry.referenced) {
+        entry.referenced = false;
+        shard->hot.push_back(entry);
+        return;
+    }
+    entry.hot = false;
+    shard->hot_bytes -= entry.data.size();
+    shard->cold_bytes += entry.data.size();
+    shard->cold.push_back(entry);
+}
+
+void BlockCache::run_cold_hand(Shard* shard) {
+    auto& entry = shard->cold.front();
+    if (entry.referenced) {
+        shard->cold.pop_front();
+        entry.referenced = false;
+        entry.hot = true;
+        shard->cold_bytes -= entry.data.size();
+        shard->hot_bytes += entry.data.size();
+        shard->hot.push_back(entry);
+        return;
+    }
+    auto key = entry.key;
+    remove(shard, &entry);
+    g_block_cache_evict_count << 1;
+    remember(shard, key);
+}
+
+void BlockCache::remember(Shard* shard, const Key& key) {
+    shard->ghosts.push_back(key);
+    shard->ghost_index.emplace(key, std::prev(shard->ghosts.end()));
+    // keep as many test periods as resident blocks, a forgotten key was not missed in its
+    // period so cold blocks get less room
+    while (shard->ghosts.size() > std::max<size_t>(shard->entries.size(), 1)) {
+        shard->ghost_index.erase(shard->ghosts.front());
+        shard->ghosts.pop_front();
+        shard->cold_target -= std::min(shard->cold_target, std::min(kBlockSize, shard->capacity / 100));
+    }
+}
+
+void BlockCache::remove(Shard* shard, Entry* entry) {
+    if (entry->hot) {
+        shard->hot.erase(shard->hot.iterator_to(*entry));
+        shard->hot_bytes -= entry->data.size();
+    } else {
+        shard->cold.erase(shard->cold.iterator_to(*entry));
+        shard->cold_bytes -= entry->data.size();
+    }
+    g_block_cache_bytes << -static_cast<int64_t>(entry->data.size());
+    shard->entries.erase(entry->key);
+}
+
+} // namespace pain::manusya
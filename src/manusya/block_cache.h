@@ -0,0 +1,112 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <pain/base/object_id.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <boost/intrusive/list.hpp>
+
+namespace pain::manusya {
+
+// BlockCache keeps verified blocks of sealed chunks in memory, sealed chunks never change so
+// the blocks need no invalidation but removal. Blocks are spread over shards by hash, each
+// shard is bounded by its share of the capacity and evicts with a CLOCK-Pro like policy:
+//
+// - a new block is cold, it is promoted to hot when referenced again before the cold hand
+//   reaches it, and evicted otherwise, so a scan touching blocks once never displaces hot ones
+// - the hot hand demotes hot blocks which were not referenced since it passed them last time
+// - keys of evicted cold blocks are remembered for a while, a block missed again in that
+//   period comes back hot and grows the share of cold blocks, while keys forgotten without
+//   being missed shrink it
+//
+// Cached data is shared with readers by reference, it is never copied out.
+class BlockCache {
+public:
+    static constexpr uint64_t kBlockSize = 64 * 1024;
+    static constexpr size_t kShardCount = 16;
+
+    BlockCache(uint64_t capacity, size_t shard_count = kShardCount);
+    ~BlockCache() = default;
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    static BlockCache& instance();
+
+    // the index-th block of chunk, crc is the crc32c of data
+    bool lookup(const ObjectId& chunk_id, uint64_t index, IOBuf* data, uint32_t* crc);
+    // a block cached with another size is replaced
+    void insert(const ObjectId& chunk_id, uint64_t index, const IOBuf& data, uint32_t crc);
+    // drop blocks of a chunk of size bytes
+    void erase(const ObjectId& chunk_id, uint64_t size);
+
+    // bytes cached
+    uint64_t size() const;
+
+    uint64_t capacity() const {
+        return _capacity;
+    }
+
+private:
+    struct Key {
+        ObjectId chunk_id;
+        uint64_t index = 0;
+
+        friend bool operator==(const Key& a, const Key& b) {
+            return a.chunk_id == b.chunk_id && a.index == b.index;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<ObjectId>()(key.chunk_id) * 31 + std::hash<uint64_t>()(key.index);
+        }
+    };
+
+    struct Entry {
+        boost::intrusive::list_member_hook<> hook;
+        Key key;
+        IOBuf data;
+        uint32_t crc = 0;
+        bool hot = false;
+        bool referenced = false;
+    };
+
+    using Clock = boost::intrusive::
+        list<Entry, boost::intrusive::member_hook<Entry, boost::intrusive::list_member_hook<>, &Entry::hook>>;
+
+    struct Shard {
+        std::unordered_map<Key, std::unique_ptr<Entry>, KeyHash> entries;
+        // the hands are at the front, entries passed by a hand move to the back
+        Clock hot;
+        Clock cold;
+        uint64_t hot_bytes = 0;
+        uint64_t cold_bytes = 0;
+        uint64_t capacity = 0;
+        // bytes the cold blocks are allowed to take, adapted by misses of evicted blocks
+        uint64_t cold_target = 0;
+        // keys of evicted cold blocks in their test period, oldest first
+        std::list<Key> ghosts;
+        std::unordered_map<Key, std::list<Key>::iterator, KeyHash> ghost_index;
+        mutable bthread::Mutex mutex;
+    };
+
+    Shard& shard(const Key& key) {
+        return _shards[KeyHash()(key) % _shards.size()];
+    }
+
+    // called with the mutex of shard held
+    void evict(Shard* shard);
+    void run_hot_hand(Shard* shard);
+    void run_cold_hand(Shard* shard);
+    void remember(Shard* shard, const Key& key);
+    void remove(Shard* shard, Entry* entry);
+
+    uint64_t _capacity;
+    std::vector<Shard> _shards;
+};
+
+} // namespace pain::manusya
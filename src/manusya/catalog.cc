@@ -0,0 +1,186 @@
+#include "manusya/catalog.h"
+#include <pain/base/plog.h>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <vector>
+#include "common/rocksdb_store.h"
+#include "common/txn_store.h"
+
+namespace pain::manusya {
+
+namespace {
+constexpr std::string_view kFileKey = "manusya.file";
+constexpr std::string_view kChecksumKey = "manusya.checksum";
+
+std::string attr_key(const std::string& name) {
+    return std::format("manusya.attr.{}", name);
+}
+
+// fields of a hash are returned with the key and a one byte separator in front
+std::string_view field_of(std::string_view key, std::string_view full_key) {
+    return full_key.substr(key.size() + 1);
+}
+
+std::string encode(const FileMeta& meta) {
+    std::string value(sizeof(meta.size) + 1, '\0');
+    memcpy(value.data(), &meta.size, sizeof(meta.size));
+    value[sizeof(meta.size)] = meta.sealed ? 1 : 0;
+    return value;
+}
+
+bool decode(std::string_view value, FileMeta* meta) {
+    if (value.size() != sizeof(meta->size) + 1) {
+        return false;
+    }
+    memcpy(&meta->size, value.data(), sizeof(meta->size));
+    meta->sealed = value[sizeof(meta->size)] != 0;
+    return true;
+}
+} // namespace
+
+Catalog::Catalog(common::StorePtr kv) : _kv(std::move(kv)) {}
+
+Status Catalog::open(const char* path, bool sync, CatalogPtr* catalog) {
+    common::RocksdbStorePtr kv;
+    // the catalog has no log of its own to recover from, it cannot skip the WAL
+    auto status = common::RocksdbStore::open(path, &kv, true, sync);
+    if (!status.ok()) {
+        return status;
+    }
+    CatalogPtr c(new Catalog(kv));
+    status = c->load();
+    if (!status.ok()) {
+        return status;
+    }
+    *catalog = std::move(c);
+    return Status::OK();
+}
+
+Status Catalog::load() {
+    std::unordered_map<std::string, FileMeta> files;
+    for (auto it = _kv->hgetall(kFileKey); it->valid(); it->next()) {
+        auto name = field_of(kFileKey, it->key());
+        FileMeta meta;
+        if (!decode(it->value(), &meta)) {
+            return Status(EBADMSG, std::format("invalid catalog entry of {}", name));
+        }
+        files.emplace(name, meta);
+    }
+    PLOG_INFO(("desc", "catalog loaded")("files", files.size()));
+    std::lock_guard lock(_mutex);
+    _files = std::move(files);
+    return Status::OK();
+}
+
+bool Catalog::empty() const {
+    std::lock_guard lock(_mutex);
+    return _files.empty();
+}
+
+Status Catalog::put(const std::string& name, const FileMeta& meta) {
+    return _kv->hset(kFileKey, name, encode(meta));
+}
+
+Status Catalog::create(const std::string& name) {
+    {
+        std::lock_guard lock(_mutex);
+        if (!_files.emplace(name, FileMeta{}).second) {
+            return Status::OK();
+        }
+    }
+    auto status = put(name, FileMeta{});
+    if (!status.ok()) {
+        std::lock_guard lock(_mutex);
+        _files.erase(name);
+    }
+    return status;
+}
+
+Status Catalog::get(const std::string& name, FileMeta* meta) const {
+    std::lock_guard lock(_mutex);
+    auto it = _files.find(name);
+    if (it == _files.end()) {
+        return Status(ENOENT, std::format("{} is not in catalog", name));
+    }
+    *meta = it->second;
+    return Status::OK();
+}
+
+Status Catalog::seal(const std::string& name, uint64_t size) {
+    FileMeta meta{.size = size, .sealed = true};
+    auto status = put(name, meta);
+    if (!status.ok()) {
+        return status;
+    }
+    std::lock_guard lock(_mutex);
+    _files[name] = meta;
+    return Status::OK();
+}
+
+Status Catalog::remove(const std::string& name) {
+    auto txn = _kv->begin_txn();
+    auto status = txn->hdel(kFileKey, name);
+    if (status.ok()) {
+        status = txn->hdel(kChecksumKey, name);
+    }
+    auto key = attr_key(name);
+    for (auto it = _kv->hgetall(key); status.ok() && it->valid(); it->next()) {
+        status = txn->hdel(key, field_of(key, it->key()));
+    }
+    if (!status.ok()) {
+        txn->rollback();
+        return status;
+    }
+    status = txn->commit();
+    if (!status.ok()) {
+        return status;
+    }
+    std::lock_guard lock(_mutex);
+    _files.erase(name);
+    return Status::OK();
+}
+
+void Catalog::for_each(std::function<void(const std::string& name, const FileMeta& meta)> cb) const {
+    // iterate a snapshot, cb may call back into the catalog
+    std::vector<std::pair<std::string, FileMeta>> files;
+    {
+        std::lock_guard lock(_mutex);
+        files.assign(_files.begin(), _files.end());
+    }
+    for (const auto& [name, meta] : files) {
+        cb(name, meta);
+    }
+}
+
+Status Catalog::set_checksums(const std::string& name, const std::string& checksums) {
+    return _kv->hset(kChecksumKey, name, checksums);
+}
+
+Status Catalog::get_checksums(const std::string& name, std::string* checksums) {
+    return _kv->hget(kChecksumKey, name, checksums);
+}
+
+Status Catalog::set_attr(const std::string& name, const std::string& key, const std::string& value) {
+    return _kv->hset(attr_key(name), key, value);
+}
+
+Status Catalog::get_attr(const std::string& name, const std::string& key, std::string* value) {
+    auto status = _kv->hget(attr_key(name), key, value);
+    // keep the errno of getxattr for missing attributes
+    if (status.error_code() == ENOENT) {
+        return Status(ENODATA, std::format("attribute {} of {} not found", key, name));
+    }
+    return status;
+}
+
+Status Catalog::list_attrs(const std::string& name, std::map<std::string, std::string>* attrs) {
+    auto key = attr_key(name);
+    for (auto it = _kv->hgetall(key); it->valid(); it->next()) {
+        (*attrs)[std::string(field_of(key, it->key()))] = it->value();
+    }
+    return Status::OK();
+}
+
+} // namespace pain::manusya
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <pain/base/types.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <boost/intrusive_ptr.hpp>
+#include "common/store.h"
+
+namespace pain::manusya {
+
+class Catalog;
+using CatalogPtr = boost::intrusive_ptr<Catalog>;
+
+struct FileMeta {
+    uint64_t size = 0;
+    bool sealed = false;
+};
+
+// Catalog records the metadata of the files of a store in an embedded key-value store: size
+// and sealed state, checksums and attributes. Sizes and states of all files are cached in
+// memory, so listing files and querying sealed files need neither syscalls nor lookups.
+// Checksums and attributes are read from the key-value store on demand.
+class Catalog {
+public:
+    Catalog(common::StorePtr kv);
+    ~Catalog() = default;
+
+    // open a catalog backed by rocksdb at path, updates always go to its WAL so they survive a
+    // crash of the process, sync also makes every update durable against power loss when returns
+    static Status open(const char* path, bool sync, CatalogPtr* catalog);
+
+    // load cached metadata from the key-value store
+    Status load();
+
+    bool empty() const;
+
+    // records a new unsealed file, it is a no-op if the file exists
+    Status create(const std::string& name);
+    Status get(const std::string& name, FileMeta* meta) const;
+    // records the final size and sealed state
+    Status seal(const std::string& name, uint64_t size);
+    // removes metadata, checksums and attributes of the file in one transaction
+    Status remove(const std::string& name);
+    void for_each(std::function<void(const std::string& name, const FileMeta& meta)> cb) const;
+
+    Status set_checksums(const std::string& name, const std::string& checksums);
+    Status get_checksums(const std::string& name, std::string* checksums);
+
+    Status set_attr(const std::string& name, const std::string& key, const std::string& value);
+    Status get_attr(const std::string& name, const std::string& key, std::string* value);
+    // attributes are listed with one prefix scan
+    Status list_attrs(const std::string& name, std::map<std::string, std::string>* attrs);
+
+private:
+    friend void intrusive_ptr_add_ref(Catalog* catalog) {
+        catalog->_use_count++;
+    }
+
+    friend void intrusive_ptr_release(Catalog* catalog) {
+        if (catalog->_use_count.fetch_sub(1) == 1) {
+            delete catalog;
+        }
+    }
+
+    Status put(const std::string& name, const FileMeta& meta);
+
+    common::StorePtr _kv;
+    std::unordered_map<std::string, FileMeta> _files;
+    mutable bthread::Mutex _mutex;
+    std::atomic<int> _use_count = 0;
+};
+
+} // namespace pain::manusya
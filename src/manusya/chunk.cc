@@ -1,135 +1,529 @@
 #include "manusya/chunk.h"
+#include <butil/time.h>
+#include <bvar/bvar.h>
 #include <fcntl.h>
+#include <gflags/gflags.h>
 #include <pain/base/plog.h>
+#include <algorithm>
 #include <cerrno>
+#include <cstring>
 #include <format>
 #include <mutex>
+#include "common/crc32c.h"
+#include "manusya/block_cache.h"
 #include "manusya/file_handle.h"
+#include "manusya/io_scheduler.h"
 #include "manusya/macro.h"
 
+DEFINE_uint64(manusya_max_pending_append_bytes_per_chunk,
+              64 * 1024 * 1024,
+              "Max bytes of out-of-order appends parked in one chunk");
+DEFINE_uint64(manusya_max_pending_append_bytes,
+              1024 * 1024 * 1024,
+              "Max bytes of out-of-order appends parked in the whole process");
+
 namespace pain::manusya {
 
-Status Chunk::append(const IOBuf& buf, uint64_t offset) {
+namespace {
+std::atomic<uint64_t> s_pending_append_bytes = 0;
+std::atomic<uint64_t> s_pending_append_count = 0;
+
+template <typename T>
+T load_atomic(void* arg) {
+    return static_cast<std::atomic<T>*>(arg)->load(std::memory_order_relaxed);
+}
+
+bvar::PassiveStatus<uint64_t> g_pending_append_bytes("manusya_pending_append_bytes",
+                                                      load_atomic<uint64_t>,
+                                                      &s_pending_append_bytes);
+bvar::PassiveStatus<uint64_t> g_pending_append_count("manusya_pending_append_count",
+                                                      load_atomic<uint64_t>,
+                                                      &s_pending_append_count);
+bvar::Adder<uint64_t> g_rejected_append_count("manusya_rejected_append_count");
+bvar::Adder<uint64_t> g_checksum_error_count("manusya_checksum_error_count");
+
+// checksums of buf written at offset, split at checksum block boundaries
+std::vector<uint32_t> block_crcs(const IOBuf& buf, uint64_t offset) {
+    return common::crc32c_blocks(buf, kChecksumBlockSize - offset % kChecksumBlockSize, kChecksumBlockSize);
+}
+} // namespace
+
+Status Chunk::append(const IOBuf& buf, uint64_t offset, const AppendOptions& options) {
     SPAN(span);
+    _access_time_us.store(butil::gettimeofday_us(), std::memory_order_relaxed);
+    AppendRequestPtr rq(new AppendRequest());
+    rq->offset = offset;
+    rq->buf = buf;
+    rq->direct_io = options.direct_io;
+    rq->io_tag = options.io_tag;
+    // checksum outside the lock, the client's crc is combined from the block pieces
+    rq->crcs = block_crcs(buf, offset);
+    if (options.crc32.has_value()) {
+        uint32_t crc = 0;
+        uint64_t pos = offset;
+        for (auto piece : rq->crcs) {
+            auto len = std::min(offset + buf.size() - pos, kChecksumBlockSize - pos % kChecksumBlockSize);
+            crc = common::crc32c_combine(crc, piece, len);
+            pos += len;
+        }
+        if (crc != *options.crc32) {
+            g_checksum_error_count << 1;
+            return Status(EBADMSG,
+                          std::format("checksum mismatch at {}@{}, expected:{:#x}, actual:{:#x}",
+                                      offset,
+                                      buf.size(),
+                                      *options.crc32,
+                                      crc));
+        }
+    }
+    rq->chunk = this;
+    rq->start = butil::cpuwide_time_ns();
+    rq->span = span;
+    auto future = rq->promise.get_future();
+
+    std::vector<AppendRequestPtr> requests;
     std::unique_lock lock(_mutex);
+    if (_state == ChunkState::kInit) {
+        return Status(EBADF, "chunk is not opened");
+    }
     if (_state == ChunkState::kSealed) {
         return Status(EPERM, "chunk is sealed");
     }
 
-    if (offset < _size) {
-        return Status(EINVAL, std::format("invalid offset at {}@{}, current size:{}", offset, buf.size(), _size));
+    if (offset < _write_offset) {
+        return Status(EINVAL, std::format("invalid offset at {}@{}, current size:{}", offset, buf.size(), size()));
     }
 
-    if (offset != _size) {
-        AppendRequestPtr rq(new AppendRequest());
-        rq->offset = offset;
-        rq->buf = buf;
-        rq->chunk = this;
-        rq->start = butil::cpuwide_time_ns();
-        rq->span = span;
-        constexpr uint64_t timeout_us = 5 * 1000 * 1000; // 5s
-        auto abstime = butil::microseconds_from_now(timeout_us);
+    if (offset != _write_offset) {
+        auto status = park(rq.get());
+        if (!status.ok()) {
+            return status;
+        }
 
         // add ref to prevent rq from being destroyed before the timer callback is called
+        constexpr uint64_t timeout_us = 5 * 1000 * 1000; // 5s
         intrusive_ptr_add_ref(rq.get());
-        bthread_timer_add(
+        TimerWheel::instance().add(
             &rq->timer,
-            abstime,
+            timeout_us,
             [](void* arg) {
                 auto rq = static_cast<AppendRequest*>(arg);
                 auto root_scope = Tracer::WithActiveSpan(rq->span);
                 SPAN(span, "timeout");
                 std::unique_lock lock(rq->chunk->_mutex);
-                if (rq->promise.is_ready()) {
-                    PLOG_DEBUG(("desc", "append request is ready"));
+                // rq has been issued or failed by others
+                if (!rq->is_linked()) {
+                    PLOG_DEBUG(("desc", "append request is issued"));
+                    lock.unlock();
+                    intrusive_ptr_release(rq);
                     return;
                 }
-                rq->unlink();
+                rq->chunk->unpark(rq);
                 rq->promise.set_value(Status(
                     EINVAL,
                     std::format(
-                        "invalid offset at {}@{}, current size:{}", rq->offset, rq->buf.size(), rq->chunk->_size)));
+                        "invalid offset at {}@{}, current size:{}", rq->offset, rq->buf.size(), rq->chunk->size())));
+                lock.unlock();
                 intrusive_ptr_release(rq);
             },
             rq.get());
+    } else {
+        reserve(rq, &requests);
+    }
+    lock.unlock();
+
+    if (options.accepted) {
+        options.accepted();
+    }
+    submit(requests);
+    auto status = future.get();
+    rq->end = butil::cpuwide_time_ns();
+    return status;
+}
 
-        _append_request_queue.insert(*rq);
-        lock.unlock();
-        auto status = rq->promise.get_future().get();
-        rq->end = butil::cpuwide_time_ns();
+void Chunk::reserve(AppendRequestPtr rq, std::vector<AppendRequestPtr>* requests) {
+    BOOST_ASSERT(rq->offset == _write_offset);
+    _write_offset += rq->buf.size();
+    _inflight_requests.push_back(rq);
+    requests->push_back(std::move(rq));
 
-        return status;
+    // pending requests which become contiguous can be issued together
+    while (!_append_request_queue.empty()) {
+        AppendRequestPtr next(&*_append_request_queue.begin());
+        if (next->offset > _write_offset) {
+            break;
+        }
+        unpark(next.get());
+        cancel_timer(next.get());
+        if (next->offset < _write_offset) {
+            next->promise.set_value(Status(
+                EINVAL,
+                std::format("invalid offset at {}@{}, current size:{}", next->offset, next->buf.size(), size())));
+            continue;
+        }
+        _write_offset += next->buf.size();
+        _inflight_requests.push_back(next);
+        requests->push_back(std::move(next));
+    }
+}
+
+void Chunk::submit(const std::vector<AppendRequestPtr>& requests) {
+    if (requests.empty()) {
+        return;
+    }
+    // one slot covers the writes of the batch and is held only while they are on the store,
+    // parked appends hold none, or they could take every slot from the append filling their gap
+    uint64_t bytes = 0;
+    for (const auto& rq : requests) {
+        bytes += rq->buf.size();
+    }
+    auto slot = IoScheduler::instance().admit(requests.front()->io_tag, bytes);
+    // issue all writes before waiting for any of them
+    std::vector<Future<Status>> futures;
+    futures.reserve(requests.size());
+    for (const auto& rq : requests) {
+        futures.push_back(rq->direct_io ? _fh->append_direct(rq->offset, rq->buf) : _fh->append(rq->offset, rq->buf));
     }
+    for (size_t i = 0; i < requests.size(); i++) {
+        complete(requests[i].get(), futures[i].get());
+    }
+}
 
-    auto status = _fh->append(offset, buf).get();
+void Chunk::complete(AppendRequest* rq, Status status) {
+    std::unique_lock lock(_mutex);
+    rq->status = std::move(status);
+    rq->done = true;
 
-    if (!status.ok()) {
-        return status;
+    // commit in offset order, a failed write breaks all requests behind it
+    while (!_inflight_requests.empty() && _inflight_requests.front()->done) {
+        auto front = std::move(_inflight_requests.front());
+        _inflight_requests.pop_front();
+        auto current_size = size();
+        auto front_status = std::move(front->status);
+        if (front_status.ok() && front->offset != current_size) {
+            front_status = Status(EIO,
+                                  std::format("preceding append failed, offset at {}@{}, current size:{}",
+                                              front->offset,
+                                              front->buf.size(),
+                                              current_size));
+        }
+        if (front_status.ok()) {
+            std::lock_guard crc_lock(_crc_mutex);
+            commit_crcs(*front);
+            _size.store(current_size + front->buf.size(), std::memory_order_release);
+        }
+        front->promise.set_value(std::move(front_status));
     }
 
-    _size += buf.size();
+    if (_inflight_requests.empty()) {
+        _write_offset = size();
+        _inflight_cond.notify_all();
+    }
+}
 
-    while (!_append_request_queue.empty()) {
-        auto it = _append_request_queue.begin();
-        auto rq = &*it;
-        if (rq->offset < _size) {
-            rq->unlink();
-            if (!rq->promise.is_ready()) {
-                rq->promise.set_value(
-                    Status(EINVAL,
-                           std::format("invalid offset at {}@{}, current size:{}", rq->offset, rq->buf.size(), _size)));
-            }
-        } else if (rq->offset == _size) {
-            auto status = _fh->append(rq->offset, rq->buf).get();
-            if (status.ok()) {
-                _size += rq->buf.size();
-            }
-            rq->unlink();
-            if (!rq->promise.is_ready()) {
-                rq->promise.set_value(status);
-            }
-        } else {
-            break;
+void Chunk::commit_crcs(const AppendRequest& rq) {
+    uint64_t pos = rq.offset;
+    uint64_t end = rq.offset + rq.buf.size();
+    for (auto crc : rq.crcs) {
+        auto in_block = pos % kChecksumBlockSize;
+        auto len = std::min(end - pos, kChecksumBlockSize - in_block);
+        _tail_crc = in_block == 0 ? crc : common::crc32c_combine(_tail_crc, crc, len);
+        pos += len;
+        if (pos % kChecksumBlockSize == 0) {
+            _block_crcs.push_back(_tail_crc);
+            _tail_crc = 0;
         }
     }
+}
+
+Status Chunk::park(AppendRequest* rq) {
+    auto bytes = rq->buf.size();
+    if (_pending_bytes + bytes > FLAGS_manusya_max_pending_append_bytes_per_chunk) {
+        g_rejected_append_count << 1;
+        return Status(EAGAIN,
+                      std::format("too many pending appends in chunk, offset at {}@{}, pending bytes:{}",
+                                  rq->offset,
+                                  bytes,
+                                  _pending_bytes));
+    }
+    auto total = s_pending_append_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (total + bytes > FLAGS_manusya_max_pending_append_bytes) {
+        s_pending_append_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        g_rejected_append_count << 1;
+        return Status(EAGAIN,
+                      std::format("too many pending appends, offset at {}@{}, pending bytes:{}",
+                                  rq->offset,
+                                  bytes,
+                                  total));
+    }
+    if (!_append_request_queue.insert(*rq).second) {
+        s_pending_append_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        return Status(EEXIST, std::format("duplicated append at {}@{}", rq->offset, bytes));
+    }
+    s_pending_append_count.fetch_add(1, std::memory_order_relaxed);
+    _pending_bytes += bytes;
+    _pending_count++;
     return Status::OK();
 }
 
+void Chunk::unpark(AppendRequest* rq) {
+    auto bytes = rq->buf.size();
+    rq->unlink();
+    s_pending_append_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    s_pending_append_count.fetch_sub(1, std::memory_order_relaxed);
+    _pending_bytes -= bytes;
+    _pending_count--;
+}
+
+uint64_t Chunk::pending_bytes() const {
+    std::lock_guard lock(_mutex);
+    return _pending_bytes;
+}
+
+uint64_t Chunk::pending_count() const {
+    std::lock_guard lock(_mutex);
+    return _pending_count;
+}
+
+void Chunk::cancel_timer(AppendRequest* rq) {
+    // release the ref held by timer if the callback will never run
+    if (TimerWheel::instance().cancel(&rq->timer)) {
+        intrusive_ptr_release(rq);
+    }
+}
+
 Status Chunk::query_and_seal(uint64_t* length) {
     SPAN(span);
     if (length == nullptr) {
         return Status(EINVAL, "length is nullptr");
     }
-    std::lock_guard lock(_mutex);
+    std::unique_lock lock(_mutex);
+    // fail pending requests and wait for inflight ones, so that the length is stable
+    auto state = _state.load();
+    if (state == ChunkState::kInit) {
+        return Status(EBADF, "chunk is not opened");
+    }
+    _state = ChunkState::kSealed;
+    while (!_append_request_queue.empty()) {
+        AppendRequestPtr rq(&*_append_request_queue.begin());
+        unpark(rq.get());
+        cancel_timer(rq.get());
+        rq->promise.set_value(Status(EPERM, "chunk is sealed"));
+    }
+    while (!_inflight_requests.empty()) {
+        _inflight_cond.wait(lock);
+    }
+
     auto status = _fh->seal().get();
     if (!status.ok()) {
+        _state = state;
         return status;
     }
     status = _fh->size(length).get();
     if (!status.ok()) {
+        _state = state;
         return status;
     }
-    _state = ChunkState::kSealed;
+    _sealed.store(true, std::memory_order_release);
+    if (!_crcs_persisted) {
+        status = persist_crcs();
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to persist checksums") //
+                       ("chunk", _chunk_id.str())                  //
+                       ("error", status.error_str()));
+            return status;
+        }
+    }
     return status;
 }
 
-Status Chunk::read(uint64_t offset, uint64_t size, IOBuf* buf) const {
+Status Chunk::persist_crcs() {
+    std::string data;
+    {
+        std::lock_guard lock(_crc_mutex);
+        if (!_verify) {
+            return Status::OK();
+        }
+        data.reserve((_block_crcs.size() + 1) * sizeof(uint32_t));
+        for (auto crc : _block_crcs) {
+            data.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+        }
+        if (size() % kChecksumBlockSize != 0) {
+            data.append(reinterpret_cast<const char*>(&_tail_crc), sizeof(_tail_crc));
+        }
+    }
+
+    auto status = _store->set_checksums(_chunk_id.str().c_str(), data).get();
+    if (!status.ok()) {
+        return status;
+    }
+    _crcs_persisted = true;
+    return Status::OK();
+}
+
+Status Chunk::load_crcs(uint64_t size) {
+    std::string data;
+    auto status = _store->get_checksums(_chunk_id.str().c_str(), &data).get();
+    if (status.error_code() == ENOENT) {
+        PLOG_WARN(("desc", "chunk has no checksums")("chunk", _chunk_id.str()));
+        _verify = false;
+        return Status::OK();
+    }
+    if (!status.ok()) {
+        return status;
+    }
+    uint64_t count = (size + kChecksumBlockSize - 1) / kChecksumBlockSize;
+    if (data.size() != count * sizeof(uint32_t)) {
+        return Status(
+            EIO,
+            std::format("checksums of {} have {} bytes, expected {}", _chunk_id.str(), data.size(), count * sizeof(uint32_t)));
+    }
+    std::vector<uint32_t> crcs(count);
+    memcpy(crcs.data(), data.data(), data.size());
+    if (size % kChecksumBlockSize != 0) {
+        _tail_crc = crcs.back();
+        crcs.pop_back();
+    }
+    _block_crcs = std::move(crcs);
+    _crcs_persisted = true;
+    return Status::OK();
+}
+
+Status Chunk::read(uint64_t offset, uint64_t size, IOBuf* buf, uint32_t* crc, const ReadOptions& options) const {
     SPAN(span);
     if (buf == nullptr) {
         return Status(EINVAL, "buf is nullptr");
     }
-    std::lock_guard lock(_mutex);
-    if (offset + size > _size) {
-        return Status(EINVAL,
-                      std::format("read out of range, offset:{}, size:{}, current size:{}", offset, size, _size));
+    if (options.background) {
+        return read_store(offset, size, buf, crc);
     }
-    FileHandlePtr fh;
-    auto status = _store->open(_chunk_id.str().c_str(), O_RDONLY, &fh).get();
+    _access_time_us.store(butil::gettimeofday_us(), std::memory_order_relaxed);
+    // sealed chunks never change, their blocks are served from the block cache, but not while
+    // sealing since the last block may still grow or the seal may fail
+    if (_sealed.load(std::memory_order_acquire) && size > 0 && BlockCache::instance().capacity() > 0) {
+        return read_cached(offset, size, buf, crc);
+    }
+    return read_store(offset, size, buf, crc);
+}
+
+Status Chunk::read_cached(uint64_t offset, uint64_t size, IOBuf* buf, uint32_t* crc) const {
+    auto current_size = this->size();
+    if (offset > current_size || size > current_size - offset) {
+        return Status(
+            EINVAL,
+            std::format("read out of range, offset:{}, size:{}, current size:{}", offset, size, current_size));
+    }
+    auto& cache = BlockCache::instance();
+    auto end = offset + size;
+    uint32_t result = 0;
+    for (auto i = offset / BlockCache::kBlockSize; i * BlockCache::kBlockSize < end; i++) {
+        auto block_start = i * BlockCache::kBlockSize;
+        auto len = std::min(BlockCache::kBlockSize, current_size - block_start);
+        IOBuf block;
+        uint32_t block_crc = 0;
+        // a block cached shorter than the sealed chunk has is stale
+        if (!cache.lookup(_chunk_id, i, &block, &block_crc) || block.size() != len) {
+            block.clear();
+            auto status = read_store(block_start, len, &block, &block_crc);
+            if (!status.ok()) {
+                return status;
+            }
+            cache.insert(_chunk_id, i, block, block_crc);
+        }
+        // blocks share their memory with the cache, only the edge blocks are trimmed
+        auto from = std::max(block_start, offset) - block_start;
+        auto n = std::min<uint64_t>(block_start + block.size(), end) - block_start - from;
+        if (n != block.size()) {
+            IOBuf part;
+            block.append_to(&part, n, from);
+            block.swap(part);
+            block_crc = common::crc32c(block);
+        }
+        result = common::crc32c_combine(result, block_crc, block.size());
+        buf->append(std::move(block));
+    }
+    if (crc != nullptr) {
+        *crc = result;
+    }
+    return Status::OK();
+}
+
+Status Chunk::read_store(uint64_t offset, uint64_t size, IOBuf* buf, uint32_t* crc) const {
+    // committed data is never rewritten, so reads within the committed size neither take
+    // the chunk mutex nor open a new handle, concurrent readers only share the store handle
+    // and copy the checksums of the blocks they cover
+    uint64_t first = offset / kChecksumBlockSize;
+    uint64_t last = (offset + size + kChecksumBlockSize - 1) / kChecksumBlockSize;
+    uint64_t current_size = 0;
+    bool verify = false;
+    std::vector<uint32_t> crcs;
+    if (state() == ChunkState::kInit) {
+        return Status(EBADF, "chunk is not opened");
+    }
+    {
+        std::lock_guard lock(_crc_mutex);
+        current_size = this->size();
+        if (offset > current_size || size > current_size - offset) {
+            return Status(EINVAL,
+                          std::format(
+                              "read out of range, offset:{}, size:{}, current size:{}", offset, size, current_size));
+        }
+        verify = _verify;
+        if (verify && size > 0) {
+            auto full_end = std::min<uint64_t>(last, _block_crcs.size());
+            crcs.assign(_block_crcs.begin() + static_cast<ptrdiff_t>(std::min(first, full_end)),
+                        _block_crcs.begin() + static_cast<ptrdiff_t>(full_end));
+            if (last > _block_crcs.size()) {
+                crcs.push_back(_tail_crc);
+            }
+        }
+    }
+    if (size == 0 || !verify) {
+        auto status = _fh->read(offset, size, buf).get();
+        if (status.ok() && crc != nullptr) {
+            *crc = common::crc32c(*buf);
+        }
+        return status;
+    }
+
+    auto start = first * kChecksumBlockSize;
+    auto end = std::min(last * kChecksumBlockSize, current_size);
+    IOBuf data;
+    auto status = _fh->read(start, end - start, &data).get();
     if (!status.ok()) {
         return status;
     }
-    status = fh->read(offset, size, buf).get();
-    return status;
+
+    // verify every covered block, then trim the edge blocks to the requested range
+    buf->clear();
+    uint32_t result = 0;
+    for (auto i = first; i < last; i++) {
+        auto block_start = i * kChecksumBlockSize;
+        IOBuf block;
+        data.cutn(&block, std::min(kChecksumBlockSize, end - block_start));
+        auto actual = common::crc32c(block);
+        if (actual != crcs[i - first]) {
+            g_checksum_error_count << 1;
+            return Status(EIO,
+                          std::format("checksum mismatch in block {} of chunk {}, expected:{:#x}, actual:{:#x}",
+                                      i,
+                                      _chunk_id.str(),
+                                      crcs[i - first],
+                                      actual));
+        }
+        auto block_end = block_start + block.size();
+        if (block_start < offset || block_end > offset + size) {
+            block.pop_front(std::max(block_start, offset) - block_start);
+            block.pop_back(block_end - std::min(block_end, offset + size));
+            actual = common::crc32c(block);
+        }
+        result = common::crc32c_combine(result, actual, block.size());
+        buf->append(std::move(block));
+    }
+    if (crc != nullptr) {
+        *crc = result;
+    }
+    return Status::OK();
 }
 
 Status Chunk::create(const ChunkOptions& options, StorePtr store, const ObjectId& chunk_id, ChunkPtr* chunk) {
@@ -144,20 +538,67 @@ Status Chunk::create(const ChunkOptions& options, StorePtr store, const ObjectId
     c->_chunk_id = chunk_id;
     c->_options = options;
     c->_store = store;
+    c->_access_time_us = butil::gettimeofday_us();
     auto status = store->open(c->_chunk_id.str().c_str(), O_CREAT | O_RDWR | O_EXCL, &c->_fh).get();
 
     if (!status.ok()) {
         return status;
     }
     c->_state = ChunkState::kOpen;
-    status = c->_fh->size(&c->_size).get();
+    uint64_t size = 0;
+    status = c->_fh->size(&size).get();
 
     if (!status.ok()) {
         return status;
     }
+    c->_size = size;
+    c->_write_offset = size;
 
     *chunk = c;
     return Status::OK();
 }
 
+ChunkPtr Chunk::recover(const ChunkOptions& options, StorePtr store, const ObjectId& chunk_id) {
+    auto c = ChunkPtr(new Chunk());
+    c->_chunk_id = chunk_id;
+    c->_options = options;
+    c->_store = std::move(store);
+    c->_access_time_us = butil::gettimeofday_us();
+    return c;
+}
+
+Status Chunk::open() {
+    if (state() != ChunkState::kInit) {
+        return Status::OK();
+    }
+    SPAN(span);
+    std::unique_lock lock(_mutex);
+    if (state() != ChunkState::kInit) {
+        return Status::OK();
+    }
+    FileHandlePtr fh;
+    auto status = _store->open(_chunk_id.str().c_str(), O_RDONLY, &fh).get();
+    if (!status.ok()) {
+        return status;
+    }
+    uint64_t size = 0;
+    status = fh->size(&size).get();
+    if (!status.ok()) {
+        return status;
+    }
+    {
+        std::lock_guard crc_lock(_crc_mutex);
+        status = load_crcs(size);
+        if (!status.ok()) {
+            return status;
+        }
+        _size = size;
+    }
+    _fh = std::move(fh);
+    _write_offset = size;
+    _sealed.store(true, std::memory_order_release);
+    _state.store(ChunkState::kSealed, std::memory_order_release);
+    return Status::OK();
+}
+
 } // namespace pain::manusya
@@ -1,15 +1,22 @@
 #pragma once
 
+#include <bthread/condition_variable.h>
 #include <bthread/mutex.h>
-#include <bthread/unstable.h>
 #include <pain/base/future.h>
 #include <pain/base/object_id.h>
 #include <pain/base/tracer.h>
 #include <pain/base/types.h>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
 #include <boost/intrusive/set.hpp>
 #include <boost/intrusive_ptr.hpp>
+#include "pain/proto/common.pb.h"
 #include "manusya/file_handle.h"
+#include "manusya/timer_wheel.h"
 
 namespace pain::manusya {
 
@@ -18,6 +25,28 @@ using ChunkPtr = boost::intrusive_ptr<Chunk>;
 
 struct ChunkOptions {};
 
+// appended data is checksummed with crc32c in blocks of this size, the checksums are kept in
+// memory while the chunk is open and persisted to the store when it is sealed
+constexpr uint64_t kChecksumBlockSize = 4096;
+
+struct AppendOptions {
+    // bypass the page cache of the store
+    bool direct_io = false;
+    // crc32c of the appended data computed by client, verified before writing
+    std::optional<uint32_t> crc32;
+    // scheduling of the store write, see IoScheduler
+    proto::IoTag io_tag;
+    // called once the append is admitted, reserved at the write offset or parked for a gap,
+    // before it is written, appends rejected up front never call it
+    std::function<void()> accepted;
+};
+
+struct ReadOptions {
+    // reads of background work, such as erasure coding, neither count as accesses nor fill
+    // the block cache, so they leave cold chunks cold
+    bool background = false;
+};
+
 enum class ChunkState {
     kInit = 0,
     kOpen = 1,
@@ -32,9 +61,17 @@ struct AppendRequest
     uint64_t end = 0;
     ChunkPtr chunk;
     Promise<Status> promise;
-    bthread_timer_t timer;
+    TimerWheel::Timer timer;
     std::shared_ptr<opentelemetry::trace::Span> span;
-    int use_count = 0;
+    // result of the store write, only valid when done is true
+    Status status;
+    bool done = false;
+    // bypass the page cache of the store
+    bool direct_io = false;
+    proto::IoTag io_tag;
+    // crc32c of buf split at checksum block boundaries
+    std::vector<uint32_t> crcs;
+    std::atomic<int> use_count = 0;
 
     friend bool operator<(const AppendRequest& a, const AppendRequest& b) {
         return a.offset < b.offset;
@@ -49,7 +86,7 @@ struct AppendRequest
         rq->use_count++;
     }
     friend void intrusive_ptr_release(AppendRequest* rq) {
-        if (--rq->use_count == 0) {
+        if (rq->use_count.fetch_sub(1) == 1) {
             delete rq;
         }
     }
@@ -65,20 +102,40 @@ public:
 
     static Status create(const ChunkOptions& options, StorePtr store, const ObjectId& chunk_id, ChunkPtr* chunk);
 
+    // registers a chunk found in store without touching its file, a recovered chunk is sealed
+    // and stays in kInit until open() reads its size and checksums on first access
+    static ChunkPtr recover(const ChunkOptions& options, StorePtr store, const ObjectId& chunk_id);
+    Status open();
+
     const ObjectId& chunk_id() const {
         return _chunk_id;
     }
-    Status append(const IOBuf& buf, uint64_t offset);
+    Status append(const IOBuf& buf, uint64_t offset, const AppendOptions& options = {});
     Status query_and_seal(uint64_t* length);
-    Status read(uint64_t offset, uint64_t size, IOBuf* buf) const;
+    // blocks covering the range are verified against their checksums, crc is set to the
+    // crc32c of the returned data if not nullptr
+    Status read(uint64_t offset,
+                uint64_t size,
+                IOBuf* buf,
+                uint32_t* crc = nullptr,
+                const ReadOptions& options = {}) const;
     uint64_t size() const {
-        return _size;
+        return _size.load(std::memory_order_acquire);
     }
 
     ChunkState state() const {
-        return _state;
+        return _state.load(std::memory_order_acquire);
     }
 
+    // time of the last append or read in microseconds, or of loading the chunk if none since
+    uint64_t access_time_us() const {
+        return _access_time_us.load(std::memory_order_relaxed);
+    }
+
+    // bytes and count of out-of-order appends waiting for the gap before them
+    uint64_t pending_bytes() const;
+    uint64_t pending_count() const;
+
     const ChunkOptions& options() const {
         return _options;
     }
@@ -98,16 +155,53 @@ private:
         }
     }
 
+    // offsets are reserved under _mutex, written to store without holding it, and
+    // committed in offset order once all preceding writes have completed
+    void reserve(AppendRequestPtr rq, std::vector<AppendRequestPtr>* requests);
+    void submit(const std::vector<AppendRequestPtr>& requests);
+    void complete(AppendRequest* rq, Status status);
+    void cancel_timer(AppendRequest* rq);
+    Status park(AppendRequest* rq);
+    void unpark(AppendRequest* rq);
+    // fold checksums of a committed request, called with _crc_mutex held
+    void commit_crcs(const AppendRequest& rq);
+    Status persist_crcs();
+    // read through the block cache, only once the seal completed
+    Status read_cached(uint64_t offset, uint64_t size, IOBuf* buf, uint32_t* crc) const;
+    // read from store and verify the checksums
+    Status read_store(uint64_t offset, uint64_t size, IOBuf* buf, uint32_t* crc) const;
+    Status load_crcs(uint64_t size);
+
     ObjectId _chunk_id;
-    uint64_t _size = 0;
-    ChunkState _state = ChunkState::kInit;
+    // committed size, all data before it is durable in store
+    std::atomic<uint64_t> _size = 0;
+    // reserved size, writes in [_size, _write_offset) are in flight
+    uint64_t _write_offset = 0;
+    std::atomic<ChunkState> _state = ChunkState::kInit;
+    // the store sealed the file and _size is final, reads go through the block cache from then
+    // on, _state turns kSealed earlier to stop appends while in-flight ones finish
+    std::atomic<bool> _sealed = false;
     std::atomic<int> _use_count = 0;
+    mutable std::atomic<uint64_t> _access_time_us = 0;
     ChunkOptions _options;
 
     FileHandlePtr _fh;
     AppendRequestQueue _append_request_queue;
+    uint64_t _pending_bytes = 0;
+    uint64_t _pending_count = 0;
+    std::deque<AppendRequestPtr> _inflight_requests;
     StorePtr _store;
     mutable bthread::Mutex _mutex;
+    bthread::ConditionVariable _inflight_cond;
+
+    // checksums of full blocks and of the partial last block of committed data, _size is
+    // updated together with them under _crc_mutex so readers get a consistent snapshot
+    std::vector<uint32_t> _block_crcs;
+    uint32_t _tail_crc = 0;
+    // chunks loaded without a sidecar are not verified
+    bool _verify = true;
+    bool _crcs_persisted = false;
+    mutable bthread::Mutex _crc_mutex;
 };
 
 } // namespace pain::manusya
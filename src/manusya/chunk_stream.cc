@@ -0,0 +1,301 @@
+#include "manusya/chunk_stream.h"
+#include <arpa/inet.h>
+#include <bthread/bthread.h>
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include <string>
+#include "pain/proto/manusya.pb.h"
+
+DEFINE_uint64(manusya_chunk_stream_max_inflight_bytes,
+              16 * 1024 * 1024,
+              "Max bytes being appended for one chunk stream, receiving blocks beyond it");
+DEFINE_int64(manusya_chunk_stream_idle_timeout_ms, 60000, "Chunk streams without data for this long are closed");
+DEFINE_uint32(manusya_read_stream_segment_size, 1024 * 1024, "Default size of segments sent by chunk read streams");
+DEFINE_uint32(manusya_read_stream_max_segment_size,
+              4 * 1024 * 1024,
+              "Max size of segments sent by chunk read streams");
+DEFINE_uint32(manusya_read_stream_max_credits, 64, "Max segments a reader may grant to a chunk read stream at once");
+
+namespace pain::manusya {
+
+namespace {
+bvar::Adder<uint64_t> g_chunk_stream_bytes("manusya_chunk_stream_bytes");
+bvar::Adder<int64_t> g_chunk_stream_count("manusya_chunk_stream_count");
+bvar::Adder<uint64_t> g_read_stream_bytes("manusya_read_stream_bytes");
+bvar::Adder<int64_t> g_read_stream_count("manusya_read_stream_count");
+} // namespace
+
+ChunkStream::ChunkStream(ChunkPtr chunk, uint64_t offset, bool direct_io) :
+    _chunk(std::move(chunk)), _direct_io(direct_io), _offset(offset) {
+    g_chunk_stream_count << 1;
+}
+
+Status ChunkStream::accept(brpc::Controller* cntl, ChunkPtr chunk, uint64_t offset, bool direct_io) {
+    auto* stream = new ChunkStream(std::move(chunk), offset, direct_io);
+    brpc::StreamOptions options;
+    options.handler = stream;
+    options.idle_timeout_ms = FLAGS_manusya_chunk_stream_idle_timeout_ms;
+    brpc::StreamId id = brpc::INVALID_STREAM_ID;
+    if (brpc::StreamAccept(&id, *cntl, &options) != 0) {
+        delete stream;
+        return Status(EIO, "failed to accept stream");
+    }
+    return Status::OK();
+}
+
+int ChunkStream::on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) {
+    auto* batch = new Batch();
+    batch->stream = this;
+    batch->id = id;
+    for (size_t i = 0; i < size; ++i) {
+        batch->buf.append(*messages[i]);
+    }
+    auto max_bytes = FLAGS_manusya_chunk_stream_max_inflight_bytes;
+    {
+        std::unique_lock lock(_mutex);
+        // the stream stops taking messages while waiting, so the writer is blocked by flow control
+        while (_inflight_count > 0 && _inflight_bytes + batch->buf.size() > max_bytes) {
+            _cond.wait(lock);
+        }
+        if (!_status.ok() || batch->buf.empty()) {
+            delete batch;
+            return 0;
+        }
+        batch->offset = _offset;
+        _offset += batch->buf.size();
+        _inflight_bytes += batch->buf.size();
+        _inflight_count++;
+    }
+    g_chunk_stream_bytes << batch->buf.size();
+
+    bthread_t tid = 0;
+    if (bthread_start_background(&tid, nullptr, run_append, batch) != 0) {
+        append(batch);
+    }
+    return 0;
+}
+
+void ChunkStream::on_idle_timeout(brpc::StreamId id) {
+    PLOG_WARN(("desc", "chunk stream is idle, closing it")("chunk", _chunk->chunk_id().str()));
+    brpc::StreamClose(id);
+}
+
+void ChunkStream::on_closed(brpc::StreamId id) {
+    PLOG_DEBUG(("desc", "chunk stream closed")("chunk", _chunk->chunk_id().str())("stream", id));
+    {
+        std::unique_lock lock(_mutex);
+        while (_inflight_count > 0) {
+            _cond.wait(lock);
+        }
+    }
+    g_chunk_stream_count << -1;
+    delete this;
+}
+
+uint64_t ChunkStream::offset() const {
+    std::lock_guard lock(_mutex);
+    return _offset;
+}
+
+void* ChunkStream::run_append(void* arg) {
+    auto* batch = static_cast<Batch*>(arg);
+    batch->stream->append(batch);
+    return nullptr;
+}
+
+void ChunkStream::append(Batch* batch) {
+    AppendOptions options;
+    options.direct_io = _direct_io;
+    auto end = batch->offset + batch->buf.size();
+    auto status = _chunk->append(batch->buf, batch->offset, options);
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to append chunk from stream") //
+                   ("chunk", _chunk->chunk_id().str())            //
+                   ("offset", batch->offset)                      //
+                   ("errno", status.error_code())                 //
+                   ("error", status.error_str()));
+    }
+    bool first_error = false;
+    {
+        std::lock_guard lock(_mutex);
+        if (!status.ok() && _status.ok()) {
+            _status = status;
+            first_error = true;
+        }
+    }
+    // the append returns after all data before it has committed, end is a cumulative offset
+    if (status.ok()) {
+        ack(batch->id, status, end);
+    } else if (first_error) {
+        ack(batch->id, status, _chunk->size());
+        brpc::StreamClose(batch->id);
+    }
+    {
+        std::lock_guard lock(_mutex);
+        _inflight_bytes -= batch->buf.size();
+        _inflight_count--;
+        _cond.notify_all();
+    }
+    delete batch;
+}
+
+void ChunkStream::ack(brpc::StreamId id, const Status& status, uint64_t offset) {
+    pain::proto::manusya::ChunkStreamAck ack;
+    ack.mutable_header()->set_status(status.error_code());
+    ack.mutable_header()->set_message(status.error_str());
+    ack.set_offset(offset);
+    std::string str;
+    ack.SerializeToString(&str);
+    IOBuf buf;
+    buf.append(str);
+    int rc = brpc::StreamWrite(id, buf);
+    if (rc != 0) {
+        PLOG_WARN(("desc", "failed to ack chunk stream")("chunk", _chunk->chunk_id().str())("errno", rc));
+    }
+}
+
+ChunkReadStream::ChunkReadStream(
+    ChunkPtr chunk, uint64_t offset, uint64_t length, uint32_t segment_size, uint32_t credits) :
+    _chunk(std::move(chunk)),
+    _offset(offset),
+    _end(length > UINT64_MAX - offset ? UINT64_MAX : offset + length),
+    _segment_size(segment_size == 0 ? FLAGS_manusya_read_stream_segment_size
+                                     : std::min(segment_size, FLAGS_manusya_read_stream_max_segment_size)),
+    _credits(std::min(credits, FLAGS_manusya_read_stream_max_credits)) {
+    g_read_stream_count << 1;
+}
+
+Status ChunkReadStream::accept(brpc::Controller* cntl,
+                               ChunkPtr chunk,
+                               uint64_t offset,
+                               uint64_t length,
+                               uint32_t segment_size,
+                               uint32_t credits) {
+    if (offset > chunk->size()) {
+        return Status(EINVAL, "offset is beyond the chunk");
+    }
+    auto* stream = new ChunkReadStream(std::move(chunk), offset, length, segment_size, credits);
+    brpc::StreamOptions options;
+    options.handler = stream;
+    options.idle_timeout_ms = FLAGS_manusya_chunk_stream_idle_timeout_ms;
+    if (brpc::StreamAccept(&stream->_id, *cntl, &options) != 0) {
+        delete stream;
+        return Status(EIO, "failed to accept stream");
+    }
+    // segments written before the response is sent are held by brpc until the stream connects
+    std::unique_lock lock(stream->_mutex);
+    if (bthread_start_background(&stream->_tid, nullptr, run_send, stream) != 0) {
+        lock.unlock();
+        brpc::StreamClose(stream->_id);
+        return Status(EAGAIN, "failed to start read stream");
+    }
+    return Status::OK();
+}
+
+int ChunkReadStream::on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) {
+    std::ignore = id;
+    std::lock_guard lock(_mutex);
+    for (size_t i = 0; i < size; ++i) {
+        pain::proto::manusya::ChunkReadCredit credit;
+        if (!credit.ParseFromString(messages[i]->to_string())) {
+            PLOG_WARN(("desc", "invalid credit of read stream")("chunk", _chunk->chunk_id().str()));
+            continue;
+        }
+        _credits = std::min<uint64_t>(uint64_t(_credits) + credit.credits(), FLAGS_manusya_read_stream_max_credits);
+    }
+    _cond.notify_all();
+    return 0;
+}
+
+void ChunkReadStream::on_idle_timeout(brpc::StreamId id) {
+    PLOG_WARN(("desc", "chunk read stream is idle, closing it")("chunk", _chunk->chunk_id().str()));
+    brpc::StreamClose(id);
+}
+
+void ChunkReadStream::on_closed(brpc::StreamId id) {
+    PLOG_DEBUG(("desc", "chunk read stream closed")("chunk", _chunk->chunk_id().str())("stream", id));
+    bthread_t tid = 0;
+    {
+        std::lock_guard lock(_mutex);
+        _closed = true;
+        tid = _tid;
+        _cond.notify_all();
+    }
+    if (tid != 0) {
+        bthread_join(tid, nullptr);
+    }
+    g_read_stream_count << -1;
+    delete this;
+}
+
+void* ChunkReadStream::run_send(void* arg) {
+    static_cast<ChunkReadStream*>(arg)->send();
+    return nullptr;
+}
+
+void ChunkReadStream::send() {
+    while (true) {
+        {
+            std::unique_lock lock(_mutex);
+            while (_credits == 0 && !_closed) {
+                _cond.wait(lock);
+            }
+            if (_closed) {
+                return;
+            }
+            _credits--;
+        }
+        // the range is cut at the committed size, an open chunk may grow after eof is sent
+        auto end = std::min(_end, _chunk->size());
+        auto size = std::min<uint64_t>(_segment_size, end - std::min(_offset, end));
+        IOBuf data;
+        uint32_t crc = 0;
+        auto status = _chunk->read(_offset, size, &data, &crc);
+        pain::proto::manusya::ChunkReadSegment segment;
+        segment.set_offset(_offset);
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to read chunk for stream") //
+                       ("chunk", _chunk->chunk_id().str())         //
+                       ("offset", _offset)                         //
+                       ("error", status.error_str()));
+            segment.mutable_header()->set_status(status.error_code());
+            segment.mutable_header()->set_message(status.error_str());
+            segment.set_eof(true);
+            std::ignore = write(segment, IOBuf());
+            return;
+        }
+        _offset += data.size();
+        segment.set_length(data.size());
+        segment.set_crc32(crc);
+        segment.set_eof(_offset >= end);
+        g_read_stream_bytes << data.size();
+        if (!write(segment, std::move(data)).ok() || segment.eof()) {
+            return;
+        }
+    }
+}
+
+Status ChunkReadStream::write(const pain::proto::manusya::ChunkReadSegment& segment, IOBuf data) {
+    std::string str;
+    segment.SerializeToString(&str);
+    uint32_t len = htonl(str.size());
+    IOBuf buf;
+    buf.append(&len, sizeof(len));
+    buf.append(str);
+    buf.append(std::move(data));
+    int rc = 0;
+    while ((rc = brpc::StreamWrite(_id, buf)) == EAGAIN) {
+        brpc::StreamWait(_id, nullptr);
+    }
+    if (rc != 0) {
+        PLOG_WARN(("desc", "failed to write read stream")("chunk", _chunk->chunk_id().str())("errno", rc));
+        return Status(rc, "failed to write stream");
+    }
+    return Status::OK();
+}
+
+} // namespace pain::manusya
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <brpc/stream.h>
+#include <bthread/bthread.h>
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include "pain/proto/manusya.pb.h"
+#include "manusya/chunk.h"
+
+namespace pain::manusya {
+
+// ChunkStream appends data received from a brpc stream to one chunk. Messages are appended
+// at consecutive offsets in the order they arrive, each batch of messages is one append, and
+// batches are appended concurrently like out-of-order AppendChunk requests, so they commit in
+// offset order. When a batch commits, the end offset of the committed data is acked to the
+// writer, acks are cumulative and a later ack covers all earlier ones.
+//
+// The stream owns itself once accepted and is deleted when closed.
+class ChunkStream : public brpc::StreamInputHandler {
+public:
+    ChunkStream(ChunkPtr chunk, uint64_t offset, bool direct_io);
+    ~ChunkStream() override = default;
+
+    // accept the stream created by the client in cntl, data is appended to chunk from offset
+    static Status accept(brpc::Controller* cntl, ChunkPtr chunk, uint64_t offset, bool direct_io);
+
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override;
+    void on_idle_timeout(brpc::StreamId id) override;
+    void on_closed(brpc::StreamId id) override;
+
+    // offset where the next message is appended
+    uint64_t offset() const;
+
+private:
+    struct Batch {
+        ChunkStream* stream = nullptr;
+        brpc::StreamId id = brpc::INVALID_STREAM_ID;
+        IOBuf buf;
+        uint64_t offset = 0;
+    };
+
+    static void* run_append(void* arg);
+    void append(Batch* batch);
+    void ack(brpc::StreamId id, const Status& status, uint64_t offset);
+
+    ChunkPtr _chunk;
+    bool _direct_io;
+    uint64_t _offset;
+    // bytes and count of batches being appended
+    uint64_t _inflight_bytes = 0;
+    uint32_t _inflight_count = 0;
+    // the first failure, data received after it is dropped
+    Status _status;
+    mutable bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+};
+
+// ChunkReadStream sends a range of a chunk over a brpc stream in segments as they are read,
+// instead of materializing the whole range in one response. The reader grants a credit for
+// each segment it can take, with the request and then with ChunkReadCredit messages, and no
+// segment is read from the chunk without one, so memory of both sides stays bounded by the
+// credits. An interrupted read is resumed by opening another stream from the offset received.
+//
+// The stream owns itself once accepted and is deleted when closed.
+class ChunkReadStream : public brpc::StreamInputHandler {
+public:
+    ChunkReadStream(ChunkPtr chunk, uint64_t offset, uint64_t length, uint32_t segment_size, uint32_t credits);
+    ~ChunkReadStream() override = default;
+
+    // accept the stream created by the client in cntl and start sending the range
+    static Status accept(brpc::Controller* cntl,
+                         ChunkPtr chunk,
+                         uint64_t offset,
+                         uint64_t length,
+                         uint32_t segment_size,
+                         uint32_t credits);
+
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override;
+    void on_idle_timeout(brpc::StreamId id) override;
+    void on_closed(brpc::StreamId id) override;
+
+private:
+    static void* run_send(void* arg);
+    // send segments until the end of the range, a failure or the stream is closed
+    void send();
+    Status write(const pain::proto::manusya::ChunkReadSegment& segment, IOBuf data);
+
+    ChunkPtr _chunk;
+    uint64_t _offset;
+    uint64_t _end;
+    uint32_t _segment_size;
+    brpc::StreamId _id = brpc::INVALID_STREAM_ID;
+    bthread_t _tid = 0;
+    uint32_t _credits;
+    bool _closed = false;
+    mutable bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+};
+
+} // namespace pain::manusya
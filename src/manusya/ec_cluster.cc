@@ -0,0 +1,213 @@
+#include "manusya/ec_cluster.h"
+#include <braft/route_table.h>
+#include <brpc/channel.h>
+#include <brpc/controller.h>
+#include <fmt/format.h>
+#include <pain/base/plog.h>
+#include <pain/base/tracer.h>
+#include <cerrno>
+#include <memory>
+#include "pain/proto/deva.pb.h"
+#include "pain/proto/manusya.pb.h"
+#include "common/crc32c.h"
+#include "common/object_id_util.h"
+#include "deva/sdk/rpc_client.h"
+#include "manusya/peer_channels.h"
+
+namespace pain::manusya {
+
+namespace {
+constexpr const char* kDevaGroup = "default";
+
+Status check(const brpc::Controller& cntl, const pain::proto::Header& header) {
+    if (cntl.Failed()) {
+        return Status(cntl.ErrorCode(), cntl.ErrorText());
+    }
+    if (header.status() != 0) {
+        return Status(header.status(), header.message());
+    }
+    return Status::OK();
+}
+
+Status peer_stub(const std::string& address, std::unique_ptr<pain::proto::manusya::ManusyaService_Stub>* stub) {
+    brpc::Channel* channel = nullptr;
+    auto status = PeerChannels::instance().get(address, &channel);
+    if (!status.ok()) {
+        return status;
+    }
+    *stub = std::make_unique<pain::proto::manusya::ManusyaService_Stub>(channel);
+    return Status::OK();
+}
+
+// a fragment read in flight, it deletes itself once done
+struct ReadCall : public google::protobuf::Closure {
+    void Run() override {
+        std::unique_ptr<ReadCall> self(this);
+        auto status = check(cntl, response.header());
+        auto& data = cntl.response_attachment();
+        if (status.ok() && common::crc32c(data) != response.crc32()) {
+            status = Status(EIO, "crc32 mismatch of fragment data");
+        }
+        done(status, std::move(data));
+    }
+
+    brpc::Controller cntl;
+    pain::proto::manusya::ReadChunkRequest request;
+    pain::proto::manusya::ReadChunkResponse response;
+    std::function<void(Status, IOBuf)> done;
+};
+} // namespace
+
+RemoteEcCluster::RemoteEcCluster(const std::string& deva_conf) {
+    PLOG_INFO(("desc", "update deva configuration")("deva_conf", deva_conf));
+    braft::rtb::update_configuration(kDevaGroup, deva_conf);
+}
+
+Status RemoteEcCluster::list_targets(std::vector<std::string>* addresses) {
+    pain::proto::deva::ListManusyaRequest request;
+    pain::proto::deva::ListManusyaResponse response;
+    auto status = deva::call_rpc(kDevaGroup, &pain::proto::deva::DevaService::Stub::ListManusya, &request, &response);
+    if (!status.ok()) {
+        return Status(status.error_code(), status.error_str());
+    }
+    if (response.header().status() != 0) {
+        return Status(response.header().status(), response.header().message());
+    }
+    addresses->clear();
+    for (const auto& manusya : response.manusya_descriptors()) {
+        if (manusya.is_alive()) {
+            addresses->push_back(fmt::format("{}:{}", manusya.manusya_id().ip(), manusya.manusya_id().port()));
+        }
+    }
+    return Status::OK();
+}
+
+Status RemoteEcCluster::write_fragment(const std::string& address,
+                                       uint32_t partition_id,
+                                       const IOBuf& data,
+                                       ObjectId* fragment_id) {
+    std::unique_ptr<pain::proto::manusya::ManusyaService_Stub> stub;
+    auto status = peer_stub(address, &stub);
+    if (!status.ok()) {
+        return status;
+    }
+
+    pain::proto::manusya::CreateChunkRequest create_request;
+    pain::proto::manusya::CreateChunkResponse create_response;
+    create_request.set_partition_id(partition_id);
+    {
+        brpc::Controller cntl;
+        inject_tracer(&cntl);
+        stub->CreateChunk(&cntl, &create_request, &create_response, nullptr);
+        status = check(cntl, create_response.header());
+        if (!status.ok()) {
+            return status;
+        }
+    }
+    *fragment_id = common::from_proto(create_response.chunk_id());
+
+    pain::proto::manusya::AppendChunkRequest append_request;
+    pain::proto::manusya::AppendChunkResponse append_response;
+    *append_request.mutable_chunk_id() = create_response.chunk_id();
+    append_request.set_offset(0);
+    append_request.set_length(data.size());
+    append_request.set_crc32(common::crc32c(data));
+    {
+        brpc::Controller cntl;
+        inject_tracer(&cntl);
+        cntl.request_attachment() = data;
+        stub->AppendChunk(&cntl, &append_request, &append_response, nullptr);
+        status = check(cntl, append_response.header());
+    }
+
+    pain::proto::manusya::QueryAndSealChunkRequest seal_request;
+    pain::proto::manusya::QueryAndSealChunkResponse seal_response;
+    *seal_request.mutable_chunk_id() = create_response.chunk_id();
+    if (status.ok()) {
+        brpc::Controller cntl;
+        inject_tracer(&cntl);
+        stub->QueryAndSealChunk(&cntl, &seal_request, &seal_response, nullptr);
+        status = check(cntl, seal_response.header());
+        if (status.ok() && seal_response.size() != data.size()) {
+            status = Status(EIO, fmt::format("fragment sealed at {} instead of {}", seal_response.size(), data.size()));
+        }
+    }
+    if (!status.ok()) {
+        std::ignore = remove_fragment(address, *fragment_id);
+    }
+    return status;
+}
+
+Status RemoteEcCluster::remove_fragment(const std::string& address, const ObjectId& fragment_id) {
+    std::unique_ptr<pain::proto::manusya::ManusyaService_Stub> stub;
+    auto status = peer_stub(address, &stub);
+    if (!status.ok()) {
+        return status;
+    }
+    pain::proto::manusya::RemoveChunkRequest request;
+    pain::proto::manusya::RemoveChunkResponse response;
+    common::to_proto(fragment_id, request.mutable_chunk_id());
+    brpc::Controller cntl;
+    inject_tracer(&cntl);
+    stub->RemoveChunk(&cntl, &request, &response, nullptr);
+    status = check(cntl, response.header());
+    if (!status.ok()) {
+        PLOG_WARN(("desc", "failed to remove fragment") //
+                  ("address", address)                  //
+                  ("fragment", fragment_id.str())       //
+                  ("error", status.error_str()));
+    }
+    return status;
+}
+
+void RemoteEcCluster::read_fragment(const std::string& address,
+                                    const ObjectId& fragment_id,
+                                    uint64_t offset,
+                                    uint32_t size,
+                                    std::function<void(Status, IOBuf)> done) {
+    std::unique_ptr<pain::proto::manusya::ManusyaService_Stub> stub;
+    auto status = peer_stub(address, &stub);
+    if (!status.ok()) {
+        done(status, IOBuf());
+        return;
+    }
+    auto* call = new ReadCall();
+    common::to_proto(fragment_id, call->request.mutable_chunk_id());
+    call->request.set_offset(offset);
+    call->request.set_length(size);
+    call->done = std::move(done);
+    inject_tracer(&call->cntl);
+    stub->ReadChunk(&call->cntl, &call->request, &call->response, call);
+}
+
+Status RemoteEcCluster::get_layout(const ObjectId& chunk_id, proto::ChunkInfo* layout) {
+    pain::proto::deva::GetChunkInfoRequest request;
+    pain::proto::deva::GetChunkInfoResponse response;
+    common::to_proto(chunk_id, request.mutable_chunk_id());
+    auto status = deva::call_rpc(kDevaGroup, &pain::proto::deva::DevaService::Stub::GetChunkInfo, &request, &response);
+    if (!status.ok()) {
+        return Status(status.error_code(), status.error_str());
+    }
+    if (response.header().status() != 0) {
+        return Status(response.header().status(), response.header().message());
+    }
+    layout->Swap(response.mutable_chunk_info());
+    return Status::OK();
+}
+
+Status RemoteEcCluster::commit_layout(const proto::ChunkInfo& layout, proto::ChunkInfo* committed) {
+    pain::proto::deva::ConvertChunkRequest request;
+    pain::proto::deva::ConvertChunkResponse response;
+    *request.mutable_chunk_info() = layout;
+    auto status = deva::call_rpc(kDevaGroup, &pain::proto::deva::DevaService::Stub::ConvertChunk, &request, &response);
+    if (!status.ok()) {
+        return Status(status.error_code(), status.error_str());
+    }
+    committed->Swap(response.mutable_chunk_info());
+    if (response.header().status() != 0) {
+        return Status(response.header().status(), response.header().message());
+    }
+    return Status::OK();
+}
+
+} // namespace pain::manusya
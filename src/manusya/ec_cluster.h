@@ -0,0 +1,61 @@
+#pragma once
+
+#include <pain/base/object_id.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "pain/proto/common.pb.h"
+
+namespace pain::manusya {
+
+// EcCluster is what erasure coding needs from the rest of the cluster, manusya to hold the
+// fragments and deva to keep the layouts of coded chunks.
+class EcCluster {
+public:
+    virtual ~EcCluster() = default;
+
+    // addresses of alive manusya fragments can be placed on
+    virtual Status list_targets(std::vector<std::string>* addresses) = 0;
+    // store data as a new sealed chunk in partition_id on the manusya at address
+    virtual Status
+    write_fragment(const std::string& address, uint32_t partition_id, const IOBuf& data, ObjectId* fragment_id) = 0;
+    virtual Status remove_fragment(const std::string& address, const ObjectId& fragment_id) = 0;
+    // read size bytes at offset of a fragment without waiting, done runs with the data once it
+    // arrives, in the calling thread or another one
+    virtual void read_fragment(const std::string& address,
+                               const ObjectId& fragment_id,
+                               uint64_t offset,
+                               uint32_t size,
+                               std::function<void(Status, IOBuf)> done) = 0;
+    // layout of the coded chunk of chunk_id, which is the chunk or one of its fragments,
+    // ENOENT if it is not coded
+    virtual Status get_layout(const ObjectId& chunk_id, proto::ChunkInfo* layout) = 0;
+    // EEXIST with the committed layout in committed if the chunk was coded already
+    virtual Status commit_layout(const proto::ChunkInfo& layout, proto::ChunkInfo* committed) = 0;
+};
+
+// RemoteEcCluster talks to other manusya over PeerChannels and to deva with its sdk.
+class RemoteEcCluster : public EcCluster {
+public:
+    // deva_conf is the configuration of the deva group, e.g. 127.0.0.1:8201:0,127.0.0.1:8202:0
+    explicit RemoteEcCluster(const std::string& deva_conf);
+    ~RemoteEcCluster() override = default;
+
+    Status list_targets(std::vector<std::string>* addresses) override;
+    Status write_fragment(const std::string& address,
+                          uint32_t partition_id,
+                          const IOBuf& data,
+                          ObjectId* fragment_id) override;
+    Status remove_fragment(const std::string& address, const ObjectId& fragment_id) override;
+    void read_fragment(const std::string& address,
+                       const ObjectId& fragment_id,
+                       uint64_t offset,
+                       uint32_t size,
+                       std::function<void(Status, IOBuf)> done) override;
+    Status get_layout(const ObjectId& chunk_id, proto::ChunkInfo* layout) override;
+    Status commit_layout(const proto::ChunkInfo& layout, proto::ChunkInfo* committed) override;
+};
+
+} // namespace pain::manusya
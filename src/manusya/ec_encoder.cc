@@ -0,0 +1,292 @@
+#include "manusya/ec_encoder.h"
+#include <bthread/condition_variable.h>
+#include <butil/time.h>
+#include <bvar/bvar.h>
+#include <fmt/format.h>
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <cerrno>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "common/object_id_util.h"
+#include "manusya/io_scheduler.h"
+
+DEFINE_uint64(manusya_ec_cold_seconds,
+              7 * 24 * 3600,
+              "Sealed chunks not accessed for this long are converted to erasure coded fragments");
+DEFINE_uint32(manusya_ec_interval_s, 600, "Interval between scans for cold chunks to erasure code");
+
+namespace pain::manusya {
+
+namespace {
+bvar::Adder<uint64_t> g_ec_converted_count("manusya_ec_converted_count");
+bvar::Adder<uint64_t> g_ec_converted_bytes("manusya_ec_converted_bytes");
+bvar::Adder<uint64_t> g_ec_failed_count("manusya_ec_failed_count");
+bvar::Adder<uint64_t> g_ec_replica_removed_count("manusya_ec_replica_removed_count");
+
+// probes of the fragments of a layout, shared with their callbacks
+struct FragmentProbes {
+    void finish(bool readable) {
+        std::lock_guard lock(mutex);
+        if (readable) {
+            this->readable++;
+        }
+        finished++;
+        cond.notify_all();
+    }
+
+    bthread::Mutex mutex;
+    bthread::ConditionVariable cond;
+    uint32_t readable = 0;
+    uint32_t finished = 0;
+};
+
+// whether layout lists exactly the fragments of other
+bool same_fragments(const proto::ChunkInfo& layout, const proto::ChunkInfo& other) {
+    if (layout.replicas_size() != other.replicas_size()) {
+        return false;
+    }
+    for (int i = 0; i < layout.replicas_size(); i++) {
+        if (common::from_proto(layout.replicas(i).chunk_id()) != common::from_proto(other.replicas(i).chunk_id())) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+EcEncoder::EcEncoder(Bank* bank, EcCluster* cluster, common::ErasureCodePtr code) :
+    _bank(bank),
+    _cluster(cluster),
+    _code(std::move(code)),
+    _loop(
+        "ec encoder",
+        [this]() {
+            run_once();
+        },
+        []() {
+            return static_cast<uint64_t>(FLAGS_manusya_ec_interval_s) * 1000 * 1000;
+        }) {}
+
+EcEncoder::~EcEncoder() {
+    stop();
+}
+
+Status EcEncoder::start() {
+    return _loop.start();
+}
+
+void EcEncoder::stop() {
+    _loop.stop();
+}
+
+uint32_t EcEncoder::run_once() {
+    uint32_t converted = 0;
+    _bank->for_each_chunk([&](const ObjectId& chunk_id) {
+        if (_loop.stopped()) {
+            return false;
+        }
+        {
+            std::lock_guard lock(_mutex);
+            if (_fragments.contains(chunk_id)) {
+                return true;
+            }
+        }
+        ChunkPtr chunk;
+        if (!_bank->get_chunk(chunk_id, &chunk).ok() || !is_cold(chunk)) {
+            return true;
+        }
+        auto status = convert(chunk_id);
+        if (!status.ok()) {
+            g_ec_failed_count << 1;
+            PLOG_WARN(("desc", "failed to erasure code chunk") //
+                      ("chunk", chunk_id.str())                //
+                      ("errno", status.error_code())           //
+                      ("error", status.error_str()));
+            return true;
+        }
+        std::lock_guard lock(_mutex);
+        if (!_fragments.contains(chunk_id)) {
+            converted++;
+        }
+        return true;
+    });
+    return converted;
+}
+
+bool EcEncoder::is_cold(const ChunkPtr& chunk) const {
+    if (chunk->state() != ChunkState::kSealed || chunk->size() == 0) {
+        return false;
+    }
+    auto now = static_cast<uint64_t>(butil::gettimeofday_us());
+    return now >= chunk->access_time_us() + FLAGS_manusya_ec_cold_seconds * 1000 * 1000;
+}
+
+Status EcEncoder::convert(const ObjectId& chunk_id) {
+    ChunkPtr chunk;
+    auto status = _bank->get_chunk(chunk_id, &chunk);
+    if (!status.ok()) {
+        return status;
+    }
+    if (chunk->state() != ChunkState::kSealed) {
+        return Status(EINVAL, "chunk is not sealed");
+    }
+
+    proto::ChunkInfo layout;
+    status = _cluster->get_layout(chunk_id, &layout);
+    if (status.ok() && common::from_proto(layout.chunk_id()) != chunk_id) {
+        std::lock_guard lock(_mutex);
+        _fragments.insert(chunk_id);
+        return Status::OK();
+    }
+    // without a layout the chunk is encoded here, with one it was coded by another replica
+    // holder and only the replica is left
+    if (status.error_code() == ENOENT) {
+        status = encode(chunk, &layout);
+    }
+    if (!status.ok()) {
+        return status;
+    }
+    // the replica may be the last copy of the data, keep it unless the fragments can serve it
+    status = check_fragments(layout);
+    if (!status.ok()) {
+        return status;
+    }
+
+    status = _bank->remove_chunk(chunk_id);
+    if (!status.ok()) {
+        return status;
+    }
+    g_ec_replica_removed_count << 1;
+    PLOG_INFO(("desc", "replica replaced by erasure coded fragments")("chunk", chunk_id.str()));
+    return Status::OK();
+}
+
+Status EcEncoder::encode(const ChunkPtr& chunk, proto::ChunkInfo* committed) {
+    const auto& chunk_id = chunk->chunk_id();
+    auto size = chunk->size();
+    IOBuf data;
+    ReadOptions options;
+    options.background = true;
+    proto::IoTag tag;
+    tag.set_io_class(proto::IoClass::IO_CLASS_BACKGROUND);
+    Status status;
+    {
+        auto slot = IoScheduler::instance().admit(tag, size);
+        status = chunk->read(0, size, &data, nullptr, options);
+    }
+    if (!status.ok()) {
+        return status;
+    }
+    std::vector<IOBuf> fragments;
+    status = _code->encode(data, &fragments);
+    if (!status.ok()) {
+        return status;
+    }
+
+    std::vector<std::string> targets;
+    status = _cluster->list_targets(&targets);
+    if (!status.ok()) {
+        return status;
+    }
+    // fragments of a stripe must not share a manusya, or losing one loses several of them
+    if (targets.size() < fragments.size()) {
+        return Status(ENOSPC, fmt::format("{} manusya for {} fragments", targets.size(), fragments.size()));
+    }
+
+    proto::ChunkInfo layout;
+    common::to_proto(chunk_id, layout.mutable_chunk_id());
+    layout.set_length(size);
+    layout.set_state(proto::ChunkState::CHUNK_STATE_SEALED);
+    layout.set_type(proto::ChunkType::CHUNK_TYPE_EC);
+    layout.mutable_config()->set_replica_count(_code->data_count());
+    layout.mutable_config()->set_parity_count(_code->parity_count());
+    // stripes of different chunks start on different manusya to spread the fragments
+    auto first = std::hash<ObjectId>()(chunk_id) % targets.size();
+    for (size_t i = 0; i < fragments.size(); i++) {
+        const auto& address = targets[(first + i) % targets.size()];
+        ObjectId fragment_id;
+        status = _cluster->write_fragment(address, chunk_id.partition_id(), fragments[i], &fragment_id);
+        if (!status.ok()) {
+            remove_fragments(layout);
+            return status;
+        }
+        auto* fragment = layout.add_replicas();
+        common::to_proto(fragment_id.uuid(), fragment->mutable_chunk_id());
+        fragment->set_length(fragments[i].size());
+        fragment->mutable_location()->set_uri(address);
+    }
+
+    status = _cluster->commit_layout(layout, committed);
+    if (status.error_code() == EEXIST) {
+        // another replica holder won the race, its fragments serve the chunk
+        remove_fragments(layout);
+        return Status::OK();
+    }
+    if (!status.ok()) {
+        // the commit may have been applied before the error, such as a timeout, the fragments
+        // are removed only once deva is known to refer to others or none
+        auto query = _cluster->get_layout(chunk_id, committed);
+        if (query.error_code() == ENOENT || (query.ok() && !same_fragments(layout, *committed))) {
+            remove_fragments(layout);
+            return query.ok() ? Status::OK() : status;
+        }
+        if (!query.ok()) {
+            PLOG_WARN(("desc", "fragments left behind by an unknown commit") //
+                      ("chunk", chunk_id.str())                            //
+                      ("error", query.error_str()));
+            return status;
+        }
+    }
+    g_ec_converted_count << 1;
+    g_ec_converted_bytes << size;
+    PLOG_INFO(("desc", "chunk erasure coded")           //
+              ("chunk", chunk_id.str())                 //
+              ("size", size)                            //
+              ("data_count", _code->data_count())       //
+              ("parity_count", _code->parity_count()));
+    return Status::OK();
+}
+
+Status EcEncoder::check_fragments(const proto::ChunkInfo& layout) {
+    auto data_count = layout.config().replica_count();
+    auto partition_id = layout.chunk_id().partition_id();
+    auto probes = std::make_shared<FragmentProbes>();
+    // reading the last byte of a fragment shows it exists with its full length
+    for (const auto& fragment : layout.replicas()) {
+        ObjectId fragment_id(partition_id, common::from_proto(fragment.chunk_id()));
+        if (fragment.length() == 0) {
+            probes->finish(false);
+            continue;
+        }
+        _cluster->read_fragment(fragment.location().uri(),
+                                fragment_id,
+                                fragment.length() - 1,
+                                1,
+                                [probes](Status status, IOBuf data) {
+                                    probes->finish(status.ok() && data.size() == 1);
+                                });
+    }
+
+    std::unique_lock lock(probes->mutex);
+    while (probes->finished < static_cast<uint32_t>(layout.replicas_size())) {
+        probes->cond.wait(lock);
+    }
+    if (data_count == 0 || probes->readable < data_count) {
+        return Status(EIO, fmt::format("{} of {} fragments readable", probes->readable, layout.replicas_size()));
+    }
+    return Status::OK();
+}
+
+void EcEncoder::remove_fragments(const proto::ChunkInfo& layout) {
+    auto partition_id = layout.chunk_id().partition_id();
+    for (const auto& fragment : layout.replicas()) {
+        ObjectId fragment_id(partition_id, common::from_proto(fragment.chunk_id()));
+        std::ignore = _cluster->remove_fragment(fragment.location().uri(), fragment_id);
+    }
+}
+
+} // namespace pain::manusya
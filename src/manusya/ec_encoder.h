@@ -0,0 +1,57 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <pain/base/object_id.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <unordered_set>
+#include "common/erasure_code.h"
+#include "manusya/background_loop.h"
+#include "manusya/bank.h"
+#include "manusya/ec_cluster.h"
+
+namespace pain::manusya {
+
+// EcEncoder converts cold sealed chunks of a bank from replicas to erasure coded fragments in
+// the background. The chunk is encoded into data and parity fragments, which are placed on
+// distinct manusya, then the layout is committed to deva and the local replica is removed.
+//
+// Every manusya holding a replica of the chunk runs its own encoder, the first layout
+// committed wins, the others remove the fragments they wrote and just drop their replicas
+// once they find the chunk coded and enough of its fragments readable.
+class EcEncoder {
+public:
+    EcEncoder(Bank* bank, EcCluster* cluster, common::ErasureCodePtr code);
+    ~EcEncoder();
+    EcEncoder(const EcEncoder&) = delete;
+    EcEncoder& operator=(const EcEncoder&) = delete;
+
+    // scan the bank every manusya_ec_interval_s until stopped
+    Status start();
+    void stop();
+
+    // convert every cold sealed chunk of the bank once, returns the number converted
+    uint32_t run_once();
+
+    // replace the local replica of a sealed chunk by fragments, fragments of coded chunks are
+    // left alone
+    Status convert(const ObjectId& chunk_id);
+
+private:
+    bool is_cold(const ChunkPtr& chunk) const;
+    // committed is the layout deva holds for the chunk once it succeeded
+    Status encode(const ChunkPtr& chunk, proto::ChunkInfo* committed);
+    // OK if enough fragments of layout are readable to decode the chunk
+    Status check_fragments(const proto::ChunkInfo& layout);
+    void remove_fragments(const proto::ChunkInfo& layout);
+
+    Bank* _bank;
+    EcCluster* _cluster;
+    common::ErasureCodePtr _code;
+    // local chunks found to be fragments, they are never converted
+    std::unordered_set<ObjectId> _fragments;
+    bthread::Mutex _mutex;
+    BackgroundLoop _loop;
+};
+
+} // namespace pain::manusya
@@ -0,0 +1,211 @@
+#include "manusya/ec_reader.h"
+#include <bthread/condition_variable.h>
+#include <butil/time.h>
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "common/object_id_util.h"
+
+DEFINE_uint32(manusya_ec_read_hedge_ms,
+              50,
+              "Data fragments not read within this long are decoded from the other fragments");
+
+namespace pain::manusya {
+
+namespace {
+bvar::Adder<uint64_t> g_ec_read_count("manusya_ec_read_count");
+bvar::Adder<uint64_t> g_ec_degraded_read_count("manusya_ec_degraded_read_count");
+
+// reads of fragments in flight, shared with their callbacks which may finish after the reader
+// stopped waiting for them
+struct FragmentReads {
+    explicit FragmentReads(size_t n) : data(n), status(n), done(n, false) {}
+
+    void finish(size_t i, Status s, IOBuf buf) {
+        std::lock_guard lock(mutex);
+        status[i] = std::move(s);
+        data[i] = std::move(buf);
+        done[i] = true;
+        if (status[i].ok()) {
+            succeeded++;
+        }
+        finished++;
+        cond.notify_all();
+    }
+
+    // wait until count reads succeeded, every started one finished or deadline_us passed,
+    // there is no deadline if it is negative
+    void wait(uint32_t count, int64_t deadline_us) {
+        std::unique_lock lock(mutex);
+        while (succeeded < count && finished < started) {
+            if (deadline_us < 0) {
+                cond.wait(lock);
+                continue;
+            }
+            auto now = butil::gettimeofday_us();
+            if (now >= deadline_us) {
+                return;
+            }
+            cond.wait_for(lock, deadline_us - now);
+        }
+    }
+
+    // data of fragment i if it was read in full, false otherwise
+    bool get(size_t i, uint64_t size, IOBuf* buf) {
+        std::lock_guard lock(mutex);
+        if (!done[i] || !status[i].ok() || data[i].size() != size) {
+            return false;
+        }
+        *buf = data[i];
+        return true;
+    }
+
+    bthread::Mutex mutex;
+    bthread::ConditionVariable cond;
+    std::vector<IOBuf> data;
+    std::vector<Status> status;
+    std::vector<bool> done;
+    // set before the reads start, the callbacks do not touch it
+    uint32_t started = 0;
+    uint32_t succeeded = 0;
+    uint32_t finished = 0;
+};
+
+using FragmentReadsPtr = std::shared_ptr<FragmentReads>;
+} // namespace
+
+EcReader::EcReader(EcCluster* cluster) : _cluster(cluster) {}
+
+Status EcReader::get_code(uint32_t data_count, uint32_t parity_count, common::ErasureCodePtr* code) {
+    std::lock_guard lock(_mutex);
+    auto& cached = _codes[{data_count, parity_count}];
+    if (cached == nullptr) {
+        auto status = common::ErasureCode::create(data_count, parity_count, &cached);
+        if (!status.ok()) {
+            _codes.erase({data_count, parity_count});
+            return status;
+        }
+    }
+    *code = cached;
+    return Status::OK();
+}
+
+Status EcReader::read(const proto::ChunkInfo& layout, uint64_t offset, uint64_t size, IOBuf* data) {
+    if (layout.type() != proto::ChunkType::CHUNK_TYPE_EC) {
+        return Status(EINVAL, "chunk is not erasure coded");
+    }
+    common::ErasureCodePtr code;
+    auto status = get_code(layout.config().replica_count(), layout.config().parity_count(), &code);
+    if (!status.ok()) {
+        return status;
+    }
+    auto count = code->fragment_count();
+    if (static_cast<uint32_t>(layout.replicas_size()) != count) {
+        return Status(EINVAL, "fragment count mismatch");
+    }
+    if (offset > layout.length()) {
+        return Status(EINVAL, "offset is beyond the chunk");
+    }
+    size = std::min(size, layout.length() - offset);
+    if (size == 0) {
+        return Status::OK();
+    }
+    g_ec_read_count << 1;
+
+    // data fragment i holds bytes [i * fragment_size, (i + 1) * fragment_size) of the chunk,
+    // the range needs [begin(i), end(i)) of the data fragments first to last
+    auto fragment_size = code->fragment_size(layout.length());
+    auto first = static_cast<uint32_t>(offset / fragment_size);
+    auto last = static_cast<uint32_t>((offset + size - 1) / fragment_size);
+    auto begin = [&](uint32_t i) {
+        return std::max(offset, i * fragment_size) - i * fragment_size;
+    };
+    auto end = [&](uint32_t i) {
+        return std::min(offset + size, (i + 1) * fragment_size) - i * fragment_size;
+    };
+    auto partition_id = layout.chunk_id().partition_id();
+    auto start_read = [&](const FragmentReadsPtr& reads, uint32_t i, uint64_t from, uint64_t to) {
+        const auto& fragment = layout.replicas(static_cast<int>(i));
+        ObjectId fragment_id(partition_id, common::from_proto(fragment.chunk_id()));
+        _cluster->read_fragment(fragment.location().uri(),
+                                fragment_id,
+                                from,
+                                static_cast<uint32_t>(to - from),
+                                [reads, i](Status s, IOBuf buf) {
+                                    reads->finish(i, std::move(s), std::move(buf));
+                                });
+    };
+
+    auto reads = std::make_shared<FragmentReads>(count);
+    reads->started = last - first + 1;
+    for (auto i = first; i <= last; i++) {
+        start_read(reads, i, begin(i), end(i));
+    }
+    reads->wait(reads->started, butil::gettimeofday_us() + FLAGS_manusya_ec_read_hedge_ms * 1000L);
+    std::vector<IOBuf> pieces(last - first + 1);
+    std::vector<uint32_t> missing;
+    for (auto i = first; i <= last; i++) {
+        if (!reads->get(i, end(i) - begin(i), &pieces[i - first])) {
+            missing.push_back(i);
+        }
+    }
+
+    if (!missing.empty()) {
+        g_ec_degraded_read_count << 1;
+        // the ranges missing are decoded at once from one range read of each other fragment
+        uint64_t from = fragment_size;
+        uint64_t to = 0;
+        for (auto i : missing) {
+            from = std::min(from, begin(i));
+            to = std::max(to, end(i));
+        }
+        auto others = std::make_shared<FragmentReads>(count);
+        std::vector<uint32_t> sources;
+        for (uint32_t i = 0; i < count; i++) {
+            if (std::find(missing.begin(), missing.end(), i) == missing.end()) {
+                sources.push_back(i);
+            }
+        }
+        others->started = sources.size();
+        for (auto i : sources) {
+            start_read(others, i, from, to);
+        }
+        others->wait(code->data_count(), -1);
+
+        std::vector<IOBuf> fragments(count);
+        std::vector<bool> present(count, false);
+        for (auto i : sources) {
+            present[i] = others->get(i, to - from, &fragments[i]);
+        }
+        status = code->decode(&fragments, present, missing);
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to decode erasure coded range")       //
+                       ("chunk", common::from_proto(layout.chunk_id()).str()) //
+                       ("offset", offset)                                     //
+                       ("size", size)                                         //
+                       ("missing", missing.size())                            //
+                       ("error", status.error_str()));
+            return status;
+        }
+        for (auto i : missing) {
+            fragments[i].append_to(&pieces[i - first], end(i) - begin(i), begin(i) - from);
+        }
+        PLOG_WARN(("desc", "degraded read of erasure coded chunk")       //
+                  ("chunk", common::from_proto(layout.chunk_id()).str()) //
+                  ("offset", offset)                                     //
+                  ("size", size)                                         //
+                  ("missing", missing.size()));
+    }
+
+    for (auto& piece : pieces) {
+        data->append(piece);
+    }
+    return Status::OK();
+}
+
+} // namespace pain::manusya
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <pain/base/object_id.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include "pain/proto/common.pb.h"
+#include "common/erasure_code.h"
+#include "manusya/ec_cluster.h"
+
+namespace pain::manusya {
+
+// EcReader reads byte ranges of erasure coded chunks from their fragments. The code is
+// systematic, a range is served by the data fragments holding it. When one of them fails or
+// does not answer within manusya_ec_read_hedge_ms, the same range of the fragment is fetched
+// from the other fragments in parallel, and the first data_count of them to arrive decode
+// it. Only the bytes of the range are read and decoded, never the whole fragments.
+class EcReader {
+public:
+    explicit EcReader(EcCluster* cluster);
+    EcReader(const EcReader&) = delete;
+    EcReader& operator=(const EcReader&) = delete;
+
+    // read size bytes at offset of the coded chunk of layout, reads past its end are cut short
+    Status read(const proto::ChunkInfo& layout, uint64_t offset, uint64_t size, IOBuf* data);
+
+private:
+    Status get_code(uint32_t data_count, uint32_t parity_count, common::ErasureCodePtr* code);
+
+    EcCluster* _cluster;
+    bthread::Mutex _mutex;
+    // codes of the layouts seen, by data and parity count
+    std::map<std::pair<uint32_t, uint32_t>, common::ErasureCodePtr> _codes;
+};
+
+} // namespace pain::manusya
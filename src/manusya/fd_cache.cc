@@ -0,0 +1,200 @@
+#include "manusya/fd_cache.h"
+#include <bvar/bvar.h>
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include <boost/assert.hpp>
+
+DEFINE_uint64(manusya_fd_cache_capacity, 65536, "Max number of fds kept open for files of local and uring stores");
+
+namespace pain::manusya {
+
+namespace {
+bvar::Adder<uint64_t> g_fd_cache_hit_count("manusya_fd_cache_hit_count");
+bvar::Adder<uint64_t> g_fd_cache_miss_count("manusya_fd_cache_miss_count");
+bvar::Adder<uint64_t> g_fd_cache_evict_count("manusya_fd_cache_evict_count");
+bvar::Adder<int64_t> g_fd_cache_open_count("manusya_fd_cache_open_count");
+
+// flags only meaningful when the file is opened the first time
+constexpr int kCreateFlags = O_CREAT | O_EXCL | O_TRUNC;
+
+void close_fds(const std::vector<int>& fds) {
+    for (auto fd : fds) {
+        ::close(fd);
+    }
+}
+} // namespace
+
+FdPin& FdPin::operator=(FdPin&& other) noexcept {
+    if (this != &other) {
+        reset();
+        _file = std::move(other._file);
+        _fd = other._fd;
+        other._fd = -1;
+    }
+    return *this;
+}
+
+void FdPin::reset() {
+    if (_file != nullptr) {
+        _file->cache->unpin(_file.get());
+        _file.reset();
+    }
+    _fd = -1;
+}
+
+FdCache::FdCache(size_t capacity) : _capacity(std::max<size_t>(capacity, 1)) {}
+
+FdCache::~FdCache() {
+    std::vector<int> fds;
+    {
+        std::lock_guard lock(_mutex);
+        while (!_lru.empty()) {
+            close_locked(&_lru.front(), &fds);
+        }
+    }
+    close_fds(fds);
+}
+
+FdCache& FdCache::instance() {
+    // never destroyed, handles may be released by static objects at exit
+    static auto* s_fd_cache = new FdCache(FLAGS_manusya_fd_cache_capacity);
+    return *s_fd_cache;
+}
+
+CachedFdPtr FdCache::add(std::string path, int flags, int fd) {
+    auto file = std::make_shared<CachedFd>();
+    file->cache = this;
+    file->path = std::move(path);
+    file->flags = flags & ~kCreateFlags;
+    file->fd = fd;
+    std::vector<int> fds;
+    {
+        std::lock_guard lock(_mutex);
+        _open++;
+        g_fd_cache_open_count << 1;
+        _lru.push_back(*file);
+        evict(&fds);
+    }
+    close_fds(fds);
+    return file;
+}
+
+Status FdCache::pin(const CachedFdPtr& file, FdPin* pin) {
+    if (file == nullptr) {
+        return Status(EINVAL, "file is nullptr");
+    }
+    if (pin == nullptr) {
+        return Status(EINVAL, "pin is nullptr");
+    }
+    pin->reset();
+    {
+        std::lock_guard lock(_mutex);
+        if (file->released) {
+            return Status(EBADF, "file is released");
+        }
+        file->pins++;
+        if (file->fd >= 0) {
+            file->hook.unlink();
+            g_fd_cache_hit_count << 1;
+            pin->_file = file;
+            pin->_fd = file->fd;
+            return Status::OK();
+        }
+    }
+
+    // the file is pinned, so the fd opened here can't be closed by others
+    std::lock_guard open_lock(file->open_mutex);
+    int flags = 0;
+    {
+        std::lock_guard lock(_mutex);
+        if (file->fd >= 0) {
+            g_fd_cache_hit_count << 1;
+            pin->_file = file;
+            pin->_fd = file->fd;
+            return Status::OK();
+        }
+        flags = file->flags;
+    }
+    g_fd_cache_miss_count << 1;
+    int fd = ::open(file->path.c_str(), flags);
+    if (fd < 0) {
+        auto error = errno;
+        PLOG_ERROR(("desc", "failed to reopen file")("path", file->path)("error", error));
+        unpin(file.get());
+        return Status(error, "failed to reopen file");
+    }
+    std::vector<int> fds;
+    {
+        std::lock_guard lock(_mutex);
+        file->fd = fd;
+        _open++;
+        g_fd_cache_open_count << 1;
+        evict(&fds);
+    }
+    close_fds(fds);
+    pin->_file = file;
+    pin->_fd = fd;
+    return Status::OK();
+}
+
+void FdCache::unpin(CachedFd* file) {
+    std::vector<int> fds;
+    {
+        std::lock_guard lock(_mutex);
+        BOOST_ASSERT(file->pins > 0);
+        file->pins--;
+        if (file->pins == 0 && file->fd >= 0) {
+            if (file->released) {
+                close_locked(file, &fds);
+            } else {
+                _lru.push_back(*file);
+                evict(&fds);
+            }
+        }
+    }
+    close_fds(fds);
+}
+
+void FdCache::set_flags(const CachedFdPtr& file, int flags) {
+    std::lock_guard lock(_mutex);
+    file->flags = flags & ~kCreateFlags;
+}
+
+void FdCache::release(const CachedFdPtr& file) {
+    std::vector<int> fds;
+    {
+        std::lock_guard lock(_mutex);
+        file->released = true;
+        if (file->pins == 0 && file->fd >= 0) {
+            close_locked(file.get(), &fds);
+        }
+    }
+    close_fds(fds);
+}
+
+size_t FdCache::size() const {
+    std::lock_guard lock(_mutex);
+    return _open;
+}
+
+void FdCache::evict(std::vector<int>* fds) {
+    while (_open > _capacity && !_lru.empty()) {
+        close_locked(&_lru.front(), fds);
+        g_fd_cache_evict_count << 1;
+    }
+}
+
+void FdCache::close_locked(CachedFd* file, std::vector<int>* fds) {
+    file->hook.unlink();
+    fds->push_back(file->fd);
+    file->fd = -1;
+    _open--;
+    g_fd_cache_open_count << -1;
+}
+
+} // namespace pain::manusya
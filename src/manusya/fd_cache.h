@@ -0,0 +1,114 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/intrusive/list.hpp>
+
+namespace pain::manusya {
+
+class FdCache;
+
+// a file known to the fd cache, it is open while fd >= 0
+struct CachedFd {
+    boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>> hook;
+    FdCache* cache = nullptr;
+    std::string path;
+    // flags to reopen the file with
+    int flags = 0;
+    int fd = -1;
+    uint32_t pins = 0;
+    // the owner has gone, the fd is closed once unpinned
+    bool released = false;
+    // serializes reopening of the file
+    bthread::Mutex open_mutex;
+};
+using CachedFdPtr = std::shared_ptr<CachedFd>;
+
+// FdPin keeps the fd of a cached file open, the fd must not be used after the pin is reset
+class FdPin {
+public:
+    FdPin() = default;
+    ~FdPin() {
+        reset();
+    }
+    FdPin(FdPin&& other) noexcept : _file(std::move(other._file)), _fd(other._fd) {
+        other._fd = -1;
+    }
+    FdPin& operator=(FdPin&& other) noexcept;
+    FdPin(const FdPin&) = delete;
+    FdPin& operator=(const FdPin&) = delete;
+
+    int fd() const {
+        return _fd;
+    }
+
+    void reset();
+
+private:
+    friend class FdCache;
+
+    CachedFdPtr _file;
+    int _fd = -1;
+};
+
+// FdCache bounds the number of fds opened for files in the process. Files which are not
+// pinned by in-flight I/O are closed in least recently used order once the capacity is
+// exceeded, and reopened when pinned again. Pinned files are never closed, so the capacity
+// may be exceeded while all of them are in use.
+class FdCache {
+public:
+    FdCache(size_t capacity);
+    ~FdCache();
+    FdCache(const FdCache&) = delete;
+    FdCache& operator=(const FdCache&) = delete;
+
+    static FdCache& instance();
+
+    // add a file the caller opened with flags, it is reopened without O_CREAT, O_EXCL and
+    // O_TRUNC after closed by the cache
+    CachedFdPtr add(std::string path, int flags, int fd);
+
+    Status pin(const CachedFdPtr& file, FdPin* pin);
+
+    // reopen the file with flags from now on
+    void set_flags(const CachedFdPtr& file, int flags);
+
+    // the owner of the file is gone, it is closed once unpinned
+    void release(const CachedFdPtr& file);
+
+    // number of open fds
+    size_t size() const;
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+private:
+    friend class FdPin;
+
+    using LruList = boost::intrusive::list<
+        CachedFd,
+        boost::intrusive::member_hook<CachedFd,
+                                      boost::intrusive::list_member_hook<
+                                          boost::intrusive::link_mode<boost::intrusive::auto_unlink>>,
+                                      &CachedFd::hook>,
+        boost::intrusive::constant_time_size<false>>;
+
+    void unpin(CachedFd* file);
+    // called with _mutex held, fds to close are returned so that they are closed without it
+    void evict(std::vector<int>* fds);
+    // called with _mutex held
+    void close_locked(CachedFd* file, std::vector<int>* fds);
+
+    size_t _capacity;
+    // open and unpinned files, least recently used first
+    LruList _lru;
+    size_t _open = 0;
+    mutable bthread::Mutex _mutex;
+};
+
+} // namespace pain::manusya
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 
 #include <boost/intrusive_ptr.hpp>
@@ -26,6 +27,9 @@ public:
     Future<Status> append(uint64_t offset, IOBuf buf) {
         return _store->append(this, offset, buf);
     }
+    Future<Status> append_direct(uint64_t offset, IOBuf buf) {
+        return _store->append_direct(this, offset, buf);
+    }
     Future<Status> read(uint64_t offset, uint64_t size, IOBuf* buf) {
         return _store->read(this, offset, size, buf);
     }
@@ -60,12 +64,12 @@ private:
     }
 
     friend void intrusive_ptr_release(FileHandle* file_handle) {
-        if (--file_handle->_use_count == 0) {
+        if (file_handle->_use_count.fetch_sub(1) == 1) {
             delete file_handle;
         }
     }
 
-    int _use_count = 0;
+    std::atomic<int> _use_count = 0;
 };
 
 } // namespace pain::manusya
@@ -0,0 +1,90 @@
+#include "manusya/group_committer.h"
+#include <butil/time.h>
+#include <bvar/bvar.h>
+#include <pain/base/plog.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+
+namespace pain::manusya {
+
+namespace {
+bvar::Adder<uint64_t> g_group_commit_count("manusya_group_commit_count");
+bvar::Adder<uint64_t> g_group_commit_sync_count("manusya_group_commit_sync_count");
+bvar::Adder<uint64_t> g_group_commit_entry_count("manusya_group_commit_entry_count");
+} // namespace
+
+GroupCommitter::GroupCommitter(uint64_t window_us, uint64_t max_bytes) : _window_us(window_us), _max_bytes(max_bytes) {
+    _thread = std::thread([this]() {
+        run();
+    });
+}
+
+GroupCommitter::~GroupCommitter() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopped = true;
+        _cond.notify_all();
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void GroupCommitter::commit(int fd, uint64_t bytes, Promise<Status> promise, std::shared_ptr<void> holder) {
+    std::lock_guard lock(_mutex);
+    if (_entries.empty()) {
+        _first_us = butil::monotonic_time_us();
+    }
+    _entries.push_back({fd, std::move(promise), std::move(holder)});
+    _bytes += bytes;
+    // wake up the syncer for the first entry to start the window, or when the batch is full
+    if (_entries.size() == 1 || _bytes >= _max_bytes) {
+        _cond.notify_one();
+    }
+}
+
+void GroupCommitter::run() {
+    std::vector<Entry> entries;
+    while (true) {
+        {
+            std::unique_lock lock(_mutex);
+            while (_entries.empty() && !_stopped) {
+                _cond.wait(lock);
+            }
+            if (_entries.empty()) {
+                return;
+            }
+            while (!_stopped && _bytes < _max_bytes) {
+                auto now = butil::monotonic_time_us();
+                if (now >= _first_us + _window_us) {
+                    break;
+                }
+                _cond.wait_for(lock, static_cast<long>(_first_us + _window_us - now));
+            }
+            entries.swap(_entries);
+            _bytes = 0;
+        }
+
+        // one fdatasync per file covers all the writes before it
+        std::map<int, Status> results;
+        for (const auto& entry : entries) {
+            results.emplace(entry.fd, Status::OK());
+        }
+        for (auto& [fd, status] : results) {
+            if (::fdatasync(fd) < 0) {
+                status = Status(errno, "failed to fdatasync");
+                PLOG_ERROR(("desc", "failed to fdatasync")("fd", fd)("error", errno));
+            }
+        }
+        g_group_commit_count << 1;
+        g_group_commit_sync_count << results.size();
+        g_group_commit_entry_count << entries.size();
+        for (auto& entry : entries) {
+            entry.promise.set_value(results[entry.fd]);
+        }
+        entries.clear();
+    }
+}
+
+} // namespace pain::manusya
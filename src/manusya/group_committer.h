@@ -0,0 +1,55 @@
+#pragma once
+
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+#include <pain/base/future.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace pain::manusya {
+
+// GroupCommitter makes written data durable in batches, writes arriving within a window or
+// up to a byte threshold share one fdatasync per file and their futures complete together.
+class GroupCommitter {
+public:
+    GroupCommitter(uint64_t window_us, uint64_t max_bytes);
+    ~GroupCommitter();
+    GroupCommitter(const GroupCommitter&) = delete;
+    GroupCommitter& operator=(const GroupCommitter&) = delete;
+
+    // bytes have been written to fd, promise is set after they are synced, fd must be kept
+    // open until then, e.g. by an owner passed as holder which is released after the sync
+    void commit(int fd, uint64_t bytes, Promise<Status> promise, std::shared_ptr<void> holder = nullptr);
+
+    Future<Status> commit(int fd, uint64_t bytes, std::shared_ptr<void> holder = nullptr) {
+        Promise<Status> promise;
+        auto future = promise.get_future();
+        commit(fd, bytes, std::move(promise), std::move(holder));
+        return future;
+    }
+
+private:
+    struct Entry {
+        int fd;
+        Promise<Status> promise;
+        std::shared_ptr<void> holder;
+    };
+
+    void run();
+
+    uint64_t _window_us;
+    uint64_t _max_bytes;
+    std::vector<Entry> _entries;
+    uint64_t _bytes = 0;
+    // arrival of the first entry of the current batch
+    uint64_t _first_us = 0;
+    bool _stopped = false;
+    bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+    std::thread _thread;
+};
+
+} // namespace pain::manusya
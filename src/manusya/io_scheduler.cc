@@ -0,0 +1,219 @@
+#include "manusya/io_scheduler.h"
+#include <butil/time.h>
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+DEFINE_uint32(manusya_io_max_inflight, 64, "Ios on the store at once, 0 admits every io without scheduling");
+DEFINE_uint32(manusya_io_latency_reserved, 8, "Slots of manusya_io_max_inflight only the latency class may use");
+DEFINE_uint32(manusya_io_default_weight, 8, "Weight of tenants not in manusya_io_tenant_weights");
+DEFINE_uint32(manusya_io_background_weight, 1, "Weight of background ios, such as scrubbing");
+DEFINE_string(manusya_io_tenant_weights, "", "Weights of tenants, e.g. tenant_a:16,tenant_b:4");
+DEFINE_string(manusya_io_tenant_limits,
+              "",
+              "IOPS and bytes per second of tenants, 0 is unlimited, e.g. tenant_a:1000:104857600,tenant_b:0:1048576");
+
+namespace pain::manusya {
+
+namespace {
+bvar::Adder<int64_t> g_io_queued("manusya_io_queued");
+bvar::Adder<int64_t> g_io_inflight("manusya_io_inflight");
+bvar::LatencyRecorder g_io_queue_latency("manusya_io_queue");
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::istringstream in(s);
+    std::string part;
+    while (std::getline(in, part, sep)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+bool parse_uint(const std::string& s, uint64_t* value) {
+    const auto* end = s.data() + s.size();
+    auto [ptr, ec] = std::from_chars(s.data(), end, *value);
+    return ec == std::errc() && ptr == end;
+}
+} // namespace
+
+IoSlot::~IoSlot() {
+    if (_scheduler != nullptr) {
+        _scheduler->release();
+    }
+}
+
+IoSlot& IoSlot::operator=(IoSlot&& other) noexcept {
+    if (this != &other) {
+        if (_scheduler != nullptr) {
+            _scheduler->release();
+        }
+        _scheduler = std::exchange(other._scheduler, nullptr);
+    }
+    return *this;
+}
+
+IoScheduler& IoScheduler::instance() {
+    static IoScheduler s_scheduler;
+    return s_scheduler;
+}
+
+IoScheduler::IoScheduler() {
+    for (const auto& entry : split(FLAGS_manusya_io_tenant_weights, ',')) {
+        auto fields = split(entry, ':');
+        uint64_t weight = 0;
+        if (fields.size() != 2 || !parse_uint(fields[1], &weight) || weight == 0) {
+            PLOG_WARN(("desc", "invalid tenant weight")("entry", entry));
+            continue;
+        }
+        _weights[fields[0]] = static_cast<double>(weight);
+    }
+    for (const auto& entry : split(FLAGS_manusya_io_tenant_limits, ',')) {
+        auto fields = split(entry, ':');
+        uint64_t iops = 0;
+        uint64_t bytes = 0;
+        if (fields.size() != 3 || !parse_uint(fields[1], &iops) || !parse_uint(fields[2], &bytes)) {
+            PLOG_WARN(("desc", "invalid tenant limit")("entry", entry));
+            continue;
+        }
+        _limits[fields[0]] = std::make_unique<Limit>(iops, bytes);
+    }
+}
+
+IoSlot IoScheduler::admit(const proto::IoTag& tag, uint64_t bytes) {
+    if (FLAGS_manusya_io_max_inflight == 0) {
+        return IoSlot();
+    }
+    auto start_us = butil::gettimeofday_us();
+    Waiter waiter;
+    waiter.bytes = bytes;
+    std::unique_lock lock(_mutex);
+    queue(tag).waiters.push_back(&waiter);
+    g_io_queued << 1;
+    while (true) {
+        auto now = butil::gettimeofday_us();
+        auto wakeup_us = dispatch(now);
+        if (waiter.granted) {
+            break;
+        }
+        if (wakeup_us < 0) {
+            _cond.wait(lock);
+        } else {
+            _cond.wait_for(lock, std::max<int64_t>(1, wakeup_us - now));
+        }
+    }
+    g_io_queued << -1;
+    g_io_queue_latency << butil::gettimeofday_us() - start_us;
+    return IoSlot(this);
+}
+
+uint32_t IoScheduler::inflight() const {
+    std::lock_guard lock(_mutex);
+    return _inflight;
+}
+
+uint32_t IoScheduler::queued() const {
+    std::lock_guard lock(_mutex);
+    uint32_t n = 0;
+    for (const auto& [key, q] : _queues) {
+        n += q.waiters.size();
+    }
+    return n;
+}
+
+void IoScheduler::release() {
+    std::lock_guard lock(_mutex);
+    _inflight--;
+    g_io_inflight << -1;
+    dispatch(butil::gettimeofday_us());
+}
+
+IoScheduler::Queue& IoScheduler::queue(const proto::IoTag& tag) {
+    auto [it, inserted] = _queues.try_emplace({tag.tenant(), tag.io_class()});
+    auto& q = it->second;
+    if (inserted) {
+        q.tenant = tag.tenant();
+        q.latency = tag.io_class() == proto::IoClass::IO_CLASS_LATENCY;
+        if (tag.io_class() == proto::IoClass::IO_CLASS_BACKGROUND) {
+            q.weight = std::max(1U, FLAGS_manusya_io_background_weight);
+        } else {
+            auto weight = _weights.find(tag.tenant());
+            q.weight = weight != _weights.end() ? weight->second : std::max(1U, FLAGS_manusya_io_default_weight);
+        }
+    }
+    return q;
+}
+
+int64_t IoScheduler::dispatch(int64_t now_us) {
+    auto max_inflight = FLAGS_manusya_io_max_inflight;
+    if (max_inflight == 0) {
+        // scheduling was turned off while ios waited, they all go
+        max_inflight = std::numeric_limits<uint32_t>::max();
+    }
+    auto reserved = std::min(FLAGS_manusya_io_latency_reserved, max_inflight - 1);
+    int64_t wakeup_us = -1;
+    // waiters recompute when to wake up once a queue is held by the limits
+    bool changed = false;
+    while (_inflight < max_inflight) {
+        Queue* next = nullptr;
+        for (auto it = _queues.begin(); it != _queues.end();) {
+            auto& q = it->second;
+            if (q.waiters.empty()) {
+                // an idle queue ahead of the virtual time would keep the share it did not use
+                it = q.finish <= _vtime ? _queues.erase(it) : std::next(it);
+                continue;
+            }
+            ++it;
+            if (q.not_before_us > now_us) {
+                wakeup_us = wakeup_us < 0 ? q.not_before_us : std::min(wakeup_us, q.not_before_us);
+                continue;
+            }
+            if (!q.latency && _inflight + reserved >= max_inflight) {
+                continue;
+            }
+            if (next == nullptr || (q.latency && !next->latency) ||
+                (q.latency == next->latency && std::max(q.finish, _vtime) < std::max(next->finish, _vtime))) {
+                next = &q;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+
+        auto* waiter = next->waiters.front();
+        if (!next->head_charged) {
+            next->head_charged = true;
+            auto limit = _limits.find(next->tenant);
+            if (limit != _limits.end()) {
+                auto& buckets = *limit->second;
+                auto wait_us = std::max(buckets.ios.take(1, now_us), buckets.bytes.take(waiter->bytes, now_us));
+                if (wait_us > 0) {
+                    next->not_before_us = now_us + wait_us;
+                    wakeup_us = wakeup_us < 0 ? next->not_before_us : std::min(wakeup_us, next->not_before_us);
+                    changed = true;
+                    continue;
+                }
+            }
+        }
+        next->waiters.pop_front();
+        next->head_charged = false;
+        _vtime = std::max(next->finish, _vtime);
+        next->finish = _vtime + static_cast<double>(waiter->bytes + kIoCostBytes) / next->weight;
+        waiter->granted = true;
+        _inflight++;
+        g_io_inflight << 1;
+        changed = true;
+    }
+    if (changed) {
+        _cond.notify_all();
+    }
+    return wakeup_us;
+}
+
+} // namespace pain::manusya
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "pain/proto/common.pb.h"
+#include "common/token_bucket.h"
+
+namespace pain::manusya {
+
+class IoScheduler;
+
+// IoSlot is the right of an admitted io to use the store, it is given back when destroyed
+class IoSlot {
+public:
+    IoSlot() = default;
+    explicit IoSlot(IoScheduler* scheduler) : _scheduler(scheduler) {}
+    ~IoSlot();
+    IoSlot(IoSlot&& other) noexcept : _scheduler(std::exchange(other._scheduler, nullptr)) {}
+    IoSlot& operator=(IoSlot&& other) noexcept;
+    IoSlot(const IoSlot&) = delete;
+    IoSlot& operator=(const IoSlot&) = delete;
+
+private:
+    IoScheduler* _scheduler = nullptr;
+};
+
+// IoScheduler admits the ios of manusya to the store, at most manusya_io_max_inflight at once.
+// Ios wait in a queue per tenant and class:
+//
+// - queues share the store by weighted start time fair queueing, an io costs its bytes plus
+//   kIoCostBytes and a queue is served in proportion to its weight, set by
+//   manusya_io_tenant_weights or manusya_io_default_weight, background queues weigh
+//   manusya_io_background_weight whatever their tenant;
+// - a tenant limited by manusya_io_tenant_limits waits once it used its IOPS or bandwidth;
+// - the latency class goes ahead of the others, and manusya_io_latency_reserved slots are
+//   kept for it so it never waits behind large ios already on the store.
+//
+// An idle queue does not save up its share, it starts again at the current virtual time.
+class IoScheduler {
+public:
+    // bytes an io costs on top of its size, so small ios are not free
+    static constexpr uint64_t kIoCostBytes = 4096;
+
+    // the scheduler of the ios of Bank::instance()
+    static IoScheduler& instance();
+
+    // reads the weights and limits from the flags
+    IoScheduler();
+    IoScheduler(const IoScheduler&) = delete;
+    IoScheduler& operator=(const IoScheduler&) = delete;
+
+    // wait until an io of bytes tagged tag may use the store
+    [[nodiscard]] IoSlot admit(const proto::IoTag& tag, uint64_t bytes);
+
+    // ios admitted and not released
+    uint32_t inflight() const;
+    // ios waiting to be admitted
+    uint32_t queued() const;
+
+private:
+    friend class IoSlot;
+
+    struct Waiter {
+        uint64_t bytes = 0;
+        bool granted = false;
+    };
+
+    struct Queue {
+        std::string tenant;
+        bool latency = false;
+        double weight = 1;
+        std::deque<Waiter*> waiters;
+        // virtual finish time of the last io admitted
+        double finish = 0;
+        // the head waits for the limits of the tenant until then
+        int64_t not_before_us = 0;
+        // the limits were charged for the head
+        bool head_charged = false;
+    };
+
+    struct Limit {
+        Limit(uint64_t iops, uint64_t bytes_per_second) : ios(iops, iops), bytes(bytes_per_second, bytes_per_second) {}
+
+        common::TokenBucket ios;
+        common::TokenBucket bytes;
+    };
+
+    void release();
+    Queue& queue(const proto::IoTag& tag);
+    // admit waiters while there are slots, returns when a queue held by limits is ready again,
+    // or -1 if none is
+    int64_t dispatch(int64_t now_us);
+
+    std::unordered_map<std::string, double> _weights;
+    std::unordered_map<std::string, std::unique_ptr<Limit>> _limits;
+    mutable bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+    // by tenant and class
+    std::map<std::pair<std::string, int>, Queue> _queues;
+    // start time of the last io admitted
+    double _vtime = 0;
+    uint32_t _inflight = 0;
+};
+
+} // namespace pain::manusya
@@ -2,44 +2,132 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <gflags/gflags.h>
 #include <pain/base/future.h>
 #include <pain/base/plog.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/xattr.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <format>
+#include <memory>
+#include <mutex>
 #include <boost/assert.hpp>
 #include "butil/iobuf.h"
 #include "manusya/file_handle.h"
 #include "manusya/store.h"
 
+DEFINE_uint64(manusya_group_commit_window_us, 500, "Max time an append waits for others to share one fdatasync");
+DEFINE_uint64(manusya_group_commit_bytes,
+              8 * 1024 * 1024,
+              "Bytes written to trigger a group commit before the window ends");
+
 namespace pain::manusya {
 
-class LocalFileHandle : public FileHandle {
-public:
-    LocalFileHandle(int fd, StorePtr store) : FileHandle(store), _fd(fd) {}
+namespace {
+// directory of the catalog in the data path
+constexpr const char* kCatalogDir = ".catalog";
+
+// O_DIRECT requires offset, size and memory to be aligned to the logical block size
+constexpr uint64_t kDirectIOAlignment = 4096;
 
-    ~LocalFileHandle() override {
-        BOOST_ASSERT(_fd > 0);
-        close(_fd);
-    };
+uint64_t align_down(uint64_t value) {
+    return value & ~(kDirectIOAlignment - 1);
+}
+
+uint64_t align_up(uint64_t value) {
+    return align_down(value + kDirectIOAlignment - 1);
+}
 
-    int64_t handle() const {
-        return _fd;
+using AlignedBuffer = std::unique_ptr<char, decltype(&free)>;
+
+AlignedBuffer allocate_aligned(uint64_t size) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, kDirectIOAlignment, size) != 0) {
+        return AlignedBuffer(nullptr, free);
     }
+    return AlignedBuffer(static_cast<char*>(ptr), free);
+}
 
-private:
-    int64_t _fd = 0;
-};
+// read one aligned block, the part beyond the end of file is zero filled
+Status read_block(int fd, uint64_t offset, char* block) {
+    uint64_t done = 0;
+    while (done < kDirectIOAlignment) {
+        auto nr = ::pread(fd, block + done, kDirectIOAlignment - done, static_cast<off_t>(offset + done));
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return Status(errno, "failed to read block");
+        }
+        if (nr == 0) {
+            break;
+        }
+        done += nr;
+    }
+    memset(block + done, 0, kDirectIOAlignment - done);
+    return Status::OK();
+}
+} // namespace
 
-LocalStore::LocalStore(const char* data_path) : _data_path(data_path) {
+LocalStore::LocalStore(const char* data_path, Durability durability, bool catalog) :
+    _data_path(data_path), _durability(durability) {
     BOOST_ASSERT(data_path != nullptr);
+    if (durability == Durability::kGroupCommit) {
+        _committer =
+            std::make_unique<GroupCommitter>(FLAGS_manusya_group_commit_window_us, FLAGS_manusya_group_commit_bytes);
+    }
     constexpr mode_t mode = 0774;
     int r = ::mkdir(data_path, mode);
     if (r < 0 && errno != EEXIST) {
         PLOG_ERROR(("desc", "failed to create data path")("path", data_path));
     }
+    if (!catalog) {
+        return;
+    }
+    auto catalog_path = std::format("{}/{}", _data_path, kCatalogDir);
+    auto status = Catalog::open(catalog_path.c_str(), durability != Durability::kNone, &_catalog);
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to open catalog")("path", catalog_path)("error", status.error_str()));
+        BOOST_ASSERT_MSG(false, "failed to open catalog");
+        return;
+    }
+    if (_catalog->empty()) {
+        import_files();
+    }
+}
+
+void LocalStore::import_files() {
+    DIR* dir = opendir(_data_path.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_type != DT_REG) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(dir), entry->d_name, &st, 0) < 0) {
+            PLOG_ERROR(("desc", "failed to stat file")("path", entry->d_name)("error", errno));
+            continue;
+        }
+        // files sealed before the catalog existed are read only
+        auto status = (st.st_mode & S_IWUSR) == 0 ? _catalog->seal(entry->d_name, st.st_size)
+                                                  : _catalog->create(entry->d_name);
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to import file")("path", entry->d_name)("error", status.error_str()));
+        }
+    }
+    closedir(dir);
+}
+
+std::string LocalStore::name_of(FileHandlePtr fh) const {
+    return fh->as<LocalFileHandle>()->path().substr(_data_path.size() + 1);
 }
 
 Future<Status> LocalStore::open(const char* path, int flags, FileHandlePtr* fh) {
@@ -49,6 +137,11 @@ Future<Status> LocalStore::open(const char* path, int flags, FileHandlePtr* fh)
     if (fh == nullptr) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
+    // sealed files are read only, as with the file mode when there is no catalog
+    FileMeta meta;
+    if (_catalog != nullptr && (flags & O_ACCMODE) != O_RDONLY && _catalog->get(path, &meta).ok() && meta.sealed) {
+        return make_ready_future(Status(EACCES, "file is sealed"));
+    }
     auto data_path = std::format("{}/{}", _data_path, path);
     constexpr mode_t mode = 0666;
     int fd = ::open(data_path.c_str(), flags, mode);
@@ -56,55 +149,208 @@ Future<Status> LocalStore::open(const char* path, int flags, FileHandlePtr* fh)
     if (fd < 0) {
         return make_ready_future(Status(errno, "failed to open file"));
     }
-    *fh = FileHandlePtr(new LocalFileHandle(fd, this));
+    FileHandlePtr handle(new LocalFileHandle(fd, flags, data_path, this));
+    // the data of a file is synced later, its directory entry has to be synced on creation
+    if ((flags & O_CREAT) != 0 && _durability != Durability::kNone) {
+        auto status = fsync_dir(std::filesystem::path(data_path).parent_path().string());
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to sync directory")("path", data_path)("error", status.error_str()));
+            return make_ready_future(std::move(status));
+        }
+    }
+    if (_catalog != nullptr && (flags & O_CREAT) != 0) {
+        auto status = _catalog->create(path);
+        if (!status.ok()) {
+            return make_ready_future(std::move(status));
+        }
+    }
+    *fh = std::move(handle);
     return make_ready_future(Status::OK());
 }
 
+void LocalFileHandle::finish_unlocked_append() {
+    // the first direct append sets the flag before waiting, so the last append out either
+    // wakes it or was counted out before it looked
+    if (--_unlocked_appends == 0 && _direct) {
+        std::lock_guard lock(_drain_mutex);
+        _drained.notify_all();
+    }
+}
+
 Future<Status> LocalStore::append(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
-    std::ignore = offset;
     if (fh == nullptr) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
 
-    int fd = fh->as<LocalFileHandle>()->handle();
+    // pairs with append_direct, either it sees this append in flight or this append sees
+    // the file taking direct appends
+    auto* lfh = fh->as<LocalFileHandle>();
+    lfh->_unlocked_appends++;
+    if (!lfh->_direct) {
+        auto future = append_buffered(std::move(fh), offset, std::move(buf));
+        lfh->finish_unlocked_append();
+        return future;
+    }
+    lfh->finish_unlocked_append();
+    std::unique_lock lock(lfh->_direct_mutex);
+    return append_buffered(std::move(fh), offset, std::move(buf));
+}
 
-    auto buf_size = buf.size();
-    auto nw = buf.cut_into_file_descriptor(fd, buf_size);
-    PLOG_DEBUG(("desc", "append to file")("fd", fd)("nw", nw)("buf_size", buf_size));
-    if (nw < 0) {
-        return make_ready_future(Status(errno, "failed to write to file"));
+Future<Status> LocalStore::append_buffered(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
+    FdPin pin;
+    auto status = fh->as<LocalFileHandle>()->pin(&pin);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
     }
+    int fd = pin.fd();
 
-    BOOST_ASSERT(nw == buf_size);
+    // positional write, appends to different ranges of the same file may be issued concurrently
+    auto buf_size = buf.size();
+    while (!buf.empty()) {
+        auto nw = buf.pcut_into_file_descriptor(fd, static_cast<off_t>(offset + buf_size - buf.size()), buf.size());
+        if (nw < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            PLOG_ERROR(("desc", "failed to write to file")("fd", fd)("offset", offset)("error", errno));
+            return make_ready_future(Status(errno, "failed to write to file"));
+        }
+    }
+    PLOG_DEBUG(("desc", "append to file")("fd", fd)("offset", offset)("buf_size", buf_size));
 
+    if (_durability == Durability::kGroupCommit) {
+        // the fd stays open until synced
+        return _committer->commit(fd, buf_size, std::make_shared<FdPin>(std::move(pin)));
+    }
     return make_ready_future(Status::OK());
 }
 
-Future<Status> LocalStore::read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) {
+Future<Status> LocalStore::append_direct(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
     if (fh == nullptr) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
-    if (buf == nullptr) {
-        return make_ready_future(Status(EINVAL, "buf is nullptr"));
+    if (buf.empty()) {
+        return make_ready_future(Status::OK());
     }
 
-    int fd = fh->as<LocalFileHandle>()->handle();
+    auto* lfh = fh->as<LocalFileHandle>();
+    std::unique_lock lock(lfh->_direct_mutex);
+    if (!lfh->_direct) {
+        // wait for the buffered appends that didn't see the flag
+        lfh->_direct = true;
+        std::unique_lock drain_lock(lfh->_drain_mutex);
+        while (lfh->_unlocked_appends > 0) {
+            lfh->_drained.wait(drain_lock);
+        }
+    }
+    if (lfh->_direct_unsupported) {
+        return append_buffered(std::move(fh), offset, std::move(buf));
+    }
+    if (lfh->_direct_fd < 0) {
+        int fd = ::open(lfh->path().c_str(), O_RDWR | O_DIRECT);
+        if (fd < 0 && errno == EINVAL) {
+            // file system without O_DIRECT support, such as tmpfs
+            PLOG_WARN(("desc", "O_DIRECT is not supported, fallback to buffered append")("path", lfh->path()));
+            lfh->_direct_unsupported = true;
+            return append_buffered(std::move(fh), offset, std::move(buf));
+        }
+        if (fd < 0) {
+            return make_ready_future(Status(errno, "failed to open file with O_DIRECT"));
+        }
+        lfh->_direct_fd = fd;
+    }
+    int fd = lfh->_direct_fd;
 
-    butil::IOPortal iop;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return make_ready_future(Status(errno, "failed to fstat"));
+    }
+    uint64_t file_size = st.st_size;
 
-    auto r = lseek(fd, offset, SEEK_SET);
-    if (r < 0) {
-        return make_ready_future(Status(errno, "failed to lseek"));
+    auto size = buf.size();
+    auto end = offset + size;
+    auto start = align_down(offset);
+    auto aligned_end = align_up(end);
+    auto aligned_size = aligned_end - start;
+    auto block = allocate_aligned(aligned_size);
+    if (block == nullptr) {
+        return make_ready_future(Status(ENOMEM, "failed to allocate aligned buffer"));
+    }
+
+    // partial head and tail blocks keep the bytes around the appended range,
+    // which may have been written by appends completing out of order
+    auto tail = aligned_end - kDirectIOAlignment;
+    if (start != offset) {
+        auto status = read_block(fd, start, block.get());
+        if (!status.ok()) {
+            return make_ready_future(std::move(status));
+        }
+    }
+    if (end != aligned_end && (tail != start || start == offset)) {
+        auto status = read_block(fd, tail, block.get() + (tail - start));
+        if (!status.ok()) {
+            return make_ready_future(std::move(status));
+        }
+    }
+    buf.copy_to(block.get() + (offset - start), size);
+
+    uint64_t done = 0;
+    while (done < aligned_size) {
+        auto nw = ::pwrite(fd, block.get() + done, aligned_size - done, static_cast<off_t>(start + done));
+        if (nw < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            PLOG_ERROR(("desc", "failed to write to file")("fd", fd)("offset", offset)("error", errno));
+            return make_ready_future(Status(errno, "failed to write to file"));
+        }
+        done += nw;
     }
 
-    auto nr = iop.append_from_file_descriptor(fd, size);
-    if (nr < 0) {
-        PLOG_ERROR(("desc", "failed to read from file")("error", errno)("fd", fd));
-        return make_ready_future(Status(errno, "failed to read from file"));
+    // cut the zero padding of the tail block
+    auto new_size = std::max(file_size, end);
+    if (aligned_end > new_size && ::ftruncate(fd, static_cast<off_t>(new_size)) < 0) {
+        return make_ready_future(Status(errno, "failed to ftruncate"));
     }
+    PLOG_DEBUG(("desc", "direct append to file")("fd", fd)("offset", offset)("buf_size", size));
 
-    if (nr != size) {
-        return make_ready_future(Status(EINVAL, "invalid size"));
+    // O_DIRECT skips the page cache, but neither the device cache nor the size update
+    if (_durability == Durability::kGroupCommit) {
+        lock.unlock();
+        return _committer->commit(fd, size);
+    }
+    return make_ready_future(Status::OK());
+}
+
+Future<Status> LocalStore::read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (buf == nullptr) {
+        return make_ready_future(Status(EINVAL, "buf is nullptr"));
+    }
+
+    FdPin pin;
+    auto status = fh->as<LocalFileHandle>()->pin(&pin);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    int fd = pin.fd();
+
+    // positional read, doesn't touch the file offset so one fd can serve concurrent readers
+    butil::IOPortal iop;
+    while (iop.size() < size) {
+        auto nr = iop.pappend_from_file_descriptor(fd, static_cast<off_t>(offset + iop.size()), size - iop.size());
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            PLOG_ERROR(("desc", "failed to read from file")("error", errno)("fd", fd));
+            return make_ready_future(Status(errno, "failed to read from file"));
+        }
+        if (nr == 0) {
+            return make_ready_future(Status(EINVAL, "invalid size"));
+        }
     }
 
     iop.swap(*buf);
@@ -117,12 +363,38 @@ Future<Status> LocalStore::seal(FileHandlePtr fh) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
 
-    int fd = fh->as<LocalFileHandle>()->handle();
+    FdPin pin;
+    auto status = fh->as<LocalFileHandle>()->pin(&pin);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    int fd = pin.fd();
+    if (_catalog != nullptr) {
+        // data is synced before the catalog records the final size
+        if (_durability != Durability::kNone && ::fdatasync(fd) < 0) {
+            return make_ready_future(Status(errno, "failed to fdatasync"));
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            return make_ready_future(Status(errno, "failed to fstat"));
+        }
+        status = _catalog->seal(name_of(fh), st.st_size);
+        if (status.ok()) {
+            // sealed files can only be opened read only
+            FdCache::instance().set_flags(fh->as<LocalFileHandle>()->_file, O_RDONLY);
+        }
+        return make_ready_future(std::move(status));
+    }
     constexpr mode_t mode = 0444;
     int r = ::fchmod(fd, mode);
     if (r < 0) {
         return make_ready_future(Status(errno, "failed to fchmod"));
     }
+    FdCache::instance().set_flags(fh->as<LocalFileHandle>()->_file, O_RDONLY);
+    // make both the data and the sealed mode durable
+    if (_durability != Durability::kNone && ::fsync(fd) < 0) {
+        return make_ready_future(Status(errno, "failed to fsync"));
+    }
     return make_ready_future(Status::OK());
 }
 
@@ -134,7 +406,19 @@ Future<Status> LocalStore::size(FileHandlePtr fh, uint64_t* size) {
         return make_ready_future(Status(EINVAL, "size is nullptr"));
     }
 
-    int fd = fh->as<LocalFileHandle>()->handle();
+    // size of sealed files never changes
+    FileMeta meta;
+    if (_catalog != nullptr && _catalog->get(name_of(fh), &meta).ok() && meta.sealed) {
+        *size = meta.size;
+        return make_ready_future(Status::OK());
+    }
+
+    FdPin pin;
+    auto status = fh->as<LocalFileHandle>()->pin(&pin);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    int fd = pin.fd();
     struct stat st;
     if (fstat(fd, &st) < 0) {
         return make_ready_future(Status(errno, "failed to fstat"));
@@ -151,10 +435,15 @@ Future<Status> LocalStore::remove(const char* path) {
 
     auto data_path = std::format("{}/{}", _data_path, path);
     int r = ::unlink(data_path.c_str());
-    if (r < 0) {
-        return make_ready_future(Status(errno, "failed to unlink"));
+    auto status = r < 0 ? Status(errno, "failed to unlink") : Status::OK();
+    FileMeta meta;
+    if (_catalog != nullptr && _catalog->get(path, &meta).ok()) {
+        auto catalog_status = _catalog->remove(path);
+        if (!catalog_status.ok()) {
+            return make_ready_future(std::move(catalog_status));
+        }
     }
-    return make_ready_future(Status::OK());
+    return make_ready_future(std::move(status));
 }
 
 Future<Status> LocalStore::set_attr(FileHandlePtr fh, const char* key, const char* value) {
@@ -168,7 +457,15 @@ Future<Status> LocalStore::set_attr(FileHandlePtr fh, const char* key, const cha
         return make_ready_future(Status(EINVAL, "value is nullptr"));
     }
 
-    int fd = fh->as<LocalFileHandle>()->handle();
+    if (_catalog != nullptr) {
+        return make_ready_future(_catalog->set_attr(name_of(fh), key, value));
+    }
+    FdPin pin;
+    auto status = fh->as<LocalFileHandle>()->pin(&pin);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    int fd = pin.fd();
     int r = fsetxattr(fd, key, value, strlen(value), 0);
     if (r < 0) {
         return make_ready_future(Status(errno, "failed to fsetxattr"));
@@ -187,7 +484,15 @@ Future<Status> LocalStore::get_attr(FileHandlePtr fh, const char* key, std::stri
         return make_ready_future(Status(EINVAL, "value is nullptr"));
     }
 
-    int fd = fh->as<LocalFileHandle>()->handle();
+    if (_catalog != nullptr) {
+        return make_ready_future(_catalog->get_attr(name_of(fh), key, value));
+    }
+    FdPin pin;
+    auto status = fh->as<LocalFileHandle>()->pin(&pin);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    int fd = pin.fd();
     constexpr size_t buf_size = 1024;
     char buf[buf_size];
     int r = fgetxattr(fd, key, buf, sizeof(buf));
@@ -206,7 +511,15 @@ Future<Status> LocalStore::list_attrs(FileHandlePtr fh, std::map<std::string, st
         return make_ready_future(Status(EINVAL, "attrs is nullptr"));
     }
 
-    int fd = fh->as<LocalFileHandle>()->handle();
+    if (_catalog != nullptr) {
+        return make_ready_future(_catalog->list_attrs(name_of(fh), attrs));
+    }
+    FdPin pin;
+    auto status = fh->as<LocalFileHandle>()->pin(&pin);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    int fd = pin.fd();
     constexpr size_t buf_size = 1024;
     char buf[buf_size];
     int r = flistxattr(fd, buf, sizeof(buf));
@@ -222,7 +535,7 @@ Future<Status> LocalStore::list_attrs(FileHandlePtr fh, std::map<std::string, st
             return make_ready_future(Status(errno, "failed to fgetxattr"));
         }
         std::string value;
-        auto status = get_attr(fh, key, &value).get();
+        status = get_attr(fh, key, &value).get();
         if (!status.ok()) {
             return make_ready_future(std::move(status));
         }
@@ -234,6 +547,17 @@ Future<Status> LocalStore::list_attrs(FileHandlePtr fh, std::map<std::string, st
 }
 
 void LocalStore::for_each(std::function<void(const char* path)> cb) {
+    if (_catalog != nullptr) {
+        _catalog->for_each([&cb](const std::string& name, const FileMeta&) {
+            try {
+                cb(name.c_str());
+            } catch (...) {
+                return;
+            }
+        });
+        return;
+    }
+
     DIR* dir = opendir(_data_path.c_str());
     if (dir == nullptr) {
         return;
@@ -252,4 +576,18 @@ void LocalStore::for_each(std::function<void(const char* path)> cb) {
     closedir(dir);
 }
 
+Future<Status> LocalStore::set_checksums(const char* path, const std::string& checksums) {
+    if (_catalog != nullptr) {
+        return make_ready_future(_catalog->set_checksums(path, checksums));
+    }
+    return Store::set_checksums(path, checksums);
+}
+
+Future<Status> LocalStore::get_checksums(const char* path, std::string* checksums) {
+    if (_catalog != nullptr) {
+        return make_ready_future(_catalog->get_checksums(path, checksums));
+    }
+    return Store::get_checksums(path, checksums);
+}
+
 }; // namespace pain::manusya
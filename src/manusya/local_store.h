@@ -1,17 +1,89 @@
 #pragma once
 
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+#include <unistd.h>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <string>
+#include "manusya/catalog.h"
+#include "manusya/fd_cache.h"
+#include "manusya/file_handle.h"
+#include "manusya/group_committer.h"
 #include "manusya/store.h"
 
 namespace pain::manusya {
 
+// LocalFileHandle refers to a file in the process wide fd cache, the fd may be closed while
+// the handle is idle and is reopened by pin
+class LocalFileHandle : public FileHandle {
+public:
+    LocalFileHandle(int fd, int flags, std::string path, StorePtr store) :
+        FileHandle(store), _file(FdCache::instance().add(path, flags, fd)), _path(std::move(path)) {}
+
+    ~LocalFileHandle() override {
+        FdCache::instance().release(_file);
+        if (_direct_fd >= 0) {
+            close(_direct_fd);
+        }
+    };
+
+    // keep the fd open until the pin is reset
+    Status pin(FdPin* pin) const {
+        return FdCache::instance().pin(_file, pin);
+    }
+
+    const std::string& path() const {
+        return _path;
+    }
+
+private:
+    friend class LocalStore;
+
+    void finish_unlocked_append();
+
+    CachedFdPtr _file;
+    std::string _path;
+    // opened with O_DIRECT on the first direct append, which are serialized by _direct_mutex
+    // since the read-modify-write of partial blocks must not interleave
+    int _direct_fd = -1;
+    // the file system rejected O_DIRECT, direct appends are buffered ones
+    bool _direct_unsupported = false;
+    // set by the first direct append, later buffered appends take _direct_mutex as well so
+    // they don't land in a partial block being rewritten
+    std::atomic<bool> _direct = false;
+    // buffered appends running without _direct_mutex, drained by the first direct append
+    // which waits on _drained until the last of them is done
+    std::atomic<uint32_t> _unlocked_appends = 0;
+    bthread::Mutex _direct_mutex;
+    bthread::Mutex _drain_mutex;
+    bthread::ConditionVariable _drained;
+};
+
+enum class Durability {
+    // acknowledged data may still be in the page cache
+    kNone = 0,
+    // data is synced when the file is sealed
+    kSyncOnSeal = 1,
+    // each append is synced before acknowledged, fdatasync is shared by concurrent appends
+    kGroupCommit = 2,
+};
+
+// With a catalog, sizes, sealed states, attributes and checksums of files are recorded in a
+// rocksdb under <data_path>/.catalog instead of file modes, xattrs and sidecar files, and
+// files are listed from it instead of the directory. Files found in the directory when the
+// catalog is created are imported once.
 class LocalStore : public Store {
 public:
-    LocalStore(const char* data_path);
+    LocalStore(const char* data_path, Durability durability = Durability::kNone, bool catalog = false);
     ~LocalStore() override = default;
 
     Future<Status> open(const char* path, int flags, FileHandlePtr* fh) override;
     Future<Status> append(FileHandlePtr fh, uint64_t offset, IOBuf buf) override;
+    // writes aligned blocks with O_DIRECT, partial blocks are read back and merged, so once a
+    // file took a direct append, all appends to it are serialized
+    Future<Status> append_direct(FileHandlePtr fh, uint64_t offset, IOBuf buf) override;
     Future<Status> read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) override;
     Future<Status> seal(FileHandlePtr fh) override;
     Future<Status> size(FileHandlePtr fh, uint64_t* size) override;
@@ -20,9 +92,33 @@ public:
     Future<Status> get_attr(FileHandlePtr fh, const char* key, std::string* value) override;
     Future<Status> list_attrs(FileHandlePtr fh, std::map<std::string, std::string>* attrs) override;
     void for_each(std::function<void(const char* path)> cb) override;
+    Future<Status> set_checksums(const char* path, const std::string& checksums) override;
+    Future<Status> get_checksums(const char* path, std::string* checksums) override;
+
+    // nullptr if the store keeps metadata in the file system
+    Catalog* catalog() const {
+        return _catalog.get();
+    }
+
+protected:
+    Durability durability() const {
+        return _durability;
+    }
+
+    GroupCommitter* committer() const {
+        return _committer.get();
+    }
 
 private:
+    // name of the file in the data path
+    std::string name_of(FileHandlePtr fh) const;
+    Future<Status> append_buffered(FileHandlePtr fh, uint64_t offset, IOBuf buf);
+    void import_files();
+
     std::string _data_path;
+    Durability _durability;
+    std::unique_ptr<GroupCommitter> _committer;
+    CatalogPtr _catalog;
 };
 
 } // namespace pain::manusya
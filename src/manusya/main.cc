@@ -3,8 +3,14 @@
 #include <pain/base/scope_exit.h>
 #include <pain/base/spdlog_sink.h>
 #include <pain/base/tracer.h>
+#include <memory>
+#include "common/erasure_code.h"
 #include "manusya/bank.h"
+#include "manusya/ec_cluster.h"
+#include "manusya/ec_encoder.h"
 #include "manusya/manusya_service_impl.h"
+#include "manusya/scrub_reporter.h"
+#include "manusya/scrubber.h"
 
 DEFINE_string(manusya_listen_address, "127.0.0.1:8101", "Listen address of manusya");
 DEFINE_int32(idle_timeout_s,
@@ -12,6 +18,11 @@ DEFINE_int32(idle_timeout_s,
              "Connection will be closed if there is no "
              "read/write operations during the last `idle_timeout_s'");
 DEFINE_string(log_level, "debug", "Log level");
+DEFINE_bool(manusya_ec_enable, false, "Convert cold sealed chunks to erasure coded fragments in the background");
+DEFINE_uint32(manusya_ec_data_count, 10, "Data fragments of erasure coded chunks");
+DEFINE_uint32(manusya_ec_parity_count, 4, "Parity fragments of erasure coded chunks");
+DEFINE_bool(manusya_scrub_enable, false, "Verify checksums of sealed chunks in the background");
+DEFINE_string(manusya_deva_conf, "", "Configuration of the deva group, e.g. 127.0.0.1:8201:0,127.0.0.1:8202:0");
 
 int main(int argc, char* argv[]) {
     gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -35,7 +46,12 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
-    pain::manusya::ManusyaServiceImpl manusya_service_impl;
+    std::unique_ptr<pain::manusya::RemoteEcCluster> ec_cluster;
+    if (FLAGS_manusya_ec_enable) {
+        ec_cluster = std::make_unique<pain::manusya::RemoteEcCluster>(FLAGS_manusya_deva_conf);
+    }
+
+    pain::manusya::ManusyaServiceImpl manusya_service_impl(ec_cluster.get());
     pain::init_tracer("manusya");
     auto stop_tracer = pain::make_scope_exit([]() {
         pain::cleanup_tracer();
@@ -53,6 +69,42 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    std::unique_ptr<pain::manusya::EcEncoder> ec_encoder;
+    if (ec_cluster != nullptr) {
+        pain::common::ErasureCodePtr code;
+        status = pain::common::ErasureCode::create(FLAGS_manusya_ec_data_count, FLAGS_manusya_ec_parity_count, &code);
+        if (!status.ok()) {
+            LOG(ERROR) << "Invalid erasure code: " << status.error_str();
+            return -1;
+        }
+        ec_encoder =
+            std::make_unique<pain::manusya::EcEncoder>(&pain::manusya::Bank::instance(), ec_cluster.get(), code);
+        status = ec_encoder->start();
+        if (!status.ok()) {
+            LOG(ERROR) << "Fail to start ec encoder";
+            return -1;
+        }
+    }
+
+    std::unique_ptr<pain::manusya::DevaScrubReporter> scrub_reporter;
+    std::unique_ptr<pain::manusya::Scrubber> scrubber;
+    if (FLAGS_manusya_scrub_enable) {
+        scrub_reporter =
+            std::make_unique<pain::manusya::DevaScrubReporter>(FLAGS_manusya_listen_address, FLAGS_manusya_deva_conf);
+        scrubber = std::make_unique<pain::manusya::Scrubber>(&pain::manusya::Bank::instance(), scrub_reporter.get());
+        status = scrubber->start();
+        if (!status.ok()) {
+            LOG(ERROR) << "Fail to start scrubber";
+            return -1;
+        }
+    }
+
     server.RunUntilAskedToQuit();
+    if (scrubber != nullptr) {
+        scrubber->stop();
+    }
+    if (ec_encoder != nullptr) {
+        ec_encoder->stop();
+    }
     return 0;
 }
@@ -1,14 +1,29 @@
 #include "manusya/manusya_service_impl.h"
 
+#include <brpc/callback.h>
+#include <brpc/channel.h>
 #include <brpc/controller.h>
+#include <bthread/bthread.h>
+#include <butil/time.h>
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include <pain/base/plog.h>
+#include <pain/base/scope_exit.h>
 #include <pain/base/tracer.h>
 #include "butil/endpoint.h"
+#include "common/crc32c.h"
 #include "common/object_id_util.h"
 #include "manusya/bank.h"
 #include "manusya/chunk.h"
+#include "manusya/chunk_stream.h"
+#include "manusya/io_scheduler.h"
 #include "manusya/macro.h"
+#include "manusya/peer_channels.h"
+#include "manusya/scrubber.h"
 
 #define MANUSYA_SERVICE_METHOD(name)                                                                                   \
     void ManusyaServiceImpl::name(::google::protobuf::RpcController* controller,                                       \
@@ -16,9 +31,150 @@
                                   [[maybe_unused]] pain::proto::manusya::name##Response* response,                     \
                                   ::google::protobuf::Closure* done)
 
+DEFINE_uint32(manusya_max_batch_items, 1024, "Max number of items in one batch request");
+
 namespace pain::manusya {
 
-ManusyaServiceImpl::ManusyaServiceImpl() {}
+namespace {
+struct BatchTask {
+    const std::function<void(size_t)>* fn = nullptr;
+    size_t index = 0;
+};
+
+void* run_batch_task(void* arg) {
+    auto* task = static_cast<BatchTask*>(arg);
+    (*task->fn)(task->index);
+    return nullptr;
+}
+
+// run fn for each item in parallel bthreads, the first item runs in the calling one
+void parallel_for(size_t n, const std::function<void(size_t)>& fn) {
+    std::vector<BatchTask> tasks(n);
+    std::vector<bthread_t> tids(n, 0);
+    std::vector<bool> started(n, false);
+    for (size_t i = 1; i < n; ++i) {
+        tasks[i].fn = &fn;
+        tasks[i].index = i;
+        started[i] = bthread_start_background(&tids[i], nullptr, run_batch_task, &tasks[i]) == 0;
+        if (!started[i]) {
+            fn(i);
+        }
+    }
+    if (n > 0) {
+        fn(0);
+    }
+    for (size_t i = 1; i < n; ++i) {
+        if (started[i]) {
+            bthread_join(tids[i], nullptr);
+        }
+    }
+}
+
+void set_status(const Status& status, pain::proto::Header* header) {
+    header->set_status(status.error_code());
+    header->set_message(status.error_str());
+}
+
+// an append forwarded to the next replica of the chain
+struct ForwardCall {
+    brpc::Controller cntl;
+    pain::proto::manusya::ForwardAppendChunkRequest request;
+    pain::proto::manusya::ForwardAppendChunkResponse response;
+    Status status;
+};
+
+// send the append to the first replica of the chain with the rest of it, without waiting
+std::unique_ptr<ForwardCall> forward(const pain::proto::manusya::AppendChunkRequest& request, const IOBuf& data) {
+    auto call = std::make_unique<ForwardCall>();
+    const auto& next = request.chain(0);
+    brpc::Channel* channel = nullptr;
+    call->status = PeerChannels::instance().get(next.address(), &channel);
+    if (!call->status.ok()) {
+        return call;
+    }
+    auto* append = call->request.mutable_append();
+    *append = request;
+    *append->mutable_chunk_id() = next.chunk_id();
+    append->mutable_chain()->DeleteSubrange(0, 1);
+    // the attachment shares blocks with the received data, forwarding copies nothing
+    call->cntl.request_attachment() = data;
+    inject_tracer(&call->cntl);
+    pain::proto::manusya::ManusyaService_Stub stub(channel);
+    stub.ForwardAppendChunk(&call->cntl, &call->request, &call->response, brpc::DoNothing());
+    return call;
+}
+
+// forward to the rest of the chain once the local append is accepted and append locally while
+// it runs, so a rejected append never reaches the replicas after this one, acks come back up
+// the chain with the responses, so a success means every replica after this one has the data too
+void append_chunk(const pain::proto::manusya::AppendChunkRequest& request,
+                  const IOBuf& data,
+                  pain::proto::manusya::AppendChunkResponse* response) {
+    ObjectId chunk_id = common::from_proto(request.chunk_id());
+    ChunkPtr chunk;
+    auto status = Bank::instance().get_chunk(chunk_id, &chunk);
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "chunk not found")("chunk", chunk_id.str()));
+        set_status(Status(ENOENT, "Chunk not found"), response->mutable_header());
+        return;
+    }
+
+    std::unique_ptr<ForwardCall> call;
+    AppendOptions options;
+    options.direct_io = request.direct_io();
+    if (request.has_crc32()) {
+        options.crc32 = request.crc32();
+    }
+    options.io_tag = request.io_tag();
+    if (request.chain_size() > 0) {
+        options.accepted = [&] { call = forward(request, data); };
+    }
+    status = chunk->append(data, request.offset(), options);
+
+    if (call != nullptr && call->status.ok()) {
+        brpc::Join(call->cntl.call_id());
+        if (call->cntl.Failed()) {
+            call->status = Status(call->cntl.ErrorCode(), call->cntl.ErrorText());
+        } else if (call->response.append().header().status() != 0) {
+            const auto& header = call->response.append().header();
+            call->status = Status(header.status(), header.message());
+        }
+    }
+
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to append chunk") //
+                   ("chunk", chunk_id.str())          //
+                   ("errno", status.error_code())     //
+                   ("error", status.error_str()));
+        set_status(status, response->mutable_header());
+        return;
+    }
+    // return new offset
+    response->set_offset(chunk->size());
+    if (call == nullptr) {
+        return;
+    }
+    if (!call->status.ok()) {
+        PLOG_ERROR(("desc", "failed to forward append") //
+                   ("chunk", chunk_id.str())            //
+                   ("next", request.chain(0).address()) //
+                   ("errno", call->status.error_code()) //
+                   ("error", call->status.error_str()));
+        set_status(call->status, response->mutable_header());
+        // a failed rpc is blamed on the next replica, otherwise the one it reports
+        auto failed = call->cntl.Failed() ? 0 : call->response.append().failed_replica();
+        response->set_failed_replica(1 + failed);
+        return;
+    }
+    response->set_offset(std::min(response->offset(), call->response.append().offset()));
+}
+} // namespace
+
+ManusyaServiceImpl::ManusyaServiceImpl(EcCluster* ec_cluster) : _ec_cluster(ec_cluster) {
+    if (_ec_cluster != nullptr) {
+        _ec_reader = std::make_unique<EcReader>(_ec_cluster);
+    }
+}
 
 MANUSYA_SERVICE_METHOD(CreateChunk) {
     DEFINE_SPAN(span, controller);
@@ -45,36 +201,38 @@ MANUSYA_SERVICE_METHOD(CreateChunk) {
 MANUSYA_SERVICE_METHOD(AppendChunk) {
     DEFINE_SPAN(span, controller);
     brpc::ClosureGuard done_guard(done);
+    auto start_us = butil::gettimeofday_us();
+    // the scrubber backs off while foreground io is slow
+    auto record_latency = pain::make_scope_exit([start_us]() {
+        foreground_io_latency() << butil::gettimeofday_us() - start_us;
+    });
     ObjectId chunk_id = common::from_proto(request->chunk_id());
     span->SetAttribute("chunk", chunk_id.str());
     PLOG_DEBUG(("desc", __func__)                                                //
                ("remote_side", butil::endpoint2str(cntl->remote_side()).c_str()) //
                ("chunk", chunk_id.str())                                         //
                ("offset", request->offset())                                     //
+               ("direct_io", request->direct_io())                               //
+               ("chain", request->chain_size())                                  //
                ("attached", cntl->request_attachment().size()));
 
-    ChunkPtr chunk;
-    auto status = Bank::instance().get_chunk(chunk_id, &chunk);
-    if (!status.ok()) {
-        PLOG_ERROR(("desc", "chunk not found")("chunk", chunk_id.str()));
-        response->mutable_header()->set_status(ENOENT);
-        response->mutable_header()->set_message("Chunk not found");
-        return;
-    }
+    append_chunk(*request, cntl->request_attachment(), response);
+}
 
-    status = chunk->append(cntl->request_attachment(), request->offset());
-    if (!status.ok()) {
-        PLOG_ERROR(("desc", "failed to append chunk") //
-                   ("chunk", chunk_id.str())          //
-                   ("errno", status.error_code())     //
-                   ("error", status.error_str()));
-        response->mutable_header()->set_status(status.error_code());
-        response->mutable_header()->set_message(status.error_str());
-        return;
-    }
+MANUSYA_SERVICE_METHOD(ForwardAppendChunk) {
+    DEFINE_SPAN(span, controller);
+    brpc::ClosureGuard done_guard(done);
+    const auto& append = request->append();
+    ObjectId chunk_id = common::from_proto(append.chunk_id());
+    span->SetAttribute("chunk", chunk_id.str());
+    PLOG_DEBUG(("desc", __func__)                                                //
+               ("remote_side", butil::endpoint2str(cntl->remote_side()).c_str()) //
+               ("chunk", chunk_id.str())                                         //
+               ("offset", append.offset())                                       //
+               ("chain", append.chain_size())                                    //
+               ("attached", cntl->request_attachment().size()));
 
-    // return new offset
-    response->set_offset(chunk->size());
+    append_chunk(append, cntl->request_attachment(), response->mutable_append());
 }
 
 MANUSYA_SERVICE_METHOD(ListChunk) {
@@ -97,6 +255,11 @@ MANUSYA_SERVICE_METHOD(ListChunk) {
 MANUSYA_SERVICE_METHOD(ReadChunk) {
     DEFINE_SPAN(span, controller);
     brpc::ClosureGuard done_guard(done);
+    auto start_us = butil::gettimeofday_us();
+    // the scrubber backs off while foreground io is slow
+    auto record_latency = pain::make_scope_exit([start_us]() {
+        foreground_io_latency() << butil::gettimeofday_us() - start_us;
+    });
     auto object_id = common::from_proto(request->chunk_id());
     span->SetAttribute("chunk", object_id.str());
 
@@ -108,6 +271,24 @@ MANUSYA_SERVICE_METHOD(ReadChunk) {
 
     ChunkPtr chunk;
     auto status = Bank::instance().get_chunk(object_id, &chunk);
+    proto::ChunkInfo layout;
+    // a chunk replaced by erasure coded fragments is read from them, fragments are not coded
+    // chunks themselves and missing ones stay not found
+    if (!status.ok() && _ec_cluster != nullptr && _ec_cluster->get_layout(object_id, &layout).ok() &&
+        common::from_proto(layout.chunk_id()) == object_id) {
+        auto& data = cntl->response_attachment();
+        status = _ec_reader->read(layout, request->offset(), request->length(), &data);
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to read coded chunk")("chunk", object_id.str())("error", status.error_str()));
+            data.clear();
+            set_status(status, response->mutable_header());
+            return;
+        }
+        response->set_offset(request->offset());
+        response->set_length(data.size());
+        response->set_crc32(common::crc32c(data));
+        return;
+    }
     if (!status.ok()) {
         PLOG_ERROR(("desc", "chunk not found")("chunk", object_id.str()));
         response->mutable_header()->set_status(ENOENT);
@@ -115,12 +296,19 @@ MANUSYA_SERVICE_METHOD(ReadChunk) {
         return;
     }
 
-    status = chunk->read(request->offset(), request->length(), &cntl->response_attachment());
+    uint32_t crc = 0;
+    {
+        auto slot = IoScheduler::instance().admit(request->io_tag(), request->length());
+        status = chunk->read(request->offset(), request->length(), &cntl->response_attachment(), &crc);
+    }
     if (!status.ok()) {
         PLOG_ERROR(("desc", "failed to read chunk")("chunk", object_id.str())("error", status.error_str()));
         cntl->SetFailed(status.error_code(), "%s", status.error_cstr());
         return;
     }
+    response->set_offset(request->offset());
+    response->set_length(cntl->response_attachment().size());
+    response->set_crc32(crc);
 }
 
 MANUSYA_SERVICE_METHOD(QueryAndSealChunk) {
@@ -193,6 +381,154 @@ MANUSYA_SERVICE_METHOD(QueryChunk) {
 
     response->set_size(chunk->size());
     response->set_sealed(chunk->state() == ChunkState::kSealed);
+    response->set_pending_bytes(chunk->pending_bytes());
+    response->set_pending_count(chunk->pending_count());
+}
+
+MANUSYA_SERVICE_METHOD(BatchAppendChunk) {
+    DEFINE_SPAN(span, controller);
+    brpc::ClosureGuard done_guard(done);
+
+    PLOG_DEBUG(("desc", __func__)                                                //
+               ("remote_side", butil::endpoint2str(cntl->remote_side()).c_str()) //
+               ("items", request->items_size())                                  //
+               ("attached", cntl->request_attachment().size()));
+
+    auto n = static_cast<size_t>(request->items_size());
+    if (n > FLAGS_manusya_max_batch_items) {
+        set_status(Status(EINVAL, "too many items"), response->mutable_header());
+        return;
+    }
+    uint64_t total = 0;
+    for (const auto& item : request->items()) {
+        total += item.length();
+    }
+    auto& attachment = cntl->request_attachment();
+    if (total != attachment.size()) {
+        set_status(Status(EINVAL, "attachment size mismatch"), response->mutable_header());
+        return;
+    }
+
+    // data of items are packed in order
+    std::vector<IOBuf> data(n);
+    for (size_t i = 0; i < n; ++i) {
+        attachment.cutn(&data[i], request->items(static_cast<int>(i)).length());
+        response->add_items();
+    }
+
+    parallel_for(n, [&](size_t i) {
+        append_chunk(request->items(static_cast<int>(i)), data[i], response->mutable_items(static_cast<int>(i)));
+    });
+}
+
+MANUSYA_SERVICE_METHOD(BatchReadChunk) {
+    DEFINE_SPAN(span, controller);
+    brpc::ClosureGuard done_guard(done);
+
+    PLOG_DEBUG(("desc", __func__)                                                //
+               ("remote_side", butil::endpoint2str(cntl->remote_side()).c_str()) //
+               ("items", request->items_size()));
+
+    auto n = static_cast<size_t>(request->items_size());
+    if (n > FLAGS_manusya_max_batch_items) {
+        set_status(Status(EINVAL, "too many items"), response->mutable_header());
+        return;
+    }
+    std::vector<IOBuf> data(n);
+    for (size_t i = 0; i < n; ++i) {
+        response->add_items();
+    }
+
+    parallel_for(n, [&](size_t i) {
+        const auto& item = request->items(static_cast<int>(i));
+        auto* result = response->mutable_items(static_cast<int>(i));
+        auto object_id = common::from_proto(item.chunk_id());
+        result->set_offset(item.offset());
+        ChunkPtr chunk;
+        auto status = Bank::instance().get_chunk(object_id, &chunk);
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "chunk not found")("chunk", object_id.str()));
+            set_status(Status(ENOENT, "Chunk not found"), result->mutable_header());
+            return;
+        }
+        uint32_t crc = 0;
+        {
+            auto slot = IoScheduler::instance().admit(item.io_tag(), item.length());
+            status = chunk->read(item.offset(), item.length(), &data[i], &crc);
+        }
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to read chunk")("chunk", object_id.str())("error", status.error_str()));
+            data[i].clear();
+            set_status(status, result->mutable_header());
+            return;
+        }
+        result->set_crc32(crc);
+    });
+
+    // data of items are packed in order
+    for (size_t i = 0; i < n; ++i) {
+        response->mutable_items(static_cast<int>(i))->set_length(data[i].size());
+        cntl->response_attachment().append(std::move(data[i]));
+    }
+}
+
+MANUSYA_SERVICE_METHOD(OpenChunkStream) {
+    DEFINE_SPAN(span, controller);
+    brpc::ClosureGuard done_guard(done);
+    ObjectId chunk_id = common::from_proto(request->chunk_id());
+    span->SetAttribute("chunk", chunk_id.str());
+    PLOG_DEBUG(("desc", __func__)                                                //
+               ("remote_side", butil::endpoint2str(cntl->remote_side()).c_str()) //
+               ("chunk", chunk_id.str())                                         //
+               ("offset", request->offset())                                     //
+               ("direct_io", request->direct_io()));
+
+    ChunkPtr chunk;
+    auto status = Bank::instance().get_chunk(chunk_id, &chunk);
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "chunk not found")("chunk", chunk_id.str()));
+        set_status(Status(ENOENT, "Chunk not found"), response->mutable_header());
+        return;
+    }
+
+    status = ChunkStream::accept(cntl, chunk, request->offset(), request->direct_io());
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to accept chunk stream")("chunk", chunk_id.str()));
+        set_status(status, response->mutable_header());
+        return;
+    }
+    response->set_offset(chunk->size());
+}
+
+MANUSYA_SERVICE_METHOD(OpenChunkReadStream) {
+    DEFINE_SPAN(span, controller);
+    brpc::ClosureGuard done_guard(done);
+    ObjectId chunk_id = common::from_proto(request->chunk_id());
+    span->SetAttribute("chunk", chunk_id.str());
+    PLOG_DEBUG(("desc", __func__)                                                //
+               ("remote_side", butil::endpoint2str(cntl->remote_side()).c_str()) //
+               ("chunk", chunk_id.str())                                         //
+               ("offset", request->offset())                                     //
+               ("length", request->length())                                     //
+               ("segment_size", request->segment_size())                         //
+               ("credits", request->credits()));
+
+    ChunkPtr chunk;
+    auto status = Bank::instance().get_chunk(chunk_id, &chunk);
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "chunk not found")("chunk", chunk_id.str()));
+        set_status(Status(ENOENT, "Chunk not found"), response->mutable_header());
+        return;
+    }
+
+    response->set_size(chunk->size());
+    status = ChunkReadStream::accept(
+        cntl, chunk, request->offset(), request->length(), request->segment_size(), request->credits());
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to accept chunk read stream")("chunk", chunk_id.str()));
+        set_status(status, response->mutable_header());
+        return;
+    }
 }
 
 } // namespace pain::manusya
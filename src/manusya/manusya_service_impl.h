@@ -1,6 +1,9 @@
 #pragma once
 
+#include <memory>
 #include "pain/proto/manusya.pb.h"
+#include "manusya/ec_cluster.h"
+#include "manusya/ec_reader.h"
 
 #define MANUSYA_SERVICE_METHOD(name)                                                                                   \
     void name(::google::protobuf::RpcController* controller,                                                           \
@@ -11,15 +14,26 @@
 namespace pain::manusya {
 class ManusyaServiceImpl : public pain::proto::manusya::ManusyaService {
 public:
-    ManusyaServiceImpl();
+    // reads of chunks replaced by erasure coded fragments are served from the fragments of
+    // ec_cluster, they fail as not found without it
+    explicit ManusyaServiceImpl(EcCluster* ec_cluster = nullptr);
     ~ManusyaServiceImpl() override = default;
     MANUSYA_SERVICE_METHOD(CreateChunk);
     MANUSYA_SERVICE_METHOD(AppendChunk);
+    MANUSYA_SERVICE_METHOD(ForwardAppendChunk);
     MANUSYA_SERVICE_METHOD(ListChunk);
     MANUSYA_SERVICE_METHOD(ReadChunk);
     MANUSYA_SERVICE_METHOD(QueryChunk);
     MANUSYA_SERVICE_METHOD(QueryAndSealChunk);
     MANUSYA_SERVICE_METHOD(RemoveChunk);
+    MANUSYA_SERVICE_METHOD(BatchAppendChunk);
+    MANUSYA_SERVICE_METHOD(BatchReadChunk);
+    MANUSYA_SERVICE_METHOD(OpenChunkStream);
+    MANUSYA_SERVICE_METHOD(OpenChunkReadStream);
+
+private:
+    EcCluster* _ec_cluster;
+    std::unique_ptr<EcReader> _ec_reader;
 };
 
 } // namespace pain::manusya
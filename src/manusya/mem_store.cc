@@ -1,13 +1,73 @@
 #include "manusya/mem_store.h"
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include "manusya/file_handle.h"
 #include "manusya/macro.h"
 
 namespace pain::manusya {
 
+void BlockBuffer::append(IOBuf* buf) {
+    while (!buf->empty()) {
+        if (_blocks.empty() || _blocks.back().size() == kBlockSize) {
+            _blocks.emplace_back();
+        }
+        auto& block = _blocks.back();
+        auto n = std::min<uint64_t>(kBlockSize - block.size(), buf->size());
+        buf->cutn(&block, n);
+        _size += n;
+    }
+}
+
+void BlockBuffer::write(uint64_t offset, IOBuf buf) {
+    if (offset > _size) {
+        IOBuf zeros;
+        zeros.resize(offset - _size);
+        append(&zeros);
+    }
+    // overwrite the covered part block by block, keeping the bytes around it
+    while (offset < _size && !buf.empty()) {
+        auto& block = _blocks[offset / kBlockSize];
+        auto pos = offset % kBlockSize;
+        auto n = std::min<uint64_t>(block.size() - pos, buf.size());
+        IOBuf result;
+        block.append_to(&result, pos);
+        buf.cutn(&result, n);
+        if (pos + n < block.size()) {
+            block.append_to(&result, block.size() - pos - n, pos + n);
+        }
+        block.swap(result);
+        offset += n;
+    }
+    append(&buf);
+}
+
+void BlockBuffer::read(uint64_t offset, uint64_t size, IOBuf* buf) const {
+    auto end = std::min(offset + size, _size);
+    while (offset < end) {
+        const auto& block = _blocks[offset / kBlockSize];
+        auto pos = offset % kBlockSize;
+        auto n = std::min<uint64_t>(block.size() - pos, end - offset);
+        block.append_to(buf, n, pos);
+        offset += n;
+    }
+}
+
+void BlockBuffer::clear() {
+    _blocks.clear();
+    _size = 0;
+}
+
+struct MemFile {
+    BlockBuffer data;
+    std::map<std::string, std::string> attrs;
+    mutable bthread::Mutex mutex;
+};
+
 class MemFileHandle : public FileHandle {
 public:
-    MemFileHandle(const char* path, StorePtr store) : FileHandle(store), _path(path){};
+    MemFileHandle(const char* path, MemFilePtr file, StorePtr store) :
+        FileHandle(store), _path(path), _file(std::move(file)){};
 
     ~MemFileHandle() override = default;
 
@@ -15,8 +75,14 @@ public:
         return _path;
     }
 
+    MemFile* file() const {
+        return _file.get();
+    }
+
 private:
     std::string _path;
+    // removed files stay valid for handles opened before, with their data dropped
+    MemFilePtr _file;
 };
 
 Future<Status> MemStore::open(const char* path, int flags, FileHandlePtr* fh) {
@@ -27,21 +93,29 @@ Future<Status> MemStore::open(const char* path, int flags, FileHandlePtr* fh) {
     if (fh == nullptr) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
-    if (_files.find(path) != _files.end()) {
-        if ((flags & O_EXCL) != 0) {
-            return make_ready_future(Status(EEXIST, "file already exists"));
-        }
-        if ((flags & O_TRUNC) != 0) {
-            _files[path].clear();
-        }
-    } else {
-        if ((flags & O_CREAT) != 0) {
-            _files[path] = IOBuf();
+    auto& s = shard(path);
+    MemFilePtr file;
+    {
+        std::lock_guard lock(s.mutex);
+        auto it = s.files.find(path);
+        if (it != s.files.end()) {
+            if ((flags & O_EXCL) != 0) {
+                return make_ready_future(Status(EEXIST, "file already exists"));
+            }
+            file = it->second;
         } else {
-            return make_ready_future(Status(ENOENT, "file not found"));
+            if ((flags & O_CREAT) == 0) {
+                return make_ready_future(Status(ENOENT, "file not found"));
+            }
+            file = std::make_shared<MemFile>();
+            s.files.emplace(path, file);
         }
     }
-    *fh = FileHandlePtr(new MemFileHandle(path, this));
+    if ((flags & O_TRUNC) != 0) {
+        std::lock_guard lock(file->mutex);
+        file->data.clear();
+    }
+    *fh = FileHandlePtr(new MemFileHandle(path, file, this));
     return make_ready_future(Status::OK());
 }
 
@@ -50,11 +124,10 @@ Future<Status> MemStore::append(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
     if (fh == nullptr) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
-    std::unique_lock lock(_mutex);
-    auto& path = fh->as<MemFileHandle>()->handle();
-    auto& iobuf = _files[path];
-
-    iobuf.append(buf);
+    auto* file = fh->as<MemFileHandle>()->file();
+    // appends may be issued out of order, write at offset like pwrite and fill the gap with zeros
+    std::lock_guard lock(file->mutex);
+    file->data.write(offset, std::move(buf));
     return make_ready_future(Status::OK());
 }
 
@@ -63,10 +136,9 @@ Future<Status> MemStore::read(FileHandlePtr fh, uint64_t offset, uint64_t size,
     if (fh == nullptr) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
-    std::unique_lock lock(_mutex);
-    auto path = fh->as<MemFileHandle>()->handle();
-    auto& iobuf = _files[path];
-    iobuf.append_to(buf, size, offset);
+    auto* file = fh->as<MemFileHandle>()->file();
+    std::lock_guard lock(file->mutex);
+    file->data.read(offset, size, buf);
     return make_ready_future(Status::OK());
 }
 
@@ -80,10 +152,9 @@ Future<Status> MemStore::size(FileHandlePtr fh, uint64_t* size) {
     if (fh == nullptr) {
         return make_ready_future(Status(EINVAL, "fh is nullptr"));
     }
-    std::unique_lock lock(_mutex);
-    auto path = fh->as<MemFileHandle>()->handle();
-    auto& iobuf = _files[path];
-    *size = iobuf.size();
+    auto* file = fh->as<MemFileHandle>()->file();
+    std::lock_guard lock(file->mutex);
+    *size = file->data.size();
     return make_ready_future(Status::OK());
 }
 
@@ -92,8 +163,21 @@ Future<Status> MemStore::remove(const char* path) {
     if (path == nullptr) {
         return make_ready_future(Status(EINVAL, "path is nullptr"));
     }
-    std::unique_lock lock(_mutex);
-    _files.erase(path);
+    auto& s = shard(path);
+    MemFilePtr file;
+    {
+        std::lock_guard lock(s.mutex);
+        auto it = s.files.find(path);
+        if (it == s.files.end()) {
+            return make_ready_future(Status::OK());
+        }
+        file = std::move(it->second);
+        s.files.erase(it);
+    }
+    // free the memory now, open handles see an empty file
+    std::lock_guard lock(file->mutex);
+    file->data.clear();
+    file->attrs.clear();
     return make_ready_future(Status::OK());
 }
 
@@ -108,9 +192,9 @@ Future<Status> MemStore::set_attr(FileHandlePtr fh, const char* key, const char*
     if (value == nullptr) {
         return make_ready_future(Status(EINVAL, "value is nullptr"));
     }
-    std::unique_lock lock(_mutex);
-    auto path = fh->as<MemFileHandle>()->handle();
-    _attrs[path][key] = value;
+    auto* file = fh->as<MemFileHandle>()->file();
+    std::lock_guard lock(file->mutex);
+    file->attrs[key] = value;
     return make_ready_future(Status::OK());
 }
 
@@ -125,10 +209,10 @@ Future<Status> MemStore::get_attr(FileHandlePtr fh, const char* key, std::string
     if (value == nullptr) {
         return make_ready_future(Status(EINVAL, "value is nullptr"));
     }
-    std::unique_lock lock(_mutex);
-    auto path = fh->as<MemFileHandle>()->handle();
-    auto it = _attrs[path].find(key);
-    if (it == _attrs[path].end()) {
+    auto* file = fh->as<MemFileHandle>()->file();
+    std::lock_guard lock(file->mutex);
+    auto it = file->attrs.find(key);
+    if (it == file->attrs.end()) {
         return make_ready_future(Status(ENOENT, "attribute not found"));
     }
     *value = it->second;
@@ -143,16 +227,23 @@ Future<Status> MemStore::list_attrs(FileHandlePtr fh, std::map<std::string, std:
     if (attrs == nullptr) {
         return make_ready_future(Status(EINVAL, "attrs is nullptr"));
     }
-    std::unique_lock lock(_mutex);
-    auto path = fh->as<MemFileHandle>()->handle();
-    *attrs = _attrs[path];
+    auto* file = fh->as<MemFileHandle>()->file();
+    std::lock_guard lock(file->mutex);
+    *attrs = file->attrs;
     return make_ready_future(Status::OK());
 }
 
 void MemStore::for_each(std::function<void(const char* path)> cb) {
     SPAN(span);
-    std::unique_lock lock(_mutex);
-    for (const auto& [path, _] : _files) {
+    // iterate a snapshot, cb may call back into the store
+    std::vector<std::string> paths;
+    for (auto& s : _shards) {
+        std::lock_guard lock(s.mutex);
+        for (const auto& [path, _] : s.files) {
+            paths.push_back(path);
+        }
+    }
+    for (const auto& path : paths) {
         cb(path.c_str());
     }
 }
@@ -1,10 +1,47 @@
 #pragma once
 
 #include <bthread/mutex.h>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "manusya/store.h"
 
 namespace pain::manusya {
 
+// BlockBuffer keeps data in blocks of kBlockSize bytes, all full but the last one, so the
+// block of an offset is found by division and a read walks only the blocks it covers
+// instead of the whole IOBuf.
+class BlockBuffer {
+public:
+    static constexpr uint64_t kBlockSize = 64 * 1024;
+
+    uint64_t size() const {
+        return _size;
+    }
+
+    // write at offset like pwrite, a gap beyond the end is filled with zeros
+    void write(uint64_t offset, IOBuf buf);
+    // append at most size bytes from offset to buf, less if it reaches the end
+    void read(uint64_t offset, uint64_t size, IOBuf* buf) const;
+    void clear();
+
+private:
+    void append(IOBuf* buf);
+
+    std::vector<IOBuf> _blocks;
+    uint64_t _size = 0;
+};
+
+struct MemFile;
+using MemFilePtr = std::shared_ptr<MemFile>;
+
+// MemStore keeps files in memory. Files are indexed by path in shards, handles refer to the
+// file directly and each file has its own lock, so operations on different files never
+// contend and operations on one file don't look up the path again.
 class MemStore : public Store {
 public:
     MemStore() = default;
@@ -23,10 +60,18 @@ protected:
     void for_each(std::function<void(const char* path)> cb) override;
 
 private:
-    std::map<std::string, IOBuf> _files;
-    std::map<std::string, std::map<std::string, std::string>> _attrs;
-    mutable bthread::Mutex _mutex;
-
     friend class FileHandle;
+
+    static constexpr size_t kShardCount = 64;
+    struct Shard {
+        std::unordered_map<std::string, MemFilePtr> files;
+        mutable bthread::Mutex mutex;
+    };
+
+    Shard& shard(const std::string& path) {
+        return _shards[std::hash<std::string>{}(path) % kShardCount];
+    }
+
+    std::array<Shard, kShardCount> _shards;
 };
 } // namespace pain::manusya
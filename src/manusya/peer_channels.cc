@@ -0,0 +1,41 @@
+#include "manusya/peer_channels.h"
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <cerrno>
+#include <mutex>
+
+DEFINE_int32(manusya_peer_timeout_ms, 10000, "Timeout of rpcs to other manusya");
+DEFINE_int32(manusya_peer_connect_timeout_ms, 2000, "Connect timeout of rpcs to other manusya");
+
+namespace pain::manusya {
+
+PeerChannels& PeerChannels::instance() {
+    static PeerChannels s_peer_channels;
+    return s_peer_channels;
+}
+
+Status PeerChannels::get(const std::string& address, brpc::Channel** channel) {
+    if (channel == nullptr) {
+        return Status(EINVAL, "channel is nullptr");
+    }
+    std::lock_guard lock(_mutex);
+    auto it = _channels.find(address);
+    if (it != _channels.end()) {
+        *channel = it->second.get();
+        return Status::OK();
+    }
+    brpc::ChannelOptions options;
+    options.connect_timeout_ms = FLAGS_manusya_peer_connect_timeout_ms;
+    options.timeout_ms = FLAGS_manusya_peer_timeout_ms;
+    options.max_retry = 0;
+    auto peer = std::make_unique<brpc::Channel>();
+    if (peer->Init(address.c_str(), &options) != 0) {
+        PLOG_ERROR(("desc", "failed to init channel to peer")("address", address));
+        return Status(EHOSTUNREACH, "failed to init channel to " + address);
+    }
+    *channel = peer.get();
+    _channels.emplace(address, std::move(peer));
+    return Status::OK();
+}
+
+} // namespace pain::manusya
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <brpc/channel.h>
+#include <bthread/mutex.h>
+#include <pain/base/types.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace pain::manusya {
+
+// PeerChannels keeps one channel for each manusya this one talks to, such as the next replica
+// of a replication chain. Channels are created on first use and kept for the process, brpc
+// shares one connection among the calls of a channel.
+class PeerChannels {
+public:
+    PeerChannels() = default;
+    ~PeerChannels() = default;
+    PeerChannels(const PeerChannels&) = delete;
+    PeerChannels& operator=(const PeerChannels&) = delete;
+
+    static PeerChannels& instance();
+
+    Status get(const std::string& address, brpc::Channel** channel);
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<brpc::Channel>> _channels;
+    bthread::Mutex _mutex;
+};
+
+} // namespace pain::manusya
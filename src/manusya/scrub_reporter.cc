@@ -0,0 +1,38 @@
+#include "manusya/scrub_reporter.h"
+#include <braft/route_table.h>
+#include <pain/base/plog.h>
+#include "pain/proto/deva.pb.h"
+#include "common/object_id_util.h"
+#include "deva/sdk/rpc_client.h"
+
+namespace pain::manusya {
+
+namespace {
+constexpr const char* kDevaGroup = "default";
+} // namespace
+
+DevaScrubReporter::DevaScrubReporter(std::string address, const std::string& deva_conf) :
+    _address(std::move(address)) {
+    PLOG_INFO(("desc", "update deva configuration")("deva_conf", deva_conf));
+    braft::rtb::update_configuration(kDevaGroup, deva_conf);
+}
+
+Status DevaScrubReporter::report(const ObjectId& chunk_id, const Status& error) {
+    pain::proto::deva::ReportBadChunkRequest request;
+    pain::proto::deva::ReportBadChunkResponse response;
+    auto* bad_chunk = request.mutable_bad_chunk();
+    common::to_proto(chunk_id, bad_chunk->mutable_chunk_id());
+    bad_chunk->set_manusya(_address);
+    bad_chunk->set_reason(error.error_str());
+    auto status =
+        deva::call_rpc(kDevaGroup, &pain::proto::deva::DevaService::Stub::ReportBadChunk, &request, &response);
+    if (!status.ok()) {
+        return Status(status.error_code(), status.error_str());
+    }
+    if (response.header().status() != 0) {
+        return Status(response.header().status(), response.header().message());
+    }
+    return Status::OK();
+}
+
+} // namespace pain::manusya
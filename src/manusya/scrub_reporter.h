@@ -0,0 +1,32 @@
+#pragma once
+
+#include <pain/base/object_id.h>
+#include <pain/base/types.h>
+#include <string>
+
+namespace pain::manusya {
+
+// ScrubReporter hands corrupted replicas found by the scrubber over for repair.
+class ScrubReporter {
+public:
+    virtual ~ScrubReporter() = default;
+
+    // error is what verifying the replica of chunk_id on this manusya failed with
+    virtual Status report(const ObjectId& chunk_id, const Status& error) = 0;
+};
+
+// DevaScrubReporter records the replicas in deva with ReportBadChunk.
+class DevaScrubReporter : public ScrubReporter {
+public:
+    // address is the listen address of this manusya, deva_conf the configuration of the deva
+    // group, e.g. 127.0.0.1:8201:0,127.0.0.1:8202:0
+    DevaScrubReporter(std::string address, const std::string& deva_conf);
+    ~DevaScrubReporter() override = default;
+
+    Status report(const ObjectId& chunk_id, const Status& error) override;
+
+private:
+    std::string _address;
+};
+
+} // namespace pain::manusya
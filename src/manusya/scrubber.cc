@@ -0,0 +1,190 @@
+#include "manusya/scrubber.h"
+#include <butil/time.h>
+#include <bvar/bvar.h>
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include "manusya/io_scheduler.h"
+
+DEFINE_uint64(manusya_scrub_bytes_per_second,
+              32 * 1024 * 1024,
+              "Bytes per second read by the scrubber, 0 is unlimited");
+DEFINE_uint32(manusya_scrub_interval_s, 24 * 3600, "Interval between passes of the scrubber over the bank");
+DEFINE_int64(manusya_scrub_latency_threshold_us,
+             20000,
+             "The scrubber slows down while foreground reads and appends take longer than this on average");
+
+namespace pain::manusya {
+
+namespace {
+// bytes verified by one read, also the burst of the token bucket so reads are evenly paced
+constexpr uint64_t kScrubReadSize = 1024 * 1024;
+// the rate is cut down to max / kMinRateDivisor at most, and grows back by max / kRateStepDivisor
+constexpr uint64_t kMinRateDivisor = 64;
+constexpr uint64_t kRateStepDivisor = 16;
+
+bvar::Adder<uint64_t> g_scrub_scanned_bytes("manusya_scrub_scanned_bytes");
+bvar::PerSecond<bvar::Adder<uint64_t>> g_scrub_throughput("manusya_scrub_throughput", &g_scrub_scanned_bytes);
+bvar::Adder<uint64_t> g_scrub_scanned_count("manusya_scrub_scanned_count");
+bvar::Adder<uint64_t> g_scrub_corrupted_count("manusya_scrub_corrupted_count");
+bvar::Adder<uint64_t> g_scrub_pass_count("manusya_scrub_pass_count");
+} // namespace
+
+bvar::LatencyRecorder& foreground_io_latency() {
+    static bvar::LatencyRecorder latency("manusya_foreground_io");
+    return latency;
+}
+
+Scrubber::Scrubber(Bank* bank, ScrubReporter* reporter, LatencySource latency) :
+    _bank(bank),
+    _reporter(reporter),
+    _latency(std::move(latency)),
+    _bucket(FLAGS_manusya_scrub_bytes_per_second, kScrubReadSize),
+    _loop(
+        "scrubber",
+        [this]() {
+            run_once();
+        },
+        []() {
+            return static_cast<uint64_t>(FLAGS_manusya_scrub_interval_s) * 1000 * 1000;
+        }) {
+    if (_latency == nullptr) {
+        _latency = []() {
+            return foreground_io_latency().latency(1);
+        };
+    }
+    _progress.rate = FLAGS_manusya_scrub_bytes_per_second;
+}
+
+Scrubber::~Scrubber() {
+    stop();
+}
+
+Status Scrubber::start() {
+    return _loop.start();
+}
+
+void Scrubber::stop() {
+    _loop.stop();
+}
+
+uint32_t Scrubber::run_once() {
+    {
+        std::lock_guard lock(_mutex);
+        _progress.scanned_chunks = 0;
+        _progress.scanned_bytes = 0;
+        _progress.position = ObjectId();
+    }
+    uint32_t corrupted = 0;
+    _bank->for_each_chunk([&](const ObjectId& chunk_id) {
+        ChunkPtr chunk;
+        // open chunks are still written, their checksums are verified once they are sealed
+        if (!_bank->get_chunk(chunk_id, &chunk).ok() || chunk->state() != ChunkState::kSealed) {
+            return true;
+        }
+        auto status = scrub(chunk);
+        if (_loop.stopped()) {
+            return false;
+        }
+        {
+            std::lock_guard lock(_mutex);
+            _progress.position = chunk_id;
+        }
+        // a chunk removed while it was read is gone, not corrupted
+        if (status.error_code() != EIO || !_bank->get_chunk(chunk_id, &chunk).ok()) {
+            return true;
+        }
+        corrupted++;
+        g_scrub_corrupted_count << 1;
+        {
+            std::lock_guard lock(_mutex);
+            _progress.corrupted_chunks++;
+        }
+        PLOG_ERROR(("desc", "corrupted chunk found by scrubber") //
+                   ("chunk", chunk_id.str())                     //
+                   ("error", status.error_str()));
+        status = _reporter->report(chunk_id, status);
+        if (!status.ok()) {
+            PLOG_WARN(("desc", "failed to report corrupted chunk") //
+                      ("chunk", chunk_id.str())                    //
+                      ("errno", status.error_code())               //
+                      ("error", status.error_str()));
+        }
+        return true;
+    });
+    if (_loop.stopped()) {
+        return corrupted;
+    }
+    g_scrub_pass_count << 1;
+    std::lock_guard lock(_mutex);
+    _progress.passes++;
+    return corrupted;
+}
+
+Status Scrubber::scrub(const ChunkPtr& chunk) {
+    auto size = chunk->size();
+    ReadOptions options;
+    options.background = true;
+    proto::IoTag tag;
+    tag.set_io_class(proto::IoClass::IO_CLASS_BACKGROUND);
+    for (uint64_t offset = 0; offset < size; offset += kScrubReadSize) {
+        auto n = std::min(kScrubReadSize, size - offset);
+        if (!throttle(n)) {
+            return Status(ECANCELED, "scrubber is stopped");
+        }
+        IOBuf buf;
+        Status status;
+        {
+            auto slot = IoScheduler::instance().admit(tag, n);
+            status = chunk->read(offset, n, &buf, nullptr, options);
+        }
+        if (!status.ok()) {
+            return status;
+        }
+        g_scrub_scanned_bytes << n;
+        std::lock_guard lock(_mutex);
+        _progress.scanned_bytes += n;
+    }
+    g_scrub_scanned_count << 1;
+    std::lock_guard lock(_mutex);
+    _progress.scanned_chunks++;
+    return Status::OK();
+}
+
+ScrubProgress Scrubber::progress() const {
+    std::lock_guard lock(_mutex);
+    return _progress;
+}
+
+bool Scrubber::throttle(uint64_t bytes) {
+    adjust_rate();
+    auto now = butil::gettimeofday_us();
+    return _loop.wait_for(static_cast<uint64_t>(_bucket.take(bytes, now)));
+}
+
+void Scrubber::adjust_rate() {
+    auto max_rate = FLAGS_manusya_scrub_bytes_per_second;
+    auto slow = _latency() > FLAGS_manusya_scrub_latency_threshold_us;
+    uint64_t rate = 0;
+    {
+        std::lock_guard lock(_mutex);
+        rate = _progress.rate;
+        if (max_rate == 0) {
+            rate = 0;
+        } else if (slow) {
+            rate = std::max(std::max<uint64_t>(1, max_rate / kMinRateDivisor), rate / 2);
+        } else {
+            // grows back from unlimited or a lowered flag as well
+            rate = rate == 0 ? max_rate : std::min(max_rate, rate + std::max<uint64_t>(1, max_rate / kRateStepDivisor));
+        }
+        if (rate == _progress.rate) {
+            return;
+        }
+        _progress.rate = rate;
+    }
+    _bucket.reset(rate, kScrubReadSize);
+}
+
+} // namespace pain::manusya
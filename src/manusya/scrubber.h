@@ -0,0 +1,77 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <bvar/bvar.h>
+#include <pain/base/object_id.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <functional>
+#include "common/token_bucket.h"
+#include "manusya/background_loop.h"
+#include "manusya/bank.h"
+#include "manusya/scrub_reporter.h"
+
+namespace pain::manusya {
+
+// latency of foreground ReadChunk and AppendChunk, the scrubber backs off while it is high
+bvar::LatencyRecorder& foreground_io_latency();
+
+struct ScrubProgress {
+    // passes over the whole bank finished
+    uint64_t passes = 0;
+    // chunks and bytes verified by the current pass so far
+    uint64_t scanned_chunks = 0;
+    uint64_t scanned_bytes = 0;
+    // corrupted replicas found by all the passes
+    uint64_t corrupted_chunks = 0;
+    // the current pass goes on after this chunk in id order
+    ObjectId position;
+    // bytes per second the scrubber may read now
+    uint64_t rate = 0;
+};
+
+// Scrubber reads back the sealed chunks of a bank in the background and verifies them against
+// their stored checksums, so latent corruption is found before a client reads it or the last
+// good replica is lost. Corrupted replicas are handed to a ScrubReporter for repair.
+//
+// Reads are paced by a token bucket of manusya_scrub_bytes_per_second. While the foreground
+// latency is above manusya_scrub_latency_threshold_us the rate is halved on every read down to
+// 1/64 of it, and it grows back by 1/16 per read once the latency recovers.
+class Scrubber {
+public:
+    // foreground latency in microseconds, the average of foreground_io_latency() by default
+    using LatencySource = std::function<int64_t()>;
+
+    Scrubber(Bank* bank, ScrubReporter* reporter, LatencySource latency = nullptr);
+    ~Scrubber();
+    Scrubber(const Scrubber&) = delete;
+    Scrubber& operator=(const Scrubber&) = delete;
+
+    // scrub the bank every manusya_scrub_interval_s until stopped
+    Status start();
+    void stop();
+
+    // verify every sealed chunk of the bank once, returns the number found corrupted
+    uint32_t run_once();
+
+    // read back every byte of a sealed chunk, EIO if a checksum mismatches
+    Status scrub(const ChunkPtr& chunk);
+
+    ScrubProgress progress() const;
+
+private:
+    // wait until bytes may be read, false if stopped meanwhile
+    bool throttle(uint64_t bytes);
+    void adjust_rate();
+
+    Bank* _bank;
+    ScrubReporter* _reporter;
+    LatencySource _latency;
+    common::TokenBucket _bucket;
+    // guards _progress
+    mutable bthread::Mutex _mutex;
+    ScrubProgress _progress;
+    BackgroundLoop _loop;
+};
+
+} // namespace pain::manusya
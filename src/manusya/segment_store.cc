@@ -0,0 +1,1148 @@
+#include "manusya/segment_store.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <pain/base/future.h>
+#include <pain/base/plog.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <boost/assert.hpp>
+#include "butil/iobuf.h"
+#include "common/crc32c.h"
+#include "manusya/file_handle.h"
+
+DECLARE_uint64(manusya_group_commit_window_us);
+DECLARE_uint64(manusya_group_commit_bytes);
+DEFINE_uint64(manusya_segment_compact_interval_ms, 10000, "Interval between compaction passes of the segment store");
+DEFINE_double(manusya_segment_compact_ratio,
+              0.5,
+              "Segments whose live bytes are below this ratio of their size are compacted");
+
+namespace pain::manusya {
+
+struct Segment {
+    Segment(uint32_t id, int fd, std::string path) : id(id), fd(fd), path(std::move(path)) {}
+    ~Segment() {
+        close(fd);
+    }
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    uint32_t id;
+    int fd;
+    std::string path;
+    // end of the records reserved so far
+    uint64_t write_offset = 0;
+    // bytes of data referenced by the index
+    uint64_t live_bytes = 0;
+    // ids of files having records in the segment
+    std::set<uint64_t> files;
+    // records reserved but not yet written and indexed, compaction skips the segment until
+    // they are, or it would miss them and delete the segment under them
+    uint64_t inflight = 0;
+};
+
+namespace {
+constexpr uint32_t kRecordMagic = 0x5347454d;
+constexpr const char* kSegmentPrefix = "segment.";
+constexpr uint64_t kScanWindow = 1024 * 1024;
+
+enum RecordType : uint8_t {
+    kCreate = 1,
+    kData = 2,
+    kSeal = 3,
+    kAttr = 4,
+    kRemove = 5,
+};
+
+// on disk header of every record, followed by key_len bytes of key and data_len bytes of
+// data. crc covers the header after itself, the key and the data of non data records, the
+// data of data records is covered by data_crc so that the header is checked without reading it
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint64_t sequence;
+    uint64_t file_id;
+    // offset in file of data records, size of the file of seal records
+    uint64_t offset;
+    uint32_t key_len;
+    uint32_t data_len;
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t data_crc;
+};
+static_assert(sizeof(RecordHeader) == 48);
+
+constexpr uint64_t kHeaderSize = sizeof(RecordHeader);
+constexpr size_t kCrcOffset = offsetof(RecordHeader, sequence);
+
+uint32_t record_crc(const RecordHeader& header, std::string_view key, std::string_view value) {
+    const auto* begin = reinterpret_cast<const char*>(&header) + kCrcOffset;
+    auto crc = common::crc32c(0, begin, kHeaderSize - kCrcOffset);
+    crc = common::crc32c(crc, key.data(), key.size());
+    return common::crc32c(crc, value.data(), value.size());
+}
+
+std::string segment_name(uint32_t id) {
+    return std::format("{}{:08}", kSegmentPrefix, id);
+}
+
+bool parse_segment_name(const char* name, uint32_t* id) {
+    constexpr int base = 10;
+    if (strncmp(name, kSegmentPrefix, strlen(kSegmentPrefix)) != 0) {
+        return false;
+    }
+    const char* digits = name + strlen(kSegmentPrefix);
+    char* end = nullptr;
+    auto value = strtoul(digits, &end, base);
+    if (end == digits || *end != '\0') {
+        return false;
+    }
+    *id = static_cast<uint32_t>(value);
+    return true;
+}
+
+Status pread_into(int fd, uint64_t offset, uint64_t size, IOBuf* buf) {
+    butil::IOPortal iop;
+    while (iop.size() < size) {
+        auto nr = iop.pappend_from_file_descriptor(fd, static_cast<off_t>(offset + iop.size()), size - iop.size());
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return Status(errno, "failed to read segment");
+        }
+        if (nr == 0) {
+            return Status(EIO, "segment is truncated");
+        }
+    }
+    buf->append(iop);
+    return Status::OK();
+}
+
+} // namespace
+
+struct SegmentStore::Record {
+    RecordType type = kData;
+    uint64_t sequence = 0;
+    uint64_t file_id = 0;
+    uint64_t offset = 0;
+    // name of created files, name of attributes
+    std::string key;
+    // value of attributes
+    std::string value;
+    // data records only
+    uint64_t data_len = 0;
+    // where the record was found by scan
+    SegmentPtr segment;
+    uint64_t data_offset = 0;
+};
+
+SegmentStore::SegmentStore(const char* data_path, Durability durability, uint64_t segment_size) :
+    _data_path(data_path), _durability(durability), _segment_size(segment_size) {
+    BOOST_ASSERT(data_path != nullptr);
+    BOOST_ASSERT(segment_size > kHeaderSize);
+    if (durability == Durability::kGroupCommit) {
+        _committer =
+            std::make_unique<GroupCommitter>(FLAGS_manusya_group_commit_window_us, FLAGS_manusya_group_commit_bytes);
+    }
+    constexpr mode_t mode = 0774;
+    int r = ::mkdir(data_path, mode);
+    if (r < 0 && errno != EEXIST) {
+        PLOG_ERROR(("desc", "failed to create data path")("path", data_path));
+    }
+    auto status = recover();
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to recover segments")("path", data_path)("error", status.error_str()));
+        BOOST_ASSERT_MSG(false, "failed to recover segments");
+    }
+    _compactor = std::thread([this]() {
+        run_compaction();
+    });
+}
+
+SegmentStore::~SegmentStore() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopped = true;
+        _cond.notify_all();
+    }
+    if (_compactor.joinable()) {
+        _compactor.join();
+    }
+}
+
+Status SegmentStore::open_segment(uint32_t id, bool create, SegmentPtr* segment) {
+    auto path = std::format("{}/{}", _data_path, segment_name(id));
+    constexpr mode_t mode = 0644;
+    int fd = ::open(path.c_str(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, mode);
+    if (fd < 0) {
+        PLOG_ERROR(("desc", "failed to open segment")("path", path)("error", errno));
+        return Status(errno, std::format("failed to open segment {}", path));
+    }
+    if (create) {
+        // keep the size so that scan stops at the end of written records
+        if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(_segment_size)) < 0) {
+            PLOG_DEBUG(("desc", "failed to preallocate segment")("path", path)("error", errno));
+        }
+        if (_durability != Durability::kNone) {
+            auto status = fsync_dir(_data_path);
+            if (!status.ok()) {
+                close(fd);
+                return status;
+            }
+        }
+    }
+    *segment = std::make_shared<Segment>(id, fd, std::move(path));
+    return Status::OK();
+}
+
+Status SegmentStore::scan(const SegmentPtr& segment, std::vector<Record>* records) {
+    struct stat st;
+    if (::fstat(segment->fd, &st) < 0) {
+        return Status(errno, "failed to stat segment");
+    }
+    uint64_t file_size = st.st_size;
+
+    // records are read through a window, data is skipped
+    std::string window;
+    uint64_t window_start = 0;
+    auto fetch = [&](uint64_t pos, uint64_t len, std::string_view* out) -> Status {
+        if (pos + len > file_size) {
+            return Status(EIO, "record exceeds the segment");
+        }
+        if (pos < window_start || pos + len > window_start + window.size()) {
+            window.resize(std::min(std::max(len, kScanWindow), file_size - pos));
+            uint64_t done = 0;
+            while (done < window.size()) {
+                auto nr =
+                    ::pread(segment->fd, window.data() + done, window.size() - done, static_cast<off_t>(pos + done));
+                if (nr < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return Status(errno, "failed to read segment");
+                }
+                if (nr == 0) {
+                    break;
+                }
+                done += nr;
+            }
+            window.resize(done);
+            window_start = pos;
+            if (done < len) {
+                return Status(EIO, "record exceeds the segment");
+            }
+        }
+        *out = std::string_view(window).substr(pos - window_start, len);
+        return Status::OK();
+    };
+
+    // parse the record at pos, false if there is none, e.g. a reservation never written or a
+    // torn write
+    auto parse = [&](uint64_t pos, Record* record, uint64_t* next) -> bool {
+        std::string_view bytes;
+        if (!fetch(pos, kHeaderSize, &bytes).ok()) {
+            return false;
+        }
+        RecordHeader header;
+        memcpy(&header, bytes.data(), kHeaderSize);
+        if (header.magic != kRecordMagic) {
+            return false;
+        }
+        uint64_t covered = header.key_len + (header.type == kData ? 0 : header.data_len);
+        std::string_view payload;
+        if (!fetch(pos + kHeaderSize, covered, &payload).ok()) {
+            return false;
+        }
+        auto key = payload.substr(0, header.key_len);
+        auto value = payload.substr(header.key_len);
+        if (record_crc(header, key, value) != header.crc) {
+            return false;
+        }
+        record->type = static_cast<RecordType>(header.type);
+        record->sequence = header.sequence;
+        record->file_id = header.file_id;
+        record->offset = header.offset;
+        record->key = key;
+        record->value = value;
+        record->segment = segment;
+        record->data_offset = pos + kHeaderSize + header.key_len;
+        if (record->type == kData) {
+            // a torn or corrupted payload drops the record like a torn header, replay must not
+            // index data the chunk checksums would only reject when it is read
+            std::string_view data;
+            if (!fetch(record->data_offset, header.data_len, &data).ok() ||
+                common::crc32c(0, data.data(), data.size()) != header.data_crc) {
+                return false;
+            }
+            record->data_len = header.data_len;
+        }
+        *next = record->data_offset + header.data_len;
+        return true;
+    };
+    // offset of the next record magic at or after pos, file_size if there is none
+    auto seek = [&](uint64_t pos) -> uint64_t {
+        auto magic = kRecordMagic;
+        std::string_view pattern(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        while (pos + kHeaderSize <= file_size) {
+            std::string_view bytes;
+            if (!fetch(pos, std::min(kScanWindow, file_size - pos), &bytes).ok()) {
+                return file_size;
+            }
+            auto found = bytes.find(pattern);
+            if (found != std::string_view::npos) {
+                return pos + found;
+            }
+            // the magic may straddle the windows
+            pos += bytes.size() - (sizeof(magic) - 1);
+        }
+        return file_size;
+    };
+
+    // offsets are reserved in order but records are written concurrently, a reservation whose
+    // writer failed or crashed leaves a hole before records already acknowledged, so scanning
+    // goes on from the next record found after it
+    uint64_t pos = 0;
+    uint64_t end = 0;
+    uint64_t skipped = 0;
+    while (pos + kHeaderSize <= file_size) {
+        Record record;
+        uint64_t next = 0;
+        if (!parse(pos, &record, &next)) {
+            pos = seek(pos + 1);
+            continue;
+        }
+        skipped += pos - end;
+        pos = next;
+        end = next;
+        records->push_back(std::move(record));
+    }
+    if (skipped > 0) {
+        PLOG_WARN(("desc", "unreadable records skipped")("segment", segment->path)("bytes", skipped));
+    }
+    // writes go on after the last record found, anything after it is a torn tail
+    segment->write_offset = end;
+    return Status::OK();
+}
+
+Status SegmentStore::recover() {
+    DIR* dir = opendir(_data_path.c_str());
+    if (dir == nullptr) {
+        return Status(errno, "failed to open data path");
+    }
+    std::vector<uint32_t> ids;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr) {
+        uint32_t id = 0;
+        if (entry->d_type == DT_REG && parse_segment_name(entry->d_name, &id)) {
+            ids.push_back(id);
+        }
+    }
+    closedir(dir);
+
+    std::vector<Record> records;
+    for (auto id : ids) {
+        SegmentPtr segment;
+        auto status = open_segment(id, false, &segment);
+        if (!status.ok()) {
+            return status;
+        }
+        status = scan(segment, &records);
+        if (!status.ok()) {
+            return status;
+        }
+        _segments[id] = segment;
+        _next_segment_id = std::max(_next_segment_id, id + 1);
+    }
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        return a.sequence < b.sequence;
+    });
+
+    // files are created first, compaction rewrites create records after the data they own,
+    // and a file is dead once its tombstone is found anywhere
+    std::unordered_set<uint64_t> removed;
+    for (const auto& record : records) {
+        if (record.type == kRemove) {
+            removed.insert(record.file_id);
+        }
+        _sequence = std::max(_sequence, record.sequence + 1);
+        _next_file_id = std::max(_next_file_id, record.file_id + 1);
+    }
+
+    std::lock_guard lock(_mutex);
+    for (const auto& record : records) {
+        if (record.type != kCreate || removed.contains(record.file_id) || _files.contains(record.file_id)) {
+            continue;
+        }
+        auto file = std::make_shared<File>();
+        file->id = record.file_id;
+        file->name = record.key;
+        _files.emplace(file->id, file);
+        _names[file->name] = file->id;
+    }
+    for (const auto& record : records) {
+        record.segment->files.insert(record.file_id);
+        if (removed.contains(record.file_id) || record.type == kCreate) {
+            continue;
+        }
+        auto it = _files.find(record.file_id);
+        if (it == _files.end()) {
+            PLOG_WARN(("desc", "record of unknown file")("file_id", record.file_id));
+            continue;
+        }
+        auto& file = it->second;
+        switch (record.type) {
+        case kData:
+            insert_extent(file.get(),
+                          record.offset,
+                          Extent{record.segment, record.data_offset, record.data_len, record.sequence});
+            break;
+        case kSeal:
+            file->sealed = true;
+            file->size = record.offset;
+            break;
+        case kAttr:
+            file->attrs[record.key] = Attr{record.value, record.sequence};
+            break;
+        default:
+            break;
+        }
+    }
+    // tombstones are kept until the segments having records of the files are compacted
+    _removed.insert(removed.begin(), removed.end());
+    PLOG_INFO(("desc", "segments recovered")("segments", _segments.size())("files", _files.size()));
+    return Status::OK();
+}
+
+Status SegmentStore::reserve(uint64_t size, Location* location) {
+    // a record larger than a segment gets an empty one to itself
+    if (_active == nullptr || (_active->write_offset > 0 && _active->write_offset + size > _segment_size)) {
+        SegmentPtr segment;
+        auto status = open_segment(_next_segment_id, true, &segment);
+        if (!status.ok()) {
+            return status;
+        }
+        _next_segment_id++;
+        _segments[segment->id] = segment;
+        _active = std::move(segment);
+    }
+    location->segment = _active;
+    location->offset = _active->write_offset;
+    _active->write_offset += size;
+    return Status::OK();
+}
+
+Status SegmentStore::write_record(const Location& location, const Record& record, IOBuf data) {
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kRecordMagic;
+    header.sequence = record.sequence;
+    header.file_id = record.file_id;
+    header.offset = record.offset;
+    header.key_len = record.key.size();
+    header.type = record.type;
+    if (record.type == kData) {
+        header.data_len = data.size();
+        header.data_crc = common::crc32c(data);
+        header.crc = record_crc(header, record.key, {});
+    } else {
+        header.data_len = record.value.size();
+        header.crc = record_crc(header, record.key, record.value);
+    }
+
+    IOBuf buf;
+    buf.append(&header, sizeof(header));
+    buf.append(record.key);
+    buf.append(record.value);
+    buf.append(std::move(data));
+    int fd = location.segment->fd;
+    auto offset = location.offset;
+    auto buf_size = buf.size();
+    while (!buf.empty()) {
+        auto nw = buf.pcut_into_file_descriptor(fd, static_cast<off_t>(offset + buf_size - buf.size()), buf.size());
+        if (nw < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            PLOG_ERROR(("desc", "failed to write record")("segment", location.segment->path)("offset", offset)
+                       ("error", errno));
+            return Status(errno, "failed to write record");
+        }
+    }
+    return Status::OK();
+}
+
+Status SegmentStore::append_record(Record record,
+                                   IOBuf data,
+                                   Location* location,
+                                   const std::function<void(const Location&)>& index) {
+    {
+        std::lock_guard lock(_mutex);
+        auto status = reserve(kHeaderSize + record.key.size() + record.value.size() + data.size(), location);
+        if (!status.ok()) {
+            return status;
+        }
+        // sequence follows the order of reservations, so replay sees the same order
+        if (record.sequence == 0) {
+            record.sequence = _sequence++;
+        }
+        location->sequence = record.sequence;
+        location->segment->files.insert(record.file_id);
+        location->segment->inflight++;
+    }
+    auto status = write_record(*location, record, std::move(data));
+    std::lock_guard lock(_mutex);
+    location->segment->inflight--;
+    if (!status.ok()) {
+        // the failed reservation is a hole recovery skips, later records go to a new segment
+        if (_active == location->segment) {
+            _active = nullptr;
+        }
+        return status;
+    }
+    if (index) {
+        index(*location);
+    }
+    return status;
+}
+
+void SegmentStore::release(const Extent& extent, uint64_t length) {
+    BOOST_ASSERT(extent.segment->live_bytes >= length);
+    extent.segment->live_bytes -= length;
+}
+
+void SegmentStore::insert_extent(File* file, uint64_t offset, Extent extent) {
+    auto end = offset + extent.length;
+    auto it = file->extents.lower_bound(offset);
+    // the extent before may overlap the head of the new one, or cover all of it
+    if (it != file->extents.begin()) {
+        auto prev = std::prev(it);
+        auto prev_end = prev->first + prev->second.length;
+        if (prev_end > offset) {
+            if (prev_end > end) {
+                Extent tail = prev->second;
+                tail.offset += end - prev->first;
+                tail.length = prev_end - end;
+                file->extents.emplace(end, std::move(tail));
+            }
+            release(prev->second, std::min(prev_end, end) - offset);
+            prev->second.length = offset - prev->first;
+            if (prev->second.length == 0) {
+                file->extents.erase(prev);
+            }
+        }
+    }
+    while (it != file->extents.end() && it->first < end) {
+        auto cur_end = it->first + it->second.length;
+        if (cur_end > end) {
+            Extent tail = it->second;
+            tail.offset += end - it->first;
+            tail.length = cur_end - end;
+            release(it->second, end - it->first);
+            file->extents.erase(it);
+            file->extents.emplace(end, std::move(tail));
+            break;
+        }
+        release(it->second, it->second.length);
+        it = file->extents.erase(it);
+    }
+    extent.segment->live_bytes += extent.length;
+    file->extents.emplace(offset, std::move(extent));
+    file->size = std::max(file->size, end);
+}
+
+Future<Status> SegmentStore::sync(const SegmentPtr& segment, uint64_t bytes) {
+    if (_durability == Durability::kGroupCommit) {
+        // the segment is held until synced, compaction may drop it meanwhile
+        return _committer->commit(segment->fd, bytes, segment);
+    }
+    return make_ready_future(Status::OK());
+}
+
+Future<Status> SegmentStore::open(const char* path, int flags, FileHandlePtr* fh) {
+    if (path == nullptr) {
+        return make_ready_future(Status(EINVAL, "path is nullptr"));
+    }
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if ((flags & O_TRUNC) != 0) {
+        return make_ready_future(Status(EINVAL, "truncate is not supported"));
+    }
+
+    FilePtr file;
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _names.find(path);
+        if (it != _names.end()) {
+            if ((flags & O_EXCL) != 0) {
+                return make_ready_future(Status(EEXIST, "file already exists"));
+            }
+            file = _files[it->second];
+            if ((flags & O_ACCMODE) != O_RDONLY && file->sealed) {
+                return make_ready_future(Status(EACCES, "file is sealed"));
+            }
+            *fh = FileHandlePtr(new SegmentFileHandle(file->id, this));
+            return make_ready_future(Status::OK());
+        }
+        if ((flags & O_CREAT) == 0) {
+            return make_ready_future(Status(ENOENT, "file not found"));
+        }
+        // the name is taken before the record is written, concurrent creates find it
+        file = std::make_shared<File>();
+        file->id = _next_file_id++;
+        file->name = path;
+        _files[file->id] = file;
+        _names[file->name] = file->id;
+    }
+
+    Record record;
+    record.type = kCreate;
+    record.file_id = file->id;
+    record.key = path;
+    Location location;
+    auto status = append_record(std::move(record), IOBuf(), &location);
+    if (!status.ok()) {
+        std::lock_guard lock(_mutex);
+        _names.erase(file->name);
+        _files.erase(file->id);
+        return make_ready_future(std::move(status));
+    }
+    *fh = FileHandlePtr(new SegmentFileHandle(file->id, this));
+    return sync(location.segment, kHeaderSize + file->name.size());
+}
+
+Future<Status> SegmentStore::append(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    auto file_id = fh->as<SegmentFileHandle>()->handle();
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _files.find(file_id);
+        if (it == _files.end()) {
+            return make_ready_future(Status(ENOENT, "file is removed"));
+        }
+        if (it->second->sealed) {
+            return make_ready_future(Status(EPERM, "file is sealed"));
+        }
+    }
+
+    // data larger than a segment is split into records which fit
+    std::vector<Future<Status>> futures;
+    uint64_t done = 0;
+    while (!buf.empty()) {
+        uint64_t length = std::min<uint64_t>(buf.size(), _segment_size - kHeaderSize);
+        IOBuf piece;
+        buf.cutn(&piece, length);
+
+        Record record;
+        record.type = kData;
+        record.file_id = file_id;
+        record.offset = offset + done;
+        Location location;
+        // the index only points to written data, readers never see a hole being written
+        auto status = append_record(std::move(record), std::move(piece), &location, [&](const Location& written) {
+            auto it = _files.find(file_id);
+            if (it != _files.end()) {
+                insert_extent(it->second.get(),
+                              offset + done,
+                              Extent{written.segment, written.offset + kHeaderSize, length, written.sequence});
+            }
+        });
+        if (!status.ok()) {
+            return make_ready_future(std::move(status));
+        }
+        futures.push_back(sync(location.segment, kHeaderSize + length));
+        done += length;
+    }
+    if (futures.size() == 1) {
+        return std::move(futures.front());
+    }
+    for (auto& future : futures) {
+        auto status = future.get();
+        if (!status.ok()) {
+            return make_ready_future(std::move(status));
+        }
+    }
+    return make_ready_future(Status::OK());
+}
+
+Future<Status> SegmentStore::read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (buf == nullptr) {
+        return make_ready_future(Status(EINVAL, "buf is nullptr"));
+    }
+    auto file_id = fh->as<SegmentFileHandle>()->handle();
+
+    // pieces of the range, holes have no segment
+    std::vector<Extent> pieces;
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _files.find(file_id);
+        if (it == _files.end()) {
+            return make_ready_future(Status(ENOENT, "file is removed"));
+        }
+        const auto& file = it->second;
+        if (offset + size > file->size) {
+            return make_ready_future(Status(EINVAL, "invalid size"));
+        }
+        auto end = offset + size;
+        auto pos = offset;
+        auto ext = file->extents.upper_bound(offset);
+        if (ext != file->extents.begin()) {
+            --ext;
+        }
+        for (; pos < end && ext != file->extents.end(); ++ext) {
+            auto ext_start = ext->first;
+            auto ext_end = ext_start + ext->second.length;
+            if (ext_end <= pos) {
+                continue;
+            }
+            if (ext_start >= end) {
+                break;
+            }
+            if (ext_start > pos) {
+                pieces.push_back(Extent{nullptr, 0, ext_start - pos, 0});
+                pos = ext_start;
+            }
+            auto length = std::min(ext_end, end) - pos;
+            pieces.push_back(Extent{ext->second.segment, ext->second.offset + (pos - ext_start), length, 0});
+            pos += length;
+        }
+        if (pos < end) {
+            pieces.push_back(Extent{nullptr, 0, end - pos, 0});
+        }
+    }
+
+    IOBuf result;
+    for (const auto& piece : pieces) {
+        if (piece.segment == nullptr) {
+            // never written, reads as zeros like a sparse file
+            result.resize(result.size() + piece.length);
+            continue;
+        }
+        auto status = pread_into(piece.segment->fd, piece.offset, piece.length, &result);
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to read segment")("segment", piece.segment->path)("offset", piece.offset)
+                       ("error", status.error_str()));
+            return make_ready_future(std::move(status));
+        }
+    }
+    result.swap(*buf);
+    return make_ready_future(Status::OK());
+}
+
+Future<Status> SegmentStore::seal(FileHandlePtr fh) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    auto file_id = fh->as<SegmentFileHandle>()->handle();
+    FilePtr file;
+    std::set<SegmentPtr> segments;
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _files.find(file_id);
+        if (it == _files.end()) {
+            return make_ready_future(Status(ENOENT, "file is removed"));
+        }
+        file = it->second;
+        if (file->sealed) {
+            return make_ready_future(Status::OK());
+        }
+        for (const auto& [offset, extent] : file->extents) {
+            segments.insert(extent.segment);
+        }
+    }
+    // data is synced before the seal record
+    if (_durability != Durability::kNone) {
+        for (const auto& segment : segments) {
+            if (::fdatasync(segment->fd) < 0) {
+                return make_ready_future(Status(errno, "failed to fdatasync"));
+            }
+        }
+    }
+
+    Record record;
+    record.type = kSeal;
+    record.file_id = file_id;
+    {
+        std::lock_guard lock(_mutex);
+        record.offset = file->size;
+    }
+    Location location;
+    // sealed once the record is written, as replay would see it, so that compaction copies it
+    auto status = append_record(std::move(record), IOBuf(), &location, [&](const Location&) {
+        file->sealed = true;
+    });
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    if (_durability != Durability::kNone && ::fdatasync(location.segment->fd) < 0) {
+        return make_ready_future(Status(errno, "failed to fdatasync"));
+    }
+    return make_ready_future(Status::OK());
+}
+
+Future<Status> SegmentStore::size(FileHandlePtr fh, uint64_t* size) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (size == nullptr) {
+        return make_ready_future(Status(EINVAL, "size is nullptr"));
+    }
+    std::lock_guard lock(_mutex);
+    auto it = _files.find(fh->as<SegmentFileHandle>()->handle());
+    if (it == _files.end()) {
+        return make_ready_future(Status(ENOENT, "file is removed"));
+    }
+    *size = it->second->size;
+    return make_ready_future(Status::OK());
+}
+
+Future<Status> SegmentStore::remove(const char* path) {
+    if (path == nullptr) {
+        return make_ready_future(Status(EINVAL, "path is nullptr"));
+    }
+    uint64_t file_id = 0;
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _names.find(path);
+        if (it == _names.end()) {
+            return make_ready_future(Status(ENOENT, "file not found"));
+        }
+        file_id = it->second;
+        _names.erase(it);
+        auto file = _files.find(file_id);
+        for (const auto& [offset, extent] : file->second->extents) {
+            release(extent, extent.length);
+        }
+        _files.erase(file);
+        _removed.insert(file_id);
+    }
+
+    Record record;
+    record.type = kRemove;
+    record.file_id = file_id;
+    Location location;
+    auto status = append_record(std::move(record), IOBuf(), &location);
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    return sync(location.segment, kHeaderSize);
+}
+
+Future<Status> SegmentStore::set_attr(FileHandlePtr fh, const char* key, const char* value) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (key == nullptr) {
+        return make_ready_future(Status(EINVAL, "key is nullptr"));
+    }
+    if (value == nullptr) {
+        return make_ready_future(Status(EINVAL, "value is nullptr"));
+    }
+    auto file_id = fh->as<SegmentFileHandle>()->handle();
+    FilePtr file;
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _files.find(file_id);
+        if (it == _files.end()) {
+            return make_ready_future(Status(ENOENT, "file is removed"));
+        }
+        file = it->second;
+    }
+
+    Record record;
+    record.type = kAttr;
+    record.file_id = file_id;
+    record.key = key;
+    record.value = value;
+    Location location;
+    // concurrent updates of one attribute keep the later record, as replay does
+    auto status = append_record(record, IOBuf(), &location, [&](const Location& written) {
+        auto& attr = file->attrs[record.key];
+        if (attr.sequence < written.sequence) {
+            attr = Attr{record.value, written.sequence};
+        }
+    });
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    return sync(location.segment, kHeaderSize + record.key.size() + record.value.size());
+}
+
+Future<Status> SegmentStore::get_attr(FileHandlePtr fh, const char* key, std::string* value) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (key == nullptr) {
+        return make_ready_future(Status(EINVAL, "key is nullptr"));
+    }
+    if (value == nullptr) {
+        return make_ready_future(Status(EINVAL, "value is nullptr"));
+    }
+    std::lock_guard lock(_mutex);
+    auto it = _files.find(fh->as<SegmentFileHandle>()->handle());
+    if (it == _files.end()) {
+        return make_ready_future(Status(ENOENT, "file is removed"));
+    }
+    auto attr = it->second->attrs.find(key);
+    if (attr == it->second->attrs.end()) {
+        // keep the errno of getxattr for missing attributes
+        return make_ready_future(Status(ENODATA, std::format("attribute {} not found", key)));
+    }
+    *value = attr->second.value;
+    return make_ready_future(Status::OK());
+}
+
+Future<Status> SegmentStore::list_attrs(FileHandlePtr fh, std::map<std::string, std::string>* attrs) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (attrs == nullptr) {
+        return make_ready_future(Status(EINVAL, "attrs is nullptr"));
+    }
+    std::lock_guard lock(_mutex);
+    auto it = _files.find(fh->as<SegmentFileHandle>()->handle());
+    if (it == _files.end()) {
+        return make_ready_future(Status(ENOENT, "file is removed"));
+    }
+    for (const auto& [key, attr] : it->second->attrs) {
+        (*attrs)[key] = attr.value;
+    }
+    return make_ready_future(Status::OK());
+}
+
+void SegmentStore::for_each(std::function<void(const char* path)> cb) {
+    // iterate a snapshot, cb may call back into the store
+    std::vector<std::string> names;
+    {
+        std::lock_guard lock(_mutex);
+        names.reserve(_names.size());
+        for (const auto& [name, file_id] : _names) {
+            names.push_back(name);
+        }
+    }
+    for (const auto& name : names) {
+        cb(name.c_str());
+    }
+}
+
+size_t SegmentStore::segment_count() const {
+    std::lock_guard lock(_mutex);
+    return _segments.size();
+}
+
+void SegmentStore::compact(double ratio) {
+    std::lock_guard compact_lock(_compact_mutex);
+    std::vector<SegmentPtr> victims;
+    {
+        std::lock_guard lock(_mutex);
+        for (const auto& [id, segment] : _segments) {
+            // records being written are not indexed yet, the segment is taken by a later pass
+            if (segment == _active || segment->inflight > 0) {
+                continue;
+            }
+            // segments left empty by a crash are dropped as well
+            if (segment->write_offset == 0 ||
+                static_cast<double>(segment->live_bytes) < ratio * static_cast<double>(segment->write_offset)) {
+                victims.push_back(segment);
+            }
+        }
+    }
+    for (const auto& victim : victims) {
+        compact_segment(victim);
+    }
+}
+
+void SegmentStore::compact_segment(const SegmentPtr& victim) {
+    struct Move {
+        FilePtr file;
+        uint64_t file_offset;
+        Extent extent;
+    };
+    std::vector<Move> moves;
+    std::vector<FilePtr> files;
+    std::vector<uint64_t> tombstones;
+    {
+        std::lock_guard lock(_mutex);
+        for (auto file_id : victim->files) {
+            auto it = _files.find(file_id);
+            if (it != _files.end()) {
+                files.push_back(it->second);
+                for (const auto& [offset, extent] : it->second->extents) {
+                    if (extent.segment == victim) {
+                        moves.push_back(Move{it->second, offset, extent});
+                    }
+                }
+                continue;
+            }
+            if (!_removed.contains(file_id)) {
+                continue;
+            }
+            // the tombstone must outlive the other records of the file
+            bool referenced = std::any_of(_segments.begin(), _segments.end(), [&](const auto& entry) {
+                return entry.second != victim && entry.second->files.contains(file_id);
+            });
+            if (referenced) {
+                tombstones.push_back(file_id);
+            }
+        }
+    }
+
+    std::set<SegmentPtr> written;
+    auto emit = [&](Record record,
+                    IOBuf data,
+                    Location* location,
+                    const std::function<void(const Location&)>& index = nullptr) {
+        auto status = append_record(std::move(record), std::move(data), location, index);
+        if (status.ok()) {
+            written.insert(location->segment);
+        }
+        return status;
+    };
+
+    // metadata is rewritten as the create and seal records of the files may be in the victim,
+    // attributes and data keep their sequences so that later updates still win on replay
+    for (const auto& file : files) {
+        Record create;
+        create.type = kCreate;
+        create.file_id = file->id;
+        std::map<std::string, Attr> attrs;
+        bool sealed = false;
+        uint64_t size = 0;
+        {
+            std::lock_guard lock(_mutex);
+            create.key = file->name;
+            attrs = file->attrs;
+            sealed = file->sealed;
+            size = file->size;
+        }
+        Location location;
+        auto status = emit(std::move(create), IOBuf(), &location);
+        for (auto it = attrs.begin(); status.ok() && it != attrs.end(); ++it) {
+            Record attr;
+            attr.type = kAttr;
+            attr.file_id = file->id;
+            attr.key = it->first;
+            attr.value = it->second.value;
+            attr.sequence = it->second.sequence;
+            status = emit(std::move(attr), IOBuf(), &location);
+        }
+        if (status.ok() && sealed) {
+            Record seal;
+            seal.type = kSeal;
+            seal.file_id = file->id;
+            seal.offset = size;
+            status = emit(std::move(seal), IOBuf(), &location);
+        }
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to compact segment")("segment", victim->path)("error", status.error_str()));
+            return;
+        }
+    }
+
+    for (auto& move : moves) {
+        IOBuf data;
+        auto status = pread_into(victim->fd, move.extent.offset, move.extent.length, &data);
+        Location location;
+        if (status.ok()) {
+            Record record;
+            record.type = kData;
+            record.file_id = move.file->id;
+            record.offset = move.file_offset;
+            record.sequence = move.extent.sequence;
+            status = emit(std::move(record), std::move(data), &location, [&](const Location& written) {
+                // the range may have been overwritten or the file removed while copying
+                auto it = move.file->extents.find(move.file_offset);
+                if (_files.contains(move.file->id) && it != move.file->extents.end() &&
+                    it->second.segment == victim && it->second.offset == move.extent.offset &&
+                    it->second.length == move.extent.length) {
+                    Extent extent{written.segment, written.offset + kHeaderSize, move.extent.length, written.sequence};
+                    insert_extent(move.file.get(), move.file_offset, std::move(extent));
+                }
+            });
+        }
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to compact segment")("segment", victim->path)("error", status.error_str()));
+            return;
+        }
+    }
+
+    for (auto file_id : tombstones) {
+        Record record;
+        record.type = kRemove;
+        record.file_id = file_id;
+        Location location;
+        auto status = emit(std::move(record), IOBuf(), &location);
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to compact segment")("segment", victim->path)("error", status.error_str()));
+            return;
+        }
+    }
+
+    // copies must be durable before the originals are gone
+    for (const auto& segment : written) {
+        if (::fdatasync(segment->fd) < 0) {
+            PLOG_ERROR(("desc", "failed to fdatasync")("segment", segment->path)("error", errno));
+            return;
+        }
+    }
+    {
+        std::lock_guard lock(_mutex);
+        if (victim->live_bytes != 0) {
+            // overwritten while copying into another range of the victim, never happens as
+            // only the active segment is written, but keep the data if it does
+            PLOG_WARN(("desc", "segment is still referenced")("segment", victim->path));
+            return;
+        }
+        _segments.erase(victim->id);
+        for (auto file_id : victim->files) {
+            if (!_removed.contains(file_id)) {
+                continue;
+            }
+            bool referenced = std::any_of(_segments.begin(), _segments.end(), [&](const auto& entry) {
+                return entry.second->files.contains(file_id);
+            });
+            if (!referenced) {
+                _removed.erase(file_id);
+            }
+        }
+    }
+    if (::unlink(victim->path.c_str()) < 0) {
+        PLOG_ERROR(("desc", "failed to unlink segment")("segment", victim->path)("error", errno));
+    }
+    PLOG_INFO(("desc", "segment compacted")("segment", victim->path)("moved", moves.size()));
+}
+
+void SegmentStore::run_compaction() {
+    while (true) {
+        {
+            std::unique_lock lock(_mutex);
+            if (!_stopped) {
+                _cond.wait_for(lock, static_cast<long>(FLAGS_manusya_segment_compact_interval_ms * 1000));
+            }
+            if (_stopped) {
+                return;
+            }
+        }
+        compact(FLAGS_manusya_segment_compact_ratio);
+    }
+}
+
+} // namespace pain::manusya
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "manusya/file_handle.h"
+#include "manusya/group_committer.h"
+#include "manusya/local_store.h"
+#include "manusya/store.h"
+
+namespace pain::manusya {
+
+struct Segment;
+using SegmentPtr = std::shared_ptr<Segment>;
+
+class SegmentFileHandle : public FileHandle {
+public:
+    SegmentFileHandle(uint64_t file_id, StorePtr store) : FileHandle(store), _file_id(file_id) {}
+
+    uint64_t handle() const {
+        return _file_id;
+    }
+
+private:
+    uint64_t _file_id;
+};
+
+// SegmentStore packs files into large preallocated segment files under data_path instead of
+// one file per chunk. Every operation appends a self-describing record to the active segment:
+// created files, data, seals, attributes and removals, so writes of many small files become
+// sequential I/O. An in-memory index maps each file offset range to (segment, offset, length)
+// and is rebuilt by scanning the record headers when the store is opened.
+// A background thread compacts segments whose live data drops below a ratio, it copies the
+// live records into the active segment, syncs them and deletes the old segment.
+class SegmentStore : public Store {
+public:
+    SegmentStore(const char* data_path, Durability durability, uint64_t segment_size);
+    ~SegmentStore() override;
+
+    Future<Status> open(const char* path, int flags, FileHandlePtr* fh) override;
+    Future<Status> append(FileHandlePtr fh, uint64_t offset, IOBuf buf) override;
+    Future<Status> read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) override;
+    Future<Status> seal(FileHandlePtr fh) override;
+    Future<Status> size(FileHandlePtr fh, uint64_t* size) override;
+    Future<Status> remove(const char* path) override;
+    Future<Status> set_attr(FileHandlePtr fh, const char* key, const char* value) override;
+    Future<Status> get_attr(FileHandlePtr fh, const char* key, std::string* value) override;
+    Future<Status> list_attrs(FileHandlePtr fh, std::map<std::string, std::string>* attrs) override;
+    void for_each(std::function<void(const char* path)> cb) override;
+
+    // run one compaction pass over segments whose live bytes are below ratio of their size
+    void compact(double ratio);
+
+    size_t segment_count() const;
+
+private:
+    struct Extent {
+        SegmentPtr segment;
+        // offset of the data in segment
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        // sequence of the record, kept when compaction copies it so that replay still
+        // orders it before later writes to the same range
+        uint64_t sequence = 0;
+    };
+
+    struct Attr {
+        std::string value;
+        uint64_t sequence = 0;
+    };
+
+    struct File {
+        uint64_t id = 0;
+        std::string name;
+        uint64_t size = 0;
+        bool sealed = false;
+        // keyed by offset in file, extents never overlap
+        std::map<uint64_t, Extent> extents;
+        std::map<std::string, Attr> attrs;
+    };
+    using FilePtr = std::shared_ptr<File>;
+
+    struct Record;
+    struct Location {
+        SegmentPtr segment;
+        uint64_t offset = 0;
+        uint64_t sequence = 0;
+    };
+
+    Status recover();
+    Status scan(const SegmentPtr& segment, std::vector<Record>* records);
+    Status open_segment(uint32_t id, bool create, SegmentPtr* segment);
+    // reserve space of a record in the active segment, rolling to a new one if it is full,
+    // called with _mutex held
+    Status reserve(uint64_t size, Location* location);
+    // write a record, the data of data records follows the header and key
+    Status write_record(const Location& location, const Record& record, IOBuf data);
+    // records without a sequence get the next one, index is called with _mutex held once the
+    // record is written and before compaction may take its segment
+    Status append_record(Record record,
+                         IOBuf data,
+                         Location* location,
+                         const std::function<void(const Location&)>& index = nullptr);
+    // called with _mutex held
+    void insert_extent(File* file, uint64_t offset, Extent extent);
+    void release(const Extent& extent, uint64_t length);
+    Future<Status> sync(const SegmentPtr& segment, uint64_t bytes);
+    void compact_segment(const SegmentPtr& victim);
+    void run_compaction();
+
+    std::string _data_path;
+    Durability _durability;
+    uint64_t _segment_size;
+    std::unique_ptr<GroupCommitter> _committer;
+
+    mutable bthread::Mutex _mutex;
+    std::map<uint32_t, SegmentPtr> _segments;
+    SegmentPtr _active;
+    uint32_t _next_segment_id = 0;
+    uint64_t _sequence = 1;
+    uint64_t _next_file_id = 1;
+    std::unordered_map<uint64_t, FilePtr> _files;
+    std::unordered_map<std::string, uint64_t> _names;
+    // removed files whose records still exist in some segment, their tombstones are kept
+    std::set<uint64_t> _removed;
+
+    // serializes compaction passes
+    bthread::Mutex _compact_mutex;
+    bool _stopped = false;
+    bthread::ConditionVariable _cond;
+    std::thread _compactor;
+};
+
+} // namespace pain::manusya
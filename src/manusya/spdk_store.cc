@@ -0,0 +1,875 @@
+#include "manusya/spdk_store.h"
+
+#include <gflags/gflags.h>
+#include <pain/base/plog.h>
+#include <spdk/bdev.h>
+#include <spdk/blob.h>
+#include <spdk/blob_bdev.h>
+#include <spdk/env.h>
+#include <spdk/init.h>
+#include <spdk/thread.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <boost/assert.hpp>
+#include "manusya/file_handle.h"
+
+DEFINE_string(manusya_spdk_config, "", "The json config of SPDK subsystems used by the spdk store");
+DEFINE_string(manusya_spdk_rpc_addr, "/var/tmp/manusya_spdk.sock", "The rpc socket used to load the SPDK config");
+DEFINE_int32(manusya_spdk_mem_size_mb, -1, "Memory reserved by the SPDK env, -1 means default");
+
+namespace pain::manusya {
+
+namespace {
+// internal xattrs of a blob, user attrs are stored with a prefix to avoid conflicts
+constexpr const char* kNameXattr = "manusya.name";
+constexpr const char* kSizeXattr = "manusya.size";
+constexpr const char* kUserXattrPrefix = "user.";
+
+using Callback = std::function<void(int)>;
+using HandleCallback = std::function<void(spdk_blob*, int)>;
+using IdCallback = std::function<void(spdk_blob_id, int)>;
+using StorePromise = std::shared_ptr<Promise<Status>>;
+
+void on_done(void* arg, int bserrno) {
+    std::unique_ptr<Callback> cb(static_cast<Callback*>(arg));
+    (*cb)(bserrno);
+}
+
+void on_handle(void* arg, spdk_blob* blob, int bserrno) {
+    std::unique_ptr<HandleCallback> cb(static_cast<HandleCallback*>(arg));
+    (*cb)(blob, bserrno);
+}
+
+void on_id(void* arg, spdk_blob_id id, int bserrno) {
+    std::unique_ptr<IdCallback> cb(static_cast<IdCallback*>(arg));
+    (*cb)(id, bserrno);
+}
+
+void on_store(void* arg, spdk_blob_store* bs, int bserrno) {
+    std::unique_ptr<std::function<void(spdk_blob_store*, int)>> cb(
+        static_cast<std::function<void(spdk_blob_store*, int)>*>(arg));
+    (*cb)(bs, bserrno);
+}
+
+void* wrap(Callback cb) {
+    return new Callback(std::move(cb));
+}
+
+void* wrap(HandleCallback cb) {
+    return new HandleCallback(std::move(cb));
+}
+
+void* wrap(IdCallback cb) {
+    return new IdCallback(std::move(cb));
+}
+
+void on_bdev_event(enum spdk_bdev_event_type type, struct spdk_bdev* bdev, void* /*event_ctx*/) {
+    PLOG_WARN(("desc", "unsupported bdev event")("type", static_cast<int>(type))("bdev", spdk_bdev_get_name(bdev)));
+}
+
+std::once_flag s_env_once;
+int s_env_rc = 0;
+
+StorePromise make_promise() {
+    return std::make_shared<Promise<Status>>();
+}
+
+Status to_status(int bserrno, const char* msg) {
+    return bserrno == 0 ? Status::OK() : Status(-bserrno, msg);
+}
+} // namespace
+
+struct SpdkBlob {
+    std::string name;
+    spdk_blob_id id = 0;
+    spdk_blob* blob = nullptr;
+    uint64_t size = 0;
+    bool opening = false;
+    bool removed = false;
+    std::vector<Callback> open_waiters;
+    // appends to one blob run one by one, partial io units are read back and merged
+    std::deque<std::function<void()>> appends;
+    bool md_syncing = false;
+    bool md_dirty = false;
+};
+
+class SpdkFileHandle : public FileHandle {
+public:
+    SpdkFileHandle(SpdkBlobPtr blob, StorePtr store) : FileHandle(store), _blob(std::move(blob)) {}
+
+    const SpdkBlobPtr& blob() const {
+        return _blob;
+    }
+
+private:
+    SpdkBlobPtr _blob;
+};
+
+SpdkStore::SpdkStore(const char* bdev_name) : _bdev_name(bdev_name) {
+    std::call_once(s_env_once, []() {
+        spdk_env_opts opts;
+        opts.opts_size = sizeof(opts);
+        spdk_env_opts_init(&opts);
+        opts.name = "manusya";
+        if (FLAGS_manusya_spdk_mem_size_mb > 0) {
+            opts.mem_size = FLAGS_manusya_spdk_mem_size_mb;
+        }
+        s_env_rc = spdk_env_init(&opts);
+        if (s_env_rc == 0) {
+            s_env_rc = spdk_thread_lib_init(nullptr, 0);
+        }
+    });
+    if (s_env_rc != 0) {
+        _init_status = Status(ENODEV, "failed to init spdk env");
+        PLOG_ERROR(("desc", "failed to init spdk env")("rc", s_env_rc));
+        return;
+    }
+
+    Promise<Status> promise;
+    auto future = promise.get_future();
+    _reactor = std::thread([this, &promise]() {
+        _thread = spdk_thread_create("manusya_spdk", nullptr);
+        if (_thread == nullptr) {
+            promise.set_value(Status(ENOMEM, "failed to create spdk thread"));
+            return;
+        }
+        spdk_set_thread(_thread);
+        load_blobstore([this, &promise](int rc) {
+            if (rc != 0) {
+                PLOG_ERROR(("desc", "failed to load blobstore")("bdev", _bdev_name)("rc", rc));
+                shutdown([this]() {
+                    _stopped = true;
+                });
+            }
+            promise.set_value(to_status(rc, "failed to load blobstore"));
+        });
+        run();
+    });
+    _init_status = future.get();
+    if (_init_status.ok()) {
+        PLOG_INFO(("desc", "spdk store is ready")("bdev", _bdev_name)("blobs", _blobs.size()));
+    }
+}
+
+SpdkStore::~SpdkStore() {
+    if (!_reactor.joinable()) {
+        return;
+    }
+    if (_init_status.ok()) {
+        post([this]() {
+            shutdown([this]() {
+                _stopped = true;
+            });
+        });
+    }
+    _reactor.join();
+}
+
+void SpdkStore::run() {
+    while (!_stopped) {
+        spdk_thread_poll(_thread, 0, 0);
+    }
+    spdk_thread_exit(_thread);
+    while (!spdk_thread_is_exited(_thread)) {
+        spdk_thread_poll(_thread, 0, 0);
+    }
+    spdk_thread_destroy(_thread);
+    _thread = nullptr;
+}
+
+void SpdkStore::post(std::function<void()> fn) {
+    auto* ctx = new std::function<void()>(std::move(fn));
+    int rc = spdk_thread_send_msg(
+        _thread,
+        [](void* arg) {
+            std::unique_ptr<std::function<void()>> fn(static_cast<std::function<void()>*>(arg));
+            (*fn)();
+        },
+        ctx);
+    BOOST_ASSERT_MSG(rc == 0, "failed to send msg to spdk thread");
+}
+
+void SpdkStore::load_blobstore(Callback cb) {
+    auto init_done = [this, cb](int rc) {
+        if (rc != 0) {
+            cb(rc);
+            return;
+        }
+        spdk_bs_dev* bs_dev = nullptr;
+        rc = spdk_bdev_create_bs_dev_ext(_bdev_name.c_str(), on_bdev_event, nullptr, &bs_dev);
+        if (rc != 0) {
+            cb(rc);
+            return;
+        }
+        spdk_bs_opts opts;
+        spdk_bs_opts_init(&opts, sizeof(opts));
+        snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "manusya");
+        auto loaded = [this, cb](spdk_blob_store* bs, int rc) {
+            if (rc == 0) {
+                _bs = bs;
+                load_blobs(cb);
+                return;
+            }
+            if (rc != -EILSEQ) {
+                cb(rc);
+                return;
+            }
+            // not a blobstore yet, the bs_dev is destroyed by the failed load
+            spdk_bs_dev* bs_dev = nullptr;
+            rc = spdk_bdev_create_bs_dev_ext(_bdev_name.c_str(), on_bdev_event, nullptr, &bs_dev);
+            if (rc != 0) {
+                cb(rc);
+                return;
+            }
+            spdk_bs_opts opts;
+            spdk_bs_opts_init(&opts, sizeof(opts));
+            snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), "manusya");
+            auto inited = [this, cb](spdk_blob_store* bs, int rc) {
+                if (rc == 0) {
+                    _bs = bs;
+                    load_blobs(cb);
+                    return;
+                }
+                cb(rc);
+            };
+            spdk_bs_init(bs_dev, &opts, on_store, new std::function<void(spdk_blob_store*, int)>(inited));
+        };
+        spdk_bs_load(bs_dev, &opts, on_store, new std::function<void(spdk_blob_store*, int)>(loaded));
+    };
+    spdk_subsystem_init_from_json_config(FLAGS_manusya_spdk_config.c_str(),
+                                         FLAGS_manusya_spdk_rpc_addr.c_str(),
+                                         [](int rc, void* arg) {
+                                             on_done(arg, rc);
+                                         },
+                                         wrap(Callback(init_done)),
+                                         true);
+}
+
+void SpdkStore::load_blobs(Callback cb) {
+    _io_unit_size = spdk_bs_get_io_unit_size(_bs);
+    _cluster_size = spdk_bs_get_cluster_size(_bs);
+    _channel = spdk_bs_alloc_io_channel(_bs);
+    if (_channel == nullptr) {
+        cb(-ENOMEM);
+        return;
+    }
+
+    // the iterator closes the previous blob, so only the name and size are kept
+    auto next = std::make_shared<HandleCallback>();
+    *next = [this, cb, next](spdk_blob* blob, int rc) {
+        if (rc == -ENOENT) {
+            *next = nullptr;
+            cb(0);
+            return;
+        }
+        if (rc != 0) {
+            *next = nullptr;
+            cb(rc);
+            return;
+        }
+        const void* value = nullptr;
+        size_t len = 0;
+        if (spdk_blob_get_xattr_value(blob, kNameXattr, &value, &len) == 0) {
+            auto b = std::make_shared<SpdkBlob>();
+            b->name.assign(static_cast<const char*>(value), len);
+            b->id = spdk_blob_get_id(blob);
+            if (spdk_blob_get_xattr_value(blob, kSizeXattr, &value, &len) == 0 && len == sizeof(uint64_t)) {
+                memcpy(&b->size, value, sizeof(uint64_t));
+            }
+            _blobs[b->name] = b;
+        }
+        spdk_bs_iter_next(_bs, blob, on_handle, wrap(HandleCallback(*next)));
+    };
+    spdk_bs_iter_first(_bs, on_handle, wrap(HandleCallback(*next)));
+}
+
+void SpdkStore::shutdown(std::function<void()> cb) {
+    auto fini = [cb]() {
+        spdk_subsystem_fini(
+            [](void* arg) {
+                std::unique_ptr<std::function<void()>> cb(static_cast<std::function<void()>*>(arg));
+                (*cb)();
+            },
+            new std::function<void()>(cb));
+    };
+    if (_bs == nullptr) {
+        fini();
+        return;
+    }
+
+    // close all blobs, then unload the blobstore
+    auto remaining = std::make_shared<size_t>(1);
+    auto unload = std::make_shared<Callback>();
+    *unload = [this, remaining, fini, unload](int /*rc*/) {
+        if (--*remaining > 0) {
+            return;
+        }
+        *unload = nullptr;
+        if (_channel != nullptr) {
+            spdk_bs_free_io_channel(_channel);
+            _channel = nullptr;
+        }
+        spdk_bs_unload(_bs, on_done, wrap(Callback([this, fini](int rc) {
+                           if (rc != 0) {
+                               PLOG_ERROR(("desc", "failed to unload blobstore")("rc", rc));
+                           }
+                           _bs = nullptr;
+                           fini();
+                       })));
+    };
+    for (auto& [name, blob] : _blobs) {
+        if (blob->blob == nullptr) {
+            continue;
+        }
+        ++*remaining;
+        auto b = blob->blob;
+        blob->blob = nullptr;
+        spdk_blob_close(b, on_done, wrap(Callback(*unload)));
+    }
+    _blobs.clear();
+    auto done = *unload;
+    done(0);
+}
+
+void SpdkStore::ensure_open(SpdkBlobPtr blob, Callback cb) {
+    if (blob->blob != nullptr) {
+        cb(0);
+        return;
+    }
+    blob->open_waiters.push_back(std::move(cb));
+    if (blob->opening) {
+        return;
+    }
+    blob->opening = true;
+    spdk_bs_open_blob(_bs, blob->id, on_handle, wrap(HandleCallback([blob](spdk_blob* b, int rc) {
+                          blob->opening = false;
+                          if (rc == 0) {
+                              blob->blob = b;
+                          }
+                          auto waiters = std::move(blob->open_waiters);
+                          for (auto& waiter : waiters) {
+                              waiter(rc);
+                          }
+                      })));
+}
+
+void SpdkStore::create_blob(SpdkBlobPtr blob) {
+    // blob is in _blobs already, concurrent opens wait for the creation
+    blob->opening = true;
+    auto fail = [this, blob](int rc) {
+        blob->opening = false;
+        if (_blobs[blob->name] == blob) {
+            _blobs.erase(blob->name);
+        }
+        auto waiters = std::move(blob->open_waiters);
+        for (auto& waiter : waiters) {
+            waiter(rc);
+        }
+    };
+
+    spdk_blob_opts opts;
+    spdk_blob_opts_init(&opts, sizeof(opts));
+    opts.num_clusters = 0;
+    spdk_bs_create_blob_ext(_bs, &opts, on_id, wrap(IdCallback([this, blob, fail](spdk_blob_id id, int rc) {
+                                if (rc != 0) {
+                                    fail(rc);
+                                    return;
+                                }
+                                blob->id = id;
+                                spdk_bs_open_blob(
+                                    _bs, id, on_handle, wrap(HandleCallback([blob, fail](spdk_blob* b, int rc) {
+                                        if (rc != 0) {
+                                            fail(rc);
+                                            return;
+                                        }
+                                        spdk_blob_set_xattr(b, kNameXattr, blob->name.data(), blob->name.size());
+                                        spdk_blob_set_xattr(b, kSizeXattr, &blob->size, sizeof(uint64_t));
+                                        spdk_blob_sync_md(b, on_done, wrap(Callback([blob, b, fail](int rc) {
+                                                              if (rc != 0) {
+                                                                  fail(rc);
+                                                                  return;
+                                                              }
+                                                              blob->opening = false;
+                                                              blob->blob = b;
+                                                              auto waiters = std::move(blob->open_waiters);
+                                                              for (auto& waiter : waiters) {
+                                                                  waiter(0);
+                                                              }
+                                                          })));
+                                    })));
+                            })));
+}
+
+void SpdkStore::sync_size(SpdkBlobPtr blob) {
+    // the size is persisted lazily, syncs issued while another one is running are merged
+    if (blob->md_syncing) {
+        blob->md_dirty = true;
+        return;
+    }
+    if (blob->blob == nullptr || blob->removed) {
+        return;
+    }
+    blob->md_syncing = true;
+    spdk_blob_set_xattr(blob->blob, kSizeXattr, &blob->size, sizeof(uint64_t));
+    spdk_blob_sync_md(blob->blob, on_done, wrap(Callback([this, blob](int rc) {
+                          blob->md_syncing = false;
+                          if (rc != 0) {
+                              PLOG_ERROR(("desc", "failed to sync blob size")("name", blob->name)("rc", rc));
+                          }
+                          if (blob->md_dirty) {
+                              blob->md_dirty = false;
+                              sync_size(blob);
+                          }
+                      })));
+}
+
+Future<Status> SpdkStore::open(const char* path, int flags, FileHandlePtr* fh) {
+    if (path == nullptr) {
+        return make_ready_future(Status(EINVAL, "path is nullptr"));
+    }
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (!_init_status.ok()) {
+        return make_ready_future(Status(_init_status.error_code(), _init_status.error_str()));
+    }
+
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([this, name = std::string(path), flags, fh, promise]() {
+        auto done = [this, flags, fh, promise](SpdkBlobPtr blob, int rc) {
+            if (rc != 0) {
+                promise->set_value(Status(-rc, "failed to open file"));
+                return;
+            }
+            if ((flags & O_TRUNC) != 0 && blob->size != 0) {
+                blob->size = 0;
+                sync_size(blob);
+            }
+            *fh = FileHandlePtr(new SpdkFileHandle(blob, this));
+            promise->set_value(Status::OK());
+        };
+
+        auto it = _blobs.find(name);
+        if (it != _blobs.end()) {
+            if ((flags & O_CREAT) != 0 && (flags & O_EXCL) != 0) {
+                promise->set_value(Status(EEXIST, "failed to open file"));
+                return;
+            }
+            auto blob = it->second;
+            ensure_open(blob, [blob, done](int rc) {
+                done(blob, rc);
+            });
+            return;
+        }
+        if ((flags & O_CREAT) == 0) {
+            promise->set_value(Status(ENOENT, "failed to open file"));
+            return;
+        }
+        auto blob = std::make_shared<SpdkBlob>();
+        blob->name = name;
+        _blobs[name] = blob;
+        blob->open_waiters.push_back([blob, done](int rc) {
+            done(blob, rc);
+        });
+        create_blob(blob);
+    });
+    return future;
+}
+
+void SpdkStore::run_append(SpdkBlobPtr blob) {
+    if (!blob->appends.empty()) {
+        blob->appends.front()();
+    }
+}
+
+Future<Status> SpdkStore::append(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (buf.empty()) {
+        return make_ready_future(Status::OK());
+    }
+
+    auto blob = fh->as<SpdkFileHandle>()->blob();
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([this, blob, offset, buf, promise]() {
+        blob->appends.push_back([this, blob, offset, buf, promise]() {
+            do_append(blob, offset, buf, [this, blob, promise](int rc) {
+                promise->set_value(to_status(rc, "failed to write to file"));
+                blob->appends.pop_front();
+                run_append(blob);
+            });
+        });
+        if (blob->appends.size() == 1) {
+            run_append(blob);
+        }
+    });
+    return future;
+}
+
+void SpdkStore::resize(SpdkBlobPtr blob, uint64_t end, Callback cb) {
+    auto clusters = (end + _cluster_size - 1) / _cluster_size;
+    if (clusters <= spdk_blob_get_num_clusters(blob->blob)) {
+        cb(0);
+        return;
+    }
+    // grow by at least one eighth to amortize the metadata syncs of a growing chunk
+    clusters = std::max(clusters, spdk_blob_get_num_clusters(blob->blob) * 9 / 8);
+    spdk_blob_resize(blob->blob, clusters, on_done, wrap(Callback([blob, cb](int rc) {
+                         if (rc != 0) {
+                             cb(rc);
+                             return;
+                         }
+                         spdk_blob_sync_md(blob->blob, on_done, wrap(Callback(cb)));
+                     })));
+}
+
+void SpdkStore::do_append(SpdkBlobPtr blob, uint64_t offset, IOBuf buf, Callback cb) {
+    if (blob->removed || blob->blob == nullptr) {
+        cb(-ENOENT);
+        return;
+    }
+    if (spdk_blob_is_read_only(blob->blob)) {
+        cb(-EPERM);
+        return;
+    }
+
+    auto unit = _io_unit_size;
+    auto size = buf.size();
+    auto end = offset + size;
+    auto start = offset / unit * unit;
+    auto aligned_end = (end + unit - 1) / unit * unit;
+    auto aligned_size = aligned_end - start;
+    auto tail = aligned_end - unit;
+
+    resize(blob, aligned_end, [=, this](int rc) {
+        if (rc != 0) {
+            cb(rc);
+            return;
+        }
+        auto* payload = static_cast<char*>(spdk_dma_zmalloc(aligned_size, unit, nullptr));
+        if (payload == nullptr) {
+            cb(-ENOMEM);
+            return;
+        }
+
+        auto write = [=, this](int rc) {
+            if (rc != 0) {
+                spdk_dma_free(payload);
+                cb(rc);
+                return;
+            }
+            buf.copy_to(payload + (offset - start), size);
+            spdk_blob_io_write(blob->blob,
+                               _channel,
+                               payload,
+                               start / unit,
+                               aligned_size / unit,
+                               on_done,
+                               wrap(Callback([=, this](int rc) {
+                                   spdk_dma_free(payload);
+                                   if (rc == 0 && end > blob->size) {
+                                       blob->size = end;
+                                       sync_size(blob);
+                                   }
+                                   cb(rc);
+                               })));
+        };
+
+        // partial head and tail units keep the bytes written before, which may be behind
+        // the appended range when appends complete out of order
+        bool read_head = start != offset && start < blob->size;
+        bool read_tail = end != aligned_end && tail < blob->size && (tail != start || !read_head);
+        auto read_tail_then_write = [=, this](int rc) {
+            if (rc != 0 || !read_tail) {
+                write(rc);
+                return;
+            }
+            spdk_blob_io_read(
+                blob->blob, _channel, payload + (tail - start), tail / unit, 1, on_done, wrap(Callback(write)));
+        };
+        if (read_head) {
+            spdk_blob_io_read(
+                blob->blob, _channel, payload, start / unit, 1, on_done, wrap(Callback(read_tail_then_write)));
+        } else {
+            read_tail_then_write(0);
+        }
+    });
+}
+
+Future<Status> SpdkStore::read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (buf == nullptr) {
+        return make_ready_future(Status(EINVAL, "buf is nullptr"));
+    }
+    if (size == 0) {
+        buf->clear();
+        return make_ready_future(Status::OK());
+    }
+
+    auto blob = fh->as<SpdkFileHandle>()->blob();
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([this, blob, offset, size, buf, promise]() {
+        if (blob->removed || blob->blob == nullptr) {
+            promise->set_value(Status(ENOENT, "failed to read from file"));
+            return;
+        }
+        if (offset > blob->size || size > blob->size - offset) {
+            promise->set_value(Status(EINVAL, "invalid size"));
+            return;
+        }
+        auto unit = _io_unit_size;
+        auto start = offset / unit * unit;
+        auto aligned_end = (offset + size + unit - 1) / unit * unit;
+        auto aligned_size = aligned_end - start;
+        auto* payload = static_cast<char*>(spdk_dma_malloc(aligned_size, unit, nullptr));
+        if (payload == nullptr) {
+            promise->set_value(Status(ENOMEM, "failed to allocate dma buffer"));
+            return;
+        }
+        spdk_blob_io_read(blob->blob,
+                          _channel,
+                          payload,
+                          start / unit,
+                          aligned_size / unit,
+                          on_done,
+                          wrap(Callback([=](int rc) {
+                              if (rc != 0) {
+                                  spdk_dma_free(payload);
+                                  promise->set_value(Status(-rc, "failed to read from file"));
+                                  return;
+                              }
+                              // hand the dma buffer over to the IOBuf without copy
+                              IOBuf iobuf;
+                              iobuf.append_user_data(payload, aligned_size, spdk_dma_free);
+                              iobuf.pop_front(offset - start);
+                              iobuf.pop_back(aligned_end - offset - size);
+                              buf->swap(iobuf);
+                              promise->set_value(Status::OK());
+                          })));
+    });
+    return future;
+}
+
+Future<Status> SpdkStore::seal(FileHandlePtr fh) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+
+    auto blob = fh->as<SpdkFileHandle>()->blob();
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([blob, promise]() {
+        if (blob->removed || blob->blob == nullptr) {
+            promise->set_value(Status(ENOENT, "failed to seal file"));
+            return;
+        }
+        spdk_blob_set_xattr(blob->blob, kSizeXattr, &blob->size, sizeof(uint64_t));
+        int rc = spdk_blob_set_read_only(blob->blob);
+        if (rc != 0) {
+            promise->set_value(Status(-rc, "failed to seal file"));
+            return;
+        }
+        spdk_blob_sync_md(blob->blob, on_done, wrap(Callback([promise](int rc) {
+                              promise->set_value(to_status(rc, "failed to seal file"));
+                          })));
+    });
+    return future;
+}
+
+Future<Status> SpdkStore::size(FileHandlePtr fh, uint64_t* size) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (size == nullptr) {
+        return make_ready_future(Status(EINVAL, "size is nullptr"));
+    }
+
+    auto blob = fh->as<SpdkFileHandle>()->blob();
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([blob, size, promise]() {
+        *size = blob->size;
+        promise->set_value(Status::OK());
+    });
+    return future;
+}
+
+Future<Status> SpdkStore::remove(const char* path) {
+    if (path == nullptr) {
+        return make_ready_future(Status(EINVAL, "path is nullptr"));
+    }
+    if (!_init_status.ok()) {
+        return make_ready_future(Status(_init_status.error_code(), _init_status.error_str()));
+    }
+
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([this, name = std::string(path), promise]() {
+        auto it = _blobs.find(name);
+        if (it == _blobs.end()) {
+            promise->set_value(Status(ENOENT, "failed to unlink"));
+            return;
+        }
+        auto blob = it->second;
+        _blobs.erase(it);
+        blob->removed = true;
+        auto remove = [this, blob, promise](int rc) {
+            if (rc != 0) {
+                promise->set_value(Status(-rc, "failed to unlink"));
+                return;
+            }
+            spdk_bs_delete_blob(_bs, blob->id, on_done, wrap(Callback([promise](int rc) {
+                                    promise->set_value(to_status(rc, "failed to unlink"));
+                                })));
+        };
+        ensure_open(blob, [blob, remove](int rc) {
+            if (rc != 0 || blob->blob == nullptr) {
+                remove(rc);
+                return;
+            }
+            auto b = blob->blob;
+            blob->blob = nullptr;
+            spdk_blob_close(b, on_done, wrap(Callback(remove)));
+        });
+    });
+    return future;
+}
+
+Future<Status> SpdkStore::set_attr(FileHandlePtr fh, const char* key, const char* value) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (key == nullptr) {
+        return make_ready_future(Status(EINVAL, "key is nullptr"));
+    }
+    if (value == nullptr) {
+        return make_ready_future(Status(EINVAL, "value is nullptr"));
+    }
+
+    auto blob = fh->as<SpdkFileHandle>()->blob();
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([blob, name = kUserXattrPrefix + std::string(key), value = std::string(value), promise]() {
+        if (blob->removed || blob->blob == nullptr) {
+            promise->set_value(Status(ENOENT, "failed to set xattr"));
+            return;
+        }
+        int rc = spdk_blob_set_xattr(blob->blob, name.c_str(), value.data(), value.size());
+        if (rc != 0) {
+            promise->set_value(Status(-rc, "failed to set xattr"));
+            return;
+        }
+        spdk_blob_sync_md(blob->blob, on_done, wrap(Callback([promise](int rc) {
+                              promise->set_value(to_status(rc, "failed to set xattr"));
+                          })));
+    });
+    return future;
+}
+
+Future<Status> SpdkStore::get_attr(FileHandlePtr fh, const char* key, std::string* value) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (key == nullptr) {
+        return make_ready_future(Status(EINVAL, "key is nullptr"));
+    }
+    if (value == nullptr) {
+        return make_ready_future(Status(EINVAL, "value is nullptr"));
+    }
+
+    auto blob = fh->as<SpdkFileHandle>()->blob();
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([blob, name = kUserXattrPrefix + std::string(key), value, promise]() {
+        if (blob->removed || blob->blob == nullptr) {
+            promise->set_value(Status(ENOENT, "failed to get xattr"));
+            return;
+        }
+        const void* v = nullptr;
+        size_t len = 0;
+        if (spdk_blob_get_xattr_value(blob->blob, name.c_str(), &v, &len) != 0) {
+            promise->set_value(Status(ENODATA, "failed to get xattr"));
+            return;
+        }
+        value->assign(static_cast<const char*>(v), len);
+        promise->set_value(Status::OK());
+    });
+    return future;
+}
+
+Future<Status> SpdkStore::list_attrs(FileHandlePtr fh, std::map<std::string, std::string>* attrs) {
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (attrs == nullptr) {
+        return make_ready_future(Status(EINVAL, "attrs is nullptr"));
+    }
+
+    auto blob = fh->as<SpdkFileHandle>()->blob();
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([blob, attrs, promise]() {
+        if (blob->removed || blob->blob == nullptr) {
+            promise->set_value(Status(ENOENT, "failed to list xattrs"));
+            return;
+        }
+        spdk_xattr_names* names = nullptr;
+        int rc = spdk_blob_get_xattr_names(blob->blob, &names);
+        if (rc != 0) {
+            promise->set_value(Status(-rc, "failed to list xattrs"));
+            return;
+        }
+        auto prefix_len = strlen(kUserXattrPrefix);
+        for (uint32_t i = 0; i < spdk_xattr_names_get_count(names); i++) {
+            const char* name = spdk_xattr_names_get_name(names, i);
+            if (strncmp(name, kUserXattrPrefix, prefix_len) != 0) {
+                continue;
+            }
+            const void* v = nullptr;
+            size_t len = 0;
+            if (spdk_blob_get_xattr_value(blob->blob, name, &v, &len) == 0) {
+                (*attrs)[name + prefix_len] = std::string(static_cast<const char*>(v), len);
+            }
+        }
+        spdk_xattr_names_free(names);
+        promise->set_value(Status::OK());
+    });
+    return future;
+}
+
+void SpdkStore::for_each(std::function<void(const char* path)> cb) {
+    if (!_init_status.ok()) {
+        return;
+    }
+    // collect names on the reactor, cb may call into the store and wait
+    std::vector<std::string> names;
+    auto promise = make_promise();
+    auto future = promise->get_future();
+    post([this, &names, promise]() {
+        for (const auto& [name, blob] : _blobs) {
+            names.push_back(name);
+        }
+        promise->set_value(Status::OK());
+    });
+    future.get();
+
+    for (const auto& name : names) {
+        try {
+            cb(name.c_str());
+        } catch (...) {
+            continue;
+        }
+    }
+}
+
+} // namespace pain::manusya
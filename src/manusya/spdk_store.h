@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include "manusya/store.h"
+
+struct spdk_thread;
+struct spdk_blob_store;
+struct spdk_io_channel;
+
+namespace pain::manusya {
+
+struct SpdkBlob;
+using SpdkBlobPtr = std::shared_ptr<SpdkBlob>;
+
+// SpdkStore maps each file to a blob of an SPDK blobstore on the given bdev, the bdevs are
+// created from the json config of --manusya_spdk_config, e.g. a malloc, aio or nvme bdev.
+// All blobstore operations run on a single polling reactor thread, requests are passed to it
+// through the lock-free message ring of spdk_thread and completions fulfill the futures.
+// Only one SpdkStore can be created in a process.
+class SpdkStore : public Store {
+public:
+    SpdkStore(const char* bdev_name);
+    ~SpdkStore() override;
+
+    Future<Status> open(const char* path, int flags, FileHandlePtr* fh) override;
+    Future<Status> append(FileHandlePtr fh, uint64_t offset, IOBuf buf) override;
+    Future<Status> read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) override;
+    Future<Status> seal(FileHandlePtr fh) override;
+    Future<Status> size(FileHandlePtr fh, uint64_t* size) override;
+    Future<Status> remove(const char* path) override;
+    Future<Status> set_attr(FileHandlePtr fh, const char* key, const char* value) override;
+    Future<Status> get_attr(FileHandlePtr fh, const char* key, std::string* value) override;
+    Future<Status> list_attrs(FileHandlePtr fh, std::map<std::string, std::string>* attrs) override;
+    void for_each(std::function<void(const char* path)> cb) override;
+
+    // status of bringing up the env, bdevs and blobstore
+    const Status& init_status() const {
+        return _init_status;
+    }
+
+private:
+    // called on the reactor thread, continuations receive a negative errno or 0
+    void run();
+    void post(std::function<void()> fn);
+    void load_blobstore(std::function<void(int)> cb);
+    void load_blobs(std::function<void(int)> cb);
+    void shutdown(std::function<void()> cb);
+    void create_blob(SpdkBlobPtr blob);
+    void ensure_open(SpdkBlobPtr blob, std::function<void(int)> cb);
+    void sync_size(SpdkBlobPtr blob);
+    void run_append(SpdkBlobPtr blob);
+    void do_append(SpdkBlobPtr blob, uint64_t offset, IOBuf buf, std::function<void(int)> cb);
+    void resize(SpdkBlobPtr blob, uint64_t end, std::function<void(int)> cb);
+
+    std::string _bdev_name;
+    Status _init_status;
+    std::thread _reactor;
+    bool _stopped = false;
+
+    // only accessed on the reactor thread
+    spdk_thread* _thread = nullptr;
+    spdk_blob_store* _bs = nullptr;
+    spdk_io_channel* _channel = nullptr;
+    uint64_t _io_unit_size = 0;
+    uint64_t _cluster_size = 0;
+    std::map<std::string, SpdkBlobPtr> _blobs;
+};
+
+} // namespace pain::manusya
@@ -1,19 +1,92 @@
 #include "manusya/store.h"
 
+#include <gflags/gflags.h>
+#include <cerrno>
 #include <format>
+#include <string>
+#include <tuple>
 #include <boost/assert.hpp>
 
+#include "manusya/file_handle.h"
 #include "manusya/local_store.h"
 #include "manusya/mem_store.h"
+#include "manusya/segment_store.h"
+#include "manusya/spdk_store.h"
+#include "manusya/uring_store.h"
+
+DEFINE_string(manusya_durability,
+              "none",
+              "Durability of local, uring and segment stores: none, sync_on_seal or group_commit");
+DEFINE_bool(manusya_catalog,
+            true,
+            "Keep metadata of local and uring stores in a catalog instead of xattrs and file modes");
+DEFINE_uint64(manusya_segment_size, 256 * 1024 * 1024, "Size of each segment file of the segment store");
+DEFINE_uint32(manusya_uring_queue_depth, 256, "Max number of in-flight I/Os of the uring store");
+DEFINE_uint32(manusya_uring_buffer_count, 64, "Number of registered buffers of the uring store");
+DEFINE_uint32(manusya_uring_buffer_size, 128 * 1024, "Size of each registered buffer of the uring store");
 
 namespace pain::manusya {
 
+namespace {
+bool parse_durability(const std::string& value, Durability* durability) {
+    if (value == "none") {
+        *durability = Durability::kNone;
+    } else if (value == "sync_on_seal") {
+        *durability = Durability::kSyncOnSeal;
+    } else if (value == "group_commit") {
+        *durability = Durability::kGroupCommit;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool validate_durability([[maybe_unused]] const char* flag, const std::string& value) {
+    Durability durability = Durability::kNone;
+    return parse_durability(value, &durability);
+}
+
+Durability durability() {
+    Durability durability = Durability::kNone;
+    auto valid = parse_durability(FLAGS_manusya_durability, &durability);
+    BOOST_ASSERT_MSG(valid, std::format("unknown durability: {}", FLAGS_manusya_durability).c_str());
+    std::ignore = valid;
+    return durability;
+}
+} // namespace
+
+// an unknown durability fails the flag parsing at startup
+DEFINE_validator(manusya_durability, validate_durability);
+
 StorePtr Store::create(const char* uri) {
     constexpr size_t local_prefix_len = 8;
     constexpr size_t memory_prefix_len = 9;
+    constexpr size_t uring_prefix_len = 8;
+    constexpr size_t spdk_prefix_len = 7;
+    constexpr size_t segment_prefix_len = 10;
     if (strncmp(uri, "local://", local_prefix_len) == 0) {
         const char* data_path = uri + local_prefix_len;
-        return StorePtr(new LocalStore(data_path));
+        return StorePtr(new LocalStore(data_path, durability(), FLAGS_manusya_catalog));
+    }
+
+    if (strncmp(uri, "uring://", uring_prefix_len) == 0) {
+        const char* data_path = uri + uring_prefix_len;
+        return StorePtr(new UringStore(data_path,
+                                       durability(),
+                                       FLAGS_manusya_uring_queue_depth,
+                                       FLAGS_manusya_uring_buffer_count,
+                                       FLAGS_manusya_uring_buffer_size,
+                                       FLAGS_manusya_catalog));
+    }
+
+    if (strncmp(uri, "segment://", segment_prefix_len) == 0) {
+        const char* data_path = uri + segment_prefix_len;
+        return StorePtr(new SegmentStore(data_path, durability(), FLAGS_manusya_segment_size));
+    }
+
+    if (strncmp(uri, "spdk://", spdk_prefix_len) == 0) {
+        const char* bdev_name = uri + spdk_prefix_len;
+        return StorePtr(new SpdkStore(bdev_name));
     }
 
     if (strncmp(uri, "memory://", memory_prefix_len) == 0) {
@@ -24,4 +97,49 @@ StorePtr Store::create(const char* uri) {
     return nullptr;
 }
 
+Future<Status> Store::set_checksums(const char* path, const std::string& checksums) {
+    FileHandlePtr fh;
+    auto status = open(checksum_path(path).c_str(), O_CREAT | O_RDWR, &fh).get();
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    IOBuf buf;
+    buf.append(checksums);
+    status = append(fh, 0, std::move(buf)).get();
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    return seal(fh);
+}
+
+Future<Status> Store::get_checksums(const char* path, std::string* checksums) {
+    FileHandlePtr fh;
+    auto status = open(checksum_path(path).c_str(), O_RDONLY, &fh).get();
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    uint64_t file_size = 0;
+    status = size(fh, &file_size).get();
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    IOBuf buf;
+    status = read(fh, 0, file_size, &buf).get();
+    if (!status.ok()) {
+        return make_ready_future(std::move(status));
+    }
+    *checksums = buf.to_string();
+    return make_ready_future(Status::OK());
+}
+
+Status fsync_dir(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return Status(errno, "failed to open directory");
+    }
+    auto status = ::fsync(fd) < 0 ? Status(errno, "failed to fsync directory") : Status::OK();
+    close(fd);
+    return status;
+}
+
 } // namespace pain::manusya
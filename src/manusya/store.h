@@ -3,7 +3,9 @@
 #include <pain/base/future.h>
 #include <pain/base/types.h>
 #include <unistd.h>
+#include <functional>
 #include <map>
+#include <string>
 #include <boost/intrusive_ptr.hpp>
 
 namespace pain::manusya {
@@ -19,10 +21,17 @@ public:
 
     // support:
     //   local:///path/to/dir
+    //   uring:///path/to/dir
+    //   segment:///path/to/dir
+    //   spdk://bdev_name
     //   memory://
     static StorePtr create(const char* uri);
     virtual Future<Status> open(const char* path, int flags, FileHandlePtr* fh) = 0;
     virtual Future<Status> append(FileHandlePtr fh, uint64_t offset, IOBuf buf) = 0;
+    // append bypassing the page cache, stores without such a mode append as usual
+    virtual Future<Status> append_direct(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
+        return append(fh, offset, std::move(buf));
+    }
     virtual Future<Status> read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) = 0;
     virtual Future<Status> seal(FileHandlePtr fh) = 0;
     virtual Future<Status> size(FileHandlePtr fh, uint64_t* size) = 0;
@@ -31,6 +40,14 @@ public:
     virtual Future<Status> get_attr(FileHandlePtr fh, const char* key, std::string* value) = 0;
     virtual Future<Status> list_attrs(FileHandlePtr fh, std::map<std::string, std::string>* attrs) = 0;
     virtual void for_each(std::function<void(const char* path)> cb) = 0;
+    // checksums of a file, kept in a sidecar file named by checksum_path by default and in
+    // the metadata of stores which have a catalog
+    virtual Future<Status> set_checksums(const char* path, const std::string& checksums);
+    virtual Future<Status> get_checksums(const char* path, std::string* checksums);
+
+    static std::string checksum_path(const char* path) {
+        return std::string(path) + ".crc";
+    }
 
     int use_count() const {
         return _use_count;
@@ -49,4 +66,7 @@ private:
 
     std::atomic<int> _use_count = 0;
 };
+
+// syncs the entries of a directory, so that files created in it survive a crash
+Status fsync_dir(const std::string& path);
 } // namespace pain::manusya
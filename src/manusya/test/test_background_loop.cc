@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "manusya/background_loop.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain::manusya;
+
+void wait_until(const std::function<bool()>& cond, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!cond() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(TestBackgroundLoop, RunsEveryInterval) {
+    std::atomic<int> passes = 0;
+    BackgroundLoop loop(
+        "test loop",
+        [&]() {
+            passes++;
+        },
+        []() {
+            return 1000;
+        });
+    ASSERT_TRUE(loop.start().ok());
+    ASSERT_EQ(loop.start().error_code(), EEXIST);
+    wait_until([&]() { return passes >= 3; }, std::chrono::seconds(5));
+    ASSERT_GE(passes, 3);
+    loop.stop();
+    ASSERT_TRUE(loop.stopped());
+
+    // 停止后不再运行，可以重新启动
+    auto stopped_at = passes.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(passes, stopped_at);
+    ASSERT_TRUE(loop.start().ok());
+    wait_until([&]() { return passes > stopped_at; }, std::chrono::seconds(5));
+    ASSERT_GT(passes, stopped_at);
+}
+
+TEST(TestBackgroundLoop, StopCutsWaitsShort) {
+    // 间隔和运行中的等待都被 stop 打断
+    std::atomic<bool> waited = false;
+    BackgroundLoop* self = nullptr;
+    BackgroundLoop loop(
+        "test loop",
+        [&]() {
+            waited = !self->wait_for(3600 * 1000 * 1000UL);
+        },
+        []() {
+            return 3600 * 1000 * 1000UL;
+        });
+    self = &loop;
+    ASSERT_TRUE(loop.start().ok());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto begin = std::chrono::steady_clock::now();
+    loop.stop();
+    ASSERT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+    ASSERT_TRUE(waited);
+    ASSERT_FALSE(loop.wait_for(0));
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
@@ -174,11 +174,105 @@ TEST_F(TestBank, ListChunkWithStartUUID) {
     ASSERT_EQ(listed_chunk_ids[0].str(), created_chunk_ids[1].str()) << "First listed UUID should match start UUID";
 }
 
+TEST_F(TestBank, ListChunkPagination) {
+    std::vector<ObjectId> created_chunk_ids;
+    for (int i = 0; i < 200; ++i) {
+        ChunkPtr chunk;
+        auto status = _bank->create_chunk({}, i % 3, &chunk);
+        ASSERT_TRUE(status.ok());
+        created_chunk_ids.push_back(chunk->chunk_id());
+    }
+    std::sort(created_chunk_ids.begin(), created_chunk_ids.end());
+
+    // 分散在多个分片中的 chunk 按 ObjectId 有序分页返回
+    std::vector<ObjectId> listed_chunk_ids;
+    ObjectId start;
+    while (true) {
+        std::vector<ObjectId> page;
+        _bank->list_chunk(start, 7, [&page](ObjectId chunk_id) {
+            page.push_back(chunk_id);
+        });
+        // 下一页从上一页最后一个开始，跳过重复的起点
+        if (!listed_chunk_ids.empty() && !page.empty() && page.front() == listed_chunk_ids.back()) {
+            page.erase(page.begin());
+        }
+        if (page.empty()) {
+            break;
+        }
+        listed_chunk_ids.insert(listed_chunk_ids.end(), page.begin(), page.end());
+        start = listed_chunk_ids.back();
+    }
+    ASSERT_EQ(listed_chunk_ids, created_chunk_ids);
+}
+
+TEST_F(TestBank, ForEachChunk) {
+    std::vector<ObjectId> created_chunk_ids;
+    for (int i = 0; i < 2500; ++i) {
+        ChunkPtr chunk;
+        auto status = _bank->create_chunk({}, i % 3, &chunk);
+        ASSERT_TRUE(status.ok());
+        created_chunk_ids.push_back(chunk->chunk_id());
+    }
+    std::sort(created_chunk_ids.begin(), created_chunk_ids.end());
+
+    // 跨多页遍历，每个 chunk 按序访问一次
+    std::vector<ObjectId> visited;
+    _bank->for_each_chunk([&visited](const ObjectId& chunk_id) {
+        visited.push_back(chunk_id);
+        return true;
+    });
+    ASSERT_EQ(visited, created_chunk_ids);
+
+    // 回调返回 false 时停止遍历
+    visited.clear();
+    _bank->for_each_chunk([&visited](const ObjectId& chunk_id) {
+        visited.push_back(chunk_id);
+        return visited.size() < 1500;
+    });
+    ASSERT_EQ(visited.size(), 1500);
+}
+
 TEST_F(TestBank, LoadEmptyStore) {
     auto status = _bank->load();
     ASSERT_TRUE(status.ok()) << "Load should succeed even with empty store";
 }
 
+TEST_F(TestBank, LoadRecoversChunks) {
+    ChunkPtr sealed;
+    ChunkPtr open;
+    ASSERT_TRUE(_bank->create_chunk({}, 0, &sealed).ok());
+    ASSERT_TRUE(_bank->create_chunk({}, 0, &open).ok());
+    IOBuf data;
+    data.append(std::string(5000, 'a'));
+    ASSERT_TRUE(sealed->append(data, 0).ok());
+    ASSERT_TRUE(open->append(data, 0).ok());
+    uint64_t length = 0;
+    ASSERT_TRUE(sealed->query_and_seal(&length).ok());
+
+    // 新的 bank 只登记 chunk，不打开文件
+    Bank bank(_store);
+    ASSERT_TRUE(bank.load().ok());
+    std::vector<ObjectId> listed_chunk_ids;
+    bank.list_chunk(ObjectId(), 10, [&listed_chunk_ids](ObjectId chunk_id) {
+        listed_chunk_ids.push_back(chunk_id);
+    });
+    ASSERT_EQ(listed_chunk_ids.size(), 2);
+
+    // 首次访问时打开，加载的 chunk 都是 sealed
+    for (const auto& id : {sealed->chunk_id(), open->chunk_id()}) {
+        ChunkPtr chunk;
+        auto status = bank.get_chunk(id, &chunk);
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        ASSERT_EQ(chunk->state(), ChunkState::kSealed);
+        ASSERT_EQ(chunk->size(), 5000);
+        IOBuf buf;
+        status = chunk->read(4000, 1000, &buf);
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        ASSERT_EQ(buf.to_string(), std::string(1000, 'a'));
+        ASSERT_EQ(chunk->append(data, 5000).error_code(), EPERM);
+    }
+}
+
 TEST_F(TestBank, ConcurrentOperations) {
     ChunkOptions options;
     const int num_threads = 10;
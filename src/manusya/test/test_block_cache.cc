@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "include/pain/base/object_id.h"
+#include "common/crc32c.h"
+#include "manusya/block_cache.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestBlockCache : public ::testing::Test {
+protected:
+    // 生成一个大小为 size 的块
+    IOBuf make_block(uint64_t size, char c) {
+        IOBuf buf;
+        buf.append(std::string(size, c));
+        return buf;
+    }
+
+    bool cached(BlockCache* cache, const ObjectId& chunk_id, uint64_t index) {
+        IOBuf data;
+        uint32_t crc = 0;
+        return cache->lookup(chunk_id, index, &data, &crc);
+    }
+};
+
+TEST_F(TestBlockCache, InsertAndLookup) {
+    BlockCache cache(1024 * 1024);
+    auto chunk_id = ObjectId::generate(0);
+    auto block = make_block(100, 'x');
+    cache.insert(chunk_id, 3, block, common::crc32c(block));
+
+    IOBuf data;
+    uint32_t crc = 0;
+    ASSERT_TRUE(cache.lookup(chunk_id, 3, &data, &crc));
+    ASSERT_EQ(data.to_string(), std::string(100, 'x'));
+    ASSERT_EQ(crc, common::crc32c(block));
+    ASSERT_FALSE(cache.lookup(chunk_id, 2, &data, &crc));
+    ASSERT_FALSE(cache.lookup(ObjectId::generate(0), 3, &data, &crc));
+    ASSERT_EQ(cache.size(), 100);
+}
+
+TEST_F(TestBlockCache, ReplaceBlockOfOtherSize) {
+    BlockCache cache(1024 * 1024);
+    auto chunk_id = ObjectId::generate(0);
+    cache.insert(chunk_id, 0, make_block(100, 'x'), 0);
+    // 同样大小的块不替换
+    cache.insert(chunk_id, 0, make_block(100, 'y'), 0);
+    IOBuf data;
+    uint32_t crc = 0;
+    ASSERT_TRUE(cache.lookup(chunk_id, 0, &data, &crc));
+    ASSERT_EQ(data.to_string(), std::string(100, 'x'));
+
+    auto block = make_block(300, 'z');
+    cache.insert(chunk_id, 0, block, common::crc32c(block));
+    data.clear();
+    ASSERT_TRUE(cache.lookup(chunk_id, 0, &data, &crc));
+    ASSERT_EQ(data.to_string(), std::string(300, 'z'));
+    ASSERT_EQ(crc, common::crc32c(block));
+    ASSERT_EQ(cache.size(), 300);
+}
+
+TEST_F(TestBlockCache, BoundedByCapacity) {
+    BlockCache cache(8 * BlockCache::kBlockSize, 2);
+    auto chunk_id = ObjectId::generate(0);
+    for (uint64_t i = 0; i < 100; i++) {
+        cache.insert(chunk_id, i, make_block(BlockCache::kBlockSize, 'a'), 0);
+        ASSERT_LE(cache.size(), cache.capacity());
+    }
+    ASSERT_GT(cache.size(), 0);
+}
+
+TEST_F(TestBlockCache, ScanResistant) {
+    BlockCache cache(16 * BlockCache::kBlockSize, 1);
+    auto hot_chunk = ObjectId::generate(0);
+    for (uint64_t i = 0; i < 8; i++) {
+        cache.insert(hot_chunk, i, make_block(BlockCache::kBlockSize, 'h'), 0);
+        ASSERT_TRUE(cached(&cache, hot_chunk, i));
+    }
+
+    // 只访问一次的顺序扫描不应挤掉反复访问的热块
+    auto scan_chunk = ObjectId::generate(0);
+    for (uint64_t i = 0; i < 200; i++) {
+        cache.insert(scan_chunk, i, make_block(BlockCache::kBlockSize, 's'), 0);
+        if (i % 4 == 0) {
+            for (uint64_t j = 0; j < 8; j++) {
+                ASSERT_TRUE(cached(&cache, hot_chunk, j)) << "block " << j << " evicted at " << i;
+            }
+        }
+    }
+    ASSERT_LE(cache.size(), cache.capacity());
+}
+
+TEST_F(TestBlockCache, MissedAgainComesBackHot) {
+    BlockCache cache(4 * BlockCache::kBlockSize, 1);
+    auto chunk_id = ObjectId::generate(0);
+    for (uint64_t i = 0; i < 5; i++) {
+        cache.insert(chunk_id, i, make_block(BlockCache::kBlockSize, 'a'), 0);
+    }
+    ASSERT_FALSE(cached(&cache, chunk_id, 0));
+
+    // 在测试期内再次缺失的块以热块身份重新进入
+    cache.insert(chunk_id, 0, make_block(BlockCache::kBlockSize, 'a'), 0);
+    auto other = ObjectId::generate(0);
+    for (uint64_t i = 0; i < 20; i++) {
+        cache.insert(other, i, make_block(BlockCache::kBlockSize, 'b'), 0);
+    }
+    ASSERT_TRUE(cached(&cache, chunk_id, 0));
+}
+
+TEST_F(TestBlockCache, EraseChunk) {
+    BlockCache cache(1024 * 1024);
+    auto chunk_id = ObjectId::generate(0);
+    for (uint64_t i = 0; i < 4; i++) {
+        cache.insert(chunk_id, i, make_block(BlockCache::kBlockSize, 'a'), 0);
+    }
+    cache.erase(chunk_id, 4 * BlockCache::kBlockSize);
+    ASSERT_EQ(cache.size(), 0);
+    for (uint64_t i = 0; i < 4; i++) {
+        ASSERT_FALSE(cached(&cache, chunk_id, i));
+    }
+}
+
+TEST_F(TestBlockCache, ConcurrentAccess) {
+    BlockCache cache(32 * BlockCache::kBlockSize);
+    auto chunk_id = ObjectId::generate(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&cache, &chunk_id, t, this]() {
+            for (uint64_t i = 0; i < 500; i++) {
+                auto index = (i * 7 + t) % 64;
+                IOBuf data;
+                uint32_t crc = 0;
+                if (!cache.lookup(chunk_id, index, &data, &crc)) {
+                    cache.insert(chunk_id, index, make_block(4096, static_cast<char>('a' + index % 26)), 0);
+                } else {
+                    ASSERT_EQ(data.to_string(), std::string(4096, static_cast<char>('a' + index % 26)));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_LE(cache.size(), cache.capacity());
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <map>
+#include <string>
+#include "manusya/catalog.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestCatalog : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _test_dir = std::filesystem::temp_directory_path() / "test_catalog";
+        std::filesystem::remove_all(_test_dir);
+        auto status = Catalog::open(_test_dir.c_str(), false, &_catalog);
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+
+    void TearDown() override {
+        _catalog.reset();
+        std::filesystem::remove_all(_test_dir);
+    }
+
+    std::filesystem::path _test_dir;
+    CatalogPtr _catalog;
+};
+
+TEST_F(TestCatalog, CreateAndSeal) {
+    ASSERT_TRUE(_catalog->empty());
+    ASSERT_TRUE(_catalog->create("file1").ok());
+    FileMeta meta;
+    ASSERT_TRUE(_catalog->get("file1", &meta).ok());
+    ASSERT_FALSE(meta.sealed);
+
+    ASSERT_TRUE(_catalog->seal("file1", 1234).ok());
+    // 已存在的文件再次 create 不会覆盖状态
+    ASSERT_TRUE(_catalog->create("file1").ok());
+    ASSERT_TRUE(_catalog->get("file1", &meta).ok());
+    ASSERT_TRUE(meta.sealed);
+    ASSERT_EQ(meta.size, 1234);
+
+    ASSERT_EQ(_catalog->get("file2", &meta).error_code(), ENOENT);
+}
+
+TEST_F(TestCatalog, Attributes) {
+    ASSERT_TRUE(_catalog->create("file1").ok());
+    ASSERT_TRUE(_catalog->create("file10").ok());
+    ASSERT_TRUE(_catalog->set_attr("file1", "k1", "v1").ok());
+    ASSERT_TRUE(_catalog->set_attr("file1", "k2", "v2").ok());
+    ASSERT_TRUE(_catalog->set_attr("file10", "k3", "v3").ok());
+
+    std::string value;
+    ASSERT_TRUE(_catalog->get_attr("file1", "k2", &value).ok());
+    ASSERT_EQ(value, "v2");
+    ASSERT_EQ(_catalog->get_attr("file1", "k3", &value).error_code(), ENODATA);
+
+    // 前缀相同的文件名之间属性互不可见
+    std::map<std::string, std::string> attrs;
+    ASSERT_TRUE(_catalog->list_attrs("file1", &attrs).ok());
+    ASSERT_EQ(attrs, (std::map<std::string, std::string>{{"k1", "v1"}, {"k2", "v2"}}));
+}
+
+TEST_F(TestCatalog, RemoveDropsEverything) {
+    ASSERT_TRUE(_catalog->create("file1").ok());
+    ASSERT_TRUE(_catalog->set_attr("file1", "k1", "v1").ok());
+    ASSERT_TRUE(_catalog->set_checksums("file1", "crcs").ok());
+    ASSERT_TRUE(_catalog->remove("file1").ok());
+
+    FileMeta meta;
+    ASSERT_EQ(_catalog->get("file1", &meta).error_code(), ENOENT);
+    std::string value;
+    ASSERT_EQ(_catalog->get_checksums("file1", &value).error_code(), ENOENT);
+    std::map<std::string, std::string> attrs;
+    ASSERT_TRUE(_catalog->list_attrs("file1", &attrs).ok());
+    ASSERT_TRUE(attrs.empty());
+}
+
+TEST_F(TestCatalog, Reload) {
+    ASSERT_TRUE(_catalog->create("file1").ok());
+    ASSERT_TRUE(_catalog->create("file2").ok());
+    ASSERT_TRUE(_catalog->seal("file2", 100).ok());
+    ASSERT_TRUE(_catalog->set_checksums("file2", "crcs").ok());
+    _catalog.reset();
+
+    // 重新打开后从 kv 中恢复全部元数据
+    auto status = Catalog::open(_test_dir.c_str(), false, &_catalog);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    std::map<std::string, FileMeta> files;
+    _catalog->for_each([&files](const std::string& name, const FileMeta& meta) {
+        files[name] = meta;
+    });
+    ASSERT_EQ(files.size(), 2);
+    ASSERT_FALSE(files["file1"].sealed);
+    ASSERT_TRUE(files["file2"].sealed);
+    ASSERT_EQ(files["file2"].size, 100);
+    std::string checksums;
+    ASSERT_TRUE(_catalog->get_checksums("file2", &checksums).ok());
+    ASSERT_EQ(checksums, "crcs");
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
@@ -1,13 +1,22 @@
 #include <gmock/gmock.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <algorithm>
 #include <future>
 #include <thread>
 #include <vector>
 #include "include/pain/base/object_id.h"
+#include "common/crc32c.h"
+#include "manusya/block_cache.h"
 #include "manusya/chunk.h"
+#include "manusya/io_scheduler.h"
 #include "manusya/mem_store.h"
 
+DECLARE_uint64(manusya_max_pending_append_bytes_per_chunk);
+DECLARE_uint64(manusya_max_pending_append_bytes);
+DECLARE_uint32(manusya_io_max_inflight);
+DECLARE_uint32(manusya_io_latency_reserved);
+
 // NOLINTBEGIN(readability-magic-numbers)
 namespace {
 using namespace pain;
@@ -107,6 +116,117 @@ TEST_F(TestChunk, BasicAppend) {
     ASSERT_EQ(chunk->size(), test_data.size());
 }
 
+TEST_F(TestChunk, DirectAppend) {
+    ChunkOptions options;
+    ChunkPtr chunk;
+
+    auto status = Chunk::create(options, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    // 不支持 direct io 的 store 按普通追加处理
+    AppendOptions append_options;
+    append_options.direct_io = true;
+    status = chunk->append(create_test_data("Hello, "), 0, append_options);
+    ASSERT_TRUE(status.ok()) << "Failed to append data: " << status.error_str();
+    status = chunk->append(create_test_data("World!"), 7, append_options);
+    ASSERT_TRUE(status.ok()) << "Failed to append data: " << status.error_str();
+
+    IOBuf buf;
+    status = chunk->read(0, chunk->size(), &buf);
+    ASSERT_TRUE(status.ok());
+    verify_iobuf_content(buf, "Hello, World!");
+}
+
+TEST_F(TestChunk, AppendChecksumMismatch) {
+    ChunkPtr chunk;
+    auto status = Chunk::create({}, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    // 客户端携带的校验和不匹配时拒绝写入
+    auto data = create_test_data("Hello, World!");
+    AppendOptions append_options;
+    append_options.crc32 = common::crc32c(data) + 1;
+    status = chunk->append(data, 0, append_options);
+    ASSERT_EQ(status.error_code(), EBADMSG);
+    ASSERT_EQ(chunk->size(), 0);
+
+    append_options.crc32 = common::crc32c(data);
+    status = chunk->append(data, 0, append_options);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(chunk->size(), data.size());
+}
+
+TEST_F(TestChunk, ReadReturnsChecksum) {
+    ChunkPtr chunk;
+    auto status = Chunk::create({}, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    // 非对齐的追加跨越多个校验块
+    std::string expected;
+    for (int i = 0; i < 20; i++) {
+        std::string data(1000 + i * 317, static_cast<char>('a' + i));
+        status = chunk->append(create_test_data(data), expected.size());
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        expected += data;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> ranges = {
+        {0, expected.size()}, {0, 4096}, {1, 4095}, {4095, 2}, {5000, 10000}, {expected.size() - 1, 1}, {100, 0}};
+    for (auto [offset, size] : ranges) {
+        IOBuf buf;
+        uint32_t crc = 0;
+        status = chunk->read(offset, size, &buf, &crc);
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        ASSERT_EQ(buf.to_string(), expected.substr(offset, size));
+        ASSERT_EQ(crc, common::crc32c(0, expected.data() + offset, size)) << offset << "@" << size;
+    }
+}
+
+TEST_F(TestChunk, ReadDetectsCorruption) {
+    ChunkPtr chunk;
+    auto status = Chunk::create({}, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    std::string data(10000, 'a');
+    status = chunk->append(create_test_data(data), 0);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    // 绕过 chunk 直接改写第二个校验块中的数据
+    FileHandlePtr fh;
+    status = _store->open(chunk->chunk_id().str().c_str(), O_RDWR, &fh).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    status = _store->append(fh, 5000, create_test_data("b")).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    IOBuf buf;
+    ASSERT_TRUE(chunk->read(0, 4096, &buf).ok());
+    ASSERT_EQ(chunk->read(0, 5000, &buf).error_code(), EIO);
+    ASSERT_EQ(chunk->read(8192, 100, &buf).error_code(), 0);
+}
+
+TEST_F(TestChunk, SealPersistsChecksums) {
+    ChunkPtr chunk;
+    auto status = Chunk::create({}, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    std::string data(5000, 'a');
+    status = chunk->append(create_test_data(data), 0);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    uint64_t length = 0;
+    status = chunk->query_and_seal(&length);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    // 一个完整块加一个尾块
+    std::string checksums;
+    status = _store->get_checksums(chunk->chunk_id().str().c_str(), &checksums).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(checksums.size(), 8);
+    uint32_t crcs[2];
+    memcpy(crcs, checksums.data(), sizeof(crcs));
+    ASSERT_EQ(crcs[0], common::crc32c(0, data.data(), 4096));
+    ASSERT_EQ(crcs[1], common::crc32c(0, data.data() + 4096, 904));
+}
+
 TEST_F(TestChunk, AppendMultipleTimes) {
     ChunkOptions options;
     ChunkPtr chunk;
@@ -724,6 +844,156 @@ TEST_F(TestChunk, AppendRequestOrdering) {
     ASSERT_EQ(chunk->size(), 18); // 最大偏移量 + 数据长度
 }
 
+TEST_F(TestChunk, PipelinedAppendsCommitInOrder) {
+    ChunkOptions options;
+    ChunkPtr chunk;
+
+    auto status = Chunk::create(options, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    // 逆序发起写入，后面的请求需要等待前面的空洞被填上
+    const int num_writes = 16;
+    std::vector<std::future<Status>> futures;
+    for (int i = num_writes - 1; i >= 0; --i) {
+        futures.emplace_back(std::async(std::launch::async, [chunk, i]() {
+            std::string data(4, static_cast<char>('a' + i));
+            IOBuf buf;
+            buf.append(data.c_str(), data.length());
+            return chunk->append(buf, i * 4);
+        }));
+    }
+
+    for (auto& future : futures) {
+        status = future.get();
+        ASSERT_TRUE(status.ok()) << "Pipelined append failed: " << status.error_str();
+    }
+    ASSERT_EQ(chunk->size(), num_writes * 4);
+
+    std::string expected;
+    for (int i = 0; i < num_writes; ++i) {
+        expected += std::string(4, static_cast<char>('a' + i));
+    }
+    IOBuf read_buf;
+    status = chunk->read(0, chunk->size(), &read_buf);
+    ASSERT_TRUE(status.ok()) << "Failed to read data: " << status.error_str();
+    verify_iobuf_content(read_buf, expected);
+}
+
+TEST_F(TestChunk, ParkedAppendsHoldNoIoSlot) {
+    gflags::FlagSaver saver;
+    FLAGS_manusya_io_max_inflight = 2;
+    FLAGS_manusya_io_latency_reserved = 0;
+
+    ChunkPtr chunk;
+    auto status = Chunk::create(ChunkOptions(), _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    // 乱序写入比调度槽位多，都在等待前面的空洞
+    const int num_parked = 8;
+    std::vector<std::future<Status>> futures;
+    for (int i = 1; i <= num_parked; ++i) {
+        futures.emplace_back(std::async(std::launch::async, [chunk, i]() {
+            IOBuf buf;
+            buf.append(std::string(4, static_cast<char>('a' + i)));
+            return chunk->append(buf, i * 4);
+        }));
+    }
+    while (chunk->pending_count() < num_parked) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(IoScheduler::instance().inflight(), 0);
+
+    // 填上空洞的写入不被阻塞
+    auto begin = std::chrono::steady_clock::now();
+    status = chunk->append(create_test_data("aaaa"), 0);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    for (auto& future : futures) {
+        status = future.get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+    ASSERT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+    ASSERT_EQ(chunk->size(), (num_parked + 1) * 4);
+    ASSERT_EQ(IoScheduler::instance().inflight(), 0);
+}
+
+TEST_F(TestChunk, SealFailsPendingAppends) {
+    ChunkOptions options;
+    ChunkPtr chunk;
+
+    auto status = Chunk::create(options, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    auto pending = std::async(std::launch::async, [chunk]() {
+        IOBuf buf;
+        buf.append("World");
+        return chunk->append(buf, 5);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint64_t length = 0;
+    status = chunk->query_and_seal(&length);
+    ASSERT_TRUE(status.ok()) << "Failed to seal chunk: " << status.error_str();
+    ASSERT_EQ(length, 0);
+
+    status = pending.get();
+    ASSERT_FALSE(status.ok());
+    ASSERT_EQ(status.error_code(), EPERM);
+}
+
+TEST_F(TestChunk, PendingAppendsOverChunkBudget) {
+    gflags::FlagSaver saver;
+    ChunkOptions options;
+    ChunkPtr chunk;
+
+    auto status = Chunk::create(options, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    FLAGS_manusya_max_pending_append_bytes_per_chunk = 8;
+
+    auto pending = std::async(std::launch::async, [chunk]() {
+        IOBuf buf;
+        buf.append("World");
+        return chunk->append(buf, 5);
+    });
+    while (chunk->pending_count() == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(chunk->pending_bytes(), 5);
+
+    // 超出单个chunk的预算，返回可重试的错误
+    auto over = create_test_data("Again");
+    status = chunk->append(over, 20);
+    ASSERT_FALSE(status.ok());
+    ASSERT_EQ(status.error_code(), EAGAIN);
+
+    // 填上空洞后等待的请求可以继续完成
+    auto head = create_test_data("Hello");
+    status = chunk->append(head, 0);
+    ASSERT_TRUE(status.ok()) << "Failed to append data: " << status.error_str();
+    status = pending.get();
+    ASSERT_TRUE(status.ok()) << "Failed to append pending data: " << status.error_str();
+    ASSERT_EQ(chunk->size(), 10);
+    ASSERT_EQ(chunk->pending_bytes(), 0);
+    ASSERT_EQ(chunk->pending_count(), 0);
+}
+
+TEST_F(TestChunk, PendingAppendsOverProcessBudget) {
+    gflags::FlagSaver saver;
+    ChunkOptions options;
+    ChunkPtr chunk;
+
+    auto status = Chunk::create(options, _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    FLAGS_manusya_max_pending_append_bytes = 0;
+
+    auto data = create_test_data("World");
+    status = chunk->append(data, 5);
+    ASSERT_FALSE(status.ok());
+    ASSERT_EQ(status.error_code(), EAGAIN);
+    ASSERT_EQ(chunk->pending_count(), 0);
+}
+
 TEST_F(TestChunk, ChunkOptionsAccess) {
     ChunkOptions options;
     ChunkPtr chunk;
@@ -732,5 +1002,65 @@ TEST_F(TestChunk, ChunkOptionsAccess) {
     ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
 }
 
+TEST_F(TestChunk, ReadSealedThroughBlockCache) {
+    ChunkPtr chunk;
+    auto status = Chunk::create(ChunkOptions(), _store, ObjectId::generate(0), &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    // 跨越多个缓存块且末尾不对齐
+    std::string content;
+    for (int i = 0; i < 150 * 1024; i++) {
+        content.push_back(static_cast<char>('a' + i % 26));
+    }
+    ASSERT_TRUE(chunk->append(create_test_data(content), 0).ok());
+    uint64_t length = 0;
+    ASSERT_TRUE(chunk->query_and_seal(&length).ok());
+
+    // 第二次读取命中缓存，结果与校验和保持一致
+    for (int round = 0; round < 2; round++) {
+        for (auto [offset, size] : std::vector<std::pair<uint64_t, uint64_t>>{
+                 {0, content.size()}, {100, 70000}, {65536, 65536}, {140000, content.size() - 140000}}) {
+            IOBuf buf;
+            uint32_t crc = 0;
+            status = chunk->read(offset, size, &buf, &crc);
+            ASSERT_TRUE(status.ok()) << status.error_str();
+            verify_iobuf_content(buf, content.substr(offset, size));
+            ASSERT_EQ(crc, common::crc32c(buf));
+        }
+    }
+
+    IOBuf buf;
+    ASSERT_EQ(chunk->read(content.size(), 1, &buf).error_code(), EINVAL);
+}
+
+TEST_F(TestChunk, ReadSealedIgnoresStalePartialBlock) {
+    ChunkPtr chunk;
+    auto chunk_id = ObjectId::generate(0);
+    auto status = Chunk::create(ChunkOptions(), _store, chunk_id, &chunk);
+    ASSERT_TRUE(status.ok()) << "Failed to create chunk: " << status.error_str();
+
+    std::string content(6000, 'x');
+    ASSERT_TRUE(chunk->append(create_test_data(content), 0).ok());
+    // 封存完成前读取不经过缓存
+    IOBuf buf;
+    ASSERT_TRUE(chunk->read(0, content.size(), &buf).ok());
+    verify_iobuf_content(buf, content);
+
+    // 模拟封存前缓存的不完整末尾块
+    IOBuf stale = create_test_data(std::string(100, 'y'));
+    BlockCache::instance().insert(chunk_id, 0, stale, common::crc32c(stale));
+
+    uint64_t length = 0;
+    ASSERT_TRUE(chunk->query_and_seal(&length).ok());
+    for (int round = 0; round < 2; round++) {
+        IOBuf data;
+        uint32_t crc = 0;
+        status = chunk->read(0, content.size(), &data, &crc);
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        verify_iobuf_content(data, content);
+        ASSERT_EQ(crc, common::crc32c(data));
+    }
+}
+
 } // namespace
 // NOLINTEND(readability-magic-numbers)
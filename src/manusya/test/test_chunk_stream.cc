@@ -0,0 +1,97 @@
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "include/pain/base/object_id.h"
+#include "manusya/chunk.h"
+#include "manusya/chunk_stream.h"
+#include "manusya/mem_store.h"
+
+DECLARE_uint64(manusya_chunk_stream_max_inflight_bytes);
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestChunkStream : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _store = Store::create("memory://");
+        ASSERT_TRUE(_store != nullptr);
+        ASSERT_TRUE(Chunk::create(ChunkOptions(), _store, ObjectId::generate(0), &_chunk).ok());
+    }
+
+    void TearDown() override {
+        _chunk.reset();
+        _store.reset();
+    }
+
+    // 模拟 brpc 投递一批消息
+    void deliver(ChunkStream* stream, const std::vector<std::string>& messages) {
+        std::vector<IOBuf> bufs(messages.size());
+        std::vector<IOBuf*> ptrs;
+        for (size_t i = 0; i < messages.size(); ++i) {
+            bufs[i].append(messages[i]);
+            ptrs.push_back(&bufs[i]);
+        }
+        ASSERT_EQ(stream->on_received_messages(1, ptrs.data(), ptrs.size()), 0);
+    }
+
+    std::string read_all() {
+        IOBuf buf;
+        EXPECT_TRUE(_chunk->read(0, _chunk->size(), &buf).ok());
+        return buf.to_string();
+    }
+
+    StorePtr _store;
+    ChunkPtr _chunk;
+};
+
+TEST_F(TestChunkStream, AppendInOrder) {
+    auto* stream = new ChunkStream(_chunk, 0, false);
+    deliver(stream, {"hello", " "});
+    deliver(stream, {"world"});
+    ASSERT_EQ(stream->offset(), 11);
+    // 关闭时等待所有追加完成，之后 stream 被释放
+    stream->on_closed(1);
+    ASSERT_EQ(_chunk->size(), 11);
+    ASSERT_EQ(read_all(), "hello world");
+}
+
+TEST_F(TestChunkStream, StartFromOffset) {
+    IOBuf buf;
+    buf.append("abc");
+    ASSERT_TRUE(_chunk->append(buf, 0).ok());
+    auto* stream = new ChunkStream(_chunk, 3, false);
+    deliver(stream, {"def"});
+    stream->on_closed(1);
+    ASSERT_EQ(read_all(), "abcdef");
+}
+
+TEST_F(TestChunkStream, BoundedInflightBytes) {
+    auto old = FLAGS_manusya_chunk_stream_max_inflight_bytes;
+    FLAGS_manusya_chunk_stream_max_inflight_bytes = 8;
+    auto* stream = new ChunkStream(_chunk, 0, false);
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        auto message = std::to_string(i) + ",";
+        expected += message;
+        deliver(stream, {message});
+    }
+    stream->on_closed(1);
+    ASSERT_EQ(read_all(), expected);
+    FLAGS_manusya_chunk_stream_max_inflight_bytes = old;
+}
+
+TEST_F(TestChunkStream, DropDataAfterFailure) {
+    uint64_t size = 0;
+    ASSERT_TRUE(_chunk->query_and_seal(&size).ok());
+    auto* stream = new ChunkStream(_chunk, 0, false);
+    deliver(stream, {"abc"});
+    stream->on_closed(1);
+    ASSERT_EQ(_chunk->size(), 0);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
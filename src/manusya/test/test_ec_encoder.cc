@@ -0,0 +1,360 @@
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include "common/erasure_code.h"
+#include "common/object_id_util.h"
+#include "manusya/bank.h"
+#include "manusya/ec_cluster.h"
+#include "manusya/ec_encoder.h"
+
+DECLARE_uint64(manusya_ec_cold_seconds);
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+// 内存中的集群：每个地址保存其上的分片，布局保存在 layouts 中
+class FakeEcCluster : public EcCluster {
+public:
+    Status list_targets(std::vector<std::string>* addresses) override {
+        *addresses = targets;
+        return Status::OK();
+    }
+
+    Status write_fragment(const std::string& address,
+                          uint32_t partition_id,
+                          const IOBuf& data,
+                          ObjectId* fragment_id) override {
+        *fragment_id = ObjectId::generate(partition_id);
+        fragments[address][*fragment_id] = data;
+        return Status::OK();
+    }
+
+    Status remove_fragment(const std::string& address, const ObjectId& fragment_id) override {
+        fragments[address].erase(fragment_id);
+        return Status::OK();
+    }
+
+    void read_fragment(const std::string& address,
+                       const ObjectId& fragment_id,
+                       uint64_t offset,
+                       uint32_t size,
+                       std::function<void(Status, IOBuf)> done) override {
+        auto it = fragments[address].find(fragment_id);
+        if (it == fragments[address].end()) {
+            done(Status(ENOENT, "fragment not found"), IOBuf());
+            return;
+        }
+        IOBuf data;
+        it->second.append_to(&data, size, offset);
+        done(Status::OK(), data);
+    }
+
+    Status get_layout(const ObjectId& chunk_id, proto::ChunkInfo* layout) override {
+        get_layout_count++;
+        for (auto& [id, l] : layouts) {
+            if (id == chunk_id) {
+                *layout = l;
+                return Status::OK();
+            }
+            for (auto& fragment : l.replicas()) {
+                if (ObjectId(id.partition_id(), common::from_proto(fragment.chunk_id())) == chunk_id) {
+                    *layout = l;
+                    return Status::OK();
+                }
+            }
+        }
+        return Status(ENOENT, "no layout");
+    }
+
+    Status commit_layout(const proto::ChunkInfo& layout, proto::ChunkInfo* committed) override {
+        auto chunk_id = common::from_proto(layout.chunk_id());
+        if (lose_race) {
+            // 模拟其他副本先提交了布局，它的分片是另一份拷贝
+            auto& winner = layouts[chunk_id];
+            winner = layout;
+            for (auto& fragment : *winner.mutable_replicas()) {
+                ObjectId id(chunk_id.partition_id(), common::from_proto(fragment.chunk_id()));
+                auto& on_target = fragments[fragment.location().uri()];
+                auto copy_id = ObjectId::generate(chunk_id.partition_id());
+                on_target[copy_id] = on_target[id];
+                common::to_proto(copy_id.uuid(), fragment.mutable_chunk_id());
+            }
+            *committed = winner;
+            return Status(EEXIST, "converted already");
+        }
+        if (commit_error != 0) {
+            // 提交结果未知：apply_commit 决定 deva 是否已经应用
+            if (apply_commit) {
+                layouts[chunk_id] = layout;
+            }
+            return Status(commit_error, "commit timed out");
+        }
+        layouts[chunk_id] = layout;
+        *committed = layout;
+        return Status::OK();
+    }
+
+    size_t fragment_count() const {
+        size_t count = 0;
+        for (auto& [_, f] : fragments) {
+            count += f.size();
+        }
+        return count;
+    }
+
+    std::vector<std::string> targets;
+    std::map<std::string, std::map<ObjectId, IOBuf>> fragments;
+    std::map<ObjectId, proto::ChunkInfo> layouts;
+    bool lose_race = false;
+    int commit_error = 0;
+    bool apply_commit = false;
+    int get_layout_count = 0;
+};
+
+class TestEcEncoder : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _saved_cold_seconds = FLAGS_manusya_ec_cold_seconds;
+        FLAGS_manusya_ec_cold_seconds = 0;
+        _store = Store::create("memory://");
+        ASSERT_TRUE(_store != nullptr);
+        _bank = std::make_unique<Bank>(_store);
+        ASSERT_TRUE(common::ErasureCode::create(4, 2, &_code).ok());
+        for (int i = 0; i < 6; i++) {
+            _cluster.targets.push_back(fmt::format("127.0.0.1:{}", 8101 + i));
+        }
+        _encoder = std::make_unique<EcEncoder>(_bank.get(), &_cluster, _code);
+    }
+
+    void TearDown() override {
+        _encoder.reset();
+        _bank.reset();
+        _store.reset();
+        FLAGS_manusya_ec_cold_seconds = _saved_cold_seconds;
+    }
+
+    ChunkPtr create_chunk(const std::string& data, bool seal) {
+        ChunkPtr chunk;
+        EXPECT_TRUE(_bank->create_chunk(ChunkOptions(), 1, &chunk).ok());
+        IOBuf buf;
+        buf.append(data);
+        EXPECT_TRUE(chunk->append(buf, 0).ok());
+        if (seal) {
+            uint64_t length = 0;
+            EXPECT_TRUE(chunk->query_and_seal(&length).ok());
+        }
+        return chunk;
+    }
+
+    // 按布局读回分片，丢失 lost 中的分片后解码
+    std::string decode(const proto::ChunkInfo& layout, const std::vector<uint32_t>& lost) {
+        std::vector<IOBuf> fragments(_code->fragment_count());
+        std::vector<bool> present(_code->fragment_count(), true);
+        for (int i = 0; i < layout.replicas_size(); i++) {
+            auto& replica = layout.replicas(i);
+            ObjectId id(layout.chunk_id().partition_id(), common::from_proto(replica.chunk_id()));
+            fragments[i] = _cluster.fragments[replica.location().uri()][id];
+        }
+        for (auto i : lost) {
+            fragments[i].clear();
+            present[i] = false;
+        }
+        EXPECT_TRUE(_code->decode(&fragments, present).ok());
+        std::string data;
+        for (uint32_t i = 0; i < _code->data_count(); i++) {
+            data += fragments[i].to_string();
+        }
+        return data.substr(0, layout.length());
+    }
+
+    // 编码 data 并写入分片，返回对应的布局
+    proto::ChunkInfo code(const ObjectId& chunk_id, const std::string& data) {
+        IOBuf buf;
+        buf.append(data);
+        std::vector<IOBuf> fragments;
+        EXPECT_TRUE(_code->encode(buf, &fragments).ok());
+        proto::ChunkInfo layout;
+        common::to_proto(chunk_id, layout.mutable_chunk_id());
+        layout.set_length(data.size());
+        layout.set_type(proto::ChunkType::CHUNK_TYPE_EC);
+        layout.mutable_config()->set_replica_count(_code->data_count());
+        layout.mutable_config()->set_parity_count(_code->parity_count());
+        for (size_t i = 0; i < fragments.size(); i++) {
+            ObjectId fragment_id;
+            EXPECT_TRUE(_cluster.write_fragment(_cluster.targets[i], 1, fragments[i], &fragment_id).ok());
+            auto* fragment = layout.add_replicas();
+            common::to_proto(fragment_id.uuid(), fragment->mutable_chunk_id());
+            fragment->set_length(fragments[i].size());
+            fragment->mutable_location()->set_uri(_cluster.targets[i]);
+        }
+        return layout;
+    }
+
+    uint64_t _saved_cold_seconds = 0;
+    StorePtr _store;
+    std::unique_ptr<Bank> _bank;
+    common::ErasureCodePtr _code;
+    FakeEcCluster _cluster;
+    std::unique_ptr<EcEncoder> _encoder;
+};
+
+TEST_F(TestEcEncoder, ConvertColdSealedChunk) {
+    std::string data(10000, 'x');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i * 7);
+    }
+    auto chunk = create_chunk(data, true);
+    auto chunk_id = chunk->chunk_id();
+    chunk.reset();
+
+    ASSERT_EQ(_encoder->run_once(), 1);
+    ChunkPtr removed;
+    ASSERT_FALSE(_bank->get_chunk(chunk_id, &removed).ok());
+
+    // 每个分片放在不同的节点上
+    ASSERT_EQ(_cluster.layouts.size(), 1);
+    auto& layout = _cluster.layouts[chunk_id];
+    ASSERT_EQ(layout.type(), proto::ChunkType::CHUNK_TYPE_EC);
+    ASSERT_EQ(layout.length(), data.size());
+    ASSERT_EQ(layout.config().replica_count(), 4);
+    ASSERT_EQ(layout.config().parity_count(), 2);
+    ASSERT_EQ(layout.replicas_size(), 6);
+    for (auto& [address, fragments] : _cluster.fragments) {
+        ASSERT_EQ(fragments.size(), 1) << address;
+    }
+    ASSERT_EQ(decode(layout, {}), data);
+    ASSERT_EQ(decode(layout, {0, 3}), data);
+}
+
+TEST_F(TestEcEncoder, SkipOpenAndHotChunks) {
+    auto open_chunk = create_chunk("open", false);
+    ASSERT_EQ(_encoder->run_once(), 0);
+
+    FLAGS_manusya_ec_cold_seconds = 3600;
+    auto hot_chunk = create_chunk("hot", true);
+    ASSERT_EQ(_encoder->run_once(), 0);
+    ASSERT_EQ(_cluster.fragment_count(), 0);
+    ChunkPtr chunk;
+    ASSERT_TRUE(_bank->get_chunk(open_chunk->chunk_id(), &chunk).ok());
+    ASSERT_TRUE(_bank->get_chunk(hot_chunk->chunk_id(), &chunk).ok());
+
+    // 未封存的块不能直接转换
+    ASSERT_EQ(_encoder->convert(open_chunk->chunk_id()).error_code(), EINVAL);
+}
+
+TEST_F(TestEcEncoder, DropReplicaOfConvertedChunk) {
+    std::string data = "converted by another replica";
+    auto chunk_id = create_chunk(data, true)->chunk_id();
+    _cluster.layouts[chunk_id] = code(chunk_id, data);
+
+    ASSERT_TRUE(_encoder->convert(chunk_id).ok());
+    ChunkPtr chunk;
+    ASSERT_FALSE(_bank->get_chunk(chunk_id, &chunk).ok());
+    ASSERT_EQ(_cluster.fragment_count(), 6);
+}
+
+TEST_F(TestEcEncoder, KeepReplicaWithoutReadableFragments) {
+    std::string data = "fragments of the committed layout are lost";
+    auto chunk_id = create_chunk(data, true)->chunk_id();
+    auto layout = code(chunk_id, data);
+    _cluster.layouts[chunk_id] = layout;
+    // 只剩 3 个分片，不足以解码
+    for (int i = 0; i < 3; i++) {
+        auto& fragment = layout.replicas(i);
+        _cluster.fragments[fragment.location().uri()].erase(
+            ObjectId(chunk_id.partition_id(), common::from_proto(fragment.chunk_id())));
+    }
+
+    ASSERT_EQ(_encoder->convert(chunk_id).error_code(), EIO);
+    ChunkPtr chunk;
+    ASSERT_TRUE(_bank->get_chunk(chunk_id, &chunk).ok());
+}
+
+TEST_F(TestEcEncoder, CommitAppliedDespiteError) {
+    _cluster.commit_error = ETIMEDOUT;
+    _cluster.apply_commit = true;
+    auto chunk_id = create_chunk("commit applied before the timeout", true)->chunk_id();
+
+    // deva 已经记录了布局，分片必须保留，副本可以删除
+    ASSERT_TRUE(_encoder->convert(chunk_id).ok());
+    ASSERT_EQ(_cluster.layouts.size(), 1);
+    ASSERT_EQ(_cluster.fragment_count(), 6);
+    ChunkPtr chunk;
+    ASSERT_FALSE(_bank->get_chunk(chunk_id, &chunk).ok());
+}
+
+TEST_F(TestEcEncoder, CommitNotApplied) {
+    _cluster.commit_error = EHOSTDOWN;
+    auto chunk_id = create_chunk("commit never reached deva", true)->chunk_id();
+
+    ASSERT_EQ(_encoder->convert(chunk_id).error_code(), EHOSTDOWN);
+    ASSERT_TRUE(_cluster.layouts.empty());
+    ASSERT_EQ(_cluster.fragment_count(), 0);
+    ChunkPtr chunk;
+    ASSERT_TRUE(_bank->get_chunk(chunk_id, &chunk).ok());
+}
+
+TEST_F(TestEcEncoder, LoseCommitRace) {
+    _cluster.lose_race = true;
+    auto chunk_id = create_chunk("lose the race", true)->chunk_id();
+
+    // 提交失败时删除自己写入的分片，副本仍然被删除
+    ASSERT_TRUE(_encoder->convert(chunk_id).ok());
+    ASSERT_EQ(_cluster.fragment_count(), 6);
+    ChunkPtr chunk;
+    ASSERT_FALSE(_bank->get_chunk(chunk_id, &chunk).ok());
+}
+
+TEST_F(TestEcEncoder, LeaveFragmentsAlone) {
+    auto fragment_id = create_chunk("fragment", true)->chunk_id();
+    auto chunk_id = ObjectId::generate(1);
+    proto::ChunkInfo layout;
+    common::to_proto(chunk_id, layout.mutable_chunk_id());
+    common::to_proto(fragment_id.uuid(), layout.add_replicas()->mutable_chunk_id());
+    _cluster.layouts[chunk_id] = layout;
+
+    ASSERT_EQ(_encoder->run_once(), 0);
+    ChunkPtr chunk;
+    ASSERT_TRUE(_bank->get_chunk(fragment_id, &chunk).ok());
+    ASSERT_EQ(_cluster.get_layout_count, 1);
+
+    // 已知的分片不再查询布局
+    ASSERT_EQ(_encoder->run_once(), 0);
+    ASSERT_EQ(_cluster.get_layout_count, 1);
+}
+
+TEST_F(TestEcEncoder, NotEnoughTargets) {
+    _cluster.targets.pop_back();
+    auto chunk_id = create_chunk("five targets for six fragments", true)->chunk_id();
+
+    ASSERT_EQ(_encoder->convert(chunk_id).error_code(), ENOSPC);
+    ASSERT_EQ(_encoder->run_once(), 0);
+    ChunkPtr chunk;
+    ASSERT_TRUE(_bank->get_chunk(chunk_id, &chunk).ok());
+    ASSERT_EQ(_cluster.fragment_count(), 0);
+    ASSERT_TRUE(_cluster.layouts.empty());
+}
+
+TEST_F(TestEcEncoder, StartAndStop) {
+    auto chunk_id = create_chunk("background", true)->chunk_id();
+    ASSERT_TRUE(_encoder->start().ok());
+    ASSERT_EQ(_encoder->start().error_code(), EEXIST);
+    ChunkPtr chunk;
+    for (int i = 0; i < 1000 && _bank->get_chunk(chunk_id, &chunk).ok(); i++) {
+        usleep(1000);
+    }
+    _encoder->stop();
+    ASSERT_FALSE(_bank->get_chunk(chunk_id, &chunk).ok());
+    ASSERT_EQ(_cluster.layouts.size(), 1);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
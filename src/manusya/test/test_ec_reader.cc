@@ -0,0 +1,198 @@
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include "common/erasure_code.h"
+#include "common/object_id_util.h"
+#include "manusya/ec_cluster.h"
+#include "manusya/ec_reader.h"
+
+DECLARE_uint32(manusya_ec_read_hedge_ms);
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+// 分片保存在内存中，dead 中的节点读失败，slow 中的节点直到 release 才返回
+class FakeEcCluster : public EcCluster {
+public:
+    Status list_targets(std::vector<std::string>* addresses) override {
+        addresses->clear();
+        return Status::OK();
+    }
+
+    Status write_fragment(const std::string& address,
+                          uint32_t partition_id,
+                          const IOBuf& data,
+                          ObjectId* fragment_id) override {
+        *fragment_id = ObjectId::generate(partition_id);
+        fragments[address][*fragment_id] = data;
+        return Status::OK();
+    }
+
+    Status remove_fragment(const std::string& address, const ObjectId& fragment_id) override {
+        fragments[address].erase(fragment_id);
+        return Status::OK();
+    }
+
+    void read_fragment(const std::string& address,
+                       const ObjectId& fragment_id,
+                       uint64_t offset,
+                       uint32_t size,
+                       std::function<void(Status, IOBuf)> done) override {
+        if (dead.contains(address)) {
+            done(Status(EHOSTDOWN, "manusya is down"), IOBuf());
+            return;
+        }
+        IOBuf data;
+        fragments[address][fragment_id].append_to(&data, size, offset);
+        read_bytes[address] += data.size();
+        if (slow.contains(address)) {
+            pending.push_back([done, data]() {
+                done(Status::OK(), data);
+            });
+            return;
+        }
+        done(Status::OK(), data);
+    }
+
+    Status get_layout(const ObjectId& chunk_id, proto::ChunkInfo* layout) override {
+        std::ignore = chunk_id;
+        std::ignore = layout;
+        return Status(ENOENT, "no layout");
+    }
+
+    Status commit_layout(const proto::ChunkInfo& layout, proto::ChunkInfo* committed) override {
+        *committed = layout;
+        return Status::OK();
+    }
+
+    void release() {
+        for (auto& fn : pending) {
+            fn();
+        }
+        pending.clear();
+    }
+
+    std::map<std::string, std::map<ObjectId, IOBuf>> fragments;
+    std::set<std::string> dead;
+    std::set<std::string> slow;
+    std::map<std::string, uint64_t> read_bytes;
+    std::vector<std::function<void()>> pending;
+};
+
+class TestEcReader : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _saved_hedge_ms = FLAGS_manusya_ec_read_hedge_ms;
+        ASSERT_TRUE(common::ErasureCode::create(4, 2, &_code).ok());
+        _data.resize(10001);
+        for (size_t i = 0; i < _data.size(); i++) {
+            _data[i] = static_cast<char>(i * 13 + 5);
+        }
+        IOBuf buf;
+        buf.append(_data);
+        std::vector<IOBuf> fragments;
+        ASSERT_TRUE(_code->encode(buf, &fragments).ok());
+
+        auto chunk_id = ObjectId::generate(1);
+        common::to_proto(chunk_id, _layout.mutable_chunk_id());
+        _layout.set_length(_data.size());
+        _layout.set_type(proto::ChunkType::CHUNK_TYPE_EC);
+        _layout.mutable_config()->set_replica_count(4);
+        _layout.mutable_config()->set_parity_count(2);
+        for (size_t i = 0; i < fragments.size(); i++) {
+            auto address = this->address(i);
+            ObjectId fragment_id;
+            ASSERT_TRUE(_cluster.write_fragment(address, 1, fragments[i], &fragment_id).ok());
+            auto* fragment = _layout.add_replicas();
+            common::to_proto(fragment_id.uuid(), fragment->mutable_chunk_id());
+            fragment->set_length(fragments[i].size());
+            fragment->mutable_location()->set_uri(address);
+        }
+    }
+
+    void TearDown() override {
+        _cluster.release();
+        FLAGS_manusya_ec_read_hedge_ms = _saved_hedge_ms;
+    }
+
+    static std::string address(size_t i) {
+        return fmt::format("127.0.0.1:{}", 8101 + i);
+    }
+
+    std::string read(uint64_t offset, uint64_t size) {
+        IOBuf data;
+        auto status = _reader.read(_layout, offset, size, &data);
+        EXPECT_TRUE(status.ok()) << status.error_str();
+        return data.to_string();
+    }
+
+    uint32_t _saved_hedge_ms = 0;
+    common::ErasureCodePtr _code;
+    std::string _data;
+    proto::ChunkInfo _layout;
+    FakeEcCluster _cluster;
+    EcReader _reader{&_cluster};
+};
+
+TEST_F(TestEcReader, ReadFromDataFragments) {
+    // 每个分片 2501 字节，跨越分片 0 和 1 的边界
+    ASSERT_EQ(read(2400, 300), _data.substr(2400, 300));
+    ASSERT_EQ(_cluster.read_bytes[address(0)], 101);
+    ASSERT_EQ(_cluster.read_bytes[address(1)], 199);
+    ASSERT_EQ(_cluster.read_bytes.size(), 2);
+
+    // 读到末尾之后被截断
+    ASSERT_EQ(read(9990, 100), _data.substr(9990));
+    ASSERT_EQ(read(0, _data.size()), _data);
+    IOBuf data;
+    ASSERT_EQ(_reader.read(_layout, _data.size() + 1, 1, &data).error_code(), EINVAL);
+}
+
+TEST_F(TestEcReader, ReconstructOnlyTheRange) {
+    _cluster.dead.insert(address(1));
+    ASSERT_EQ(read(3000, 500), _data.substr(3000, 500));
+    // 其他分片只读缺失的那一段
+    for (size_t i = 0; i < 6; i++) {
+        if (i != 1) {
+            ASSERT_EQ(_cluster.read_bytes[address(i)], 500) << i;
+        }
+    }
+
+    // 丢失两个数据分片，范围跨越它们
+    _cluster.dead.insert(address(2));
+    ASSERT_EQ(read(4000, 3000), _data.substr(4000, 3000));
+    ASSERT_EQ(read(0, _data.size()), _data);
+}
+
+TEST_F(TestEcReader, HedgeSlowFragment) {
+    FLAGS_manusya_ec_read_hedge_ms = 1;
+    _cluster.slow.insert(address(0));
+    ASSERT_EQ(read(100, 1000), _data.substr(100, 1000));
+    _cluster.release();
+
+    // 慢节点只是校验分片时不影响
+    _cluster.slow = {address(5)};
+    ASSERT_EQ(read(0, 1000), _data.substr(0, 1000));
+    ASSERT_TRUE(_cluster.pending.empty());
+}
+
+TEST_F(TestEcReader, TooManyLostFragments) {
+    _cluster.dead = {address(0), address(4), address(5)};
+    IOBuf data;
+    ASSERT_EQ(_reader.read(_layout, 0, 100, &data).error_code(), ENODATA);
+    // 不需要丢失的分片时仍然可以读
+    ASSERT_EQ(read(2600, 100), _data.substr(2600, 100));
+
+    _layout.set_type(proto::ChunkType::CHUNK_TYPE_NORMAL);
+    ASSERT_EQ(_reader.read(_layout, 0, 100, &data).error_code(), EINVAL);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
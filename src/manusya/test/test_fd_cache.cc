@@ -0,0 +1,160 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "manusya/fd_cache.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestFdCache : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // 创建临时测试目录
+        _test_dir = std::filesystem::temp_directory_path() / "test_fd_cache";
+        std::filesystem::create_directories(_test_dir);
+    }
+
+    void TearDown() override {
+        if (std::filesystem::exists(_test_dir)) {
+            std::filesystem::remove_all(_test_dir);
+        }
+    }
+
+    // 创建文件并写入内容，返回打开的 fd
+    int create_file(const std::string& name, const std::string& data, int flags = O_RDWR | O_CREAT) {
+        auto path = (_test_dir / name).string();
+        int fd = ::open(path.c_str(), flags, 0644);
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(::pwrite(fd, data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+        return fd;
+    }
+
+    std::string read_all(int fd) {
+        char buf[64];
+        auto n = ::pread(fd, buf, sizeof(buf), 0);
+        return n < 0 ? "" : std::string(buf, n);
+    }
+
+    std::filesystem::path _test_dir;
+};
+
+TEST_F(TestFdCache, EvictsLeastRecentlyUsed) {
+    FdCache cache(2);
+    std::vector<CachedFdPtr> files;
+    for (int i = 0; i < 3; ++i) {
+        auto name = "file" + std::to_string(i);
+        files.push_back(cache.add((_test_dir / name).string(), O_RDWR | O_CREAT, create_file(name, name)));
+    }
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(files[0]->fd, -1);
+    ASSERT_GE(files[1]->fd, 0);
+
+    // 使用 file1 后，file2 成为最久未使用的文件
+    {
+        FdPin pin;
+        ASSERT_TRUE(cache.pin(files[1], &pin).ok());
+    }
+    // 重新打开被淘汰的 file0
+    FdPin pin;
+    ASSERT_TRUE(cache.pin(files[0], &pin).ok());
+    ASSERT_EQ(read_all(pin.fd()), "file0");
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(files[2]->fd, -1);
+    ASSERT_GE(files[1]->fd, 0);
+
+    pin.reset();
+    for (auto& file : files) {
+        cache.release(file);
+    }
+    ASSERT_EQ(cache.size(), 0);
+}
+
+TEST_F(TestFdCache, PinnedFilesAreNotEvicted) {
+    FdCache cache(1);
+    auto a = cache.add((_test_dir / "a").string(), O_RDWR, create_file("a", "a"));
+    FdPin pin;
+    ASSERT_TRUE(cache.pin(a, &pin).ok());
+
+    // a 被 pin 住时允许超出容量
+    auto b = cache.add((_test_dir / "b").string(), O_RDWR, create_file("b", "b"));
+    ASSERT_EQ(cache.size(), 1);
+    ASSERT_GE(a->fd, 0);
+    ASSERT_EQ(b->fd, -1);
+    FdPin pin_b;
+    ASSERT_TRUE(cache.pin(b, &pin_b).ok());
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(read_all(pin.fd()), "a");
+    ASSERT_EQ(read_all(pin_b.fd()), "b");
+
+    pin.reset();
+    ASSERT_EQ(cache.size(), 1);
+    ASSERT_EQ(a->fd, -1);
+
+    // pin 期间释放，unpin 时才关闭
+    cache.release(b);
+    ASSERT_EQ(cache.size(), 1);
+    pin_b.reset();
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_EQ(cache.pin(b, &pin_b).error_code(), EBADF);
+    cache.release(a);
+}
+
+TEST_F(TestFdCache, ReopenWithoutCreateFlags) {
+    FdCache cache(1);
+    auto a = cache.add((_test_dir / "a").string(), O_RDWR | O_CREAT | O_EXCL | O_TRUNC, create_file("a", "hello"));
+    auto b = cache.add((_test_dir / "b").string(), O_RDWR, create_file("b", "b"));
+    ASSERT_EQ(a->fd, -1);
+
+    // 重新打开时不能截断或因 O_EXCL 失败
+    FdPin pin;
+    ASSERT_TRUE(cache.pin(a, &pin).ok());
+    ASSERT_EQ(read_all(pin.fd()), "hello");
+    pin.reset();
+
+    // 文件被删除后无法重新打开
+    cache.set_flags(b, O_RDONLY);
+    std::filesystem::remove(_test_dir / "b");
+    ASSERT_EQ(cache.pin(b, &pin).error_code(), ENOENT);
+    cache.release(a);
+    cache.release(b);
+}
+
+TEST_F(TestFdCache, ConcurrentPins) {
+    FdCache cache(4);
+    std::vector<CachedFdPtr> files;
+    for (int i = 0; i < 16; ++i) {
+        auto name = "file" + std::to_string(i);
+        files.push_back(cache.add((_test_dir / name).string(), O_RDWR, create_file(name, name)));
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, &files, t]() {
+            for (int j = 0; j < 1000; ++j) {
+                auto& file = files[(t * 7 + j) % files.size()];
+                FdPin pin;
+                ASSERT_TRUE(cache.pin(file, &pin).ok());
+                char c = 0;
+                ASSERT_EQ(::pread(pin.fd(), &c, 1, 0), 1);
+                ASSERT_EQ(c, 'f');
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_LE(cache.size(), 4);
+    for (auto& file : files) {
+        cache.release(file);
+    }
+    ASSERT_EQ(cache.size(), 0);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
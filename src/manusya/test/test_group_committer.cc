@@ -0,0 +1,75 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <butil/time.h>
+#include <filesystem>
+#include <vector>
+#include "manusya/group_committer.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestGroupCommitter : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _path = std::filesystem::temp_directory_path() / "test_group_committer";
+        _fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        ASSERT_GE(_fd, 0);
+    }
+
+    void TearDown() override {
+        ::close(_fd);
+        std::filesystem::remove(_path);
+    }
+
+    std::filesystem::path _path;
+    int _fd = -1;
+};
+
+TEST_F(TestGroupCommitter, CommitAfterWindow) {
+    GroupCommitter committer(20 * 1000, 1024 * 1024);
+    auto start = butil::monotonic_time_us();
+    auto status = committer.commit(_fd, 10).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    // 字节数未达到阈值时要等满窗口
+    ASSERT_GE(butil::monotonic_time_us() - start, 20 * 1000);
+}
+
+TEST_F(TestGroupCommitter, CommitWhenBatchIsFull) {
+    GroupCommitter committer(10 * 1000 * 1000, 100);
+    auto start = butil::monotonic_time_us();
+    std::vector<Future<Status>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(committer.commit(_fd, 10));
+    }
+    // 达到字节阈值立即提交，不用等 10s 的窗口
+    for (auto& future : futures) {
+        auto status = future.get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+    ASSERT_LT(butil::monotonic_time_us() - start, 5 * 1000 * 1000);
+}
+
+TEST_F(TestGroupCommitter, FailedSyncFailsItsEntries) {
+    GroupCommitter committer(1000, 1024 * 1024);
+    auto ok = committer.commit(_fd, 10);
+    auto bad = committer.commit(-1, 10);
+    ASSERT_TRUE(ok.get().ok());
+    auto status = bad.get();
+    ASSERT_FALSE(status.ok());
+    ASSERT_EQ(status.error_code(), EBADF);
+}
+
+TEST_F(TestGroupCommitter, PendingEntriesCompleteOnDestroy) {
+    Future<Status> future;
+    {
+        GroupCommitter committer(10 * 1000 * 1000, 1024 * 1024);
+        future = committer.commit(_fd, 10);
+    }
+    ASSERT_TRUE(future.get().ok());
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
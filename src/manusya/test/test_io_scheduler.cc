@@ -0,0 +1,178 @@
+#include <butil/time.h>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "manusya/io_scheduler.h"
+
+DECLARE_uint32(manusya_io_max_inflight);
+DECLARE_uint32(manusya_io_latency_reserved);
+DECLARE_string(manusya_io_tenant_weights);
+DECLARE_string(manusya_io_tenant_limits);
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+proto::IoTag make_tag(const std::string& tenant, proto::IoClass io_class = proto::IoClass::IO_CLASS_NORMAL) {
+    proto::IoTag tag;
+    tag.set_tenant(tenant);
+    tag.set_io_class(io_class);
+    return tag;
+}
+
+class TestIoScheduler : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _saved_max_inflight = FLAGS_manusya_io_max_inflight;
+        _saved_reserved = FLAGS_manusya_io_latency_reserved;
+        _saved_weights = FLAGS_manusya_io_tenant_weights;
+        _saved_limits = FLAGS_manusya_io_tenant_limits;
+        FLAGS_manusya_io_max_inflight = 1;
+        FLAGS_manusya_io_latency_reserved = 0;
+    }
+
+    void TearDown() override {
+        for (auto& t : _threads) {
+            t.join();
+        }
+        FLAGS_manusya_io_max_inflight = _saved_max_inflight;
+        FLAGS_manusya_io_latency_reserved = _saved_reserved;
+        FLAGS_manusya_io_tenant_weights = _saved_weights;
+        FLAGS_manusya_io_tenant_limits = _saved_limits;
+    }
+
+    // 在后台线程中提交 io，被调度后记录租户
+    void submit(const proto::IoTag& tag, uint64_t bytes) {
+        _threads.emplace_back([this, tag, bytes]() {
+            auto slot = _scheduler->admit(tag, bytes);
+            std::lock_guard lock(_mutex);
+            _order.push_back(tag.tenant());
+        });
+    }
+
+    void wait_queued(uint32_t n) {
+        while (_scheduler->queued() < n) {
+            usleep(1000);
+        }
+    }
+
+    std::vector<std::string> order() {
+        std::lock_guard lock(_mutex);
+        return _order;
+    }
+
+    uint32_t _saved_max_inflight = 0;
+    uint32_t _saved_reserved = 0;
+    std::string _saved_weights;
+    std::string _saved_limits;
+    std::unique_ptr<IoScheduler> _scheduler;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::vector<std::string> _order;
+};
+
+TEST_F(TestIoScheduler, LimitInflight) {
+    FLAGS_manusya_io_max_inflight = 2;
+    _scheduler = std::make_unique<IoScheduler>();
+    auto first = _scheduler->admit(make_tag("a"), 4096);
+    {
+        auto second = _scheduler->admit(make_tag("a"), 4096);
+        ASSERT_EQ(_scheduler->inflight(), 2);
+        submit(make_tag("b"), 4096);
+        wait_queued(1);
+        ASSERT_TRUE(order().empty());
+    }
+    _threads.back().join();
+    _threads.pop_back();
+    ASSERT_EQ(order(), std::vector<std::string>{"b"});
+    ASSERT_EQ(_scheduler->inflight(), 1);
+}
+
+TEST_F(TestIoScheduler, WeightedFairShare) {
+    FLAGS_manusya_io_tenant_weights = "a:3,b:1";
+    _scheduler = std::make_unique<IoScheduler>();
+    {
+        auto hold = _scheduler->admit(make_tag("hold"), 0);
+        for (int i = 0; i < 8; i++) {
+            submit(make_tag("a"), 4096);
+            submit(make_tag("b"), 4096);
+        }
+        wait_queued(16);
+    }
+    for (auto& t : _threads) {
+        t.join();
+    }
+    _threads.clear();
+    // 两个租户都有积压时按 3:1 调度
+    auto result = order();
+    ASSERT_EQ(result.size(), 16);
+    std::map<std::string, int> count;
+    for (int i = 0; i < 8; i++) {
+        count[result[i]]++;
+    }
+    ASSERT_EQ(count["a"], 6);
+    ASSERT_EQ(count["b"], 2);
+}
+
+TEST_F(TestIoScheduler, LatencyLane) {
+    FLAGS_manusya_io_max_inflight = 2;
+    FLAGS_manusya_io_latency_reserved = 1;
+    _scheduler = std::make_unique<IoScheduler>();
+    {
+        auto bulk = _scheduler->admit(make_tag("bulk"), 1024 * 1024);
+        // 预留的槽位只给延迟敏感的 io
+        submit(make_tag("bulk"), 1024 * 1024);
+        wait_queued(1);
+        auto latency = _scheduler->admit(make_tag("user", proto::IoClass::IO_CLASS_LATENCY), 4096);
+        ASSERT_EQ(_scheduler->inflight(), 2);
+        ASSERT_TRUE(order().empty());
+    }
+    _threads.back().join();
+    _threads.pop_back();
+    ASSERT_EQ(order(), std::vector<std::string>{"bulk"});
+
+    // 排队时延迟敏感的 io 先被调度
+    FLAGS_manusya_io_latency_reserved = 0;
+    FLAGS_manusya_io_max_inflight = 1;
+    {
+        auto hold = _scheduler->admit(make_tag("hold"), 0);
+        submit(make_tag("bulk"), 4096);
+        wait_queued(1);
+        submit(make_tag("user", proto::IoClass::IO_CLASS_LATENCY), 4096);
+        wait_queued(2);
+    }
+    for (auto& t : _threads) {
+        t.join();
+    }
+    _threads.clear();
+    ASSERT_EQ(order(), (std::vector<std::string>{"bulk", "user", "bulk"}));
+}
+
+TEST_F(TestIoScheduler, TenantLimit) {
+    FLAGS_manusya_io_max_inflight = 8;
+    FLAGS_manusya_io_tenant_limits = "slow:2:0,invalid:1";
+    _scheduler = std::make_unique<IoScheduler>();
+    auto begin = butil::gettimeofday_us();
+    // 突发两个，之后每秒两个
+    for (int i = 0; i < 3; i++) {
+        auto slot = _scheduler->admit(make_tag("slow"), 4096);
+    }
+    ASSERT_GE(butil::gettimeofday_us() - begin, 300 * 1000);
+
+    // 不受限的租户不等待
+    begin = butil::gettimeofday_us();
+    for (int i = 0; i < 3; i++) {
+        auto slot = _scheduler->admit(make_tag("invalid"), 4096);
+    }
+    ASSERT_LT(butil::gettimeofday_us() - begin, 100 * 1000);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
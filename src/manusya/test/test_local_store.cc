@@ -129,7 +129,7 @@ TEST_F(TestLocalStore, AppendMultipleTimes) {
         IOBuf buf;
         buf.append(data.c_str(), data.length());
 
-        auto append_future = _store->append(fh, 0, buf);
+        auto append_future = _store->append(fh, total_size, buf);
         status = append_future.get();
         ASSERT_TRUE(status.ok());
 
@@ -150,6 +150,133 @@ TEST_F(TestLocalStore, AppendMultipleTimes) {
     ASSERT_EQ(actual, expected);
 }
 
+TEST_F(TestLocalStore, AppendOutOfOrder) {
+    FileHandlePtr fh;
+    auto future = _store->open("test_file_ooo", O_RDWR | O_CREAT, &fh);
+    auto status = future.get();
+    ASSERT_TRUE(status.ok());
+
+    // 后半部分先写入，写入位置由offset决定
+    IOBuf tail;
+    tail.append("World");
+    status = _store->append(fh, 5, tail).get();
+    ASSERT_TRUE(status.ok());
+
+    IOBuf head;
+    head.append("Hello");
+    status = _store->append(fh, 0, head).get();
+    ASSERT_TRUE(status.ok());
+
+    IOBuf read_buf;
+    status = _store->read(fh, 0, 10, &read_buf).get();
+    ASSERT_TRUE(status.ok());
+    ASSERT_EQ(read_buf.to_string(), "HelloWorld");
+}
+
+TEST_F(TestLocalStore, DirectAppendUnaligned) {
+    FileHandlePtr fh;
+    auto status = _store->open("test_file_direct", O_RDWR | O_CREAT, &fh).get();
+    ASSERT_TRUE(status.ok());
+
+    // 非对齐的追加，尾部块需要读改写
+    std::string expected;
+    for (int i = 0; i < 20; ++i) {
+        std::string data(1000 + i * 37, static_cast<char>('a' + i % 26));
+        IOBuf buf;
+        buf.append(data);
+        status = _store->append_direct(fh, expected.size(), buf).get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        expected += data;
+        ASSERT_EQ(get_file_size("test_file_direct"), expected.size());
+    }
+
+    IOBuf read_buf;
+    status = _store->read(fh, 0, expected.size(), &read_buf).get();
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(read_buf.to_string() == expected);
+}
+
+TEST_F(TestLocalStore, DirectAppendOutOfOrder) {
+    FileHandlePtr fh;
+    auto status = _store->open("test_file_direct_ooo", O_RDWR | O_CREAT, &fh).get();
+    ASSERT_TRUE(status.ok());
+
+    // 后面的数据先落盘，前面的写入不能用填充覆盖它
+    std::string head(5000, 'h');
+    std::string tail(3000, 't');
+    IOBuf tail_buf;
+    tail_buf.append(tail);
+    status = _store->append_direct(fh, head.size(), tail_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    IOBuf head_buf;
+    head_buf.append(head);
+    status = _store->append_direct(fh, 0, head_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(get_file_size("test_file_direct_ooo"), head.size() + tail.size());
+
+    IOBuf read_buf;
+    status = _store->read(fh, 0, head.size() + tail.size(), &read_buf).get();
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(read_buf.to_string() == head + tail);
+}
+
+TEST_F(TestLocalStore, MixedDirectAndBufferedAppends) {
+    FileHandlePtr fh;
+    auto status = _store->open("test_file_mixed", O_RDWR | O_CREAT, &fh).get();
+    ASSERT_TRUE(status.ok());
+
+    // 并发的直接写和缓冲写共享部分块，读改写不能覆盖缓冲写的数据
+    constexpr int kAppends = 64;
+    constexpr size_t kSize = 1000;
+    std::vector<std::future<Status>> futures;
+    for (int i = 0; i < kAppends; ++i) {
+        futures.push_back(std::async(std::launch::async, [&, i]() {
+            IOBuf buf;
+            buf.append(std::string(kSize, static_cast<char>('a' + i % 26)));
+            if (i % 2 == 0) {
+                return _store->append_direct(fh, i * kSize, buf).get();
+            }
+            return _store->append(fh, i * kSize, buf).get();
+        }));
+    }
+    for (auto& future : futures) {
+        status = future.get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+
+    std::string expected;
+    for (int i = 0; i < kAppends; ++i) {
+        expected += std::string(kSize, static_cast<char>('a' + i % 26));
+    }
+    IOBuf read_buf;
+    status = _store->read(fh, 0, expected.size(), &read_buf).get();
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(read_buf.to_string() == expected);
+}
+
+TEST_F(TestLocalStore, GroupCommitAppends) {
+    auto store = StorePtr(new LocalStore(_test_dir.c_str(), Durability::kGroupCommit));
+    FileHandlePtr fh;
+    auto status = store->open("test_file_group_commit", O_RDWR | O_CREAT, &fh).get();
+    ASSERT_TRUE(status.ok());
+
+    // 并发的追加共享 fdatasync，全部完成后数据可读
+    std::vector<Future<Status>> futures;
+    for (int i = 0; i < 10; ++i) {
+        IOBuf buf;
+        buf.append(std::string(100, static_cast<char>('a' + i)));
+        futures.push_back(store->append(fh, i * 100, buf));
+    }
+    for (auto& future : futures) {
+        status = future.get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+    ASSERT_EQ(get_file_size("test_file_group_commit"), 1000);
+
+    status = store->seal(fh).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+}
+
 TEST_F(TestLocalStore, ReadWithOffset) {
     FileHandlePtr fh;
     auto future = _store->open("test_file1", O_RDWR | O_CREAT, &fh);
@@ -176,6 +303,40 @@ TEST_F(TestLocalStore, ReadWithOffset) {
     ASSERT_EQ(actual, expected);
 }
 
+TEST_F(TestLocalStore, ConcurrentPositionalReads) {
+    FileHandlePtr fh;
+    auto status = _store->open("test_file_pread", O_RDWR | O_CREAT, &fh).get();
+    ASSERT_TRUE(status.ok());
+
+    std::string data;
+    for (int i = 0; i < 256; ++i) {
+        data += std::string(16, static_cast<char>('a' + i % 26));
+    }
+    IOBuf write_buf;
+    write_buf.append(data);
+    status = _store->append(fh, 0, write_buf).get();
+    ASSERT_TRUE(status.ok());
+
+    // 多个线程共享同一个句柄读取不同的偏移量
+    std::vector<std::future<bool>> futures;
+    for (int i = 0; i < 8; ++i) {
+        futures.emplace_back(std::async(std::launch::async, [this, fh, &data, i]() {
+            for (int j = 0; j < 100; ++j) {
+                uint64_t offset = ((i * 100 + j) * 16) % data.size();
+                IOBuf read_buf;
+                auto status = _store->read(fh, offset, 16, &read_buf).get();
+                if (!status.ok() || read_buf.to_string() != data.substr(offset, 16)) {
+                    return false;
+                }
+            }
+            return true;
+        }));
+    }
+    for (auto& future : futures) {
+        ASSERT_TRUE(future.get());
+    }
+}
+
 TEST_F(TestLocalStore, FileSize) {
     FileHandlePtr fh;
     auto future = _store->open("test_file1", O_RDWR | O_CREAT, &fh);
@@ -1091,5 +1252,75 @@ TEST_F(TestLocalStore, ThreadSafetyWithMultipleStores) {
     }
 }
 
+TEST_F(TestLocalStore, CatalogReplacesFileMetadata) {
+    auto store = StorePtr(new LocalStore((_test_dir / "catalog").c_str(), Durability::kNone, true));
+    ASSERT_TRUE(dynamic_cast<LocalStore*>(store.get())->catalog() != nullptr);
+
+    FileHandlePtr fh;
+    auto status = store->open("test_file1", O_RDWR | O_CREAT, &fh).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    IOBuf buf;
+    buf.append("Hello, World!");
+    ASSERT_TRUE(store->append(fh, 0, buf).get().ok());
+    ASSERT_TRUE(store->set_attr(fh, "k1", "v1").get().ok());
+    ASSERT_TRUE(store->seal(fh).get().ok());
+
+    // seal 记录在 catalog 中，不再修改文件权限
+    auto perms = std::filesystem::status(_test_dir / "catalog" / "test_file1").permissions();
+    ASSERT_NE(perms & std::filesystem::perms::owner_write, std::filesystem::perms::none);
+    FileHandlePtr fh2;
+    ASSERT_EQ(store->open("test_file1", O_RDWR, &fh2).get().error_code(), EACCES);
+    fh.reset();
+    store.reset();
+
+    // 重新打开后从 catalog 中列出文件并读取元数据
+    store = StorePtr(new LocalStore((_test_dir / "catalog").c_str(), Durability::kNone, true));
+    std::vector<std::string> paths;
+    store->for_each([&paths](const char* path) {
+        paths.emplace_back(path);
+    });
+    ASSERT_EQ(paths, std::vector<std::string>{"test_file1"});
+    status = store->open("test_file1", O_RDONLY, &fh).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    uint64_t size = 0;
+    ASSERT_TRUE(store->size(fh, &size).get().ok());
+    ASSERT_EQ(size, 13);
+    std::map<std::string, std::string> attrs;
+    ASSERT_TRUE(store->list_attrs(fh, &attrs).get().ok());
+    ASSERT_EQ(attrs["k1"], "v1");
+
+    ASSERT_TRUE(store->remove("test_file1").get().ok());
+    paths.clear();
+    store->for_each([&paths](const char* path) {
+        paths.emplace_back(path);
+    });
+    ASSERT_TRUE(paths.empty());
+}
+
+TEST_F(TestLocalStore, CatalogImportsExistingFiles) {
+    // 没有 catalog 时写入并 seal 的文件在首次启用 catalog 时导入
+    auto data_path = _test_dir / "import";
+    auto store = StorePtr(new LocalStore(data_path.c_str()));
+    for (const char* name : {"sealed", "open"}) {
+        FileHandlePtr fh;
+        ASSERT_TRUE(store->open(name, O_RDWR | O_CREAT, &fh).get().ok());
+        IOBuf buf;
+        buf.append("Hello");
+        ASSERT_TRUE(store->append(fh, 0, buf).get().ok());
+        if (strcmp(name, "sealed") == 0) {
+            ASSERT_TRUE(store->seal(fh).get().ok());
+        }
+    }
+
+    store = StorePtr(new LocalStore(data_path.c_str(), Durability::kNone, true));
+    auto* catalog = dynamic_cast<LocalStore*>(store.get())->catalog();
+    FileMeta meta;
+    ASSERT_TRUE(catalog->get("sealed", &meta).ok());
+    ASSERT_TRUE(meta.sealed);
+    ASSERT_EQ(meta.size, 5);
+    ASSERT_TRUE(catalog->get("open", &meta).ok());
+    ASSERT_FALSE(meta.sealed);
+}
+
 } // namespace
 // NOLINTEND(readability-magic-numbers)
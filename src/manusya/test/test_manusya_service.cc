@@ -0,0 +1,629 @@
+#include <arpa/inet.h>
+#include <brpc/channel.h>
+#include <brpc/controller.h>
+#include <brpc/server.h>
+#include <brpc/stream.h>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "common/crc32c.h"
+#include "common/object_id_util.h"
+#include "manusya/bank.h"
+#include "manusya/ec_cluster.h"
+#include "manusya/manusya_service_impl.h"
+
+DECLARE_uint32(manusya_max_batch_items);
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestManusyaService : public ::testing::Test {
+protected:
+    void TearDown() override {
+        for (const auto& chunk_id : _chunk_ids) {
+            std::ignore = Bank::instance().remove_chunk(chunk_id);
+        }
+    }
+
+    // 在 Bank::instance() 中创建一个 chunk 并写入 data
+    ObjectId create_chunk(const std::string& data) {
+        ChunkPtr chunk;
+        auto status = Bank::instance().create_chunk(ChunkOptions(), 0, &chunk);
+        EXPECT_TRUE(status.ok()) << status.error_str();
+        _chunk_ids.push_back(chunk->chunk_id());
+        if (!data.empty()) {
+            IOBuf buf;
+            buf.append(data);
+            status = chunk->append(buf, 0);
+            EXPECT_TRUE(status.ok()) << status.error_str();
+        }
+        return chunk->chunk_id();
+    }
+
+    static std::string chunk_data(const ObjectId& chunk_id) {
+        ChunkPtr chunk;
+        if (!Bank::instance().get_chunk(chunk_id, &chunk).ok()) {
+            return "";
+        }
+        IOBuf buf;
+        if (!chunk->read(0, chunk->size(), &buf).ok()) {
+            return "";
+        }
+        return buf.to_string();
+    }
+
+    static void add_append(const ObjectId& chunk_id,
+                           uint64_t offset,
+                           const std::string& data,
+                           proto::manusya::BatchAppendChunkRequest* request,
+                           brpc::Controller* cntl) {
+        auto* item = request->add_items();
+        common::to_proto(chunk_id, item->mutable_chunk_id());
+        item->set_offset(offset);
+        item->set_length(data.size());
+        cntl->request_attachment().append(data);
+    }
+
+    static void add_read(const ObjectId& chunk_id,
+                         uint64_t offset,
+                         uint32_t length,
+                         proto::manusya::BatchReadChunkRequest* request) {
+        auto* item = request->add_items();
+        common::to_proto(chunk_id, item->mutable_chunk_id());
+        item->set_offset(offset);
+        item->set_length(length);
+    }
+
+    ManusyaServiceImpl _service;
+    std::vector<ObjectId> _chunk_ids;
+};
+
+TEST_F(TestManusyaService, BatchAppendStatusPerItem) {
+    auto chunk_a = create_chunk("");
+    auto chunk_b = create_chunk("");
+    auto missing = ObjectId::generate(0);
+
+    brpc::Controller cntl;
+    proto::manusya::BatchAppendChunkRequest request;
+    proto::manusya::BatchAppendChunkResponse response;
+    add_append(chunk_a, 0, "Hello", &request, &cntl);
+    add_append(missing, 0, "xyz", &request, &cntl);
+    add_append(chunk_b, 0, "World!", &request, &cntl);
+    _service.BatchAppendChunk(&cntl, &request, &response, nullptr);
+
+    // 单个 chunk 不存在不影响其他项
+    ASSERT_EQ(response.header().status(), 0) << response.header().message();
+    ASSERT_EQ(response.items_size(), 3);
+    ASSERT_EQ(response.items(0).header().status(), 0);
+    ASSERT_EQ(response.items(0).offset(), 5);
+    ASSERT_EQ(response.items(1).header().status(), ENOENT);
+    ASSERT_EQ(response.items(2).header().status(), 0);
+    ASSERT_EQ(response.items(2).offset(), 6);
+
+    // 附件按项的顺序和长度切分
+    ASSERT_EQ(chunk_data(chunk_a), "Hello");
+    ASSERT_EQ(chunk_data(chunk_b), "World!");
+}
+
+TEST_F(TestManusyaService, BatchAppendSizeMismatch) {
+    auto chunk_a = create_chunk("");
+
+    brpc::Controller cntl;
+    proto::manusya::BatchAppendChunkRequest request;
+    proto::manusya::BatchAppendChunkResponse response;
+    add_append(chunk_a, 0, "Hello", &request, &cntl);
+    request.mutable_items(0)->set_length(6);
+    _service.BatchAppendChunk(&cntl, &request, &response, nullptr);
+
+    ASSERT_EQ(response.header().status(), EINVAL);
+    ASSERT_EQ(response.header().message(), "attachment size mismatch");
+    ASSERT_EQ(response.items_size(), 0);
+    ASSERT_EQ(chunk_data(chunk_a), "");
+}
+
+TEST_F(TestManusyaService, BatchAppendTooManyItems) {
+    auto saved = FLAGS_manusya_max_batch_items;
+    FLAGS_manusya_max_batch_items = 1;
+    auto chunk_a = create_chunk("");
+
+    brpc::Controller cntl;
+    proto::manusya::BatchAppendChunkRequest request;
+    proto::manusya::BatchAppendChunkResponse response;
+    add_append(chunk_a, 0, "Hello", &request, &cntl);
+    add_append(chunk_a, 5, "World", &request, &cntl);
+    _service.BatchAppendChunk(&cntl, &request, &response, nullptr);
+    FLAGS_manusya_max_batch_items = saved;
+
+    ASSERT_EQ(response.header().status(), EINVAL);
+    ASSERT_EQ(chunk_data(chunk_a), "");
+}
+
+TEST_F(TestManusyaService, BatchReadPacksItemsInOrder) {
+    auto chunk_a = create_chunk("Hello World");
+    auto chunk_b = create_chunk("0123456789");
+
+    brpc::Controller cntl;
+    proto::manusya::BatchReadChunkRequest request;
+    proto::manusya::BatchReadChunkResponse response;
+    add_read(chunk_b, 2, 4, &request);
+    add_read(ObjectId::generate(0), 0, 3, &request);
+    add_read(chunk_a, 6, 5, &request);
+    // 越界的读取失败且不带数据
+    add_read(chunk_a, 6, 100, &request);
+    add_read(chunk_b, 0, 1, &request);
+    _service.BatchReadChunk(&cntl, &request, &response, nullptr);
+
+    ASSERT_EQ(response.header().status(), 0) << response.header().message();
+    ASSERT_EQ(response.items_size(), 5);
+    ASSERT_EQ(response.items(0).header().status(), 0);
+    ASSERT_EQ(response.items(0).offset(), 2);
+    ASSERT_EQ(response.items(0).length(), 4);
+    ASSERT_EQ(response.items(1).header().status(), ENOENT);
+    ASSERT_EQ(response.items(1).length(), 0);
+    ASSERT_EQ(response.items(2).header().status(), 0);
+    ASSERT_EQ(response.items(2).length(), 5);
+    ASSERT_EQ(response.items(3).header().status(), EINVAL);
+    ASSERT_EQ(response.items(3).length(), 0);
+    ASSERT_EQ(response.items(4).length(), 1);
+
+    // 数据按项的顺序打包在附件中
+    ASSERT_EQ(cntl.response_attachment().to_string(), "2345World0");
+    IOBuf expected;
+    expected.append("2345");
+    ASSERT_EQ(response.items(0).crc32(), common::crc32c(expected));
+    expected.clear();
+    expected.append("World");
+    ASSERT_EQ(response.items(2).crc32(), common::crc32c(expected));
+}
+
+// 纠删码分片所在的节点都不可用
+class DeadEcCluster : public EcCluster {
+public:
+    Status list_targets(std::vector<std::string>* addresses) override {
+        addresses->clear();
+        return Status::OK();
+    }
+
+    Status write_fragment([[maybe_unused]] const std::string& address,
+                          [[maybe_unused]] uint32_t partition_id,
+                          [[maybe_unused]] const IOBuf& data,
+                          [[maybe_unused]] ObjectId* fragment_id) override {
+        return Status(EHOSTDOWN, "manusya is down");
+    }
+
+    Status remove_fragment([[maybe_unused]] const std::string& address,
+                           [[maybe_unused]] const ObjectId& fragment_id) override {
+        return Status(EHOSTDOWN, "manusya is down");
+    }
+
+    void read_fragment([[maybe_unused]] const std::string& address,
+                       [[maybe_unused]] const ObjectId& fragment_id,
+                       [[maybe_unused]] uint64_t offset,
+                       [[maybe_unused]] uint32_t size,
+                       std::function<void(Status, IOBuf)> done) override {
+        done(Status(EHOSTDOWN, "manusya is down"), IOBuf());
+    }
+
+    Status get_layout(const ObjectId& chunk_id, proto::ChunkInfo* layout) override {
+        layout->Clear();
+        common::to_proto(chunk_id, layout->mutable_chunk_id());
+        layout->set_length(100);
+        layout->set_type(proto::ChunkType::CHUNK_TYPE_EC);
+        layout->mutable_config()->set_replica_count(2);
+        layout->mutable_config()->set_parity_count(1);
+        for (int i = 0; i < 3; i++) {
+            auto* fragment = layout->add_replicas();
+            common::to_proto(ObjectId::generate(chunk_id.partition_id()).uuid(), fragment->mutable_chunk_id());
+            fragment->set_length(50);
+            fragment->mutable_location()->set_uri("127.0.0.1:8339");
+        }
+        return Status::OK();
+    }
+
+    Status commit_layout(const proto::ChunkInfo& layout, proto::ChunkInfo* committed) override {
+        *committed = layout;
+        return Status::OK();
+    }
+};
+
+TEST_F(TestManusyaService, ReadCodedChunkFailureInHeader) {
+    DeadEcCluster cluster;
+    ManusyaServiceImpl service(&cluster);
+
+    brpc::Controller cntl;
+    proto::manusya::ReadChunkRequest request;
+    proto::manusya::ReadChunkResponse response;
+    common::to_proto(ObjectId::generate(0), request.mutable_chunk_id());
+    request.set_offset(0);
+    request.set_length(10);
+    service.ReadChunk(&cntl, &request, &response, nullptr);
+
+    // 和其他读取错误一样通过 header 返回，rpc 本身成功
+    ASSERT_FALSE(cntl.Failed());
+    ASSERT_NE(response.header().status(), 0);
+    ASSERT_FALSE(response.header().message().empty());
+    ASSERT_TRUE(cntl.response_attachment().empty());
+}
+
+// 读取流的客户端：按顺序收集服务端发送的分段
+class SegmentReader : public brpc::StreamInputHandler {
+public:
+    struct Segment {
+        proto::manusya::ChunkReadSegment segment;
+        std::string data;
+    };
+
+    int on_received_messages([[maybe_unused]] brpc::StreamId id,
+                             butil::IOBuf* const messages[],
+                             size_t size) override {
+        std::lock_guard lock(_mutex);
+        for (size_t i = 0; i < size; ++i) {
+            uint32_t len = 0;
+            messages[i]->cutn(&len, sizeof(len));
+            IOBuf meta;
+            messages[i]->cutn(&meta, ntohl(len));
+            Segment segment;
+            EXPECT_TRUE(segment.segment.ParseFromString(meta.to_string()));
+            segment.data = messages[i]->to_string();
+            _segments.push_back(std::move(segment));
+        }
+        _cond.notify_all();
+        return 0;
+    }
+
+    void on_idle_timeout([[maybe_unused]] brpc::StreamId id) override {}
+
+    void on_closed([[maybe_unused]] brpc::StreamId id) override {
+        std::lock_guard lock(_mutex);
+        _closed = true;
+        _cond.notify_all();
+    }
+
+    // 等待收到 count 个分段，超时后返回已收到的
+    std::vector<Segment> wait(size_t count, int timeout_ms = 5000) {
+        std::unique_lock lock(_mutex);
+        _cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            return _segments.size() >= count;
+        });
+        return _segments;
+    }
+
+    void wait_closed() {
+        std::unique_lock lock(_mutex);
+        _cond.wait(lock, [&] {
+            return _closed;
+        });
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::vector<Segment> _segments;
+    bool _closed = false;
+};
+
+class TestChunkReadStream : public TestManusyaService {
+protected:
+    static constexpr const char* kAddress = "127.0.0.1:8310";
+
+    void SetUp() override {
+        ASSERT_EQ(_server.AddService(&_service, brpc::SERVER_DOESNT_OWN_SERVICE), 0);
+        ASSERT_EQ(_server.Start(kAddress, nullptr), 0);
+        ASSERT_EQ(_channel.Init(kAddress, nullptr), 0);
+    }
+
+    void TearDown() override {
+        if (_stream != brpc::INVALID_STREAM_ID) {
+            brpc::StreamClose(_stream);
+            _reader.wait_closed();
+        }
+        _server.Stop(0);
+        _server.Join();
+        TestManusyaService::TearDown();
+    }
+
+    Status open(const ObjectId& chunk_id,
+                uint64_t offset,
+                uint64_t length,
+                uint32_t segment_size,
+                uint32_t credits,
+                proto::manusya::OpenChunkReadStreamResponse* response) {
+        brpc::Controller cntl;
+        brpc::StreamOptions options;
+        options.handler = &_reader;
+        if (brpc::StreamCreate(&_stream, cntl, &options) != 0) {
+            return Status(EIO, "failed to create stream");
+        }
+        proto::manusya::OpenChunkReadStreamRequest request;
+        common::to_proto(chunk_id, request.mutable_chunk_id());
+        request.set_offset(offset);
+        request.set_length(length);
+        request.set_segment_size(segment_size);
+        request.set_credits(credits);
+        proto::manusya::ManusyaService_Stub stub(&_channel);
+        stub.OpenChunkReadStream(&cntl, &request, response, nullptr);
+        if (cntl.Failed()) {
+            return Status(cntl.ErrorCode(), cntl.ErrorText());
+        }
+        return Status(response->header().status(), response->header().message());
+    }
+
+    void grant(uint32_t credits) {
+        proto::manusya::ChunkReadCredit credit;
+        credit.set_credits(credits);
+        IOBuf buf;
+        buf.append(credit.SerializeAsString());
+        ASSERT_EQ(brpc::StreamWrite(_stream, buf), 0);
+    }
+
+    static std::string join(const std::vector<SegmentReader::Segment>& segments) {
+        std::string data;
+        for (const auto& segment : segments) {
+            data += segment.data;
+        }
+        return data;
+    }
+
+    brpc::Server _server;
+    brpc::Channel _channel;
+    SegmentReader _reader;
+    brpc::StreamId _stream = brpc::INVALID_STREAM_ID;
+};
+
+TEST_F(TestChunkReadStream, NoSegmentWithoutCredit) {
+    std::string content;
+    for (int i = 0; i < 10 * 1024; i++) {
+        content.push_back(static_cast<char>('a' + i % 26));
+    }
+    auto chunk_id = create_chunk(content);
+    proto::manusya::OpenChunkReadStreamResponse response;
+    auto status = open(chunk_id, 0, content.size(), 1024, 2, &response);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(response.size(), content.size());
+
+    // 只发送请求中授予的分段
+    ASSERT_EQ(_reader.wait(2).size(), 2);
+    ASSERT_EQ(_reader.wait(3, 200).size(), 2);
+
+    grant(3);
+    ASSERT_EQ(_reader.wait(5).size(), 5);
+    ASSERT_EQ(_reader.wait(6, 200).size(), 5);
+
+    grant(100);
+    auto segments = _reader.wait(10);
+    ASSERT_EQ(segments.size(), 10);
+    for (size_t i = 0; i < segments.size(); i++) {
+        ASSERT_EQ(segments[i].segment.header().status(), 0);
+        ASSERT_EQ(segments[i].segment.offset(), i * 1024);
+        ASSERT_EQ(segments[i].segment.length(), 1024);
+        IOBuf data;
+        data.append(segments[i].data);
+        ASSERT_EQ(segments[i].segment.crc32(), common::crc32c(data));
+        ASSERT_EQ(segments[i].segment.eof(), i == 9);
+    }
+    ASSERT_EQ(join(segments), content);
+    // eof 之后不再发送
+    ASSERT_EQ(_reader.wait(11, 200).size(), 10);
+}
+
+TEST_F(TestChunkReadStream, ShortTailEndsAtChunkSize) {
+    std::string content(2500, 'x');
+    auto chunk_id = create_chunk(content);
+    proto::manusya::OpenChunkReadStreamResponse response;
+    auto status = open(chunk_id, 0, 10000, 1024, 10, &response);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    auto segments = _reader.wait(3);
+    ASSERT_EQ(segments.size(), 3);
+    ASSERT_EQ(segments[2].segment.offset(), 2048);
+    ASSERT_EQ(segments[2].segment.length(), 452);
+    ASSERT_TRUE(segments[2].segment.eof());
+    ASSERT_FALSE(segments[1].segment.eof());
+    ASSERT_EQ(join(segments), content);
+    ASSERT_EQ(_reader.wait(4, 200).size(), 3);
+}
+
+TEST_F(TestChunkReadStream, ResumeFromOffset) {
+    std::string content;
+    for (int i = 0; i < 6000; i++) {
+        content.push_back(static_cast<char>('a' + i % 26));
+    }
+    auto chunk_id = create_chunk(content);
+    proto::manusya::OpenChunkReadStreamResponse response;
+    auto status = open(chunk_id, 3000, 2000, 1024, 10, &response);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    auto segments = _reader.wait(2);
+    ASSERT_EQ(segments.size(), 2);
+    ASSERT_EQ(segments[0].segment.offset(), 3000);
+    ASSERT_EQ(segments[1].segment.offset(), 4024);
+    ASSERT_TRUE(segments[1].segment.eof());
+    ASSERT_EQ(join(segments), content.substr(3000, 2000));
+}
+
+TEST_F(TestChunkReadStream, OffsetBeyondChunk) {
+    auto chunk_id = create_chunk("Hello");
+    proto::manusya::OpenChunkReadStreamResponse response;
+    auto status = open(chunk_id, 6, 10, 1024, 10, &response);
+    ASSERT_EQ(status.error_code(), EINVAL);
+}
+
+TEST_F(TestChunkReadStream, ErrorSegmentOnReadFailure) {
+    auto chunk_id = create_chunk(std::string(5000, 'x'));
+    proto::manusya::OpenChunkReadStreamResponse response;
+    auto status = open(chunk_id, 0, 5000, 1024, 0, &response);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    // 流打开后 chunk 被删除，数据被丢弃，读取时校验失败
+    ASSERT_TRUE(Bank::instance().remove_chunk(chunk_id).ok());
+    grant(10);
+    auto segments = _reader.wait(1);
+    ASSERT_EQ(segments.size(), 1);
+    ASSERT_EQ(segments[0].segment.header().status(), EIO);
+    ASSERT_EQ(segments[0].segment.offset(), 0);
+    ASSERT_TRUE(segments[0].segment.eof());
+    ASSERT_TRUE(segments[0].data.empty());
+    ASSERT_EQ(_reader.wait(2, 200).size(), 1);
+}
+
+class TestReplicationChain : public TestManusyaService {
+protected:
+    static constexpr int kReplicaCount = 3;
+    // 没有服务监听的地址
+    static constexpr const char* kDeadAddress = "127.0.0.1:8329";
+
+    void SetUp() override {
+        for (int i = 0; i < kReplicaCount; i++) {
+            _addresses.push_back("127.0.0.1:" + std::to_string(8320 + i));
+            _services.push_back(std::make_unique<ManusyaServiceImpl>());
+            _servers.push_back(std::make_unique<brpc::Server>());
+            ASSERT_EQ(_servers.back()->AddService(_services.back().get(), brpc::SERVER_DOESNT_OWN_SERVICE), 0);
+            ASSERT_EQ(_servers.back()->Start(_addresses.back().c_str(), nullptr), 0);
+        }
+        ASSERT_EQ(_channel.Init(_addresses[0].c_str(), nullptr), 0);
+    }
+
+    void TearDown() override {
+        for (auto& server : _servers) {
+            server->Stop(0);
+            server->Join();
+        }
+        TestManusyaService::TearDown();
+    }
+
+    // 向第一个 manusya 追加，chain 是其后的副本
+    void append(const ObjectId& chunk_id,
+                uint64_t offset,
+                const std::string& data,
+                const std::vector<std::pair<std::string, ObjectId>>& chain,
+                proto::manusya::AppendChunkResponse* response) {
+        brpc::Controller cntl;
+        proto::manusya::AppendChunkRequest request;
+        common::to_proto(chunk_id, request.mutable_chunk_id());
+        request.set_offset(offset);
+        request.set_length(data.size());
+        for (const auto& [address, replica_id] : chain) {
+            auto* replica = request.add_chain();
+            replica->set_address(address);
+            common::to_proto(replica_id, replica->mutable_chunk_id());
+        }
+        cntl.request_attachment().append(data);
+        proto::manusya::ManusyaService_Stub stub(&_channel);
+        stub.AppendChunk(&cntl, &request, response, nullptr);
+        ASSERT_FALSE(cntl.Failed()) << cntl.ErrorText();
+    }
+
+    std::vector<std::string> _addresses;
+    std::vector<std::unique_ptr<ManusyaServiceImpl>> _services;
+    std::vector<std::unique_ptr<brpc::Server>> _servers;
+    brpc::Channel _channel;
+};
+
+TEST_F(TestReplicationChain, TwoHopsAckTheSmallestOffset) {
+    auto c0 = create_chunk("");
+    auto c1 = create_chunk("");
+    auto c2 = create_chunk("");
+
+    // 第一个副本上有一个等待空洞的追加，填上空洞后它比后面的副本长
+    ChunkPtr chunk0;
+    ASSERT_TRUE(Bank::instance().get_chunk(c0, &chunk0).ok());
+    std::thread parked([&] {
+        IOBuf buf;
+        buf.append("World");
+        ASSERT_TRUE(chunk0->append(buf, 5).ok());
+    });
+    while (chunk0->pending_count() == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    proto::manusya::AppendChunkResponse response;
+    append(c0, 0, "Hello", {{_addresses[1], c1}, {_addresses[2], c2}}, &response);
+    parked.join();
+
+    ASSERT_EQ(response.header().status(), 0) << response.header().message();
+    ASSERT_EQ(chunk_data(c0), "HelloWorld");
+    ASSERT_EQ(chunk_data(c1), "Hello");
+    ASSERT_EQ(chunk_data(c2), "Hello");
+    // 确认的是链上最小的提交位置
+    ASSERT_EQ(response.offset(), 5);
+}
+
+TEST_F(TestReplicationChain, RpcFailureBlamesNextReplica) {
+    auto c0 = create_chunk("");
+    auto c1 = create_chunk("");
+
+    proto::manusya::AppendChunkResponse response;
+    append(c0, 0, "Hello", {{kDeadAddress, ObjectId::generate(0)}}, &response);
+    ASSERT_NE(response.header().status(), 0);
+    ASSERT_EQ(response.failed_replica(), 1);
+    ASSERT_EQ(chunk_data(c0), "Hello");
+
+    // 第二跳的 rpc 失败，由中间的副本报告，位置相对于第一个副本
+    auto c2 = create_chunk("");
+    response.Clear();
+    append(c2, 0, "World", {{_addresses[1], c1}, {kDeadAddress, ObjectId::generate(0)}}, &response);
+    ASSERT_NE(response.header().status(), 0);
+    ASSERT_EQ(response.failed_replica(), 2);
+    ASSERT_EQ(chunk_data(c1), "World");
+}
+
+TEST_F(TestReplicationChain, RemoteErrorBlamesFailedReplica) {
+    auto c0 = create_chunk("");
+    auto c1 = create_chunk("");
+
+    // 下一个副本自己失败，报告它在链上的位置
+    proto::manusya::AppendChunkResponse response;
+    append(c0, 0, "Hello", {{_addresses[1], ObjectId::generate(0)}, {_addresses[2], c1}}, &response);
+    ASSERT_EQ(response.header().status(), ENOENT);
+    ASSERT_EQ(response.failed_replica(), 1);
+
+    // 最后一个副本失败，前面的副本都已写入
+    auto c2 = create_chunk("");
+    response.Clear();
+    append(c2, 0, "Hello", {{_addresses[1], c1}, {_addresses[2], ObjectId::generate(0)}}, &response);
+    ASSERT_EQ(response.header().status(), ENOENT);
+    ASSERT_EQ(response.failed_replica(), 2);
+    ASSERT_EQ(chunk_data(c2), "Hello");
+    ASSERT_EQ(chunk_data(c1), "Hello");
+}
+
+TEST_F(TestReplicationChain, LocalRejectionIsNotForwarded) {
+    auto c0 = create_chunk("");
+    auto c1 = create_chunk("");
+    ChunkPtr chunk0;
+    ASSERT_TRUE(Bank::instance().get_chunk(c0, &chunk0).ok());
+    uint64_t length = 0;
+    ASSERT_TRUE(chunk0->query_and_seal(&length).ok());
+
+    // 本地拒绝的追加不转发，下游副本保持不变，失败归于本地
+    proto::manusya::AppendChunkResponse response;
+    append(c0, 0, "Hello", {{_addresses[1], c1}}, &response);
+    ASSERT_EQ(response.header().status(), EPERM);
+    ASSERT_EQ(response.failed_replica(), 0);
+    ASSERT_EQ(chunk_data(c1), "");
+
+    // 偏移非法同样不转发
+    auto c2 = create_chunk("");
+    auto c3 = create_chunk("");
+    response.Clear();
+    append(c2, 0, "Hello", {{_addresses[1], c3}}, &response);
+    ASSERT_EQ(response.header().status(), 0);
+    response.Clear();
+    append(c2, 0, "World", {{_addresses[1], c3}}, &response);
+    ASSERT_EQ(response.header().status(), EINVAL);
+    ASSERT_EQ(response.failed_replica(), 0);
+    ASSERT_EQ(chunk_data(c3), "Hello");
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
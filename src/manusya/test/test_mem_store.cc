@@ -371,8 +371,7 @@ TEST_F(TestMemStore, AppendToInvalidFileHandle) {
     EXPECT_EXIT(new FileHandle(nullptr), testing::KilledBySignal(SIGABRT), "store is nullptr");
 }
 
-// WARNING: ConcurrentWrite is not yet supported in the current implementation
-TEST_F(TestMemStore, DISABLED_ConcurrentAccess) {
+TEST_F(TestMemStore, ConcurrentAccess) {
     FileHandlePtr fh;
     auto future = _store->open("/test/file1", O_RDWR | O_CREAT, &fh);
     auto status = future.get();
@@ -1165,5 +1164,92 @@ TEST_F(TestMemStore, FileHandleTypeSafety) {
     ASSERT_EQ(size, strlen(test_data));
 }
 
+TEST_F(TestMemStore, ConcurrentFiles) {
+    // 不同文件的并发写入互不影响
+    const int num_threads = 8;
+    const int writes_per_thread = 200;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([this, i, writes_per_thread]() {
+            FileHandlePtr fh;
+            auto path = "/test/concurrent_" + std::to_string(i);
+            ASSERT_TRUE(_store->open(path.c_str(), O_RDWR | O_CREAT, &fh).get().ok());
+            for (int j = 0; j < writes_per_thread; ++j) {
+                IOBuf buf;
+                buf.append(std::string(100, static_cast<char>('a' + i)));
+                ASSERT_TRUE(_store->append(fh, j * 100, buf).get().ok());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i < num_threads; ++i) {
+        FileHandlePtr fh;
+        auto path = "/test/concurrent_" + std::to_string(i);
+        ASSERT_TRUE(_store->open(path.c_str(), O_RDONLY, &fh).get().ok());
+        IOBuf buf;
+        ASSERT_TRUE(_store->read(fh, 0, writes_per_thread * 100, &buf).get().ok());
+        ASSERT_EQ(buf.to_string(), std::string(writes_per_thread * 100, static_cast<char>('a' + i)));
+    }
+}
+
+TEST(TestBlockBuffer, ReadAcrossBlocks) {
+    BlockBuffer buffer;
+    std::string data(BlockBuffer::kBlockSize * 3 + 100, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i % 251);
+    }
+    // 以不对齐的小块写入
+    for (size_t offset = 0; offset < data.size(); offset += 1000) {
+        IOBuf buf;
+        buf.append(data.substr(offset, 1000));
+        buffer.write(offset, buf);
+    }
+    ASSERT_EQ(buffer.size(), data.size());
+
+    IOBuf out;
+    buffer.read(BlockBuffer::kBlockSize - 10, 20, &out);
+    ASSERT_EQ(out.to_string(), data.substr(BlockBuffer::kBlockSize - 10, 20));
+    out.clear();
+    buffer.read(BlockBuffer::kBlockSize * 3, 1000, &out);
+    ASSERT_EQ(out.to_string(), data.substr(BlockBuffer::kBlockSize * 3));
+    out.clear();
+    buffer.read(0, data.size(), &out);
+    ASSERT_EQ(out.to_string(), data);
+    out.clear();
+    buffer.read(data.size(), 10, &out);
+    ASSERT_TRUE(out.empty());
+}
+
+TEST(TestBlockBuffer, OverwriteAndGap) {
+    BlockBuffer buffer;
+    IOBuf buf;
+    buf.append("World");
+    buffer.write(BlockBuffer::kBlockSize + 2, buf);
+    ASSERT_EQ(buffer.size(), BlockBuffer::kBlockSize + 7);
+
+    // 跨越块边界覆盖
+    buf.clear();
+    buf.append(std::string(10, 'x'));
+    buffer.write(BlockBuffer::kBlockSize - 5, buf);
+    IOBuf out;
+    buffer.read(BlockBuffer::kBlockSize - 6, 13, &out);
+    ASSERT_EQ(out.to_string(), std::string("\0xxxxxxxxxxld", 13));
+
+    // 覆盖并延长文件
+    buf.clear();
+    buf.append("Hello, World");
+    buffer.write(BlockBuffer::kBlockSize + 5, buf);
+    ASSERT_EQ(buffer.size(), BlockBuffer::kBlockSize + 17);
+    out.clear();
+    buffer.read(BlockBuffer::kBlockSize, 17, &out);
+    ASSERT_EQ(out.to_string(), "xxxxxHello, World");
+
+    buffer.clear();
+    ASSERT_EQ(buffer.size(), 0);
+}
+
 } // namespace
 // NOLINTEND(readability-magic-numbers)
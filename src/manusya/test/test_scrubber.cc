@@ -0,0 +1,172 @@
+#include <butil/time.h>
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "manusya/bank.h"
+#include "manusya/scrub_reporter.h"
+#include "manusya/scrubber.h"
+
+DECLARE_uint64(manusya_scrub_bytes_per_second);
+DECLARE_int64(manusya_scrub_latency_threshold_us);
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+// 记录上报的损坏副本
+class FakeScrubReporter : public ScrubReporter {
+public:
+    Status report(const ObjectId& chunk_id, const Status& error) override {
+        reported.push_back(chunk_id);
+        errors.push_back(error.error_code());
+        return Status::OK();
+    }
+
+    std::vector<ObjectId> reported;
+    std::vector<int> errors;
+};
+
+class TestScrubber : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _saved_rate = FLAGS_manusya_scrub_bytes_per_second;
+        _saved_threshold = FLAGS_manusya_scrub_latency_threshold_us;
+        FLAGS_manusya_scrub_bytes_per_second = 1024 * 1024 * 1024;
+        FLAGS_manusya_scrub_latency_threshold_us = 1000;
+        _store = Store::create("memory://");
+        ASSERT_TRUE(_store != nullptr);
+        _bank = std::make_unique<Bank>(_store);
+        _scrubber = std::make_unique<Scrubber>(_bank.get(), &_reporter, [this]() {
+            return _latency.load();
+        });
+    }
+
+    void TearDown() override {
+        _scrubber.reset();
+        _bank.reset();
+        _store.reset();
+        FLAGS_manusya_scrub_bytes_per_second = _saved_rate;
+        FLAGS_manusya_scrub_latency_threshold_us = _saved_threshold;
+    }
+
+    ChunkPtr create_chunk(const std::string& data, bool seal) {
+        ChunkPtr chunk;
+        EXPECT_TRUE(_bank->create_chunk(ChunkOptions(), 1, &chunk).ok());
+        IOBuf buf;
+        buf.append(data);
+        EXPECT_TRUE(chunk->append(buf, 0).ok());
+        if (seal) {
+            uint64_t length = 0;
+            EXPECT_TRUE(chunk->query_and_seal(&length).ok());
+        }
+        return chunk;
+    }
+
+    // 绕过 chunk 直接改写文件中的数据
+    void corrupt(const ChunkPtr& chunk, uint64_t offset) {
+        FileHandlePtr fh;
+        auto status = _store->open(chunk->chunk_id().str().c_str(), O_RDWR, &fh).get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        IOBuf buf;
+        buf.append("x");
+        status = _store->append(fh, offset, buf).get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+
+    uint64_t _saved_rate = 0;
+    int64_t _saved_threshold = 0;
+    StorePtr _store;
+    std::unique_ptr<Bank> _bank;
+    FakeScrubReporter _reporter;
+    std::atomic<int64_t> _latency = 0;
+    std::unique_ptr<Scrubber> _scrubber;
+};
+
+TEST_F(TestScrubber, FindCorruptedChunk) {
+    auto good = create_chunk(std::string(10000, 'a'), true);
+    auto bad = create_chunk(std::string(10000, 'b'), true);
+    corrupt(bad, 5000);
+
+    ASSERT_EQ(_scrubber->run_once(), 1);
+    ASSERT_EQ(_reporter.reported.size(), 1);
+    ASSERT_EQ(_reporter.reported[0], bad->chunk_id());
+    ASSERT_EQ(_reporter.errors[0], EIO);
+
+    auto progress = _scrubber->progress();
+    ASSERT_EQ(progress.passes, 1);
+    ASSERT_EQ(progress.scanned_chunks, 1);
+    ASSERT_EQ(progress.corrupted_chunks, 1);
+    ASSERT_EQ(progress.position, std::max(good->chunk_id(), bad->chunk_id()));
+
+    // 每一轮都会再次上报
+    ASSERT_EQ(_scrubber->run_once(), 1);
+    ASSERT_EQ(_reporter.reported.size(), 2);
+    ASSERT_EQ(_scrubber->progress().passes, 2);
+    ASSERT_EQ(_scrubber->progress().corrupted_chunks, 2);
+}
+
+TEST_F(TestScrubber, SkipOpenChunks) {
+    auto open = create_chunk(std::string(10000, 'a'), false);
+    auto sealed = create_chunk(std::string(3 * 1024 * 1024 + 1, 'b'), true);
+
+    ASSERT_EQ(_scrubber->run_once(), 0);
+    auto progress = _scrubber->progress();
+    ASSERT_EQ(progress.scanned_chunks, 1);
+    ASSERT_EQ(progress.scanned_bytes, sealed->size());
+    ASSERT_TRUE(_reporter.reported.empty());
+}
+
+TEST_F(TestScrubber, BackOffWhenForegroundIsSlow) {
+    auto max_rate = FLAGS_manusya_scrub_bytes_per_second;
+    for (int i = 0; i < 8; i++) {
+        create_chunk(std::string(4096, 'a'), true);
+    }
+    ASSERT_EQ(_scrubber->progress().rate, max_rate);
+
+    // 每次读都减半，但不低于 1/64
+    _latency = 5000;
+    _scrubber->run_once();
+    ASSERT_EQ(_scrubber->progress().rate, max_rate / 64);
+
+    // 前台恢复后每次读增加 1/16
+    _latency = 100;
+    _scrubber->run_once();
+    ASSERT_EQ(_scrubber->progress().rate, max_rate / 64 + max_rate / 16 * 8);
+    _scrubber->run_once();
+    _scrubber->run_once();
+    ASSERT_EQ(_scrubber->progress().rate, max_rate);
+    ASSERT_EQ(_scrubber->progress().scanned_chunks, 8);
+}
+
+TEST_F(TestScrubber, StartAndStop) {
+    create_chunk(std::string(10000, 'a'), true);
+    ASSERT_TRUE(_scrubber->start().ok());
+    ASSERT_EQ(_scrubber->start().error_code(), EEXIST);
+    while (_scrubber->progress().passes == 0) {
+        usleep(1000);
+    }
+    _scrubber->stop();
+
+    // 限速时 stop 不等待令牌
+    FLAGS_manusya_scrub_bytes_per_second = 1024;
+    create_chunk(std::string(1024 * 1024, 'b'), true);
+    Scrubber slow(_bank.get(), &_reporter, []() {
+        return 0;
+    });
+    ASSERT_TRUE(slow.start().ok());
+    usleep(10 * 1000);
+    auto begin = butil::gettimeofday_us();
+    slow.stop();
+    ASSERT_LT(butil::gettimeofday_us() - begin, 1000 * 1000);
+    ASSERT_EQ(slow.progress().passes, 0);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
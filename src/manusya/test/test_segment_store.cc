@@ -0,0 +1,356 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "manusya/file_handle.h"
+#include "manusya/segment_store.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestSegmentStore : public ::testing::Test {
+protected:
+    static constexpr uint64_t kSegmentSize = 64 * 1024;
+
+    void SetUp() override {
+        // 创建临时测试目录
+        _test_dir = std::filesystem::temp_directory_path() / "test_segment_store";
+        std::filesystem::remove_all(_test_dir);
+        std::filesystem::create_directories(_test_dir);
+        reopen();
+    }
+
+    void TearDown() override {
+        _store.reset();
+
+        // 清理测试目录
+        if (std::filesystem::exists(_test_dir)) {
+            std::filesystem::remove_all(_test_dir);
+        }
+    }
+
+    void reopen() {
+        _store.reset();
+        _store = StorePtr(new SegmentStore(_test_dir.c_str(), Durability::kNone, kSegmentSize));
+    }
+
+    SegmentStore* segment_store() {
+        return dynamic_cast<SegmentStore*>(_store.get());
+    }
+
+    size_t file_count() {
+        return std::distance(std::filesystem::directory_iterator(_test_dir), std::filesystem::directory_iterator());
+    }
+
+    void write_file(const std::string& name, const std::string& data) {
+        FileHandlePtr fh;
+        auto status = _store->open(name.c_str(), O_RDWR | O_CREAT, &fh).get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        IOBuf buf;
+        buf.append(data);
+        status = _store->append(fh, 0, buf).get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+
+    std::string read_file(const std::string& name) {
+        FileHandlePtr fh;
+        auto status = _store->open(name.c_str(), O_RDONLY, &fh).get();
+        if (!status.ok()) {
+            return status.error_str();
+        }
+        uint64_t size = 0;
+        status = _store->size(fh, &size).get();
+        if (!status.ok()) {
+            return status.error_str();
+        }
+        IOBuf buf;
+        status = _store->read(fh, 0, size, &buf).get();
+        if (!status.ok()) {
+            return status.error_str();
+        }
+        return buf.to_string();
+    }
+
+    std::filesystem::path _test_dir;
+    StorePtr _store;
+};
+
+TEST_F(TestSegmentStore, CreateFromUri) {
+    auto store = Store::create(("segment://" + (_test_dir / "uri").string()).c_str());
+    ASSERT_TRUE(dynamic_cast<SegmentStore*>(store.get()) != nullptr);
+}
+
+TEST_F(TestSegmentStore, AppendAndRead) {
+    FileHandlePtr fh;
+    ASSERT_TRUE(_store->open("test_file1", O_RDWR | O_CREAT, &fh).get().ok());
+    IOBuf buf;
+    buf.append("Hello");
+    ASSERT_TRUE(_store->append(fh, 0, buf).get().ok());
+    buf.clear();
+    buf.append(", World!");
+    ASSERT_TRUE(_store->append(fh, 5, buf).get().ok());
+
+    uint64_t size = 0;
+    ASSERT_TRUE(_store->size(fh, &size).get().ok());
+    ASSERT_EQ(size, 13);
+    IOBuf read_buf;
+    read_buf.append("garbage");
+    ASSERT_TRUE(_store->read(fh, 3, 6, &read_buf).get().ok());
+    ASSERT_EQ(read_buf.to_string(), "lo, Wo");
+    ASSERT_EQ(_store->read(fh, 10, 10, &read_buf).get().error_code(), EINVAL);
+}
+
+TEST_F(TestSegmentStore, OpenFlags) {
+    FileHandlePtr fh;
+    ASSERT_EQ(_store->open("test_file1", O_RDONLY, &fh).get().error_code(), ENOENT);
+    ASSERT_TRUE(_store->open("test_file1", O_RDWR | O_CREAT | O_EXCL, &fh).get().ok());
+    ASSERT_EQ(_store->open("test_file1", O_RDWR | O_CREAT | O_EXCL, &fh).get().error_code(), EEXIST);
+    ASSERT_TRUE(_store->open("test_file1", O_RDWR, &fh).get().ok());
+    ASSERT_EQ(_store->remove("test_file2").get().error_code(), ENOENT);
+}
+
+TEST_F(TestSegmentStore, PacksSmallFiles) {
+    // 大量小文件写入同一个 segment，而不是每个文件一个
+    for (int i = 0; i < 100; ++i) {
+        write_file("file" + std::to_string(i), std::string(100, static_cast<char>('a' + i % 26)));
+    }
+    ASSERT_EQ(segment_store()->segment_count(), 1);
+    ASSERT_EQ(file_count(), 1);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(read_file("file" + std::to_string(i)), std::string(100, static_cast<char>('a' + i % 26)));
+    }
+
+    std::vector<std::string> names;
+    _store->for_each([&names](const char* path) {
+        names.emplace_back(path);
+    });
+    ASSERT_EQ(names.size(), 100);
+}
+
+TEST_F(TestSegmentStore, OutOfOrderAppends) {
+    FileHandlePtr fh;
+    ASSERT_TRUE(_store->open("test_file1", O_RDWR | O_CREAT, &fh).get().ok());
+    IOBuf buf;
+    buf.append("World");
+    ASSERT_TRUE(_store->append(fh, 7, buf).get().ok());
+    buf.clear();
+    buf.append("Hello");
+    ASSERT_TRUE(_store->append(fh, 0, buf).get().ok());
+    // 覆盖已写入的范围
+    buf.clear();
+    buf.append("xyz");
+    ASSERT_TRUE(_store->append(fh, 3, buf).get().ok());
+
+    IOBuf read_buf;
+    ASSERT_TRUE(_store->read(fh, 0, 12, &read_buf).get().ok());
+    ASSERT_EQ(read_buf.to_string(), std::string("Helxyz\0World", 12));
+
+    // 重启后按记录顺序恢复
+    fh.reset();
+    reopen();
+    ASSERT_EQ(read_file("test_file1"), std::string("Helxyz\0World", 12));
+}
+
+TEST_F(TestSegmentStore, SealAndAttrs) {
+    FileHandlePtr fh;
+    ASSERT_TRUE(_store->open("test_file1", O_RDWR | O_CREAT, &fh).get().ok());
+    IOBuf buf;
+    buf.append("Hello");
+    ASSERT_TRUE(_store->append(fh, 0, buf).get().ok());
+    ASSERT_TRUE(_store->set_attr(fh, "k1", "v1").get().ok());
+    ASSERT_TRUE(_store->set_attr(fh, "k1", "v2").get().ok());
+    ASSERT_TRUE(_store->seal(fh).get().ok());
+    ASSERT_EQ(_store->append(fh, 5, buf).get().error_code(), EPERM);
+    FileHandlePtr fh2;
+    ASSERT_EQ(_store->open("test_file1", O_RDWR, &fh2).get().error_code(), EACCES);
+    std::string value;
+    ASSERT_EQ(_store->get_attr(fh, "k2", &value).get().error_code(), ENODATA);
+
+    fh.reset();
+    reopen();
+    ASSERT_EQ(_store->open("test_file1", O_RDWR, &fh).get().error_code(), EACCES);
+    ASSERT_TRUE(_store->open("test_file1", O_RDONLY, &fh).get().ok());
+    ASSERT_TRUE(_store->get_attr(fh, "k1", &value).get().ok());
+    ASSERT_EQ(value, "v2");
+    std::map<std::string, std::string> attrs;
+    ASSERT_TRUE(_store->list_attrs(fh, &attrs).get().ok());
+    ASSERT_EQ(attrs.size(), 1);
+    ASSERT_EQ(read_file("test_file1"), "Hello");
+}
+
+TEST_F(TestSegmentStore, LargeAppendSpansSegments) {
+    std::string data(kSegmentSize * 3, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i % 251);
+    }
+    write_file("large", data);
+    ASSERT_GE(segment_store()->segment_count(), 4);
+    ASSERT_EQ(read_file("large"), data);
+
+    reopen();
+    ASSERT_EQ(read_file("large"), data);
+}
+
+TEST_F(TestSegmentStore, CompactReclaimsRemovedFiles) {
+    // 写满多个 segment，删除其中大部分文件
+    std::string data(8 * 1024, 'x');
+    for (int i = 0; i < 32; ++i) {
+        write_file("file" + std::to_string(i), data);
+    }
+    FileHandlePtr fh;
+    ASSERT_TRUE(_store->open("file0", O_RDONLY, &fh).get().ok());
+    ASSERT_TRUE(_store->set_attr(fh, "k1", "v1").get().ok());
+    fh.reset();
+    auto before = segment_store()->segment_count();
+    ASSERT_GE(before, 4);
+    for (int i = 1; i < 32; ++i) {
+        if (i % 8 != 0) {
+            ASSERT_TRUE(_store->remove(("file" + std::to_string(i)).c_str()).get().ok());
+        }
+    }
+
+    segment_store()->compact(0.5);
+    ASSERT_LT(segment_store()->segment_count(), before);
+    ASSERT_EQ(file_count(), segment_store()->segment_count());
+    for (int i = 0; i < 32; i += 8) {
+        ASSERT_EQ(read_file("file" + std::to_string(i)), data);
+    }
+
+    // 压缩后重启，删除的文件不会恢复，保留的数据和属性完整
+    reopen();
+    std::vector<std::string> names;
+    _store->for_each([&names](const char* path) {
+        names.emplace_back(path);
+    });
+    std::sort(names.begin(), names.end());
+    ASSERT_EQ(names, (std::vector<std::string>{"file0", "file16", "file24", "file8"}));
+    for (int i = 0; i < 32; i += 8) {
+        ASSERT_EQ(read_file("file" + std::to_string(i)), data);
+    }
+    ASSERT_TRUE(_store->open("file0", O_RDONLY, &fh).get().ok());
+    std::string value;
+    ASSERT_TRUE(_store->get_attr(fh, "k1", &value).get().ok());
+    ASSERT_EQ(value, "v1");
+}
+
+TEST_F(TestSegmentStore, CompactKeepsLaterOverwrites) {
+    FileHandlePtr fh;
+    ASSERT_TRUE(_store->open("test_file1", O_RDWR | O_CREAT, &fh).get().ok());
+    IOBuf buf;
+    buf.append("Hello");
+    ASSERT_TRUE(_store->append(fh, 0, buf).get().ok());
+    // 填满第一个 segment，使其可以被压缩
+    write_file("filler", std::string(kSegmentSize - 256, 'f'));
+    ASSERT_TRUE(_store->remove("filler").get().ok());
+    buf.clear();
+    buf.append("J");
+    ASSERT_TRUE(_store->append(fh, 0, buf).get().ok());
+
+    segment_store()->compact(1.0);
+    ASSERT_EQ(read_file("test_file1"), "Jello");
+    fh.reset();
+    reopen();
+    ASSERT_EQ(read_file("test_file1"), "Jello");
+}
+
+TEST_F(TestSegmentStore, RecoverPastUnwrittenRecords) {
+    write_file("first", "Hello");
+    write_file("second", "World");
+    write_file("third", std::string(1000, 'x'));
+    _store.reset();
+
+    // 模拟前面预留的记录没有写入：清零第一个文件的所有记录，后面已确认的记录仍要恢复
+    auto path = _test_dir / "segment.00000000";
+    auto size = std::filesystem::file_size(path);
+    int fd = ::open(path.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    std::string zeros(48 * 2 + 5 + 5, '\0');
+    ASSERT_EQ(::pwrite(fd, zeros.data(), zeros.size(), 0), static_cast<ssize_t>(zeros.size()));
+    // 尾部的半条记录被丢弃
+    std::string torn(20, 'M');
+    ASSERT_EQ(::pwrite(fd, torn.data(), torn.size(), static_cast<off_t>(size)), static_cast<ssize_t>(torn.size()));
+    ::close(fd);
+
+    reopen();
+    ASSERT_NE(read_file("first"), "Hello");
+    ASSERT_EQ(read_file("second"), "World");
+    ASSERT_EQ(read_file("third"), std::string(1000, 'x'));
+
+    // 之后的写入接在最后一条记录之后
+    write_file("fourth", "again");
+    reopen();
+    ASSERT_EQ(read_file("second"), "World");
+    ASSERT_EQ(read_file("fourth"), "again");
+}
+
+TEST_F(TestSegmentStore, RecoverSkipsCorruptedData) {
+    write_file("first", "Hello");
+    write_file("second", "World");
+    _store.reset();
+
+    // 头部完整但数据损坏的记录在恢复时丢弃
+    auto path = _test_dir / "segment.00000000";
+    int fd = ::open(path.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    // 第一个文件的数据记录在 create 记录之后
+    auto data_offset = 48 + 5 + 48;
+    ASSERT_EQ(::pwrite(fd, "J", 1, data_offset), 1);
+    ::close(fd);
+
+    reopen();
+    ASSERT_EQ(read_file("first"), "");
+    ASSERT_EQ(read_file("second"), "World");
+}
+
+TEST_F(TestSegmentStore, CompactWhileAppending) {
+    // 追加与压缩并发，压缩不能删除还有未索引记录的 segment
+    constexpr int kThreads = 4;
+    constexpr int kAppends = 64;
+    std::string piece(1024, 'x');
+    std::atomic<bool> stop{false};
+    std::thread compactor([&] {
+        while (!stop.load()) {
+            segment_store()->compact(1.0);
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int i = 0; i < kThreads; ++i) {
+        writers.emplace_back([&, i] {
+            FileHandlePtr fh;
+            auto name = "file" + std::to_string(i);
+            ASSERT_TRUE(_store->open(name.c_str(), O_RDWR | O_CREAT, &fh).get().ok());
+            for (int j = 0; j < kAppends; ++j) {
+                IOBuf buf;
+                buf.append(piece);
+                ASSERT_TRUE(_store->append(fh, j * piece.size(), buf).get().ok());
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    stop = true;
+    compactor.join();
+
+    std::string expected;
+    for (int j = 0; j < kAppends; ++j) {
+        expected += piece;
+    }
+    for (int i = 0; i < kThreads; ++i) {
+        ASSERT_EQ(read_file("file" + std::to_string(i)), expected);
+    }
+    reopen();
+    for (int i = 0; i < kThreads; ++i) {
+        ASSERT_EQ(read_file("file" + std::to_string(i)), expected);
+    }
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
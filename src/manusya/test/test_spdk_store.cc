@@ -0,0 +1,171 @@
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "manusya/file_handle.h"
+#include "manusya/spdk_store.h"
+
+DECLARE_string(manusya_spdk_config);
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestSpdkStore : public ::testing::Test {
+protected:
+    // spdk env 和 subsystem 在进程内只初始化一次，所有用例共享一个基于 malloc bdev 的 store
+    static void SetUpTestSuite() {
+        s_config = std::filesystem::temp_directory_path() / "test_spdk_store.json";
+        std::ofstream out(s_config);
+        out << R"({"subsystems":[{"subsystem":"bdev","config":[{"method":"bdev_malloc_create",)"
+            << R"("params":{"name":"Malloc0","num_blocks":65536,"block_size":512}}]}]})";
+        out.close();
+        FLAGS_manusya_spdk_config = s_config.string();
+        s_store = new SpdkStore("Malloc0");
+        intrusive_ptr_add_ref(s_store);
+    }
+
+    static void TearDownTestSuite() {
+        intrusive_ptr_release(s_store);
+        s_store = nullptr;
+        std::filesystem::remove(s_config);
+    }
+
+    void SetUp() override {
+        if (!s_store->init_status().ok()) {
+            // 没有 hugepage 等运行环境时跳过
+            GTEST_SKIP() << "spdk is not available: " << s_store->init_status().error_str();
+        }
+    }
+
+    FileHandlePtr open(const std::string& path, int flags = O_RDWR | O_CREAT) {
+        FileHandlePtr fh;
+        auto status = s_store->open(path.c_str(), flags, &fh).get();
+        EXPECT_TRUE(status.ok()) << status.error_str();
+        return fh;
+    }
+
+    static inline SpdkStore* s_store = nullptr;
+    static inline std::filesystem::path s_config;
+};
+
+TEST_F(TestSpdkStore, OpenAndRemove) {
+    auto fh = open("open_and_remove");
+    ASSERT_TRUE(fh != nullptr);
+
+    FileHandlePtr fh2;
+    auto status = s_store->open("open_and_remove", O_RDWR | O_CREAT | O_EXCL, &fh2).get();
+    ASSERT_EQ(status.error_code(), EEXIST);
+
+    status = s_store->remove("open_and_remove").get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    status = s_store->open("open_and_remove", O_RDWR, &fh2).get();
+    ASSERT_EQ(status.error_code(), ENOENT);
+}
+
+TEST_F(TestSpdkStore, UnalignedAppendAndRead) {
+    auto fh = open("unaligned");
+    ASSERT_TRUE(fh != nullptr);
+
+    // 非对齐的追加需要对首尾 io unit 读改写
+    std::string expected;
+    for (int i = 0; i < 10; ++i) {
+        std::string data(100 + i * 333, static_cast<char>('a' + i));
+        IOBuf buf;
+        buf.append(data);
+        auto status = s_store->append(fh, expected.size(), buf).get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        expected += data;
+    }
+
+    uint64_t size = 0;
+    ASSERT_TRUE(s_store->size(fh, &size).get().ok());
+    ASSERT_EQ(size, expected.size());
+
+    IOBuf read_buf;
+    auto status = s_store->read(fh, 0, expected.size(), &read_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_TRUE(read_buf.to_string() == expected);
+
+    status = s_store->read(fh, 77, 1000, &read_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_TRUE(read_buf.to_string() == expected.substr(77, 1000));
+
+    status = s_store->read(fh, expected.size(), 1, &read_buf).get();
+    ASSERT_EQ(status.error_code(), EINVAL);
+}
+
+TEST_F(TestSpdkStore, PipelinedOutOfOrderAppends) {
+    auto fh = open("pipelined");
+    ASSERT_TRUE(fh != nullptr);
+
+    // 逆序提交，后面的数据不能被前面写入的填充覆盖
+    constexpr int count = 16;
+    constexpr size_t block = 700;
+    std::vector<Future<Status>> futures;
+    for (int i = count - 1; i >= 0; --i) {
+        IOBuf buf;
+        buf.append(std::string(block, static_cast<char>('a' + i)));
+        futures.push_back(s_store->append(fh, i * block, buf));
+    }
+    for (auto& future : futures) {
+        auto status = future.get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+
+    IOBuf read_buf;
+    auto status = s_store->read(fh, 0, count * block, &read_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    auto data = read_buf.to_string();
+    for (int i = 0; i < count; ++i) {
+        ASSERT_EQ(data.substr(i * block, block), std::string(block, static_cast<char>('a' + i)));
+    }
+}
+
+TEST_F(TestSpdkStore, SealRejectsAppend) {
+    auto fh = open("sealed");
+    ASSERT_TRUE(fh != nullptr);
+
+    IOBuf buf;
+    buf.append("Hello");
+    ASSERT_TRUE(s_store->append(fh, 0, buf).get().ok());
+    ASSERT_TRUE(s_store->seal(fh).get().ok());
+
+    auto status = s_store->append(fh, 5, buf).get();
+    ASSERT_EQ(status.error_code(), EPERM);
+}
+
+TEST_F(TestSpdkStore, Attributes) {
+    auto fh = open("attrs");
+    ASSERT_TRUE(fh != nullptr);
+
+    ASSERT_TRUE(s_store->set_attr(fh, "k1", "v1").get().ok());
+    ASSERT_TRUE(s_store->set_attr(fh, "k2", "v2").get().ok());
+
+    std::string value;
+    ASSERT_TRUE(s_store->get_attr(fh, "k1", &value).get().ok());
+    ASSERT_EQ(value, "v1");
+    ASSERT_EQ(s_store->get_attr(fh, "k3", &value).get().error_code(), ENODATA);
+
+    // 内部使用的 xattr 不会出现在列表中
+    std::map<std::string, std::string> attrs;
+    ASSERT_TRUE(s_store->list_attrs(fh, &attrs).get().ok());
+    ASSERT_EQ(attrs.size(), 2);
+    ASSERT_EQ(attrs["k2"], "v2");
+}
+
+TEST_F(TestSpdkStore, ForEach) {
+    auto fh = open("for_each");
+    ASSERT_TRUE(fh != nullptr);
+
+    bool found = false;
+    s_store->for_each([&](const char* path) {
+        found = found || std::string(path) == "for_each";
+    });
+    ASSERT_TRUE(found);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
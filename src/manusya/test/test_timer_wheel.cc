@@ -0,0 +1,103 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "manusya/timer_wheel.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain::manusya;
+
+struct Counter {
+    std::atomic<int> fired = 0;
+};
+
+void on_timeout(void* arg) {
+    static_cast<Counter*>(arg)->fired++;
+}
+
+void wait_until(const std::function<bool()>& cond, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!cond() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(TestTimerWheel, Expire) {
+    TimerWheel wheel(1000);
+    Counter counter;
+    TimerWheel::Timer timer;
+
+    wheel.add(&timer, 10 * 1000, on_timeout, &counter);
+    ASSERT_EQ(wheel.size(), 1);
+    wait_until([&]() { return counter.fired == 1; }, std::chrono::seconds(5));
+    ASSERT_EQ(counter.fired, 1);
+    ASSERT_EQ(wheel.size(), 0);
+    ASSERT_FALSE(wheel.cancel(&timer));
+}
+
+TEST(TestTimerWheel, Cancel) {
+    TimerWheel wheel(1000);
+    Counter counter;
+    TimerWheel::Timer timer;
+
+    wheel.add(&timer, 50 * 1000, on_timeout, &counter);
+    ASSERT_TRUE(wheel.cancel(&timer));
+    ASSERT_FALSE(wheel.cancel(&timer));
+    ASSERT_EQ(wheel.size(), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(counter.fired, 0);
+}
+
+TEST(TestTimerWheel, NotEarlierThanTimeout) {
+    TimerWheel wheel(1000);
+    Counter counter;
+    TimerWheel::Timer timer;
+
+    auto start = std::chrono::steady_clock::now();
+    wheel.add(&timer, 20 * 1000, on_timeout, &counter);
+    wait_until([&]() { return counter.fired == 1; }, std::chrono::seconds(5));
+    ASSERT_EQ(counter.fired, 1);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
+TEST(TestTimerWheel, CascadeFromHigherLevels) {
+    TimerWheel wheel(100);
+    // 多个超时时间跨越不同层级的时间轮
+    std::vector<uint64_t> timeouts_us = {100, 5 * 1000, 50 * 1000, 300 * 1000};
+    std::vector<TimerWheel::Timer> timers(timeouts_us.size());
+    Counter counter;
+
+    for (size_t i = 0; i < timeouts_us.size(); ++i) {
+        wheel.add(&timers[i], timeouts_us[i], on_timeout, &counter);
+    }
+    ASSERT_EQ(wheel.size(), timeouts_us.size());
+    wait_until([&]() { return counter.fired == static_cast<int>(timeouts_us.size()); }, std::chrono::seconds(5));
+    ASSERT_EQ(counter.fired, timeouts_us.size());
+    ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(TestTimerWheel, ManyTimers) {
+    TimerWheel wheel(1000);
+    const int num_timers = 10000;
+    std::vector<TimerWheel::Timer> timers(num_timers);
+    Counter counter;
+
+    for (int i = 0; i < num_timers; ++i) {
+        wheel.add(&timers[i], (i % 100) * 1000, on_timeout, &counter);
+    }
+    // 取消一半的定时器
+    int cancelled = 0;
+    for (int i = 0; i < num_timers; i += 2) {
+        if (wheel.cancel(&timers[i])) {
+            cancelled++;
+        }
+    }
+    wait_until([&]() { return counter.fired + cancelled == num_timers; }, std::chrono::seconds(5));
+    ASSERT_EQ(counter.fired + cancelled, num_timers);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
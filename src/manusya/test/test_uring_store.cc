@@ -0,0 +1,185 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include "manusya/file_handle.h"
+#include "manusya/uring_store.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+using namespace pain::manusya;
+
+class TestUringStore : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // 创建临时测试目录
+        _test_dir = std::filesystem::temp_directory_path() / "test_uring_store";
+        std::filesystem::create_directories(_test_dir);
+
+        // 注册缓冲区较小，方便同时覆盖 fixed buffer 和 readv/writev 两条路径
+        _store = StorePtr(new UringStore(_test_dir.c_str(), Durability::kNone, 32, 4, 4096));
+    }
+
+    void TearDown() override {
+        _store.reset();
+
+        // 清理测试目录
+        if (std::filesystem::exists(_test_dir)) {
+            std::filesystem::remove_all(_test_dir);
+        }
+    }
+
+    FileHandlePtr open(const char* path) {
+        FileHandlePtr fh;
+        auto status = _store->open(path, O_RDWR | O_CREAT, &fh).get();
+        EXPECT_TRUE(status.ok()) << status.error_str();
+        return fh;
+    }
+
+    std::filesystem::path _test_dir;
+    StorePtr _store;
+};
+
+TEST_F(TestUringStore, CreateFromUri) {
+    auto store = Store::create(("uring://" + _test_dir.string()).c_str());
+    ASSERT_TRUE(store != nullptr);
+    FileHandlePtr fh;
+    auto status = store->open("test_file1", O_RDWR | O_CREAT, &fh).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_TRUE(std::filesystem::exists(_test_dir / "test_file1"));
+}
+
+TEST_F(TestUringStore, BasicAppendAndRead) {
+    auto fh = open("test_file1");
+    ASSERT_TRUE(fh != nullptr);
+
+    IOBuf write_buf;
+    const char* test_data = "Hello, World!";
+    write_buf.append(test_data, strlen(test_data));
+    auto status = _store->append(fh, 0, write_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(std::filesystem::file_size(_test_dir / "test_file1"), strlen(test_data));
+
+    IOBuf read_buf;
+    status = _store->read(fh, 0, strlen(test_data), &read_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(read_buf.to_string(), test_data);
+
+    // 带偏移读取
+    status = _store->read(fh, 7, 5, &read_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(read_buf.to_string(), "World");
+}
+
+TEST_F(TestUringStore, LargeAppendAndRead) {
+    auto fh = open("test_file1");
+    ASSERT_TRUE(fh != nullptr);
+
+    // 超过注册缓冲区大小，走 writev/readv
+    std::string data(1024 * 1024 + 123, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>('a' + i % 26);
+    }
+    IOBuf write_buf;
+    write_buf.append(data);
+    auto status = _store->append(fh, 0, write_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+
+    IOBuf read_buf;
+    status = _store->read(fh, 0, data.size(), &read_buf).get();
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(read_buf.size(), data.size());
+    ASSERT_TRUE(read_buf.to_string() == data);
+}
+
+TEST_F(TestUringStore, PipelinedAppends) {
+    auto fh = open("test_file1");
+    ASSERT_TRUE(fh != nullptr);
+
+    // 不等待完成，连续提交多个写请求
+    constexpr int count = 100;
+    constexpr size_t block = 1000;
+    std::vector<Future<Status>> futures;
+    for (int i = 0; i < count; ++i) {
+        IOBuf buf;
+        buf.append(std::string(block, static_cast<char>('a' + i % 26)));
+        futures.push_back(_store->append(fh, i * block, buf));
+    }
+    for (auto& future : futures) {
+        auto status = future.get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+    ASSERT_EQ(std::filesystem::file_size(_test_dir / "test_file1"), count * block);
+
+    for (int i = 0; i < count; ++i) {
+        IOBuf buf;
+        auto status = _store->read(fh, i * block, block, &buf).get();
+        ASSERT_TRUE(status.ok()) << status.error_str();
+        ASSERT_EQ(buf.to_string(), std::string(block, static_cast<char>('a' + i % 26)));
+    }
+}
+
+TEST_F(TestUringStore, ConcurrentAppendAndRead) {
+    constexpr int thread_count = 8;
+    constexpr int loop = 50;
+    constexpr size_t block = 512;
+    std::vector<FileHandlePtr> handles;
+    for (int i = 0; i < thread_count; ++i) {
+        handles.push_back(open(("test_file" + std::to_string(i)).c_str()));
+    }
+
+    std::atomic<int> failed = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+            auto fh = handles[t];
+            for (int i = 0; i < loop; ++i) {
+                std::string data(block, static_cast<char>('a' + (t + i) % 26));
+                IOBuf buf;
+                buf.append(data);
+                if (!_store->append(fh, i * block, buf).get().ok()) {
+                    failed++;
+                    continue;
+                }
+                IOBuf read_buf;
+                if (!_store->read(fh, i * block, block, &read_buf).get().ok() || read_buf.to_string() != data) {
+                    failed++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(failed, 0);
+}
+
+TEST_F(TestUringStore, ReadBeyondFileSize) {
+    auto fh = open("test_file1");
+    ASSERT_TRUE(fh != nullptr);
+
+    IOBuf write_buf;
+    write_buf.append("Hello");
+    ASSERT_TRUE(_store->append(fh, 0, write_buf).get().ok());
+
+    IOBuf read_buf;
+    auto status = _store->read(fh, 100, 10, &read_buf).get();
+    ASSERT_FALSE(status.ok());
+    ASSERT_EQ(status.error_code(), EINVAL);
+}
+
+TEST_F(TestUringStore, NullArguments) {
+    IOBuf buf;
+    buf.append("Hello");
+    ASSERT_EQ(_store->append(nullptr, 0, buf).get().error_code(), EINVAL);
+    ASSERT_EQ(_store->read(nullptr, 0, 5, &buf).get().error_code(), EINVAL);
+
+    auto fh = open("test_file1");
+    ASSERT_TRUE(fh != nullptr);
+    ASSERT_EQ(_store->read(fh, 0, 5, nullptr).get().error_code(), EINVAL);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
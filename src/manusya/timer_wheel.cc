@@ -0,0 +1,116 @@
+#include "manusya/timer_wheel.h"
+#include <butil/time.h>
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <mutex>
+#include <boost/assert.hpp>
+
+DEFINE_uint64(manusya_timer_wheel_tick_us, 10 * 1000, "Tick of the timer wheel used by pending appends");
+
+namespace pain::manusya {
+
+TimerWheel::TimerWheel(uint64_t tick_us) : _tick_us(std::max<uint64_t>(tick_us, 1)) {
+    _start_us = butil::monotonic_time_us();
+    _thread = std::thread([this]() {
+        run();
+    });
+}
+
+TimerWheel::~TimerWheel() {
+    _stopped = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+TimerWheel& TimerWheel::instance() {
+    static TimerWheel s_timer_wheel(FLAGS_manusya_timer_wheel_tick_us);
+    return s_timer_wheel;
+}
+
+uint64_t TimerWheel::now_tick() const {
+    return (butil::monotonic_time_us() - _start_us) / _tick_us;
+}
+
+void TimerWheel::add(Timer* timer, uint64_t timeout_us, Callback callback, void* arg) {
+    BOOST_ASSERT(timer != nullptr);
+    BOOST_ASSERT(!timer->hook.is_linked());
+    // round up so that the timer never fires earlier than timeout_us
+    timer->expire_tick = now_tick() + (timeout_us + _tick_us - 1) / _tick_us;
+    timer->callback = callback;
+    timer->arg = arg;
+    std::lock_guard lock(_mutex);
+    add_locked(timer);
+    _size.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool TimerWheel::cancel(Timer* timer) {
+    BOOST_ASSERT(timer != nullptr);
+    std::lock_guard lock(_mutex);
+    if (!timer->hook.is_linked()) {
+        return false;
+    }
+    timer->hook.unlink();
+    _size.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void TimerWheel::add_locked(Timer* timer) {
+    auto expire = std::max(timer->expire_tick, _next_tick);
+    auto delta = std::min(expire - _next_tick, kMaxDelta);
+    expire = _next_tick + delta;
+    uint32_t level = 0;
+    while (level + 1 < kLevelCount && delta >= (1ULL << (kSlotBits * (level + 1)))) {
+        level++;
+    }
+    auto slot = (expire >> (kSlotBits * level)) & kSlotMask;
+    _wheels[level][slot].push_back(*timer);
+}
+
+void TimerWheel::cascade(uint32_t level, uint32_t slot) {
+    auto& list = _wheels[level][slot];
+    while (!list.empty()) {
+        auto& timer = list.front();
+        list.pop_front();
+        add_locked(&timer);
+    }
+}
+
+void TimerWheel::advance(uint64_t tick, std::vector<Timer*>* expired) {
+    std::lock_guard lock(_mutex);
+    for (; _next_tick <= tick; _next_tick++) {
+        auto t = _next_tick;
+        // move timers of higher levels down when lower levels wrap around
+        if ((t & kSlotMask) == 0) {
+            for (uint32_t level = 1; level < kLevelCount; level++) {
+                auto slot = (t >> (kSlotBits * level)) & kSlotMask;
+                cascade(level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+        auto& list = _wheels[0][t & kSlotMask];
+        while (!list.empty()) {
+            auto& timer = list.front();
+            list.pop_front();
+            expired->push_back(&timer);
+        }
+    }
+    _size.fetch_sub(expired->size(), std::memory_order_relaxed);
+}
+
+void TimerWheel::run() {
+    std::vector<Timer*> expired;
+    while (!_stopped.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(_tick_us));
+        advance(now_tick(), &expired);
+        // callbacks are called without holding the lock, they may add or cancel timers
+        for (auto* timer : expired) {
+            timer->callback(timer->arg);
+        }
+        expired.clear();
+    }
+}
+
+} // namespace pain::manusya
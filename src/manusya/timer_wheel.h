@@ -0,0 +1,76 @@
+#pragma once
+
+#include <bthread/mutex.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <boost/intrusive/list.hpp>
+
+namespace pain::manusya {
+
+// Hierarchical timing wheel, timers are added and cancelled in O(1) and expired in batch by a
+// single ticking thread, which is much cheaper than one bthread_timer per short-lived request.
+class TimerWheel {
+public:
+    using Callback = void (*)(void*);
+
+    struct Timer {
+        boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>> hook;
+        uint64_t expire_tick = 0;
+        Callback callback = nullptr;
+        void* arg = nullptr;
+    };
+
+    TimerWheel(uint64_t tick_us);
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    static TimerWheel& instance();
+
+    // callback is called in the ticking thread after at least timeout_us
+    void add(Timer* timer, uint64_t timeout_us, Callback callback, void* arg);
+
+    // return true if the timer is removed before its callback is called,
+    // otherwise the callback is running or has been run
+    bool cancel(Timer* timer);
+
+    size_t size() const {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t kSlotBits = 6;
+    static constexpr uint32_t kSlotCount = 1U << kSlotBits;
+    static constexpr uint32_t kSlotMask = kSlotCount - 1;
+    static constexpr uint32_t kLevelCount = 4;
+    static constexpr uint64_t kMaxDelta = (1ULL << (kSlotBits * kLevelCount)) - 1;
+
+    using TimerList = boost::intrusive::list<
+        Timer,
+        boost::intrusive::member_hook<Timer,
+                                      boost::intrusive::list_member_hook<
+                                          boost::intrusive::link_mode<boost::intrusive::auto_unlink>>,
+                                      &Timer::hook>,
+        boost::intrusive::constant_time_size<false>>;
+
+    uint64_t now_tick() const;
+    void run();
+    void advance(uint64_t tick, std::vector<Timer*>* expired);
+    void cascade(uint32_t level, uint32_t slot);
+    void add_locked(Timer* timer);
+
+    uint64_t _tick_us;
+    uint64_t _start_us;
+    // the next tick to be processed, all timers before it have been expired
+    uint64_t _next_tick = 0;
+    std::array<std::array<TimerList, kSlotCount>, kLevelCount> _wheels;
+    std::atomic<size_t> _size = 0;
+    bthread::Mutex _mutex;
+    std::atomic<bool> _stopped = false;
+    std::thread _thread;
+};
+
+} // namespace pain::manusya
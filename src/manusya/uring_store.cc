@@ -0,0 +1,506 @@
+#include "manusya/uring_store.h"
+
+#include <pain/base/plog.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include "manusya/file_handle.h"
+
+namespace pain::manusya {
+
+struct UringRequest {
+    enum class Type {
+        kNop,
+        kWrite,
+        kRead,
+    };
+
+    Type type = Type::kNop;
+    // no reference is held on the file handle, otherwise the store could be destroyed in the
+    // reaping thread, callers keep the handle until the future is ready. The pin keeps the fd
+    // open and is handed to the group committer after a write
+    std::shared_ptr<FdPin> pin;
+    int fd = -1;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t done = 0;
+    // write payload, written bytes are popped when not using a registered buffer
+    IOBuf data;
+    std::vector<iovec> iov;
+    IOBuf* out = nullptr;
+    int buffer_index = -1;
+    char* buffer = nullptr;
+    Promise<Status> promise;
+};
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// how long a submission rejected with EAGAIN or EBUSY waits for completions before retrying
+constexpr long kSubmitRetryUs = 1000;
+
+template <typename T>
+T* ring_field(void* ptr, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(ptr) + offset);
+}
+
+} // namespace
+
+UringStore::UringStore(const char* data_path,
+                       Durability durability,
+                       uint32_t queue_depth,
+                       uint32_t buffer_count,
+                       uint32_t buffer_size,
+                       bool catalog) :
+    LocalStore(data_path, durability, catalog) {
+    if (!setup(queue_depth)) {
+        PLOG_WARN(("desc", "io_uring is not available, fallback to synchronous I/O")("error", errno));
+        return;
+    }
+    register_buffers(buffer_count, buffer_size);
+    _reaper = std::thread([this]() {
+        reap();
+    });
+}
+
+UringStore::~UringStore() {
+    if (_ring_fd < 0) {
+        return;
+    }
+    // wake up the reaper with a nop
+    _stopped = true;
+    acquire_slot();
+    auto rq = new UringRequest();
+    rq->type = UringRequest::Type::kNop;
+    submit(rq);
+    _reaper.join();
+
+    if (!_buffers.empty()) {
+        io_uring_register(_ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+    for (auto* buffer : _buffers) {
+        free(buffer);
+    }
+    munmap(_sqes, _sqes_size);
+    if (_cq_ptr != _sq_ptr) {
+        munmap(_cq_ptr, _cq_size);
+    }
+    munmap(_sq_ptr, _sq_size);
+    close(_ring_fd);
+}
+
+bool UringStore::setup(uint32_t queue_depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = io_uring_setup(queue_depth, &params);
+    if (fd < 0) {
+        return false;
+    }
+
+    _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+    }
+
+    _sq_ptr = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (_sq_ptr == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    _cq_ptr = _sq_ptr;
+    if (!single_mmap) {
+        _cq_ptr = mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (_cq_ptr == MAP_FAILED) {
+            munmap(_sq_ptr, _sq_size);
+            close(fd);
+            return false;
+        }
+    }
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    auto sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (_cq_ptr != _sq_ptr) {
+            munmap(_cq_ptr, _cq_size);
+        }
+        munmap(_sq_ptr, _sq_size);
+        close(fd);
+        return false;
+    }
+    _sqes = static_cast<io_uring_sqe*>(sqes);
+
+    _sq_head = ring_field<unsigned>(_sq_ptr, params.sq_off.head);
+    _sq_tail = ring_field<unsigned>(_sq_ptr, params.sq_off.tail);
+    _sq_ring_mask = ring_field<unsigned>(_sq_ptr, params.sq_off.ring_mask);
+    _sq_array = ring_field<unsigned>(_sq_ptr, params.sq_off.array);
+    _cq_head = ring_field<unsigned>(_cq_ptr, params.cq_off.head);
+    _cq_tail = ring_field<unsigned>(_cq_ptr, params.cq_off.tail);
+    _cq_ring_mask = ring_field<unsigned>(_cq_ptr, params.cq_off.ring_mask);
+    _cqes = ring_field<io_uring_cqe>(_cq_ptr, params.cq_off.cqes);
+
+    _queue_depth = params.sq_entries;
+    _ring_fd = fd;
+    return true;
+}
+
+void UringStore::register_buffers(uint32_t buffer_count, uint32_t buffer_size) {
+    constexpr size_t alignment = 4096;
+    std::vector<iovec> iovs;
+    for (uint32_t i = 0; i < buffer_count; i++) {
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, alignment, buffer_size) != 0) {
+            break;
+        }
+        _buffers.push_back(static_cast<char*>(buffer));
+        iovs.push_back({buffer, buffer_size});
+    }
+    if (iovs.empty()) {
+        return;
+    }
+    if (io_uring_register(_ring_fd, IORING_REGISTER_BUFFERS, iovs.data(), iovs.size()) < 0) {
+        // usually limited by RLIMIT_MEMLOCK, all I/Os go through the unregistered path
+        PLOG_WARN(("desc", "failed to register buffers")("error", errno)("count", iovs.size()));
+        for (auto* buffer : _buffers) {
+            free(buffer);
+        }
+        _buffers.clear();
+        return;
+    }
+    _buffer_size = buffer_size;
+    for (int i = static_cast<int>(_buffers.size()) - 1; i >= 0; i--) {
+        _free_buffers.push_back(i);
+    }
+}
+
+int UringStore::acquire_buffer(uint64_t size) {
+    if (size == 0 || size > _buffer_size) {
+        return -1;
+    }
+    std::lock_guard lock(_buffer_mutex);
+    if (_free_buffers.empty()) {
+        return -1;
+    }
+    auto index = _free_buffers.back();
+    _free_buffers.pop_back();
+    return index;
+}
+
+void UringStore::release_buffer(int index) {
+    std::lock_guard lock(_buffer_mutex);
+    _free_buffers.push_back(index);
+}
+
+void UringStore::acquire_slot() {
+    std::unique_lock lock(_inflight_mutex);
+    while (_inflight >= _queue_depth) {
+        _inflight_cond.wait(lock);
+    }
+    _inflight++;
+}
+
+void UringStore::release_slot() {
+    std::lock_guard lock(_inflight_mutex);
+    _inflight--;
+    _inflight_cond.notify_one();
+    _completion_cond.notify_all();
+}
+
+Future<Status> UringStore::append(FileHandlePtr fh, uint64_t offset, IOBuf buf) {
+    if (_ring_fd < 0) {
+        return LocalStore::append(fh, offset, buf);
+    }
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (buf.empty()) {
+        return make_ready_future(Status::OK());
+    }
+
+    auto rq = new UringRequest();
+    rq->type = UringRequest::Type::kWrite;
+    rq->pin = std::make_shared<FdPin>();
+    auto status = fh->as<LocalFileHandle>()->pin(rq->pin.get());
+    if (!status.ok()) {
+        delete rq;
+        return make_ready_future(std::move(status));
+    }
+    rq->fd = rq->pin->fd();
+    rq->offset = offset;
+    rq->size = buf.size();
+    rq->buffer_index = acquire_buffer(rq->size);
+    if (rq->buffer_index >= 0) {
+        rq->buffer = _buffers[rq->buffer_index];
+        buf.copy_to(rq->buffer, rq->size);
+    } else {
+        rq->data.swap(buf);
+    }
+    auto future = rq->promise.get_future();
+    acquire_slot();
+    submit(rq);
+    return future;
+}
+
+Future<Status> UringStore::read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) {
+    if (_ring_fd < 0) {
+        return LocalStore::read(fh, offset, size, buf);
+    }
+    if (fh == nullptr) {
+        return make_ready_future(Status(EINVAL, "fh is nullptr"));
+    }
+    if (buf == nullptr) {
+        return make_ready_future(Status(EINVAL, "buf is nullptr"));
+    }
+    if (size == 0) {
+        buf->clear();
+        return make_ready_future(Status::OK());
+    }
+
+    auto rq = new UringRequest();
+    rq->type = UringRequest::Type::kRead;
+    rq->pin = std::make_shared<FdPin>();
+    auto status = fh->as<LocalFileHandle>()->pin(rq->pin.get());
+    if (!status.ok()) {
+        delete rq;
+        return make_ready_future(std::move(status));
+    }
+    rq->fd = rq->pin->fd();
+    rq->offset = offset;
+    rq->size = size;
+    rq->out = buf;
+    rq->buffer_index = acquire_buffer(size);
+    if (rq->buffer_index >= 0) {
+        rq->buffer = _buffers[rq->buffer_index];
+    } else {
+        // read directly into a heap block which is handed over to the IOBuf without copy
+        rq->buffer = static_cast<char*>(malloc(size));
+        if (rq->buffer == nullptr) {
+            delete rq;
+            return make_ready_future(Status(ENOMEM, "failed to allocate read buffer"));
+        }
+    }
+    auto future = rq->promise.get_future();
+    acquire_slot();
+    submit(rq);
+    return future;
+}
+
+void UringStore::prepare(UringRequest* rq, io_uring_sqe* sqe) {
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = reinterpret_cast<uint64_t>(rq);
+    if (rq->type == UringRequest::Type::kNop) {
+        sqe->opcode = IORING_OP_NOP;
+        return;
+    }
+
+    sqe->fd = rq->fd;
+    sqe->off = rq->offset + rq->done;
+    if (rq->buffer_index >= 0) {
+        sqe->opcode = rq->type == UringRequest::Type::kWrite ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->addr = reinterpret_cast<uint64_t>(rq->buffer + rq->done);
+        sqe->len = rq->size - rq->done;
+        sqe->buf_index = rq->buffer_index;
+        return;
+    }
+
+    rq->iov.clear();
+    if (rq->type == UringRequest::Type::kWrite) {
+        // gather the IOBuf blocks without copying, the rest is resubmitted on short write
+        sqe->opcode = IORING_OP_WRITEV;
+        auto block_num = std::min<size_t>(rq->data.backing_block_num(), IOV_MAX);
+        for (size_t i = 0; i < block_num; i++) {
+            auto block = rq->data.backing_block(i);
+            rq->iov.push_back({const_cast<char*>(block.data()), block.size()});
+        }
+    } else {
+        sqe->opcode = IORING_OP_READV;
+        rq->iov.push_back({rq->buffer + rq->done, rq->size - rq->done});
+    }
+    sqe->addr = reinterpret_cast<uint64_t>(rq->iov.data());
+    sqe->len = rq->iov.size();
+}
+
+void UringStore::submit(UringRequest* rq) {
+    {
+        std::lock_guard lock(_sq_mutex);
+        auto tail = *_sq_tail;
+        auto index = tail & *_sq_ring_mask;
+        prepare(rq, &_sqes[index]);
+        _sq_array[index] = index;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        _unsubmitted++;
+    }
+    submit_pending();
+}
+
+bool UringStore::submit_pending() {
+    std::unique_lock lock(_sq_mutex);
+    // whoever is already in io_uring_enter submits the new entries in its next round,
+    // so concurrent callers are batched into one syscall
+    if (_submitting) {
+        return true;
+    }
+    _submitting = true;
+    std::vector<UringRequest*> failed;
+    int error = 0;
+    while (_unsubmitted > 0) {
+        auto to_submit = _unsubmitted;
+        _unsubmitted = 0;
+        lock.unlock();
+        int r = io_uring_enter(_ring_fd, to_submit, 0, 0);
+        error = errno;
+        lock.lock();
+        if (r >= 0) {
+            _unsubmitted += to_submit - r;
+            continue;
+        }
+        _unsubmitted += to_submit;
+        if (error == EINTR) {
+            continue;
+        }
+        if (error == EAGAIN || error == EBUSY) {
+            // out of kernel resources or completions pending, retry after some requests
+            // complete. The reaper can't wait for itself, it retries after reaping
+            if (std::this_thread::get_id() == _reaper.get_id()) {
+                break;
+            }
+            lock.unlock();
+            wait_completion();
+            lock.lock();
+            continue;
+        }
+
+        // entries the kernel didn't consume would never complete, take them back and fail them
+        PLOG_ERROR(("desc", "failed to submit to io_uring")("error", error)("count", _unsubmitted));
+        auto head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+        auto tail = *_sq_tail;
+        for (auto i = head; i != tail; i++) {
+            failed.push_back(reinterpret_cast<UringRequest*>(_sqes[i & *_sq_ring_mask].user_data));
+        }
+        __atomic_store_n(_sq_tail, head, __ATOMIC_RELEASE);
+        _unsubmitted = 0;
+    }
+    bool done = _unsubmitted == 0;
+    _submitting = false;
+    lock.unlock();
+
+    for (auto* rq : failed) {
+        complete(rq, -error);
+    }
+    return done;
+}
+
+void UringStore::wait_completion() {
+    std::unique_lock lock(_inflight_mutex);
+    _completion_cond.wait_for(lock, kSubmitRetryUs);
+}
+
+void UringStore::reap() {
+    while (true) {
+        auto head = *_cq_head;
+        auto tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (_stopped.load(std::memory_order_relaxed)) {
+                std::lock_guard lock(_inflight_mutex);
+                if (_inflight == 0) {
+                    return;
+                }
+            }
+            // entries left by a resubmit of the reaper while the ring was busy
+            if (!submit_pending()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(kSubmitRetryUs));
+                continue;
+            }
+            int r = io_uring_enter(_ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+            if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                PLOG_ERROR(("desc", "failed to wait io_uring")("error", errno));
+            }
+            continue;
+        }
+
+        for (; head != tail; head++) {
+            auto& cqe = _cqes[head & *_cq_ring_mask];
+            auto rq = reinterpret_cast<UringRequest*>(cqe.user_data);
+            auto res = cqe.res;
+            // release the cqe before completing, a resubmit may need the slot
+            __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+            complete(rq, res);
+        }
+    }
+}
+
+void UringStore::complete(UringRequest* rq, int res) {
+    if (rq->type == UringRequest::Type::kNop) {
+        delete rq;
+        release_slot();
+        return;
+    }
+
+    if (res == -EINTR || res == -EAGAIN) {
+        submit(rq);
+        return;
+    }
+
+    Status status;
+    if (res < 0) {
+        PLOG_ERROR(("desc", "io_uring request failed")("fd", rq->fd)("offset", rq->offset)("error", -res));
+        status = Status(-res, rq->type == UringRequest::Type::kWrite ? "failed to write to file"
+                                                                     : "failed to read from file");
+    } else if (res == 0 && rq->type == UringRequest::Type::kRead) {
+        status = Status(EINVAL, "invalid size");
+    } else {
+        rq->done += res;
+        if (rq->buffer_index < 0 && rq->type == UringRequest::Type::kWrite) {
+            rq->data.pop_front(res);
+        }
+        if (rq->done < rq->size) {
+            submit(rq);
+            return;
+        }
+    }
+
+    if (rq->type == UringRequest::Type::kRead) {
+        if (status.ok()) {
+            rq->out->clear();
+            if (rq->buffer_index >= 0) {
+                rq->out->append(rq->buffer, rq->size);
+            } else {
+                rq->out->append_user_data(rq->buffer, rq->size, free);
+                rq->buffer = nullptr;
+            }
+        } else if (rq->buffer_index < 0) {
+            free(rq->buffer);
+        }
+    }
+    if (rq->buffer_index >= 0) {
+        release_buffer(rq->buffer_index);
+    }
+    if (status.ok() && rq->type == UringRequest::Type::kWrite && durability() == Durability::kGroupCommit) {
+        committer()->commit(rq->fd, rq->size, std::move(rq->promise), std::move(rq->pin));
+    } else {
+        rq->promise.set_value(std::move(status));
+    }
+    delete rq;
+    release_slot();
+}
+
+} // namespace pain::manusya
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+#include <linux/io_uring.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "manusya/local_store.h"
+
+namespace pain::manusya {
+
+struct UringRequest;
+
+// UringStore keeps the on-disk layout and metadata operations of LocalStore, but appends and
+// reads are submitted to an io_uring and their futures are fulfilled by a reaping thread, so
+// callers can keep many I/Os in flight without blocking a worker in a syscall.
+// The file handle must be kept until the returned future is ready.
+// Falls back to the synchronous LocalStore path if io_uring is not available.
+class UringStore : public LocalStore {
+public:
+    UringStore(const char* data_path,
+               Durability durability,
+               uint32_t queue_depth,
+               uint32_t buffer_count,
+               uint32_t buffer_size,
+               bool catalog = false);
+    ~UringStore() override;
+
+    Future<Status> append(FileHandlePtr fh, uint64_t offset, IOBuf buf) override;
+    Future<Status> read(FileHandlePtr fh, uint64_t offset, uint64_t size, IOBuf* buf) override;
+
+    bool enabled() const {
+        return _ring_fd >= 0;
+    }
+
+private:
+    bool setup(uint32_t queue_depth);
+    void register_buffers(uint32_t buffer_count, uint32_t buffer_size);
+    int acquire_buffer(uint64_t size);
+    void release_buffer(int index);
+    void acquire_slot();
+    void release_slot();
+
+    void submit(UringRequest* rq);
+    // submits the queued entries, returns false if some are left for a later round
+    bool submit_pending();
+    void wait_completion();
+    void prepare(UringRequest* rq, io_uring_sqe* sqe);
+    void reap();
+    void complete(UringRequest* rq, int res);
+
+    int _ring_fd = -1;
+    uint32_t _queue_depth = 0;
+
+    // submission ring
+    void* _sq_ptr = nullptr;
+    size_t _sq_size = 0;
+    unsigned* _sq_head = nullptr;
+    unsigned* _sq_tail = nullptr;
+    unsigned* _sq_ring_mask = nullptr;
+    unsigned* _sq_array = nullptr;
+    io_uring_sqe* _sqes = nullptr;
+    size_t _sqes_size = 0;
+    uint32_t _unsubmitted = 0;
+    bool _submitting = false;
+    bthread::Mutex _sq_mutex;
+
+    // completion ring
+    void* _cq_ptr = nullptr;
+    size_t _cq_size = 0;
+    unsigned* _cq_head = nullptr;
+    unsigned* _cq_tail = nullptr;
+    unsigned* _cq_ring_mask = nullptr;
+    io_uring_cqe* _cqes = nullptr;
+
+    // registered buffers, small I/Os are copied into them to avoid pinning pages per request
+    std::vector<char*> _buffers;
+    std::vector<int> _free_buffers;
+    uint32_t _buffer_size = 0;
+    bthread::Mutex _buffer_mutex;
+
+    // requests in flight are bounded by the queue depth so the rings never overflow
+    uint32_t _inflight = 0;
+    bthread::Mutex _inflight_mutex;
+    bthread::ConditionVariable _inflight_cond;
+    // notified on each completion, for submissions waiting for the ring to drain
+    bthread::ConditionVariable _completion_cond;
+
+    std::atomic<bool> _stopped = false;
+    std::thread _reaper;
+};
+
+} // namespace pain::manusya
@@ -11,7 +11,7 @@ enum class ChunkState {
 
 enum class ChunkType {
     kReplication = 0,
-    kEc = 1, // not supported
+    kEc = 1,
 };
 
 struct Location {
@@ -29,8 +29,8 @@ struct Chunk {
     UUID uuid;
     ChunkState chunk_state;
     ChunkType chunk_type;
-    uint32_t m; // replica count
-    uint32_t n; // redundancy
+    uint32_t m; // replica count, data cells of a stripe for kEc
+    uint32_t n; // redundancy, parity cells of a stripe for kEc
     std::vector<SubChunk> sub_chunks;
 };
 
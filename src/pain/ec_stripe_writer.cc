@@ -0,0 +1,222 @@
+#include "pain/ec_stripe_writer.h"
+#include <brpc/callback.h>
+#include <brpc/controller.h>
+#include <fmt/format.h>
+#include <pain/base/plog.h>
+#include <pain/base/tracer.h>
+#include <algorithm>
+#include <cerrno>
+#include "pain/proto/manusya.pb.h"
+#include "common/crc32c.h"
+#include "common/object_id_util.h"
+
+namespace pain {
+
+namespace {
+constexpr int kTimeoutMs = 20000;
+constexpr int kConnectTimeoutMs = 2000;
+// bytes of cells sent to a chunk by one append, larger appends are split
+constexpr uint64_t kMaxBatchBytes = 16 * 1024 * 1024;
+
+Status check(const brpc::Controller& cntl, const proto::Header& header) {
+    if (cntl.Failed()) {
+        return Status(cntl.ErrorCode(), cntl.ErrorText());
+    }
+    if (header.status() != 0) {
+        return Status(header.status(), header.message());
+    }
+    return Status::OK();
+}
+} // namespace
+
+EcStripeWriter::EcStripeWriter(common::ErasureCodePtr code, uint32_t cell_size) :
+    _code(std::move(code)), _cell_size(cell_size) {}
+
+Status EcStripeWriter::create(common::ErasureCodePtr code,
+                              uint32_t cell_size,
+                              uint32_t partition_id,
+                              const std::vector<std::string>& addresses,
+                              std::unique_ptr<EcStripeWriter>* writer) {
+    if (cell_size == 0) {
+        return Status(EINVAL, "cell size is 0");
+    }
+    if (addresses.size() != code->fragment_count()) {
+        return Status(EINVAL, fmt::format("{} manusya for {} cells", addresses.size(), code->fragment_count()));
+    }
+    std::unique_ptr<EcStripeWriter> w(new EcStripeWriter(std::move(code), cell_size));
+    for (const auto& address : addresses) {
+        auto status = w->open_chunk(address, partition_id);
+        if (!status.ok()) {
+            w->remove_chunks();
+            return status;
+        }
+    }
+    *writer = std::move(w);
+    return Status::OK();
+}
+
+Status EcStripeWriter::open_chunk(const std::string& address, uint32_t partition_id) {
+    auto channel = std::make_unique<brpc::Channel>();
+    brpc::ChannelOptions options;
+    options.timeout_ms = kTimeoutMs;
+    options.connect_timeout_ms = kConnectTimeoutMs;
+    // a retried append whose first try landed fails on the offset, the group is replaced instead
+    options.max_retry = 0;
+    if (channel->Init(address.c_str(), &options) != 0) {
+        return Status(EINVAL, fmt::format("failed to connect to manusya {}", address));
+    }
+
+    proto::manusya::CreateChunkRequest request;
+    proto::manusya::CreateChunkResponse response;
+    request.set_partition_id(partition_id);
+    brpc::Controller cntl;
+    inject_tracer(&cntl);
+    proto::manusya::ManusyaService_Stub stub(channel.get());
+    stub.CreateChunk(&cntl, &request, &response, nullptr);
+    auto status = check(cntl, response.header());
+    if (!status.ok()) {
+        return status;
+    }
+    _chunks.push_back(CellChunk{address, common::from_proto(response.chunk_id())});
+    _channels.push_back(std::move(channel));
+    return Status::OK();
+}
+
+Status EcStripeWriter::append(const IOBuf& data, bool direct_io) {
+    if (!_status.ok()) {
+        return _status;
+    }
+    if (_sealed) {
+        return Status(EPERM, "chunk group is sealed");
+    }
+    _buffer.append(data);
+    auto size = _buffer.size() / stripe_size() * stripe_size();
+    if (size == 0) {
+        return Status::OK();
+    }
+    IOBuf stripes;
+    _buffer.cutn(&stripes, size);
+    return write_stripes(&stripes, direct_io);
+}
+
+Status EcStripeWriter::seal(bool direct_io) {
+    if (_sealed) {
+        return _status;
+    }
+    _sealed = true;
+    if (_status.ok() && !_buffer.empty()) {
+        IOBuf stripe;
+        stripe.swap(_buffer);
+        auto size = stripe.size();
+        stripe.resize(stripe_size());
+        if (write_stripes(&stripe, direct_io).ok()) {
+            // the padding is not data of the file
+            _durable_size -= stripe_size() - size;
+        }
+    }
+    auto status = seal_chunks();
+    return _status.ok() ? status : _status;
+}
+
+Status EcStripeWriter::write_stripes(IOBuf* stripes, bool direct_io) {
+    auto batch_stripes = std::max<uint64_t>(1, kMaxBatchBytes / _cell_size);
+    while (!stripes->empty()) {
+        auto count = std::min<uint64_t>(stripes->size() / stripe_size(), batch_stripes);
+        // cell i of consecutive stripes is contiguous in chunk i, one append per chunk carries them
+        std::vector<IOBuf> cells(_chunks.size());
+        for (uint64_t s = 0; s < count; s++) {
+            IOBuf stripe;
+            stripes->cutn(&stripe, stripe_size());
+            std::vector<IOBuf> fragments;
+            _status = _code->encode(stripe, &fragments);
+            if (!_status.ok()) {
+                return _status;
+            }
+            for (size_t i = 0; i < cells.size(); i++) {
+                cells[i].append(fragments[i]);
+            }
+        }
+
+        auto offset = _stripe_count * _cell_size;
+        std::vector<brpc::Controller> cntls(_chunks.size());
+        std::vector<proto::manusya::AppendChunkRequest> requests(_chunks.size());
+        std::vector<proto::manusya::AppendChunkResponse> responses(_chunks.size());
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            common::to_proto(_chunks[i].chunk_id, requests[i].mutable_chunk_id());
+            requests[i].set_offset(offset);
+            requests[i].set_length(cells[i].size());
+            requests[i].set_crc32(common::crc32c(cells[i]));
+            requests[i].set_direct_io(direct_io);
+            cntls[i].request_attachment().swap(cells[i]);
+            inject_tracer(&cntls[i]);
+            proto::manusya::ManusyaService_Stub stub(_channels[i].get());
+            stub.AppendChunk(&cntls[i], &requests[i], &responses[i], brpc::DoNothing());
+        }
+        // the stripes are acked only once every cell is durable
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            brpc::Join(cntls[i].call_id());
+            auto status = check(cntls[i], responses[i].header());
+            if (!status.ok() && _status.ok()) {
+                PLOG_ERROR(("desc", "failed to append cells")   //
+                           ("chunk", _chunks[i].chunk_id.str()) //
+                           ("address", _chunks[i].address)      //
+                           ("offset", offset)                   //
+                           ("errno", status.error_code())       //
+                           ("error", status.error_str()));
+                _status = status;
+            }
+        }
+        if (!_status.ok()) {
+            return _status;
+        }
+        _stripe_count += count;
+        _durable_size += count * stripe_size();
+    }
+    return Status::OK();
+}
+
+Status EcStripeWriter::seal_chunks() {
+    Status result;
+    for (size_t i = 0; i < _chunks.size(); i++) {
+        proto::manusya::QueryAndSealChunkRequest request;
+        proto::manusya::QueryAndSealChunkResponse response;
+        common::to_proto(_chunks[i].chunk_id, request.mutable_chunk_id());
+        brpc::Controller cntl;
+        inject_tracer(&cntl);
+        proto::manusya::ManusyaService_Stub stub(_channels[i].get());
+        stub.QueryAndSealChunk(&cntl, &request, &response, nullptr);
+        auto status = check(cntl, response.header());
+        if (!status.ok()) {
+            PLOG_ERROR(("desc", "failed to seal chunk")     //
+                       ("chunk", _chunks[i].chunk_id.str()) //
+                       ("address", _chunks[i].address)      //
+                       ("errno", status.error_code())       //
+                       ("error", status.error_str()));
+            result = status;
+        }
+    }
+    return result;
+}
+
+void EcStripeWriter::remove_chunks() {
+    for (size_t i = 0; i < _chunks.size(); i++) {
+        proto::manusya::RemoveChunkRequest request;
+        proto::manusya::RemoveChunkResponse response;
+        common::to_proto(_chunks[i].chunk_id, request.mutable_chunk_id());
+        brpc::Controller cntl;
+        inject_tracer(&cntl);
+        proto::manusya::ManusyaService_Stub stub(_channels[i].get());
+        stub.RemoveChunk(&cntl, &request, &response, nullptr);
+        auto status = check(cntl, response.header());
+        if (!status.ok()) {
+            PLOG_WARN(("desc", "failed to remove chunk")   //
+                      ("chunk", _chunks[i].chunk_id.str()) //
+                      ("address", _chunks[i].address)      //
+                      ("error", status.error_str()));
+        }
+    }
+    _chunks.clear();
+    _channels.clear();
+}
+
+} // namespace pain
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <brpc/channel.h>
+#include <pain/base/object_id.h>
+#include <pain/base/types.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/erasure_code.h"
+
+namespace pain {
+
+// a chunk of a chunk group, it holds cell i of every stripe of the group back to back
+struct CellChunk {
+    std::string address;
+    ObjectId chunk_id;
+};
+
+// EcStripeWriter appends data erasure coded to a group of k + m chunks on distinct manusya.
+// Data is buffered until it fills a stripe of k cells, the stripe is encoded with m parity
+// cells on the client and the k + m cells are appended to their chunks in parallel, so the
+// data crosses the network (k + m) / k times instead of once per replica.
+//
+// append() returns once the cells of every stripe it filled are durable on all the chunks,
+// bytes left in the partial last stripe are durable when a later append fills it or seal()
+// writes it padded with zeros. A failed stripe leaves the chunks at different offsets, the
+// writer fails every append after it and the group is sealed and replaced.
+class EcStripeWriter {
+public:
+    // create a chunk in partition_id on each of the k + m manusya at addresses
+    static Status create(common::ErasureCodePtr code,
+                         uint32_t cell_size,
+                         uint32_t partition_id,
+                         const std::vector<std::string>& addresses,
+                         std::unique_ptr<EcStripeWriter>* writer);
+    ~EcStripeWriter() = default;
+    EcStripeWriter(const EcStripeWriter&) = delete;
+    EcStripeWriter& operator=(const EcStripeWriter&) = delete;
+
+    Status append(const IOBuf& data, bool direct_io);
+    // write the partial stripe and seal the chunks, the group takes no appends after it
+    Status seal(bool direct_io);
+
+    // bytes appended
+    uint64_t size() const {
+        return _durable_size + _buffer.size();
+    }
+
+    // bytes durable on all the chunks
+    uint64_t durable_size() const {
+        return _durable_size;
+    }
+
+    // bytes of each chunk, cells of the stripes written
+    uint64_t chunk_size() const {
+        return _stripe_count * _cell_size;
+    }
+
+    uint64_t stripe_size() const {
+        return static_cast<uint64_t>(_cell_size) * _code->data_count();
+    }
+
+    bool failed() const {
+        return !_status.ok();
+    }
+
+    const std::vector<CellChunk>& chunks() const {
+        return _chunks;
+    }
+
+private:
+    EcStripeWriter(common::ErasureCodePtr code, uint32_t cell_size);
+    Status open_chunk(const std::string& address, uint32_t partition_id);
+    // write stripes, a multiple of stripe_size() bytes
+    Status write_stripes(IOBuf* stripes, bool direct_io);
+    Status seal_chunks();
+    void remove_chunks();
+
+    common::ErasureCodePtr _code;
+    uint32_t _cell_size;
+    std::vector<CellChunk> _chunks;
+    std::vector<std::unique_ptr<brpc::Channel>> _channels;
+    // the partial last stripe
+    IOBuf _buffer;
+    uint64_t _durable_size = 0;
+    // stripes written, cell i of the next stripe goes to chunk i at _stripe_count * _cell_size
+    uint64_t _stripe_count = 0;
+    bool _sealed = false;
+    // the first failure, the writer takes no appends after it
+    Status _status;
+};
+
+} // namespace pain
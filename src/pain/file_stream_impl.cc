@@ -1,9 +1,24 @@
 #include "pain/file_stream_impl.h"
 #include <brpc/closure_guard.h>
 #include <brpc/controller.h>
+#include <butil/endpoint.h>
+#include <butil/fast_rand.h>
+#include <fmt/format.h>
+#include <gflags/gflags.h>
 #include <pain/base/macro.h>
 #include <pain/base/plog.h>
+#include <pain/proto/deva.pb.h>
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include "common/object_id_util.h"
 #include "pain/controller.h"
+#include "deva/sdk/rpc_client.h"
+
+DEFINE_uint32(pain_ec_data_count, 0, "Data cells of a stripe when files are written erasure coded, 0 replicates them");
+DEFINE_uint32(pain_ec_parity_count, 4, "Parity cells of a stripe when files are written erasure coded");
+DEFINE_uint32(pain_ec_cell_size, 1024 * 1024, "Bytes of a cell of an erasure coded stripe");
+DEFINE_uint64(pain_ec_chunk_size, 64 * 1024 * 1024, "Bytes of cells a chunk of an erasure coded file holds");
 
 #define FILE_STREAM_METHOD(name)                                                                                       \
     void FileStreamImpl::name(::google::protobuf::RpcController* controller,                                           \
@@ -20,16 +35,26 @@ FILE_STREAM_METHOD(Append) {
                ("file_id", _file_id)            //
                ("direct_io", cntl->direct_io()) //
                ("data_size", cntl->request_attachment().size()));
+    brpc::ClosureGuard done_guard(done);
+
+    if (_ec_code != nullptr) {
+        auto status = append_ec(cntl->request_attachment(), cntl->direct_io(), response);
+        if (!status.ok()) {
+            response->mutable_header()->set_status(status.error_code());
+            response->mutable_header()->set_message(status.error_str());
+        }
+        return;
+    }
 
     // append to chunk
     // if _chunks is empty, create a new chunk
     // if the last chunk is full(64MB), create a new chunk
     // if append timeout, seal and new chunk
     // chunk = get_last_chunk();
-    // foreach subchunk in chunk:
-    //   subchunk->append(cntl->request_attachment());
-    //   if timeout, seal and new chunk
-    brpc::ClosureGuard done_guard(done);
+    // send the append once to the first subchunk with the others as its chain, manusya
+    // forwards it down the chain and acks after all of them have appended:
+    //   chunk->sub_chunks[0]->append(cntl->request_attachment(), cntl->direct_io(), chain);
+    //   if timeout or failed, seal and new chunk
 }
 
 FILE_STREAM_METHOD(Read) {
@@ -38,4 +63,155 @@ FILE_STREAM_METHOD(Read) {
     brpc::ClosureGuard done_guard(done);
 }
 
+FileStreamImpl::~FileStreamImpl() {
+    std::lock_guard lock(_mutex);
+    if (_ec_writer != nullptr) {
+        // the partial last stripe is written with O_DIRECT like appends are by default
+        std::ignore = seal_ec_chunk(true);
+    }
+}
+
+Status FileStreamImpl::append_ec(const IOBuf& data, bool direct_io, proto::AppendResponse* response) {
+    std::lock_guard lock(_mutex);
+    response->set_offset(_size);
+    IOBuf rest = data;
+    Status status;
+    while (!rest.empty()) {
+        if (_ec_writer == nullptr || _ec_writer->size() == _ec_group_size) {
+            status = new_ec_chunk(direct_io);
+            if (!status.ok()) {
+                break;
+            }
+        }
+        IOBuf piece;
+        rest.cutn(&piece, std::min<uint64_t>(rest.size(), _ec_group_size - _ec_writer->size()));
+        auto size = piece.size();
+        status = _ec_writer->append(piece, direct_io);
+        if (!status.ok()) {
+            // the cells are at different offsets now, the next append goes to a new group
+            std::ignore = seal_ec_chunk(direct_io);
+            break;
+        }
+        _size += size;
+    }
+    // the partial last stripe stays buffered in the open group, only whole stripes are durable
+    response->set_durable_size(_sealed_size + (_ec_writer != nullptr ? _ec_writer->durable_size() : 0));
+    return status;
+}
+
+Status FileStreamImpl::new_ec_chunk(bool direct_io) {
+    if (_ec_writer != nullptr) {
+        std::ignore = seal_ec_chunk(direct_io);
+    }
+
+    proto::deva::ListManusyaRequest request;
+    proto::deva::ListManusyaResponse response;
+    auto s = deva::call_rpc("default", &proto::deva::DevaService::Stub::ListManusya, &request, &response);
+    if (!s.ok()) {
+        return Status(s.error_code(), s.error_str());
+    }
+    if (response.header().status() != 0) {
+        return Status(response.header().status(), response.header().message());
+    }
+    std::vector<std::string> alive;
+    for (const auto& manusya : response.manusya_descriptors()) {
+        if (manusya.is_alive()) {
+            alive.push_back(fmt::format("{}:{}", manusya.manusya_id().ip(), manusya.manusya_id().port()));
+        }
+    }
+    // cells of a stripe must not share a manusya, or losing one loses several of them
+    auto count = _ec_code->fragment_count();
+    if (alive.size() < count) {
+        return Status(ENOSPC, fmt::format("{} manusya for {} cells", alive.size(), count));
+    }
+    std::vector<std::string> addresses;
+    auto first = butil::fast_rand_less_than(alive.size());
+    for (uint32_t i = 0; i < count; i++) {
+        addresses.push_back(alive[(first + i) % alive.size()]);
+    }
+
+    auto cell_size = FLAGS_pain_ec_cell_size;
+    auto partition_id = _file_info.file_id().partition_id();
+    auto status = EcStripeWriter::create(_ec_code, cell_size, partition_id, addresses, &_ec_writer);
+    if (!status.ok()) {
+        return status;
+    }
+    _ec_group_size = std::max<uint64_t>(1, FLAGS_pain_ec_chunk_size / cell_size) * _ec_writer->stripe_size();
+
+    // the group is recorded in the file before data goes to it, the length of an open group is
+    // recovered from its chunks like that of a replicated chunk
+    Chunk chunk;
+    chunk.index = _chunks.size();
+    chunk.uuid = UUID::generate();
+    chunk.chunk_state = ChunkState::kOpen;
+    chunk.chunk_type = ChunkType::kEc;
+    chunk.m = _ec_code->data_count();
+    chunk.n = _ec_code->parity_count();
+    for (const auto& cell_chunk : _ec_writer->chunks()) {
+        SubChunk sub_chunk;
+        sub_chunk.uuid = cell_chunk.chunk_id.uuid();
+        sub_chunk.size = 0;
+        butil::str2endpoint(cell_chunk.address.c_str(), &sub_chunk.location.end_point);
+        chunk.sub_chunks.push_back(sub_chunk);
+    }
+    status = check_in_ec_chunk(chunk, _sealed_size);
+    if (!status.ok()) {
+        PLOG_ERROR(("desc", "failed to check in chunk")("file_id", _file_id)("error", status.error_str()));
+        // nothing is written to a group the file doesn't know
+        std::ignore = _ec_writer->seal(direct_io);
+        _ec_writer.reset();
+        return status;
+    }
+    _chunks.push_back(std::move(chunk));
+    PLOG_DEBUG(("desc", "new erasure coded chunk")("file_id", _file_id)("index", _chunks.back().index));
+    return Status::OK();
+}
+
+Status FileStreamImpl::seal_ec_chunk(bool direct_io) {
+    auto status = _ec_writer->seal(direct_io);
+    auto& chunk = _chunks.back();
+    chunk.chunk_state = ChunkState::kSealed;
+    for (auto& sub_chunk : chunk.sub_chunks) {
+        sub_chunk.size = _ec_writer->chunk_size();
+    }
+    // bytes buffered in a failed group are lost, they were never reported durable and the file
+    // goes on after the durable ones
+    _sealed_size += _ec_writer->durable_size();
+    _size = _sealed_size;
+    auto check_in_status = check_in_ec_chunk(chunk, _sealed_size - _ec_writer->durable_size());
+    _ec_writer.reset();
+    return status.ok() ? check_in_status : status;
+}
+
+Status FileStreamImpl::check_in_ec_chunk(const Chunk& chunk, uint64_t offset) {
+    proto::deva::CheckInChunkRequest request;
+    proto::deva::CheckInChunkResponse response;
+    request.mutable_file_id()->CopyFrom(_file_info.file_id());
+    auto* chunk_info = request.mutable_chunk_info();
+    common::to_proto(ObjectId(_file_info.file_id().partition_id(), chunk.uuid), chunk_info->mutable_chunk_id());
+    chunk_info->set_index(chunk.index);
+    chunk_info->set_offset(offset);
+    chunk_info->set_length(chunk.chunk_state == ChunkState::kSealed ? _ec_writer->durable_size() : 0);
+    chunk_info->set_state(chunk.chunk_state == ChunkState::kSealed ? proto::ChunkState::CHUNK_STATE_SEALED
+                                                                   : proto::ChunkState::CHUNK_STATE_CHECKIN);
+    chunk_info->set_type(proto::ChunkType::CHUNK_TYPE_EC);
+    chunk_info->mutable_config()->set_replica_count(chunk.m);
+    chunk_info->mutable_config()->set_parity_count(chunk.n);
+    for (const auto& cell_chunk : _ec_writer->chunks()) {
+        auto* replica = chunk_info->add_replicas();
+        common::to_proto(cell_chunk.chunk_id.uuid(), replica->mutable_chunk_id());
+        replica->set_length(_ec_writer->chunk_size());
+        replica->mutable_location()->set_uri(cell_chunk.address);
+    }
+
+    auto s = deva::call_rpc("default", &proto::deva::DevaService::Stub::CheckInChunk, &request, &response);
+    if (!s.ok()) {
+        return Status(s.error_code(), s.error_str());
+    }
+    if (response.header().status() != 0) {
+        return Status(response.header().status(), response.header().message());
+    }
+    return Status::OK();
+}
+
 } // namespace pain
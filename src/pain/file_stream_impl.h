@@ -1,8 +1,12 @@
 #pragma once
+#include <bthread/mutex.h>
 #include <list>
+#include <memory>
 
+#include <pain/base/types.h>
 #include <pain/base/uuid.h>
 #include "pain/chunk.h"
+#include "pain/ec_stripe_writer.h"
 #include "pain/proto/common.pb.h"
 #include "pain/proto/pain.pb.h"
 
@@ -24,9 +28,26 @@ public:
 
 private:
     friend class FileSystem;
-    ~FileStreamImpl() override = default;
+    ~FileStreamImpl() override;
+    Status append_ec(const IOBuf& data, bool direct_io, proto::AppendResponse* response);
+    // seal the chunk group being written and open a new one on distinct manusya
+    Status new_ec_chunk(bool direct_io);
+    Status seal_ec_chunk(bool direct_io);
+    // record the chunk group of the writer at offset of the file in deva, again once sealed
+    Status check_in_ec_chunk(const Chunk& chunk, uint64_t offset);
+
     proto::FileInfo _file_info;
     std::string _file_id;
+    bthread::Mutex _mutex;
+    std::list<Chunk> _chunks;
+    uint64_t _size = 0;
+    // bytes of the chunk groups sealed
+    uint64_t _sealed_size = 0;
+    // set for files written erasure coded
+    common::ErasureCodePtr _ec_code;
+    std::unique_ptr<EcStripeWriter> _ec_writer;
+    // bytes of data a chunk group of the writer holds
+    uint64_t _ec_group_size = 0;
     friend class FileStream;
 };
 
@@ -7,8 +7,12 @@
 #include <pain/proto/asura.pb.h>
 #include <pain/proto/deva.pb.h>
 #include <fmt/format.h>
+#include <gflags/gflags.h>
 #include "deva/sdk/rpc_client.h"
 
+DECLARE_uint32(pain_ec_data_count);
+DECLARE_uint32(pain_ec_parity_count);
+
 namespace pain {
 
 class FileSystemImpl {
@@ -101,8 +105,17 @@ Status FileSystem::open(const char* path, int flags, FileStream** file_stream) {
 
     PLOG_DEBUG(("desc", "open file")("file_info", response.file_info().DebugString()));
 
+    common::ErasureCodePtr ec_code;
+    if (FLAGS_pain_ec_data_count != 0) {
+        status = common::ErasureCode::create(FLAGS_pain_ec_data_count, FLAGS_pain_ec_parity_count, &ec_code);
+        if (!status.ok()) {
+            return status;
+        }
+    }
+
     auto file_info = response.file_info();
     auto file_stream_impl = new FileStreamImpl();
+    file_stream_impl->_ec_code = std::move(ec_code);
     file_stream_impl->_file_info = file_info;
     UUID uuid(file_info.file_id().uuid().high(), file_info.file_id().uuid().low());
     ObjectId id(file_info.file_id().partition_id(), uuid);
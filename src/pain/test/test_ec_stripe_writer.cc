@@ -0,0 +1,218 @@
+#include <brpc/closure_guard.h>
+#include <brpc/controller.h>
+#include <brpc/server.h>
+#include <gtest/gtest.h>
+#include <pain/base/object_id.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include "pain/proto/manusya.pb.h"
+#include "common/erasure_code.h"
+#include "common/object_id_util.h"
+#include "pain/ec_stripe_writer.h"
+
+// NOLINTBEGIN(readability-magic-numbers)
+namespace {
+using namespace pain;
+
+// 内存中的 manusya：只实现写入纠删码分组用到的接口
+// NOLINTNEXTLINE(cppcoreguidelines-virtual-class-destructor)
+class FakeManusya : public proto::manusya::ManusyaService {
+public:
+    struct FakeChunk {
+        std::string data;
+        bool sealed = false;
+    };
+
+    void CreateChunk([[maybe_unused]] google::protobuf::RpcController* controller,
+                     const proto::manusya::CreateChunkRequest* request,
+                     proto::manusya::CreateChunkResponse* response,
+                     google::protobuf::Closure* done) override {
+        brpc::ClosureGuard done_guard(done);
+        std::lock_guard lock(mutex);
+        auto chunk_id = ObjectId::generate(request->partition_id());
+        chunks[chunk_id.str()] = FakeChunk();
+        common::to_proto(chunk_id, response->mutable_chunk_id());
+    }
+
+    void AppendChunk(google::protobuf::RpcController* controller,
+                     const proto::manusya::AppendChunkRequest* request,
+                     proto::manusya::AppendChunkResponse* response,
+                     google::protobuf::Closure* done) override {
+        brpc::ClosureGuard done_guard(done);
+        auto* cntl = static_cast<brpc::Controller*>(controller);
+        std::lock_guard lock(mutex);
+        auto& chunk = chunks[common::from_proto(request->chunk_id()).str()];
+        if (fail_appends) {
+            response->mutable_header()->set_status(EIO);
+            response->mutable_header()->set_message("injected failure");
+            return;
+        }
+        if (chunk.sealed || request->offset() != chunk.data.size()) {
+            response->mutable_header()->set_status(EINVAL);
+            response->mutable_header()->set_message("invalid offset");
+            return;
+        }
+        chunk.data.append(cntl->request_attachment().to_string());
+        response->set_offset(chunk.data.size());
+    }
+
+    void QueryAndSealChunk([[maybe_unused]] google::protobuf::RpcController* controller,
+                           const proto::manusya::QueryAndSealChunkRequest* request,
+                           proto::manusya::QueryAndSealChunkResponse* response,
+                           google::protobuf::Closure* done) override {
+        brpc::ClosureGuard done_guard(done);
+        std::lock_guard lock(mutex);
+        auto& chunk = chunks[common::from_proto(request->chunk_id()).str()];
+        chunk.sealed = true;
+        response->set_size(chunk.data.size());
+    }
+
+    void RemoveChunk([[maybe_unused]] google::protobuf::RpcController* controller,
+                     const proto::manusya::RemoveChunkRequest* request,
+                     [[maybe_unused]] proto::manusya::RemoveChunkResponse* response,
+                     google::protobuf::Closure* done) override {
+        brpc::ClosureGuard done_guard(done);
+        std::lock_guard lock(mutex);
+        chunks.erase(common::from_proto(request->chunk_id()).str());
+    }
+
+    FakeChunk chunk(const ObjectId& chunk_id) {
+        std::lock_guard lock(mutex);
+        return chunks[chunk_id.str()];
+    }
+
+    std::mutex mutex;
+    std::map<std::string, FakeChunk> chunks;
+    std::atomic<bool> fail_appends = false;
+};
+
+class TestEcStripeWriter : public ::testing::Test {
+protected:
+    static constexpr uint32_t kCellSize = 4096;
+
+    void SetUp() override {
+        ASSERT_TRUE(common::ErasureCode::create(2, 1, &_code).ok());
+        for (int i = 0; i < 3; i++) {
+            auto address = fmt::format("127.0.0.1:{}", 8300 + i);
+            _manusya.push_back(std::make_unique<FakeManusya>());
+            _servers.push_back(std::make_unique<brpc::Server>());
+            ASSERT_EQ(_servers.back()->AddService(_manusya.back().get(), brpc::SERVER_DOESNT_OWN_SERVICE), 0);
+            ASSERT_EQ(_servers.back()->Start(address.c_str(), nullptr), 0);
+            _addresses.push_back(address);
+        }
+        auto status = EcStripeWriter::create(_code, kCellSize, 0, _addresses, &_writer);
+        ASSERT_TRUE(status.ok()) << status.error_str();
+    }
+
+    void TearDown() override {
+        _writer.reset();
+        for (auto& server : _servers) {
+            server->Stop(0);
+            server->Join();
+        }
+    }
+
+    // 第 i 个分片所在 manusya 上的数据
+    FakeManusya::FakeChunk cell_chunk(size_t i) {
+        return _manusya[i]->chunk(_writer->chunks()[i].chunk_id);
+    }
+
+    static std::string make_data(size_t size) {
+        std::string data;
+        for (size_t i = 0; i < size; i++) {
+            data.push_back(static_cast<char>('a' + i % 26));
+        }
+        return data;
+    }
+
+    static IOBuf to_iobuf(const std::string& data) {
+        IOBuf buf;
+        buf.append(data);
+        return buf;
+    }
+
+    common::ErasureCodePtr _code;
+    std::vector<std::unique_ptr<FakeManusya>> _manusya;
+    std::vector<std::unique_ptr<brpc::Server>> _servers;
+    std::vector<std::string> _addresses;
+    std::unique_ptr<EcStripeWriter> _writer;
+};
+
+TEST_F(TestEcStripeWriter, AppendWholeStripes) {
+    auto data = make_data(2 * _writer->stripe_size());
+    auto status = _writer->append(to_iobuf(data), false);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    ASSERT_EQ(_writer->durable_size(), data.size());
+    ASSERT_EQ(_writer->chunk_size(), 2 * kCellSize);
+
+    // 数据分片依次保存每个条带的第 i 个单元
+    ASSERT_EQ(cell_chunk(0).data, data.substr(0, kCellSize) + data.substr(2 * kCellSize, kCellSize));
+    ASSERT_EQ(cell_chunk(1).data, data.substr(kCellSize, kCellSize) + data.substr(3 * kCellSize, kCellSize));
+    ASSERT_EQ(cell_chunk(2).data.size(), 2 * kCellSize);
+}
+
+TEST_F(TestEcStripeWriter, PartialStripeIsDurableAfterSeal) {
+    auto data = make_data(kCellSize + 1000);
+    auto status = _writer->append(to_iobuf(data), false);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    // 不完整的条带只在客户端内存中
+    ASSERT_EQ(_writer->size(), data.size());
+    ASSERT_EQ(_writer->durable_size(), 0);
+    ASSERT_TRUE(cell_chunk(0).data.empty());
+
+    status = _writer->seal(false);
+    ASSERT_TRUE(status.ok()) << status.error_str();
+    // 补零写入后，填充部分不计入数据大小
+    ASSERT_EQ(_writer->durable_size(), data.size());
+    ASSERT_EQ(_writer->chunk_size(), kCellSize);
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(cell_chunk(i).sealed);
+        ASSERT_EQ(cell_chunk(i).data.size(), kCellSize);
+    }
+    ASSERT_EQ(cell_chunk(0).data, data.substr(0, kCellSize));
+    ASSERT_EQ(cell_chunk(1).data, data.substr(kCellSize) + std::string(kCellSize - 1000, '\0'));
+
+    // 封存后不再接受写入
+    ASSERT_EQ(_writer->append(to_iobuf("x"), false).error_code(), EPERM);
+}
+
+TEST_F(TestEcStripeWriter, FailedStripeFailsWriter) {
+    auto data = make_data(_writer->stripe_size());
+    ASSERT_TRUE(_writer->append(to_iobuf(data), false).ok());
+
+    _manusya[1]->fail_appends = true;
+    auto status = _writer->append(to_iobuf(data), false);
+    ASSERT_EQ(status.error_code(), EIO);
+    ASSERT_TRUE(_writer->failed());
+    // 失败的条带不计入持久化的大小
+    ASSERT_EQ(_writer->durable_size(), data.size());
+    ASSERT_EQ(_writer->chunk_size(), kCellSize);
+
+    // 之后的写入和封存都返回第一次的错误，不完整的条带也不再补零写入
+    _manusya[1]->fail_appends = false;
+    ASSERT_EQ(_writer->append(to_iobuf("x"), false).error_code(), EIO);
+    ASSERT_EQ(_writer->seal(false).error_code(), EIO);
+    ASSERT_EQ(_writer->durable_size(), data.size());
+    ASSERT_EQ(cell_chunk(1).data.size(), kCellSize);
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(cell_chunk(i).sealed);
+    }
+}
+
+TEST_F(TestEcStripeWriter, FailedPaddingIsNotDurable) {
+    auto data = make_data(1000);
+    ASSERT_TRUE(_writer->append(to_iobuf(data), false).ok());
+
+    _manusya[2]->fail_appends = true;
+    ASSERT_EQ(_writer->seal(false).error_code(), EIO);
+    ASSERT_EQ(_writer->durable_size(), 0);
+    ASSERT_EQ(_writer->chunk_size(), 0);
+}
+
+} // namespace
+// NOLINTEND(readability-magic-numbers)
@@ -1,9 +1,16 @@
 #include <brpc/channel.h>
 #include <brpc/controller.h>
+#include <brpc/stream.h>
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
 #include <butil/guid.h>
 #include <butil/status.h>
 #include <json2pb/pb_to_json.h>
+#include <arpa/inet.h>
+#include <algorithm>
 #include <fstream>
+#include <mutex>
+#include <vector>
 #include <fmt/format.h>
 #include <argparse/argparse.hpp>
 
@@ -11,6 +18,7 @@
 #include <pain/base/tracer.h>
 #include <pain/base/types.h>
 #include "pain/proto/manusya.pb.h"
+#include "common/crc32c.h"
 #include "common/object_id_util.h"
 #include "sad/common.h"
 #include "sad/macro.h"
@@ -99,6 +107,12 @@ REGISTER_MANUSYA_CMD(append_chunk, [](argparse::ArgumentParser& parser) {
     // NOLINTNEXTLINE(modernize-use-nullptr)
     parser.add_argument("-o", "--offset").default_value(0UL).help("offset to append data").scan<'i', uint64_t>();
     parser.add_argument("-d", "--data").required().help("data to append");
+    parser.add_argument("--direct-io").default_value(false).implicit_value(true).help("bypass page cache of manusya");
+    parser.add_argument("--chain")
+        .default_value(std::vector<std::string>{})
+        .append()
+        .help("replicas the data is forwarded to in order, such as 127.0.0.1:8004,<chunk uuid>");
+    parser.add_argument("--tenant").default_value(std::string("")).help("tenant the io is scheduled for");
 });
 COMMAND(append_chunk) {
     SPAN(span);
@@ -106,6 +120,9 @@ COMMAND(append_chunk) {
     auto host = args.get<std::string>("--host");
     auto data = args.get<std::string>("--data");
     auto offset = args.get<uint64_t>("--offset");
+    auto direct_io = args.get<bool>("--direct-io");
+    auto chain = args.get<std::vector<std::string>>("--chain");
+    auto tenant = args.get<std::string>("--tenant");
 
     if (!pain::ObjectId::valid(chunk_id)) {
         return Status(EINVAL, fmt::format("Invalid chunk id: {}", chunk_id));
@@ -128,8 +145,20 @@ COMMAND(append_chunk) {
 
     auto id = pain::ObjectId::from_str_or_die(chunk_id);
     request.set_offset(offset);
+    request.set_direct_io(direct_io);
+    request.mutable_io_tag()->set_tenant(tenant);
     common::to_proto(id, request.mutable_chunk_id());
+    for (const auto& replica : chain) {
+        auto pos = replica.rfind(',');
+        if (pos == std::string::npos || !pain::ObjectId::valid(replica.substr(pos + 1))) {
+            return Status(EINVAL, fmt::format("Invalid replica: {}", replica));
+        }
+        auto* next = request.add_chain();
+        next->set_address(replica.substr(0, pos));
+        common::to_proto(pain::ObjectId::from_str_or_die(replica.substr(pos + 1)), next->mutable_chunk_id());
+    }
     cntl.request_attachment().append(data);
+    request.set_crc32(common::crc32c(cntl.request_attachment()));
     stub.AppendChunk(&cntl, &request, &response, nullptr);
     if (cntl.Failed()) {
         return Status(cntl.ErrorCode(), cntl.ErrorText());
@@ -198,6 +227,11 @@ REGISTER_MANUSYA_CMD(read_chunk, [](argparse::ArgumentParser& parser) {
     parser.add_argument("--offset").default_value(0UL).help("offset to read data").scan<'i', uint64_t>();
     parser.add_argument("-l", "--length").default_value(1024U).help("length to read data").scan<'i', uint32_t>();
     parser.add_argument("-o", "--output").default_value(std::string("-"));
+    parser.add_argument("--tenant").default_value(std::string("")).help("tenant the io is scheduled for");
+    parser.add_argument("--latency")
+        .default_value(false)
+        .implicit_value(true)
+        .help("schedule the read ahead of other ios of manusya");
 });
 COMMAND(read_chunk) {
     SPAN(span);
@@ -206,6 +240,8 @@ COMMAND(read_chunk) {
     auto offset = args.get<uint64_t>("--offset");
     auto length = args.get<uint32_t>("--length");
     auto output = args.get<std::string>("--output");
+    auto tenant = args.get<std::string>("--tenant");
+    auto latency = args.get<bool>("--latency");
 
     if (!pain::ObjectId::valid(chunk_id)) {
         return Status(EINVAL, fmt::format("Invalid chunk id: {}", chunk_id));
@@ -230,11 +266,18 @@ COMMAND(read_chunk) {
 
     request.set_offset(offset);
     request.set_length(length);
+    request.mutable_io_tag()->set_tenant(tenant);
+    if (latency) {
+        request.mutable_io_tag()->set_io_class(pain::proto::IoClass::IO_CLASS_LATENCY);
+    }
     common::to_proto(id, request.mutable_chunk_id());
     stub.ReadChunk(&cntl, &request, &response, nullptr);
     if (cntl.Failed()) {
         return Status(cntl.ErrorCode(), cntl.ErrorText());
     }
+    if (common::crc32c(cntl.response_attachment()) != response.crc32()) {
+        return Status(EBADMSG, "checksum mismatch of read data");
+    }
 
     print(cntl, &response);
 
@@ -370,4 +413,367 @@ COMMAND(query_chunk) {
     return Status::OK();
 }
 
+namespace {
+// collects cumulative acks sent back over a chunk stream
+class ChunkStreamAcks : public brpc::StreamInputHandler {
+public:
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override {
+        std::ignore = id;
+        std::lock_guard lock(_mutex);
+        for (size_t i = 0; i < size; ++i) {
+            pain::proto::manusya::ChunkStreamAck ack;
+            if (!ack.ParseFromString(messages[i]->to_string())) {
+                _status = Status(EBADMSG, "invalid ack of chunk stream");
+            } else if (ack.header().status() != 0) {
+                _status = Status(ack.header().status(), ack.header().message());
+            } else {
+                _offset = std::max(_offset, ack.offset());
+            }
+        }
+        _cond.notify_all();
+        return 0;
+    }
+
+    void on_idle_timeout(brpc::StreamId id) override {
+        std::ignore = id;
+    }
+
+    void on_closed(brpc::StreamId id) override {
+        std::ignore = id;
+        std::lock_guard lock(_mutex);
+        _closed = true;
+        _cond.notify_all();
+    }
+
+    // wait until data before offset is acked, or the stream fails
+    Status wait(uint64_t offset) {
+        std::unique_lock lock(_mutex);
+        while (_status.ok() && _offset < offset && !_closed) {
+            _cond.wait(lock);
+        }
+        if (!_status.ok()) {
+            return _status;
+        }
+        if (_offset < offset) {
+            return Status(EPIPE, fmt::format("stream closed at offset {}", _offset));
+        }
+        return Status::OK();
+    }
+
+    // wait until the stream is closed, the handler must outlive it
+    void join() {
+        std::unique_lock lock(_mutex);
+        while (!_closed) {
+            _cond.wait(lock);
+        }
+    }
+
+private:
+    uint64_t _offset = 0;
+    Status _status;
+    bool _closed = false;
+    bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+};
+} // namespace
+
+REGISTER_MANUSYA_CMD(stream_append_chunk, [](argparse::ArgumentParser& parser) {
+    parser.add_description("append a file to chunk over a stream");
+    parser.add_argument("-c", "--chunk-id").required().help("chunk uuid, such as 123e4567-e89b-12d3-a456-426655440000");
+    // NOLINTNEXTLINE(modernize-use-nullptr)
+    parser.add_argument("-o", "--offset").default_value(0UL).help("offset to append data").scan<'i', uint64_t>();
+    parser.add_argument("-i", "--input").required().help("file to append");
+    parser.add_argument("--block-size")
+        .default_value(1024U * 1024U) // NOLINT(readability-magic-numbers)
+        .help("bytes of each stream message")
+        .scan<'i', uint32_t>();
+    parser.add_argument("--direct-io").default_value(false).implicit_value(true).help("bypass page cache of manusya");
+});
+COMMAND(stream_append_chunk) {
+    SPAN(span);
+    auto chunk_id = args.get<std::string>("--chunk-id");
+    auto host = args.get<std::string>("--host");
+    auto offset = args.get<uint64_t>("--offset");
+    auto input = args.get<std::string>("--input");
+    auto block_size = args.get<uint32_t>("--block-size");
+    auto direct_io = args.get<bool>("--direct-io");
+
+    if (!pain::ObjectId::valid(chunk_id)) {
+        return Status(EINVAL, fmt::format("Invalid chunk id: {}", chunk_id));
+    }
+    if (block_size == 0) {
+        return Status(EINVAL, "block size must be positive");
+    }
+    std::ifstream ifs(input, std::ios::binary);
+    if (!ifs) {
+        return Status(ENOENT, fmt::format("Fail to open {}", input));
+    }
+
+    brpc::Channel channel;
+    brpc::ChannelOptions options;
+    options.connect_timeout_ms = 2000; // NOLINT(readability-magic-numbers)
+    options.timeout_ms = 10000;        // NOLINT(readability-magic-numbers)
+    options.max_retry = 0;
+    if (channel.Init(host.c_str(), &options) != 0) {
+        return Status(EAGAIN, "Fail to initialize channel");
+    }
+
+    brpc::Controller cntl;
+    pain::proto::manusya::OpenChunkStreamRequest request;
+    pain::proto::manusya::OpenChunkStreamResponse response;
+    pain::proto::manusya::ManusyaService_Stub stub(&channel);
+    inject_tracer(&cntl);
+
+    ChunkStreamAcks acks;
+    brpc::StreamOptions stream_options;
+    stream_options.handler = &acks;
+    brpc::StreamId stream_id = brpc::INVALID_STREAM_ID;
+    if (brpc::StreamCreate(&stream_id, cntl, &stream_options) != 0) {
+        return Status(EIO, "Fail to create stream");
+    }
+
+    auto id = pain::ObjectId::from_str_or_die(chunk_id);
+    request.set_offset(offset);
+    request.set_direct_io(direct_io);
+    common::to_proto(id, request.mutable_chunk_id());
+    stub.OpenChunkStream(&cntl, &request, &response, nullptr);
+    Status status;
+    if (cntl.Failed()) {
+        status = Status(cntl.ErrorCode(), cntl.ErrorText());
+    } else if (response.header().status() != 0) {
+        status = Status(response.header().status(), response.header().message());
+    }
+
+    // write continuously, waiting only when the stream buffer is full
+    uint64_t end = offset;
+    std::string block(block_size, '\0');
+    while (status.ok() && ifs) {
+        ifs.read(block.data(), block.size());
+        auto n = static_cast<size_t>(ifs.gcount());
+        if (n == 0) {
+            break;
+        }
+        butil::IOBuf buf;
+        buf.append(block.data(), n);
+        int rc = 0;
+        while ((rc = brpc::StreamWrite(stream_id, buf)) == EAGAIN) {
+            brpc::StreamWait(stream_id, nullptr);
+        }
+        if (rc != 0) {
+            // manusya closes the stream after a failed append, the ack tells why
+            status = acks.wait(end + n);
+            if (status.ok()) {
+                status = Status(rc, "Fail to write stream");
+            }
+            break;
+        }
+        end += n;
+    }
+    if (status.ok()) {
+        status = acks.wait(end);
+    }
+    brpc::StreamClose(stream_id);
+    acks.join();
+    if (!status.ok()) {
+        return status;
+    }
+
+    print(cntl, &response, [&](Json& out) {
+        out["offset"] = end;
+        out["bytes"] = end - offset;
+    });
+    return Status::OK();
+}
+
+namespace {
+// receives segments of a chunk read stream, writes them out and grants a credit back for each
+class ChunkReadSegments : public brpc::StreamInputHandler {
+public:
+    ChunkReadSegments(uint64_t offset, std::ostream* out) : _offset(offset), _out(out) {}
+
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override {
+        std::lock_guard lock(_mutex);
+        for (size_t i = 0; i < size && _status.ok() && !_eof; ++i) {
+            _status = consume(messages[i]);
+        }
+        if (_status.ok() && !_eof) {
+            pain::proto::manusya::ChunkReadCredit credit;
+            credit.set_credits(static_cast<uint32_t>(size));
+            butil::IOBuf buf;
+            buf.append(credit.SerializeAsString());
+            brpc::StreamWrite(id, buf);
+        }
+        _cond.notify_all();
+        return 0;
+    }
+
+    void on_idle_timeout(brpc::StreamId id) override {
+        std::ignore = id;
+    }
+
+    void on_closed(brpc::StreamId id) override {
+        std::ignore = id;
+        std::lock_guard lock(_mutex);
+        _closed = true;
+        _cond.notify_all();
+    }
+
+    // wait until the stream ends, offset is where the data received ends
+    Status wait(uint64_t* offset, bool* eof) {
+        std::unique_lock lock(_mutex);
+        while (_status.ok() && !_eof && !_closed) {
+            _cond.wait(lock);
+        }
+        *offset = _offset;
+        *eof = _eof;
+        return _status;
+    }
+
+    void join() {
+        std::unique_lock lock(_mutex);
+        while (!_closed) {
+            _cond.wait(lock);
+        }
+    }
+
+private:
+    Status consume(butil::IOBuf* message) {
+        uint32_t len = 0;
+        if (message->cutn(&len, sizeof(len)) != sizeof(len)) {
+            return Status(EBADMSG, "truncated segment");
+        }
+        len = ntohl(len);
+        butil::IOBuf header;
+        pain::proto::manusya::ChunkReadSegment segment;
+        if (message->cutn(&header, len) != len || !segment.ParseFromString(header.to_string())) {
+            return Status(EBADMSG, "invalid segment");
+        }
+        if (segment.header().status() != 0) {
+            return Status(segment.header().status(), segment.header().message());
+        }
+        if (segment.offset() != _offset || message->size() != segment.length()) {
+            return Status(EBADMSG, fmt::format("unexpected segment at offset {}", segment.offset()));
+        }
+        if (common::crc32c(*message) != segment.crc32()) {
+            return Status(EBADMSG, "checksum mismatch of read data");
+        }
+        *_out << *message;
+        _offset += segment.length();
+        _eof = segment.eof();
+        return Status::OK();
+    }
+
+    uint64_t _offset;
+    std::ostream* _out;
+    Status _status;
+    bool _eof = false;
+    bool _closed = false;
+    bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+};
+} // namespace
+
+REGISTER_MANUSYA_CMD(stream_read_chunk, [](argparse::ArgumentParser& parser) {
+    parser.add_description("read a large range of chunk over a stream");
+    parser.add_argument("-c", "--chunk-id").required().help("chunk uuid, such as 123e4567-e89b-12d3-a456-426655440000");
+    // NOLINTNEXTLINE(modernize-use-nullptr)
+    parser.add_argument("--offset").default_value(0UL).help("offset to read data").scan<'i', uint64_t>();
+    parser.add_argument("-l", "--length")
+        .default_value(UINT64_MAX)
+        .help("length to read data, up to the end of chunk by default")
+        .scan<'i', uint64_t>();
+    parser.add_argument("--segment-size").default_value(0U).help("bytes of each segment").scan<'i', uint32_t>();
+    parser.add_argument("--credits").default_value(8U).help("segments in flight").scan<'i', uint32_t>();
+    parser.add_argument("--retries")
+        .default_value(3U)
+        .help("times to resume an interrupted read")
+        .scan<'i', uint32_t>();
+    parser.add_argument("-o", "--output").default_value(std::string("-"));
+});
+COMMAND(stream_read_chunk) {
+    SPAN(span);
+    auto chunk_id = args.get<std::string>("--chunk-id");
+    auto host = args.get<std::string>("--host");
+    auto offset = args.get<uint64_t>("--offset");
+    auto length = args.get<uint64_t>("--length");
+    auto segment_size = args.get<uint32_t>("--segment-size");
+    auto credits = args.get<uint32_t>("--credits");
+    auto retries = args.get<uint32_t>("--retries");
+    auto output = args.get<std::string>("--output");
+
+    if (!pain::ObjectId::valid(chunk_id)) {
+        return Status(EINVAL, fmt::format("Invalid chunk id: {}", chunk_id));
+    }
+    if (credits == 0) {
+        return Status(EINVAL, "credits must be positive");
+    }
+    std::ofstream ofs;
+    if (output != "-") {
+        ofs.open(output, std::ios::binary);
+    }
+    std::ostream* out = output == "-" ? &std::cout : &ofs;
+
+    brpc::Channel channel;
+    brpc::ChannelOptions options;
+    options.connect_timeout_ms = 2000; // NOLINT(readability-magic-numbers)
+    options.timeout_ms = 10000;        // NOLINT(readability-magic-numbers)
+    options.max_retry = 0;
+    if (channel.Init(host.c_str(), &options) != 0) {
+        return Status(EAGAIN, "Fail to initialize channel");
+    }
+    auto id = pain::ObjectId::from_str_or_die(chunk_id);
+    auto end = length > UINT64_MAX - offset ? UINT64_MAX : offset + length;
+
+    // a stream interrupted before eof is resumed from the offset received
+    uint64_t current = offset;
+    Status status;
+    for (uint32_t attempt = 0; attempt <= retries; ++attempt) {
+        brpc::Controller cntl;
+        pain::proto::manusya::OpenChunkReadStreamRequest request;
+        pain::proto::manusya::OpenChunkReadStreamResponse response;
+        pain::proto::manusya::ManusyaService_Stub stub(&channel);
+        inject_tracer(&cntl);
+
+        ChunkReadSegments segments(current, out);
+        brpc::StreamOptions stream_options;
+        stream_options.handler = &segments;
+        brpc::StreamId stream_id = brpc::INVALID_STREAM_ID;
+        if (brpc::StreamCreate(&stream_id, cntl, &stream_options) != 0) {
+            return Status(EIO, "Fail to create stream");
+        }
+
+        common::to_proto(id, request.mutable_chunk_id());
+        request.set_offset(current);
+        request.set_length(end - current);
+        request.set_segment_size(segment_size);
+        request.set_credits(credits);
+        stub.OpenChunkReadStream(&cntl, &request, &response, nullptr);
+        bool eof = false;
+        if (cntl.Failed()) {
+            status = Status(cntl.ErrorCode(), cntl.ErrorText());
+        } else if (response.header().status() != 0) {
+            status = Status(response.header().status(), response.header().message());
+        } else {
+            status = segments.wait(&current, &eof);
+        }
+        brpc::StreamClose(stream_id);
+        segments.join();
+        if (status.ok() && eof) {
+            break;
+        }
+        if (status.ok()) {
+            status = Status(EPIPE, fmt::format("stream closed at offset {}", current));
+        }
+        if (response.header().status() != 0 || status.error_code() == EBADMSG) {
+            break;
+        }
+    }
+    out->flush();
+    if (!status.ok()) {
+        return status;
+    }
+    std::cerr << fmt::format("read {} bytes from offset {}\n", current - offset, offset);
+    return Status::OK();
+}
+
 } // namespace pain::sad::manusya